@@ -1,4 +1,6 @@
 
+#include <algorithm>
+#include <functional>
 #include <vector>
 #include <tuple>
 #include <cmath>
@@ -7,15 +9,27 @@
 #include <CLI/CLI.hpp>
 
 #include <sigproc/io.hpp>
+#include <sigproc/parallel.hpp>
+#include <sigproc/prefetch.hpp>
+#include <sigproc/stats.hpp>
 #include "kernels.hpp"
 
 int main(int argc, char** argv) {
     CLI::App app{"bandpass - outputs the band pass from a filterbank file"};
 
-    std::string filename;
-    app.add_option("filename", filename, "the filterbank data file")
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "the filterbank data file(s), consecutive files of one "
+                   "observation are read as a single stream, or a "
+                   "shm:<name> ring")
         ->required()
-        ->check(CLI::ExistingFile);
+        ->check(CLI::ExistingFile | CLI::Validator(
+                                        [](std::string& source) {
+                                            return is_shm_source(source)
+                                                       ? std::string()
+                                                       : "not a shm: ring";
+                                        },
+                                        "SHM"));
 
     std::string outfile;
     app.add_option("-o,--outfile", outfile, "output txt file");
@@ -30,13 +44,50 @@ int main(int argc, char** argv) {
     int gulp = 512;
     app.add_option("-g,--gulp", gulp,
                    "number of time samples to read at a given time(def=512)");
+
+    std::size_t nbuffers = 4;
+    app.add_option("-b,--nbuffers", nbuffers,
+                   "number of blocks to prefetch while processing (def=4)");
+
+    int nthreads = 1;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of threads, each reading its own sample range "
+                   "(def=1, 0=all cores)")
+        ->check(CLI::NonNegativeNumber);
+
+    bool use_mmap = false;
+    app.add_flag("-m,--mmap", use_mmap,
+                 "map the file into memory when using several threads");
+
+    bool use_index = false;
+    auto* index_opt = app.add_flag(
+        "-i,--index", use_index,
+        "answer from the per-chunk statistics sidecar (<file>.stats), "
+        "building it on first use");
+
+    int chunk_len = 32768;
+    app.add_option("-c,--chunk", chunk_len,
+                   "time samples per chunk when building the index "
+                   "(def=32768)")
+        ->check(CLI::PositiveNumber);
+
+    bool print_rms = false;
+    app.add_flag("-r,--rms", print_rms,
+                 "also output the rms of each channel")
+        ->needs(index_opt);
+    std::string engine = "buffered";
+    app.add_option("--engine", engine,
+                   "read engine: buffered, direct (O_DIRECT) or uring "
+                   "(def=buffered)")
+        ->check(CLI::IsMember({"buffered", "direct", "uring"}));
     CLI11_PARSE(app, argc, argv);
 
-    FilterbankReader filreader(filename);
+    FilReader filreader(filenames, false, read_engine_from_string(engine));
 
     /* set number of dumps to average over if user has supplied seconds */
-    int nstart = (int)std::rint(tstart / filreader.hdr.get<double>("tsamp"));
-    int nsamp  = (int)std::rint(total_time / filreader.hdr.get<double>("tsamp"));
+    int64_t nstart = std::llround(tstart / filreader.hdr.get<double>("tsamp"));
+    int64_t nsamp =
+        std::llround(total_time / filreader.hdr.get<double>("tsamp"));
     int nchans = filreader.hdr.get<int>("nchans");
 
     /* initialize buffer for storing bandpass */
@@ -48,30 +99,81 @@ int main(int argc, char** argv) {
                            + filreader.hdr.get<double>("fch1");
     }
 
-    std::vector<float> block;
-    std::vector<readplan_tuple> plan_blocks
-        = filreader.get_readplan(gulp, 0, nstart, nsamp);
-    filreader.seek_sample(nstart);  // start sample = nstart
-
-    int block_len, skip, nsamps;
-    int num_samples = 0;
-    for (const auto& tup : plan_blocks) {
-        block_len = std::get<1>(tup);
-        skip      = std::get<2>(tup);
-        nsamps    = (int)(block_len / nchans);
-        filreader.read_plan(block_len, block, skip);
-        sigproc::getBpass(block.data(), bandpass.data(), nchans, nsamps);
-        num_samples += nsamps;
-    };
-
-    for (auto& elem : bandpass) {
-        elem = elem / num_samples;
+    std::vector<double> rms(nchans, 0);
+    if (use_index) {
+        if (filenames.size() != 1 || is_shm_source(filenames[0])) {
+            fmt::print(stderr, "Error: --index needs a single data file\n");
+            return 1;
+        }
+        const auto index = ChunkStatsIndex::load_or_build(
+            ChunkStatsIndex::sidecar_name(filenames[0]), filreader,
+            chunk_len);
+        const auto stats = index.query(filreader, nstart, nsamp);
+        /* combine the IFs of each channel */
+        std::vector<ChannelStats> stats_by_chan(nchans);
+        for (std::size_t ii = 0; ii < stats.size(); ++ii) {
+            ChannelStats& chan = stats_by_chan[ii % nchans];
+            chan.merge(stats[ii]);
+        }
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            bandpass[ichan] = stats_by_chan[ichan].mean();
+            rms[ichan]      = stats_by_chan[ichan].stddev();
+        }
+    } else if (nthreads != 1) {
+        /* each worker sums its own sample range, the sums are then added */
+        struct BandpassSum {
+            std::vector<double> sum;
+            int64_t nsamps;
+        };
+        MapReduceOptions opts;
+        opts.nthreads = nthreads;
+        opts.gulp     = gulp;
+        opts.use_mmap = use_mmap;
+        opts.engine   = read_engine_from_string(engine);
+        const auto total = parallel_map_reduce(
+            filenames, nstart, nsamp, BandpassSum{bandpass, 0}, opts,
+            [nchans](BandpassSum& acc, std::span<const float> block,
+                     int64_t /*start_sample*/, int /*nsamps*/) {
+                /* IFs are summed like further samples, as below */
+                const int nspectra = static_cast<int>(block.size()) / nchans;
+                sigproc::get_bpass(block, acc.sum, nchans, nspectra);
+                acc.nsamps += nspectra;
+            },
+            [](BandpassSum& acc, const BandpassSum& part) {
+                std::transform(acc.sum.begin(), acc.sum.end(),
+                               part.sum.begin(), acc.sum.begin(),
+                               std::plus<>());
+                acc.nsamps += part.nsamps;
+            });
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            bandpass[ichan] = total.sum[ichan] / total.nsamps;
+        }
+    } else {
+        filreader.seek_sample(nstart);  // start sample = nstart
+
+        /* whole gulps to the end, also of a live ring */
+        PrefetchReader prefetcher(filreader, gulp, nsamp, nbuffers);
+        int64_t num_samples = 0;
+        while (auto block = prefetcher.next()) {
+            const int nsamps = block->block_len / nchans;
+            sigproc::get_bpass(block->data, bandpass, nchans, nsamps);
+            num_samples += nsamps;
+        }
+
+        for (auto& elem : bandpass) {
+            elem = elem / num_samples;
+        }
     }
 
     std::ofstream outstream(outfile.c_str());
     for (int ichan = 0; ichan < nchans; ++ichan) {
-        fmt::print(outstream, "{:.4f}\t{:.4f}\n", chanFreqs[ichan],
-                   bandpass[ichan]);
+        if (print_rms) {
+            fmt::print(outstream, "{:.4f}\t{:.4f}\t{:.4f}\n",
+                       chanFreqs[ichan], bandpass[ichan], rms[ichan]);
+        } else {
+            fmt::print(outstream, "{:.4f}\t{:.4f}\n", chanFreqs[ichan],
+                       bandpass[ichan]);
+        }
     }
 
     return 0;
@@ -0,0 +1,93 @@
+/*
+ * sig_catalogue.cpp catalogue the headers of many filterbank files
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+#include <CLI/CLI.hpp>
+
+#include <sigproc/catalogue.hpp>
+
+int main(int argc, char** argv) {
+    CLI::App app{"catalogue - scans directories of filterbank files and "
+                 "lists their headers"};
+
+    std::vector<std::string> roots;
+    app.add_option("paths", roots,
+                   "directories to scan recursively, or single files")
+        ->required()
+        ->check(CLI::ExistingPath);
+
+    std::string outfile;
+    app.add_option("-o,--outfile", outfile,
+                   "output catalogue, JSON if it ends in .json (def=stdout)");
+
+    bool json = false;
+    app.add_flag("--json", json, "write JSON instead of CSV");
+
+    std::string cache;
+    app.add_option("-c,--cache", cache,
+                   "binary cache of parsed headers, unchanged files are not "
+                   "read again");
+
+    int nthreads = 0;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of parsing threads (def=0, all cores)")
+        ->check(CLI::NonNegativeNumber);
+
+    std::vector<std::string> extensions{".fil"};
+    app.add_option("-e,--ext", extensions,
+                   "file extensions to consider (def=.fil)");
+
+    std::string source;
+    app.add_option("--source", source, "only list files of this source");
+
+    double freq = 0.0;
+    auto* freq_opt = app.add_option("--freq", freq,
+                                    "only list files covering this "
+                                    "frequency (MHz)");
+
+    double mjd = 0.0;
+    auto* mjd_opt = app.add_option("--mjd", mjd,
+                                   "only list files covering this MJD");
+    CLI11_PARSE(app, argc, argv);
+
+    auto catalogue = cache.empty() ? HeaderCatalogue()
+                                   : HeaderCatalogue::load(cache);
+    const auto stats = catalogue.scan(roots, nthreads, extensions);
+    if (!cache.empty()) {
+        catalogue.save(cache);
+    }
+    fmt::print(stderr,
+               "Scanned {} files in {:.3f} s ({:.0f} files/s): {} parsed "
+               "({:.0f} headers/s), {} unchanged in cache, {} not sigproc\n",
+               stats.nfiles, stats.seconds, stats.files_per_second(),
+               stats.nparsed, stats.parsed_per_second(), stats.ncached,
+               stats.nfailed);
+
+    std::vector<CatalogueEntry> selected;
+    for (const auto& entry : catalogue.entries()) {
+        if ((source.empty() || entry.source_name == source) &&
+            (freq_opt->count() == 0 || entry.covers_freq(freq)) &&
+            (mjd_opt->count() == 0 || entry.covers_mjd(mjd))) {
+            selected.push_back(entry);
+        }
+    }
+
+    json = json || outfile.ends_with(".json");
+    std::ofstream outstream;
+    if (!outfile.empty()) {
+        outstream.open(outfile);
+    }
+    std::ostream& stream = outfile.empty() ? std::cout : outstream;
+    if (json) {
+        HeaderCatalogue::write_json(stream, selected);
+    } else {
+        HeaderCatalogue::write_csv(stream, selected);
+    }
+    return 0;
+}
@@ -5,17 +5,30 @@
 #include <vector>
 #include <tuple>
 #include <cmath>
+#include <exception>
+#include <thread>
 
 #include <CLI/CLI.hpp>
+#include <fmt/core.h>
 #include <sigproc/io.hpp>
+#include <sigproc/prefetch.hpp>
 
 int main(int argc, char** argv) {
     CLI::App app{"chop_fil: splits a fil file in time"};
 
-    std::string filename;
-    app.add_option("filename", filename, "the filterbank data file")
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "the filterbank data file(s), consecutive files of one "
+                   "observation are read as a single stream, or a "
+                   "shm:<name> ring")
         ->required()
-        ->check(CLI::ExistingFile);
+        ->check(CLI::ExistingFile | CLI::Validator(
+                                        [](std::string& source) {
+                                            return is_shm_source(source)
+                                                       ? std::string()
+                                                       : "not a shm: ring";
+                                        },
+                                        "SHM"));
 
     std::string outfile;
     app.add_option("-o,--outfile", outfile, "output flterbank file name");
@@ -30,33 +43,97 @@ int main(int argc, char** argv) {
     int gulp = 512;
     app.add_option("-g,--gulp", gulp,
                    "number of time samples to read at a given time(def=512)");
-    CLI11_PARSE(app, argc, argv);
-
-    FilterbankReader filreader(filename);
-
-    int nstart = (int)std::rint(tstart / filreader.hdr.get<double>("tsamp"));
-    int nsamp = (int)std::rint(total_time / filreader.hdr.get<double>("tsamp"));
 
-    FilterbankWriter filwriter(outfile, filreader.hdr);
-
-    int stride_len
-        = filreader.hdr.get<int>("nchans") * filreader.hdr.get<int>("nifs");
+    std::size_t nbuffers = 4;
+    app.add_option("-b,--nbuffers", nbuffers,
+                   "number of blocks to prefetch while writing (def=4)");
+    std::size_t nwbuffers = 4;
+    app.add_option("-w,--wbuffers", nwbuffers,
+                   "number of output blocks queued for the writer thread "
+                   "(def=4, 0=write synchronously)");
+    int nthreads = 1;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of threads, each copying its own sample range "
+                   "(def=1)")
+        ->check(CLI::PositiveNumber);
+    std::string engine = "buffered";
+    app.add_option("--engine", engine,
+                   "read engine: buffered, direct (O_DIRECT) or uring "
+                   "(def=buffered)")
+        ->check(CLI::IsMember({"buffered", "direct", "uring"}));
+    CLI11_PARSE(app, argc, argv);
 
-    std::vector<float> out_arr(gulp * stride_len, 0);
-    std::vector<float> block;
+    FilReader filreader(filenames, false, read_engine_from_string(engine));
+
+    int64_t nstart =
+        std::llround(tstart / filreader.hdr.get<HeaderKey::kTsamp>());
+    int64_t nsamp =
+        std::llround(total_time / filreader.hdr.get<HeaderKey::kTsamp>());
+
+    if (nthreads > 1 && is_shm_source(filenames.front())) {
+        // every reader would attach to the ring and read it all again
+        fmt::print(stderr, "Warning: a shm: ring is copied by one thread\n");
+        nthreads = 1;
+    }
+    if (nthreads > 1) {
+        if (nsamp == 0) {
+            nsamp = filreader.hdr.get<HeaderKey::kNsamples>() - nstart;
+        }
+        const int stride_len = filreader.hdr.get<HeaderKey::kNchans>() *
+                               filreader.hdr.get<HeaderKey::kNifs>();
+        const int64_t chunk = (nsamp + nthreads - 1) / nthreads;
+        FilterbankRangeWriter rangewriter(outfile, filreader.hdr, nsamp);
+        std::vector<std::exception_ptr> errors(nthreads);
+        std::vector<std::thread> threads;
+        for (int ithread = 0; ithread < nthreads; ++ithread) {
+            threads.emplace_back([&, ithread] {
+                try {
+                    const int64_t first = ithread * chunk;
+                    const int64_t count = std::min(chunk, nsamp - first);
+                    if (count <= 0) {
+                        return;
+                    }
+                    // Each thread has its own reader and file handles
+                    FilReader reader(filenames, false,
+                                     read_engine_from_string(engine));
+                    auto plan =
+                        reader.get_readplan(gulp, 0, nstart + first, count);
+                    reader.seek_sample(nstart + first);
+                    std::vector<float> block;
+                    std::size_t out_sample = first;
+                    for (const auto& [iread, block_len, skip] : plan) {
+                        reader.read_plan(block_len, block, skip);
+                        rangewriter.write_samples(
+                            out_sample, std::span(block).first(block_len));
+                        out_sample += block_len / stride_len;
+                    }
+                } catch (...) {
+                    errors[ithread] = std::current_exception();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        rangewriter.close();
+        return 0;
+    }
+
+    FilterbankWriter filwriter(outfile, filreader.hdr, nwbuffers);
 
-    std::vector<readplan_tuple> plan_blocks
-        = filreader.get_readplan(gulp, 0, nstart, nsamp);
     filreader.seek_sample(nstart);  // start sample = nstart
 
-    int block_len, skip, nsamps;
-    for (const auto& tup : plan_blocks) {
-        block_len = std::get<1>(tup);
-        skip      = std::get<2>(tup);
-        nsamps    = (int)(block_len / filreader.hdr.get<int>("nchans"));
-        filreader.read_plan(block_len, block, skip);
-        filwriter.write_block(out_arr, nsamps * stride_len);
-    };
+    // whole gulps to the end, also of a live ring
+    PrefetchReader prefetcher(filreader, gulp, nsamp, nbuffers);
+    while (auto block = prefetcher.next()) {
+        filwriter.write_block(block->data, block->block_len);
+    }
+    filwriter.close();
 
     return 0;
 }
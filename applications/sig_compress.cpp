@@ -0,0 +1,75 @@
+/*
+ * sig_compress.cpp losslessly (de)compress a filterbank file
+ */
+
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+#include <CLI/CLI.hpp>
+
+#include <sigproc/compress.hpp>
+#include <sigproc/io.hpp>
+#include <sigproc/prefetch.hpp>
+
+int main(int argc, char** argv) {
+    CLI::App app{"compress - converts a filterbank file to or from the "
+                 "chunked lossless compressed format"};
+
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "the filterbank data file(s), consecutive files of one "
+                   "observation are read as a single stream")
+        ->required()
+        ->check(CLI::ExistingFile);
+
+    std::string outfile;
+    app.add_option("-o,--outfile", outfile, "output filterbank file name")
+        ->required();
+
+    bool decompress = false;
+    app.add_flag("-d,--decompress", decompress,
+                 "write a plain sigproc file instead");
+
+    std::size_t chunk_nsamps = 4096;
+    app.add_option("-c,--chunk", chunk_nsamps,
+                   "time samples per compressed chunk (def=4096)")
+        ->check(CLI::PositiveNumber);
+
+    int gulp = 4096;
+    app.add_option("-g,--gulp", gulp,
+                   "number of time samples to read at a given time(def=4096)");
+
+    std::size_t nbuffers = 4;
+    app.add_option("-b,--nbuffers", nbuffers,
+                   "number of blocks to prefetch while writing (def=4)");
+    std::string engine = "buffered";
+    app.add_option("--engine", engine,
+                   "read engine: buffered, direct (O_DIRECT) or uring "
+                   "(def=buffered)")
+        ->check(CLI::IsMember({"buffered", "direct", "uring"}));
+    CLI11_PARSE(app, argc, argv);
+
+    FilReader filreader(filenames, false, read_engine_from_string(engine));
+    PrefetchReader prefetcher(filreader, gulp, 0, nbuffers);
+
+    if (decompress) {
+        FilterbankWriter filwriter(outfile, filreader.hdr);
+        while (auto block = prefetcher.next()) {
+            filwriter.write_block(block->data, block->block_len);
+        }
+        filwriter.close();
+        return 0;
+    }
+
+    CompressedFilterbankWriter zwriter(outfile, filreader.hdr, chunk_nsamps);
+    while (auto block = prefetcher.next()) {
+        zwriter.write_block(block->data, block->block_len);
+    }
+    zwriter.close();
+    fmt::print("{}: {} -> {} bytes of data, ratio {:.2f}\n", outfile,
+               zwriter.raw_bytes(), zwriter.compressed_bytes(),
+               static_cast<double>(zwriter.raw_bytes()) /
+                   static_cast<double>(zwriter.compressed_bytes()));
+    return 0;
+}
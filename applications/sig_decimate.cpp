@@ -5,20 +5,34 @@
 #include <vector>
 #include <tuple>
 #include <cmath>
+#include <exception>
+#include <thread>
 
 #include <CLI/CLI.hpp>
+#include <fmt/core.h>
 
+#include <sigproc/buffer.hpp>
 #include <sigproc/io.hpp>
+#include <sigproc/prefetch.hpp>
 #include "kernels.hpp"
 
 int main(int argc, char** argv) {
     CLI::App app{"decimate - reduce time and/or frequency resolution of "
                  "filterbank data"};
 
-    std::string filename;
-    app.add_option("filename", filename, "the filterbank data file")
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "the filterbank data file(s), consecutive files of one "
+                   "observation are read as a single stream, or a "
+                   "shm:<name> ring")
         ->required()
-        ->check(CLI::ExistingFile);
+        ->check(CLI::ExistingFile | CLI::Validator(
+                                        [](std::string& source) {
+                                            return is_shm_source(source)
+                                                       ? std::string()
+                                                       : "not a shm: ring";
+                                        },
+                                        "SHM"));
 
     std::string outfile;
     app.add_option("-o,--outfile", outfile, "output flterbank file name");
@@ -34,53 +48,144 @@ int main(int argc, char** argv) {
     int out_nbits = 0;
     app.add_option("-n,--nbits", out_nbits,
                    "specify output number of bits (def=input)");
-
+    std::size_t nbuffers = 4;
+    app.add_option("-b,--nbuffers", nbuffers,
+                   "number of blocks to prefetch while processing (def=4)");
+    std::size_t nwbuffers = 4;
+    app.add_option("-w,--wbuffers", nwbuffers,
+                   "number of output blocks queued for the writer thread "
+                   "(def=4, 0=write synchronously)");
+    bool verbose = false;
+    app.add_flag("-v,--verbose", verbose,
+                 "print I/O buffer statistics at the end");
+    int nthreads = 1;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of threads, each decimating its own sample range "
+                   "(def=1)")
+        ->check(CLI::PositiveNumber);
+
+    std::string engine = "buffered";
+    app.add_option("--engine", engine,
+                   "read engine: buffered, direct (O_DIRECT) or uring "
+                   "(def=buffered)")
+        ->check(CLI::IsMember({"buffered", "direct", "uring"}));
     CLI11_PARSE(app, argc, argv);
 
-    FilterbankReader filreader(filename);
+    FilReader filreader(filenames, false, read_engine_from_string(engine));
+    const int nchans_in = filreader.hdr.get<HeaderKey::kNchans>();
 
     // gulp must be a multiple of tfactor
     gulp = (int)(std::ceil(gulp / tfactor) * tfactor);
 
     // Output nbits
     if (out_nbits == 0) {
-        out_nbits = filreader.hdr.get<int>("nbits");
+        out_nbits = filreader.hdr.get<HeaderKey::kNbits>();
     }
 
-    int nc = (int)filreader.hdr.get<int>("nchans") / ffactor;
-    if ((nc * ffactor) != filreader.hdr.get<int>("nchans")) {
+    int nc = nchans_in / ffactor;
+    if ((nc * ffactor) != nchans_in) {
         std::runtime_error(
             "nchans must be integer multiple of decimation factor");
     }
 
-    std::map<std::string, sig_hdr_types> out_hdr_map
-        = {{"tsamp", filreader.hdr.get<double>("tsamp") * tfactor},
-           {"foff", filreader.hdr.get<double>("foff") * ffactor},
-           {"nchans", filreader.hdr.get<int>("nchans") / ffactor},
+    std::map<std::string, SighdrTypes> out_hdr_map
+        = {{"tsamp", filreader.hdr.get<HeaderKey::kTsamp>() * tfactor},
+           {"foff", filreader.hdr.get<HeaderKey::kFoff>() * ffactor},
+           {"nchans", filreader.hdr.get<HeaderKey::kNchans>() / ffactor},
            {"nbits", out_nbits}};
-    filreader.hdr.update(out_hdr_map);
+    SigprocHeader out_hdr = filreader.hdr.new_header(out_hdr_map);
+
+    int stride_len = nchans_in * filreader.hdr.get<HeaderKey::kNifs>();
 
-    FilterbankWriter filwriter(outfile, filreader.hdr);
+    if (nthreads > 1 && is_shm_source(filenames.front())) {
+        // every reader would attach to the ring and read it all again
+        fmt::print(stderr, "Warning: a shm: ring is decimated by one thread\n");
+        nthreads = 1;
+    }
+    if (nthreads > 1) {
+        const int64_t nsamples = filreader.hdr.get<HeaderKey::kNsamples>();
+        // ranges start on a gulp boundary so blocks never straddle tfactor
+        const int64_t chunk = (nsamples / nthreads + gulp - 1) / gulp * gulp;
+        FilterbankRangeWriter rangewriter(outfile, out_hdr,
+                                          nsamples / tfactor);
+        std::vector<std::exception_ptr> errors(nthreads);
+        std::vector<std::thread> threads;
+        for (int ithread = 0; ithread < nthreads; ++ithread) {
+            threads.emplace_back([&, ithread] {
+                try {
+                    const int64_t first = ithread * chunk;
+                    const int64_t count = ithread == nthreads - 1
+                                          ? nsamples - first
+                                          : std::min(chunk, nsamples - first);
+                    if (count <= 0) {
+                        return;
+                    }
+                    // Each thread has its own reader and file handles
+                    FilReader reader(filenames, false,
+                                     read_engine_from_string(engine));
+                    auto plan = reader.get_readplan(gulp, 0, first, count);
+                    reader.seek_sample(first);
+                    std::vector<float> block;
+                    std::vector<float> out(gulp * stride_len / ffactor /
+                                           tfactor);
+                    std::size_t out_sample = first / tfactor;
+                    for (const auto& [iread, block_len, skip] : plan) {
+                        reader.read_plan(block_len, block, skip);
+                        const int nsamps     = block_len / stride_len;
+                        const int nsamps_out = nsamps / tfactor;
+                        sigproc::downsample(block, out, tfactor, ffactor,
+                                            nchans_in, nsamps);
+                        rangewriter.write_samples(
+                            out_sample,
+                            std::span(out).first(nsamps_out * stride_len /
+                                                 ffactor));
+                        out_sample += nsamps_out;
+                    }
+                } catch (...) {
+                    errors[ithread] = std::current_exception();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        rangewriter.close();
+        return 0;
+    }
 
-    int stride_len
-        = filreader.hdr.get<int>("nchans") * filreader.hdr.get<int>("nifs");
+    FilterbankWriter filwriter(outfile, out_hdr, nwbuffers);
 
     std::vector<float> out_arr(gulp * stride_len / ffactor / tfactor, 0);
-    std::vector<float> block;
 
-    std::vector<readplan_tuple> plan_blocks = filreader.get_readplan(gulp);
     filreader.seek_sample(0);  // start sample = 0
 
-    int block_len, skip, nsamps;
-    for (const auto& tup : plan_blocks) {
-        block_len = std::get<1>(tup);
-        skip      = std::get<2>(tup);
-        nsamps    = (int)(block_len / filreader.hdr.get<int>("nchans"));
-        filreader.read_plan(block_len, block, skip);
-        sigproc::downsample(block.data(), out_arr.data(), tfactor, ffactor,
-                            sigfile.hdr.get<int>("nchans"), nsamps);
+    // whole gulps to the end, also of a live ring
+    PrefetchReader prefetcher(filreader, gulp, 0, nbuffers);
+    while (auto block = prefetcher.next()) {
+        const int nsamps = block->block_len / nchans_in;
+        sigproc::downsample(block->data, out_arr, tfactor, ffactor, nchans_in,
+                            nsamps);
         filwriter.write_block(out_arr, nsamps * stride_len / ffactor / tfactor);
-    };
+    }
+    filwriter.close();
+
+    if (verbose) {
+        const PoolStats pool = BufferPool::default_pool().stats();
+        const PrefetchStats prefetch = prefetcher.stats();
+        fmt::print(stderr,
+                   "buffer pool: {} allocations, {} reuses, peak {} bytes\n",
+                   pool.nallocs, pool.nreuses, pool.peak_bytes);
+        fmt::print(stderr,
+                   "prefetch: {} blocks, consumer stall {:.3f} s, producer "
+                   "stall {:.3f} s\n",
+                   prefetch.nblocks, prefetch.consumer_stall_sec,
+                   prefetch.producer_stall_sec);
+    }
 
     return 0;
 }
@@ -0,0 +1,170 @@
+/*
+    DEDISPBENCH  - compare the dedispersion engines on a simulated pulse
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <fmt/core.h>
+
+#include <sigproc/dedisperse.hpp>
+#include <sigproc/fdmt.hpp>
+#include <sigproc/parallel.hpp>
+#include <sigproc/subband.hpp>
+
+namespace {
+
+struct Detection {
+    std::size_t idm;
+    int64_t sample;
+    double snr;
+};
+
+// Brightest sample of the plane, S/N against its own trial
+Detection find_peak(const std::vector<float>& out, int nsamps_out) {
+    const auto peak = std::ranges::max_element(out) - out.begin();
+    const auto idm  = static_cast<std::size_t>(peak / nsamps_out);
+    const auto row  = std::span(out).subspan(idm * nsamps_out, nsamps_out);
+    const double mean =
+        std::accumulate(row.begin(), row.end(), 0.0) / nsamps_out;
+    double var = 0.0;
+    for (const float value : row) {
+        var += (value - mean) * (value - mean);
+    }
+    const double rms = std::sqrt(var / nsamps_out);
+    return {idm, peak % nsamps_out, (out[peak] - mean) / rms};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CLI::App app{"dedispbench - time brute-force, subband and FDMT "
+                 "dedispersion of a simulated dispersed pulse"};
+
+    int nchans = 1024;
+    app.add_option("-c,--nchans", nchans, "number of channels (def=1024)")
+        ->check(CLI::PositiveNumber);
+    int nsamps = 8192;
+    app.add_option("-n,--nsamps", nsamps,
+                   "time samples in the block (def=8192)")
+        ->check(CLI::PositiveNumber);
+    double fch1 = 400.0;
+    app.add_option("--fch1", fch1, "frequency of channel 1 in MHz (def=400)");
+    double bandwidth = -100.0;
+    app.add_option("--bw", bandwidth,
+                   "bandwidth in MHz, negative for a descending band "
+                   "(def=-100)");
+    double tsamp = 327.68e-6;
+    app.add_option("--tsamp", tsamp, "sampling time in s (def=327.68e-6)");
+    double dm_max = 50.0;
+    app.add_option("--hidm", dm_max, "last trial DM (def=50)");
+    double pulse_dm = 30.0;
+    app.add_option("--dm", pulse_dm, "DM of the simulated pulse (def=30)");
+    double amplitude = 2.0;
+    app.add_option("-a,--amplitude", amplitude,
+                   "pulse amplitude per channel, in units of the noise rms "
+                   "(def=2)");
+    double smearing = 1.0;
+    app.add_option("--smear", smearing,
+                   "subband smearing budget in samples (def=1)")
+        ->check(CLI::PositiveNumber);
+    int nthreads = 0;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of threads (def=0, all cores)")
+        ->check(CLI::NonNegativeNumber);
+    int nrepeat = 3;
+    app.add_option("-r,--repeat", nrepeat,
+                   "runs of each engine, the fastest is reported (def=3)")
+        ->check(CLI::PositiveNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    SigprocHeader hdr;
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("fch1", fch1);
+    hdr.set("foff", bandwidth / nchans);
+    hdr.set("tsamp", tsamp);
+    hdr = hdr.new_header(std::map<std::string, int>{{"nbits", 32}});
+
+    // All engines run the trials of the FDMT grid
+    const DMPlan plan(hdr, FDMT::dm_list(hdr, 0.0, dm_max));
+    FDMT fdmt(plan);
+    SubbandDedisperser subband(plan, smearing);
+    const int max_delay = std::max(
+        {plan.max_delay(), fdmt.max_delay(), subband.max_delay()});
+    if (nsamps <= 2 * max_delay) {
+        fmt::print(stderr, "Error: need more than {} samples for a maximum "
+                           "delay of {} samples\n",
+                   2 * max_delay, max_delay);
+        return 1;
+    }
+
+    // Gaussian noise with a one-sample pulse at each channel's delay
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamps);
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0F, 1.0F);
+    std::ranges::generate(data, [&] { return noise(rng); });
+    const int64_t t0  = nsamps / 4;
+    const double ftop = hdr.get_ref_freq("top");
+    for (int ichan = 0; ichan < nchans; ++ichan) {
+        const double freq  = fch1 + ichan * hdr.get<HeaderKey::kFoff>();
+        const double delay = kDMConst * pulse_dm *
+                             (1.0 / (freq * freq) - 1.0 / (ftop * ftop)) /
+                             tsamp;
+        data[ichan * static_cast<int64_t>(nsamps) + t0 + std::lround(delay)] +=
+            static_cast<float>(amplitude);
+    }
+
+    const KernelThreadLimit limit(resolve_nthreads(nthreads));
+    fmt::print("{} channels x {} samples, {} trials up to DM {:.2f}, max "
+               "delay {} samples, pulse at DM {:.2f} sample {}\n",
+               nchans, nsamps, plan.ndms(), plan.dms().back(), max_delay,
+               pulse_dm, t0);
+
+    const auto run = [&](const std::string& name, int engine_delay,
+                         const std::function<void(std::vector<float>&)>&
+                             dedisperse) {
+        const int nsamps_out = nsamps - engine_delay;
+        std::vector<float> out(plan.ndms() * nsamps_out);
+        double best = 0.0;
+        for (int irun = 0; irun < nrepeat; ++irun) {
+            const auto start = std::chrono::steady_clock::now();
+            dedisperse(out);
+            const double sec = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+            best = irun == 0 ? sec : std::min(best, sec);
+        }
+        const auto det = find_peak(out, nsamps_out);
+        fmt::print("{:>7}: {:.4f} s, {:.3e} samples*DMs/s, peak at DM {:.2f} "
+                   "sample {} S/N {:.1f}\n",
+                   name, best,
+                   static_cast<double>(nsamps_out) * plan.ndms() / best,
+                   plan.dms()[det.idm], det.sample, det.snr);
+        return best;
+    };
+
+    const double brute_sec = run("brute", plan.max_delay(), [&](auto& out) {
+        dedisperse_brute(plan, data, nsamps, 1, out);
+    });
+    const double subband_sec =
+        run("subband", subband.max_delay(), [&](auto& out) {
+            subband.execute(data, nsamps, 1, out);
+        });
+    const double fdmt_sec = run("fdmt", fdmt.max_delay(), [&](auto& out) {
+        fdmt.execute(data, nsamps, 1, out);
+    });
+    fmt::print("Subband ({} subbands, {} coarse DMs) speed-up: {:.1f}x\n",
+               subband.nsub(), subband.coarse_dms().size(),
+               brute_sec / subband_sec);
+    fmt::print("FDMT speed-up: {:.1f}x\n", brute_sec / fdmt_sec);
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+    DEDISPERSE  - brute-force dedispersion of filterbank data over a DM grid
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <fmt/core.h>
+
+#include <sigproc/dedisperse.hpp>
+#include <sigproc/dmplan.hpp>
+#include <sigproc/exceptions.hpp>
+#include <sigproc/fdmt.hpp>
+#include <sigproc/io.hpp>
+#include <sigproc/parallel.hpp>
+#include <sigproc/ringbuffer.hpp>
+#include <sigproc/subband.hpp>
+#include "kernels.hpp"
+
+namespace {
+
+// Each .tim file keeps a descriptor open for the whole run, stay well
+// below the usual limit of 1024
+constexpr int kMaxTimFiles = 512;
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CLI::App app{"dedisperse - form dedispersed time series for a grid of "
+                 "trial DMs"};
+
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "the filterbank data file(s), consecutive files of one "
+                   "observation are read as a single stream, or a "
+                   "shm:<name> ring")
+        ->required()
+        ->check(CLI::ExistingFile | CLI::Validator(
+                                        [](std::string& source) {
+                                            return is_shm_source(source)
+                                                       ? std::string()
+                                                       : "not a shm: ring";
+                                        },
+                                        "SHM"));
+
+    std::string basename = "dedisp";
+    app.add_option("-o,--output", basename,
+                   "output base name, <base>_<trial>_DM<dm>.tim per trial "
+                   "or <base>.fil with --plane (def=dedisp)");
+    double dm_min = 0.0;
+    app.add_option("--lodm", dm_min, "first trial DM (def=0)");
+    double dm_max = 100.0;
+    app.add_option("--hidm", dm_max, "last trial DM (def=100)");
+    double tolerance = 1.25;
+    app.add_option("--tol", tolerance,
+                   "smearing tolerance between trials (def=1.25)");
+    double pulse_width = 40.0;
+    app.add_option("--width", pulse_width,
+                   "intrinsic pulse width in us (def=40)");
+    std::string ref_freq = "top";
+    app.add_option("--ref", ref_freq,
+                   "reference frequency: top, ch1 or center (def=top)");
+    std::string plan_file;
+    app.add_option("-p,--plan", plan_file,
+                   "DM plan cache, reused when it matches (def=none)");
+    int gulp = 16384;
+    app.add_option("-g,--gulp", gulp,
+                   "output samples per trial and block (def=16384)")
+        ->check(CLI::PositiveNumber);
+    bool plane = false;
+    app.add_flag("--plane", plane,
+                 "write one DM-time plane, a filterbank with a channel per "
+                 "trial, instead of .tim files (needed above 512 trials)");
+    int nthreads = 0;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of dedispersion threads (def=0, all cores)")
+        ->check(CLI::NonNegativeNumber);
+    bool use_mmap = false;
+    app.add_flag("-m,--mmap", use_mmap, "map the file into memory");
+    std::string engine_name = "brute";
+    app.add_option("-e,--engine", engine_name,
+                   "brute, subband, or fdmt for one trial per sample of "
+                   "delay across the band (def=brute)")
+        ->check(CLI::IsMember({"brute", "subband", "fdmt"}));
+    std::string read_engine = "buffered";
+    app.add_option("--read-engine", read_engine,
+                   "read engine: buffered, direct (O_DIRECT) or uring "
+                   "(def=buffered)")
+        ->check(CLI::IsMember({"buffered", "direct", "uring"}));
+    DedispersionOptions options;
+    app.add_option("--smear", options.smearing,
+                   "subband: delay error allowed within a subband, in "
+                   "samples (def=1)")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--nsub", options.nsub,
+                   "subband: number of subbands (def=0, chosen from the "
+                   "smearing)")
+        ->check(CLI::NonNegativeNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    if (engine_name == "subband") {
+        options.engine = DedispersionEngine::kSubband;
+    } else if (engine_name == "fdmt") {
+        options.engine = DedispersionEngine::kFDMT;
+    }
+
+    FilReader reader(filenames, use_mmap,
+                     read_engine_from_string(read_engine));
+    const auto& hdr = reader.hdr;
+
+    const auto dms =
+        options.engine == DedispersionEngine::kFDMT
+            ? FDMT::dm_list(hdr, dm_min, dm_max)
+            : DMPlan::generate_dm_list(hdr, dm_min, dm_max,
+                                       pulse_width * 1e-6, tolerance);
+    const DMPlan plan = plan_file.empty()
+                            ? DMPlan(hdr, dms, ref_freq)
+                            : DMPlan::load_or_build(plan_file, hdr, dms,
+                                                    ref_freq);
+    const auto ndms      = static_cast<int>(plan.ndms());
+    const int max_delay  = dedispersion_overlap(plan, options);
+    const int64_t nsamps = hdr.get<HeaderKey::kNsamples>();
+    if (!reader.is_unbounded() && nsamps <= max_delay) {
+        fmt::print(stderr, "Error: {} samples do not cover the maximum delay "
+                           "of {} samples\n",
+                   nsamps, max_delay);
+        return 1;
+    }
+    // A live ring is dedispersed until it ends, its length is not known yet
+    const int64_t nsamps_out =
+        reader.is_unbounded() ? 0 : nsamps - max_delay;
+    if (!plane && ndms > kMaxTimFiles) {
+        fmt::print(stderr, "Error: {} trials would keep {} .tim files open, "
+                           "at most {}; write a DM-time plane with --plane\n",
+                   ndms, ndms, kMaxTimFiles);
+        return 1;
+    }
+    fmt::print(stderr, "{} trials from DM {:.3f} to {:.3f}, max delay {} "
+                       "samples\n",
+               ndms, dms.front(), dms.back(), max_delay);
+    if (options.engine == DedispersionEngine::kSubband) {
+        const SubbandDedisperser subband(plan, options.smearing, options.nsub);
+        fmt::print(stderr, "{} subbands, {} coarse DMs, {:.1f}x fewer "
+                           "additions than brute force\n",
+                   subband.nsub(), subband.coarse_dms().size(),
+                   subband.speedup());
+    }
+
+    // One writer per trial, or one for the plane
+    std::vector<std::unique_ptr<FilterbankWriter>> writers;
+    std::vector<float> turned;
+    if (plane) {
+        const double step = ndms > 1 ? dms[1] - dms[0] : 0.0;
+        const auto plane_hdr = hdr.new_header(
+            std::map<std::string, SighdrTypes>{{"nchans", ndms},
+                                               {"nifs", 1},
+                                               {"nbits", 32},
+                                               {"fch1", dms.front()},
+                                               {"foff", step},
+                                               {"refdm", 0.0},
+                                               {"nsamples", nsamps_out}});
+        writers.push_back(std::make_unique<FilterbankWriter>(
+            basename + ".fil", plane_hdr, 4));
+        // The trials are not evenly spaced, list them alongside the plane
+        std::ofstream dmfile(basename + ".dms");
+        ErrorChecker::check_stream(dmfile, basename + ".dms");
+        for (const double dm : dms) {
+            dmfile << std::format("{:.6f}\n", dm);
+        }
+        turned.resize(static_cast<std::size_t>(ndms) * gulp);
+    } else {
+        // The trial number keeps names unique when DM steps are below the
+        // printed precision
+        const auto width = std::to_string(ndms - 1).size();
+        for (int idm = 0; idm < ndms; ++idm) {
+            const double dm = dms[idm];
+            const auto tim_hdr = hdr.new_header(
+                std::map<std::string, SighdrTypes>{{"nchans", 1},
+                                                   {"nifs", 1},
+                                                   {"nbits", 32},
+                                                   {"data_type", 2},
+                                                   {"fch1", plan.ref_freq()},
+                                                   {"refdm", dm},
+                                                   {"nsamples", nsamps_out}});
+            writers.push_back(std::make_unique<FilterbankWriter>(
+                std::format("{}_{:0{}}_DM{:.3f}.tim", basename, idm, width,
+                            dm),
+                tim_hdr));
+        }
+    }
+
+    const KernelThreadLimit limit(resolve_nthreads(nthreads));
+    double write_sec = 0.0;
+    const auto t0    = std::chrono::steady_clock::now();
+    const int64_t ndone = dedisperse_stream(
+        reader, plan, gulp,
+        [&](std::span<const float> out, int64_t /*start_sample*/,
+            int nsamps_block) {
+            const auto w0 = std::chrono::steady_clock::now();
+            if (plane) {
+                sigproc::transpose(out, turned, ndms, nsamps_block);
+                writers[0]->write_block(turned, ndms * nsamps_block);
+            } else {
+                for (int idm = 0; idm < ndms; ++idm) {
+                    writers[idm]->write_block(
+                        out.subspan(static_cast<std::size_t>(idm) *
+                                        nsamps_block,
+                                    nsamps_block),
+                        nsamps_block);
+                }
+            }
+            write_sec += std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - w0)
+                             .count();
+        },
+        0, 0, options);
+    for (auto& writer : writers) {
+        writer->close();
+    }
+    const double total_sec = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - t0)
+                                 .count();
+
+    const double work = static_cast<double>(ndone) * ndms;
+    fmt::print(stderr,
+               "{} samples x {} DMs in {:.3f} s: {:.3e} samples*DMs/s, "
+               "{:.3e} excluding {:.3f} s of output\n",
+               ndone, ndms, total_sec, work / total_sec,
+               work / std::max(total_sec - write_sec, 1e-9), write_sec);
+    return 0;
+}
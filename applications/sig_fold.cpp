@@ -0,0 +1,136 @@
+/*
+    FOLD  - fold filterbank data or time series into pulse profiles
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <fmt/core.h>
+
+#include <sigproc/fold.hpp>
+#include <sigproc/io.hpp>
+#include <sigproc/parallel.hpp>
+
+int main(int argc, char** argv) {
+    CLI::App app{"fold - fold filterbank data or time series at a period "
+                 "into phase bins and sub-integrations"};
+
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "filterbank or time series files, read as one stream")
+        ->required()
+        ->check(CLI::ExistingFile);
+
+    std::string outfile = "fold.prf";
+    app.add_option("-o,--outfile", outfile,
+                   "pulse profile file, data_type 3 (def=fold.prf)");
+    FoldParams params;
+    app.add_option("-p,--period", params.period,
+                   "folding period at the first sample in s")
+        ->required()
+        ->check(CLI::PositiveNumber);
+    app.add_option("--pdot", params.pdot, "period derivative in s/s (def=0)");
+    app.add_option("-d,--dm", params.dm,
+                   "DM whose channel delays are removed (def=0)")
+        ->check(CLI::NonNegativeNumber);
+    app.add_option("-b,--nbins", params.nbins,
+                   "phase bins per period (def=64)")
+        ->check(CLI::PositiveNumber);
+    app.add_option("-n,--nsubints", params.nsubints,
+                   "sub-integrations (def=1)")
+        ->check(CLI::PositiveNumber);
+    bool fscrunch = false;
+    app.add_flag("-F,--fscrunch", fscrunch,
+                 "average the channels of each IF into one profile");
+    int64_t nstart = 0;
+    app.add_option("-s,--start", nstart, "first sample folded (def=0)")
+        ->check(CLI::NonNegativeNumber);
+    int64_t nsamp = 0;
+    app.add_option("-r,--nsamp", nsamp,
+                   "samples folded (def=0, the rest of the data)")
+        ->check(CLI::NonNegativeNumber);
+    int nthreads = 0;
+    app.add_option("-j,--nthreads", nthreads,
+                   "worker threads, each folding its share of the samples "
+                   "(def=0, all cores)")
+        ->check(CLI::NonNegativeNumber);
+    int gulp = 4096;
+    app.add_option("-g,--gulp", gulp, "samples read per block (def=4096)")
+        ->check(CLI::PositiveNumber);
+    bool use_mmap = false;
+    app.add_flag("-m,--mmap", use_mmap, "memory map the input files");
+    std::string engine = "buffered";
+    app.add_option("--engine", engine,
+                   "read engine: buffered, direct (O_DIRECT) or uring "
+                   "(def=buffered)")
+        ->check(CLI::IsMember({"buffered", "direct", "uring"}));
+    CLI11_PARSE(app, argc, argv);
+
+    MapReduceOptions opts;
+    opts.nthreads = nthreads;
+    opts.gulp     = gulp;
+    opts.use_mmap = use_mmap;
+    opts.engine   = read_engine_from_string(engine);
+    const auto start  = std::chrono::steady_clock::now();
+    const auto folder = fold_stream(filenames, params, opts, nstart, nsamp);
+
+    const double fold_sec = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+    SigprocHeader out_hdr = folder.profile_header();
+    std::vector<float> profiles;
+    if (fscrunch) {
+        // Weighted mean of the channels, bin by bin
+        const int nchans = out_hdr.get<HeaderKey::kNchans>();
+        const int nbins  = folder.nbins();
+        const auto nprof = static_cast<std::size_t>(folder.nsubints()) *
+                           folder.nrows() / nchans;
+        const auto sums    = folder.sums();
+        const auto weights = folder.weights();
+        profiles.assign(nprof * nbins, 0.0F);
+        for (std::size_t iprof = 0; iprof < nprof; ++iprof) {
+            for (int ibin = 0; ibin < nbins; ++ibin) {
+                double sum    = 0.0;
+                double weight = 0.0;
+                for (int ichan = 0; ichan < nchans; ++ichan) {
+                    const auto ii = (iprof * nchans + ichan) * nbins + ibin;
+                    sum += sums[ii];
+                    weight += weights[ii];
+                }
+                profiles[iprof * nbins + ibin] =
+                    weight > 0.0 ? static_cast<float>(sum / weight) : 0.0F;
+            }
+        }
+        const double foff = out_hdr.get<HeaderKey::kFoff>();
+        out_hdr = out_hdr.new_header(std::map<std::string, SighdrTypes>{
+            {"nchans", 1},
+            {"fch1", out_hdr.get_ref_freq("center")},
+            {"foff", foff * nchans}});
+    } else {
+        profiles = folder.profiles();
+    }
+
+    FilterbankWriter writer(outfile, out_hdr);
+    writer.write_block(profiles, static_cast<int>(profiles.size()));
+    writer.close();
+
+    // Every sample adds a weight of 1 to each of its profiles
+    const auto weights = folder.weights();
+    const double nfolded =
+        std::accumulate(weights.begin(), weights.end(), 0.0) / folder.nrows();
+    fmt::print(stderr,
+               "Folded {:.0f} samples ({} pulses) into {} x {} bins in "
+               "{:.3f} s ({:.3e} samples/s), wrote {}\n",
+               nfolded, out_hdr.get<HeaderKey::kNpuls>(), folder.nsubints(),
+               folder.nbins(), fold_sec, nfolded / std::max(fold_sec, 1e-9),
+               outfile);
+    return 0;
+}
@@ -10,8 +10,8 @@
 void print_header(const SigprocHeader& hdr) {
     constexpr auto kFormat = "{:<33}: {}\n";
     fmt::print(kFormat, "Data file", hdr.get<std::string>("rawdatafile"));
-    fmt::print(kFormat, "Header size (bytes)", hdr.get<int>("header_size"));
-    fmt::print(kFormat, "Data size (bytes)", hdr.get<int>("data_size"));
+    fmt::print(kFormat, "Header size (bytes)", hdr.get<int64_t>("header_size"));
+    fmt::print(kFormat, "Data size (bytes)", hdr.get<int64_t>("data_size"));
     fmt::print("{:<33}: {} ({})\n", "Data type",
                hdr.get<std::string>("datatype"), hdr.get<std::string>("frame"));
     fmt::print(kFormat, "Telescope", hdr.get<std::string>("telescope"));
@@ -70,7 +70,7 @@ void print_header(const SigprocHeader& hdr) {
     if (hdr.get<int>("data_type") != 3) {
         fmt::print("{:<33}: {:.5f}\n", "Sample time (us)",
                    hdr.get<double>("tsamp") * 1.0e6);
-        fmt::print(kFormat, "Number of samples", hdr.get<int>("nsamples"));
+        fmt::print(kFormat, "Number of samples", hdr.get<int64_t>("nsamples"));
         fmt::print(kFormat, "Observation length",
                    hdr.get<std::string>("tobs_str"));
     }
@@ -79,8 +79,10 @@ void print_header(const SigprocHeader& hdr) {
 }
 
 void header_help() {
-    for (const auto& param : kSigprocKeys) {
-        fmt::print("{:<15}- return {}\n", param.first, param.second.helpstr);
+    for (const auto& info : kHeaderKeys) {
+        if (info.in_file) {
+            fmt::print("{:<15}- return {}\n", info.name, info.helpstr);
+        }
     }
 }
 
@@ -106,32 +108,33 @@ int main(int argc, char** argv) {
         return 0;
     }
 
-    FilterbankReader filreader(filename);
+    FilReader filreader(filename);
 
     if (!token.empty()) {
-        std::map<std::string, sig_type> header_keys = sigproc_keys;
-        header_keys.insert(extra_keys.begin(), extra_keys.end());
-        if (utils::exists_key(header_keys, token)) {
-            sig_type type = header_keys.at(token);
-            switch (type) {
-            case sig_type::sInt: {
+        if (const auto key = find_key(token)) {
+            switch (key_info(*key).type) {
+            case KeyType::kSInt: {
                 fmt::print("{}", filreader.hdr.get<int>(token));
                 break;
             }
-            case sig_type::sDouble: {
+            case KeyType::kSLong: {
+                fmt::print("{}", filreader.hdr.get<int64_t>(token));
+                break;
+            }
+            case KeyType::kSDouble: {
                 fmt::print("{}", filreader.hdr.get<double>(token));
                 break;
             }
-            case sig_type::sBool: {
+            case KeyType::kSBool: {
                 fmt::print("{}", filreader.hdr.get<bool>(token));
                 break;
             }
-            case sig_type::sString: {
+            case KeyType::kSString: {
                 fmt::print("{}", filreader.hdr.get<std::string>(token));
                 break;
             }
             }
-        } else {
+    } else {
             header_help();
             fmt::print(stderr, "Unknown argument {} passed to header\n", token);
             return 0;
@@ -0,0 +1,166 @@
+/*
+    SEEK  - FFT periodicity search of dedispersed time series
+*/
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <fmt/core.h>
+
+#include <sigproc/io.hpp>
+#include <sigproc/parallel.hpp>
+#include <sigproc/periodicity.hpp>
+
+int main(int argc, char** argv) {
+    CLI::App app{"seek - search dedispersed time series for periodic "
+                 "signals with harmonic summing"};
+
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "time series (.tim) files, e.g. the output of "
+                   "sig_dedisperse, all with the same sampling time")
+        ->required()
+        ->check(CLI::ExistingFile);
+
+    std::string outfile = "seek.cands";
+    app.add_option("-o,--outfile", outfile,
+                   "binary candidate file (def=seek.cands)");
+    bool text = false;
+    app.add_flag("-t,--text", text,
+                 "also print the candidates: DM, frequency, period, "
+                 "harmonics, power and sigma");
+    PeriodSearchOptions options;
+    app.add_option("--harmonics", options.max_harmonics,
+                   "most harmonics summed: 1, 2, 4, 8, 16 or 32 (def=16)")
+        ->check(CLI::IsMember({1, 2, 4, 8, 16, 32}));
+    app.add_option("--thresh", options.threshold,
+                   "detection threshold in sigma (def=6)");
+    app.add_option("--fmin", options.fmin,
+                   "lowest fundamental frequency in Hz (def=0.1)")
+        ->check(CLI::NonNegativeNumber);
+    app.add_option("--fmax", options.fmax,
+                   "highest fundamental frequency in Hz (def=0, Nyquist)")
+        ->check(CLI::NonNegativeNumber);
+    app.add_option("-n,--ncands", options.max_candidates,
+                   "candidates kept per time series (def=100, 0 for all)")
+        ->check(CLI::NonNegativeNumber);
+    bool pad = false;
+    app.add_flag("-p,--pad", pad,
+                 "zero-pad the series to the next power of two instead of "
+                 "truncating them to an even length");
+    int nthreads = 0;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of series searched at once (def=0, all cores)")
+        ->check(CLI::NonNegativeNumber);
+    std::string wisdom = FFTPlanManager::default_wisdom_file();
+    app.add_option("-w,--wisdom", wisdom,
+                   "FFTW wisdom file (def=$SIGPROC_WISDOM or "
+                   "~/.sigproc_fftw_wisdom)");
+    CLI11_PARSE(app, argc, argv);
+
+    // Every series is read first for the transform length
+    std::vector<int64_t> lengths;
+    double tsamp = 0.0;
+    for (const auto& filename : filenames) {
+        const FilReader reader(filename);
+        const auto& hdr = reader.hdr;
+        if (hdr.get<HeaderKey::kNchans>() != 1 ||
+            hdr.get<HeaderKey::kNifs>() != 1) {
+            fmt::print(stderr, "Error: {} is not a time series\n", filename);
+            return 1;
+        }
+        if (tsamp == 0.0) {
+            tsamp = hdr.get<HeaderKey::kTsamp>();
+        } else if (hdr.get<HeaderKey::kTsamp>() != tsamp) {
+            fmt::print(stderr, "Error: {} has another sampling time\n",
+                       filename);
+            return 1;
+        }
+        lengths.push_back(hdr.get<HeaderKey::kNsamples>());
+    }
+    const int64_t nsamps = std::ranges::max(lengths);
+    const int64_t length =
+        pad ? static_cast<int64_t>(
+                  std::bit_ceil(static_cast<uint64_t>(nsamps)))
+            : nsamps - nsamps % 2;
+    if (length < 2 || length > std::numeric_limits<int>::max()) {
+        fmt::print(stderr, "Error: cannot transform {} samples\n", length);
+        return 1;
+    }
+    const int nfft = static_cast<int>(length);
+
+    auto& manager = FFTPlanManager::default_manager();
+    manager.set_wisdom_file(wisdom);
+    PeriodicitySearch search(nfft, tsamp, options);
+    fmt::print(stderr, "{} series, {} point FFTs, {:.3e} Hz bins, up to {} "
+                       "harmonics\n",
+               filenames.size(), nfft, search.bin_width(),
+               options.max_harmonics);
+
+    // A few series per thread are held in memory at a time
+    const int batch = 2 * resolve_nthreads(nthreads);
+    std::vector<float> series;
+    std::vector<double> dms;
+    std::vector<PeriodCandidate> cands;
+    double search_sec = 0.0;
+    const auto start  = std::chrono::steady_clock::now();
+    for (std::size_t first = 0; first < filenames.size(); first += batch) {
+        const auto last =
+            std::min(first + static_cast<std::size_t>(batch),
+                     filenames.size());
+        series.assign((last - first) * static_cast<std::size_t>(nfft), 0.0F);
+        dms.clear();
+        for (std::size_t ifile = first; ifile < last; ++ifile) {
+            FilReader reader(filenames[ifile]);
+            reader.seek_sample(0);
+            const auto one = std::span(series).subspan(
+                (ifile - first) * nfft,
+                static_cast<std::size_t>(
+                    std::min<int64_t>(lengths[ifile], nfft)));
+            const auto nread = reader.read_samples(one);
+            // Zero-pad about the mean, not about zero
+            const auto data = one.first(static_cast<std::size_t>(nread));
+            const double mean =
+                std::accumulate(data.begin(), data.end(), 0.0) /
+                static_cast<double>(std::max<int64_t>(nread, 1));
+            for (auto& value : data) {
+                value = static_cast<float>(value - mean);
+            }
+            dms.push_back(reader.hdr.get<HeaderKey::kRefdm>());
+        }
+        const auto search_start = std::chrono::steady_clock::now();
+        const auto found = search.search_many(series, nfft, dms, nthreads);
+        search_sec += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - search_start)
+                          .count();
+        cands.insert(cands.end(), found.begin(), found.end());
+    }
+    manager.save_wisdom();
+    write_period_candidates(outfile, cands);
+
+    if (text) {
+        fmt::print("# DM freq(Hz) period(ms) nharm power sigma\n");
+        for (const auto& cand : cands) {
+            fmt::print("{:.3f} {:.9f} {:.9f} {} {:.2f} {:.2f}\n", cand.dm,
+                       cand.freq, 1e3 / cand.freq, cand.nharm, cand.power,
+                       cand.sigma);
+        }
+    }
+    const double total_sec = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+    fmt::print(stderr,
+               "{} candidates from {} series in {:.3f} s ({:.1f} series/s "
+               "searching), total {:.3f} s\n",
+               cands.size(), filenames.size(), search_sec,
+               filenames.size() / std::max(search_sec, 1e-9), total_sec);
+    return 0;
+}
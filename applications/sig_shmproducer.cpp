@@ -0,0 +1,78 @@
+/*
+    SHMPRODUCER - stream a filterbank file into a shared memory ring
+*/
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <fmt/core.h>
+
+#include <sigproc/io.hpp>
+#include <sigproc/ringbuffer.hpp>
+
+int main(int argc, char** argv) {
+    CLI::App app{"shmproducer - test producer feeding a filterbank file into "
+                 "a shared memory ring, as a real-time backend would"};
+
+    std::string filename;
+    app.add_option("filename", filename, "the filterbank data file")
+        ->required()
+        ->check(CLI::ExistingFile);
+
+    std::string name = "shm:/sigproc";
+    app.add_option("-n,--name", name, "ring name (def=shm:/sigproc)");
+    std::size_t nslots = 64;
+    app.add_option("-s,--nslots", nslots, "number of ring slots (def=64)");
+    std::size_t slot_size = std::size_t{1} << 20;
+    app.add_option("-z,--slot-size", slot_size,
+                   "size of a ring slot in bytes (def=1048576)");
+    bool realtime = false;
+    app.add_flag("-r,--realtime", realtime,
+                 "pace the output at the sampling rate of the file");
+    double linger = 5.0;
+    app.add_option("-l,--linger", linger,
+                   "seconds to keep the ring alive after the last sample, so "
+                   "consumers can drain it (def=5)");
+    CLI11_PARSE(app, argc, argv);
+
+    const StreamInfo sinfo = read_stream_info({filename});
+    const FileInfo& info   = sinfo.entries().front();
+
+    // Consumers get the file header verbatim
+    std::vector<uint8_t> header(info.hdrlen);
+    std::ifstream stream(filename, std::ios::binary);
+    stream.read(reinterpret_cast<char*>(header.data()),
+                static_cast<std::streamsize>(header.size()));
+
+    FileReader reader(sinfo, "r", info.nbits);
+    ShmRingWriter ring(name, header, nslots, slot_size);
+    fmt::print(stderr, "Streaming {} into {}\n", filename, shm_name(name));
+
+    const double bytes_per_sec = static_cast<double>(info.nchans * info.nifs) *
+                                 info.nbits / 8.0 / info.tsamp;
+    std::vector<uint8_t> buffer(slot_size);
+    std::size_t nsent = 0;
+    const auto start  = std::chrono::steady_clock::now();
+    while (true) {
+        const auto nread = static_cast<std::size_t>(
+            reader.creadinto(std::span(buffer)));
+        if (nread == 0) {
+            break;
+        }
+        ring.write(std::span(buffer).first(nread));
+        nsent += nread;
+        if (realtime) {
+            std::this_thread::sleep_until(
+                start + std::chrono::duration<double>(
+                            static_cast<double>(nsent) / bytes_per_sec));
+        }
+    }
+    ring.finish();
+    fmt::print(stderr, "Sent {} bytes in {} slots\n", nsent,
+               ring.nslots_published());
+    std::this_thread::sleep_for(std::chrono::duration<double>(linger));
+    return 0;
+}
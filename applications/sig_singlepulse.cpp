@@ -0,0 +1,233 @@
+/*
+    SINGLEPULSE  - boxcar single-pulse search of dedispersed time series
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <fmt/core.h>
+
+#include <sigproc/io.hpp>
+#include <sigproc/overlap.hpp>
+#include <sigproc/singlepulse.hpp>
+
+namespace {
+
+// Time series open at once, well below the usual limit of 1024 descriptors
+constexpr int kMaxOpenSeries = 256;
+
+// Trial DMs of a DM-time plane, from the .dms file sig_dedisperse writes
+// next to it, otherwise from its channel axis
+std::vector<double> plane_dms(const std::string& filename,
+                              const SigprocHeader& hdr) {
+    std::vector<double> dms;
+    const auto dmfile =
+        std::filesystem::path(filename).replace_extension(".dms");
+    if (std::ifstream stream(dmfile); stream) {
+        double dm = 0.0;
+        while (stream >> dm) {
+            dms.push_back(dm);
+        }
+    }
+    const int nchans = hdr.get<HeaderKey::kNchans>();
+    if (dms.size() != static_cast<std::size_t>(nchans)) {
+        dms.clear();
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            dms.push_back(hdr.get<HeaderKey::kFch1>() +
+                          ichan * hdr.get<HeaderKey::kFoff>());
+        }
+    }
+    return dms;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CLI::App app{"singlepulse - boxcar search of dedispersed time series "
+                 "for single pulses"};
+
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "time series (.tim) files, or one DM-time plane written "
+                   "by sig_dedisperse --plane")
+        ->required()
+        ->check(CLI::ExistingFile);
+
+    std::string outfile;
+    app.add_option("-o,--outfile", outfile,
+                   "candidate list: sample, time, DM, width, S/N "
+                   "(def=stdout)");
+    SinglePulseOptions options;
+    app.add_option("--thresh", options.threshold,
+                   "detection threshold in S/N (def=6)");
+    app.add_option("--maxw", options.max_width,
+                   "widest boxcar in samples (def=64)")
+        ->check(CLI::PositiveNumber);
+    app.add_flag("--all-widths", options.all_widths,
+                 "try every width up to --maxw, not steps of about 1.5x");
+    app.add_option("--norm", options.norm_window,
+                   "samples per block of the running median and MAD "
+                   "(def=4096)")
+        ->check(CLI::PositiveNumber);
+    int gulp = 65536;
+    app.add_option("-g,--gulp", gulp,
+                   "start samples searched per block (def=65536)")
+        ->check(CLI::PositiveNumber);
+    int nthreads = 0;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of series searched at once (def=0, all cores)")
+        ->check(CLI::NonNegativeNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    // Headers first, one file at a time
+    std::vector<double> dms;
+    double tsamp   = 0.0;
+    int64_t nsamps = 0;
+    bool plane     = false;
+    for (std::size_t ifile = 0; ifile < filenames.size(); ++ifile) {
+        const FilReader reader(filenames[ifile]);
+        const auto& hdr = reader.hdr;
+        if (ifile == 0) {
+            tsamp  = hdr.get<HeaderKey::kTsamp>();
+            nsamps = hdr.get<HeaderKey::kNsamples>();
+            plane  = filenames.size() == 1 &&
+                    hdr.get<HeaderKey::kNchans>() > 1;
+            if (plane) {
+                dms = plane_dms(filenames.front(), hdr);
+                break;
+            }
+        }
+        if (hdr.get<HeaderKey::kNchans>() != 1 ||
+            hdr.get<HeaderKey::kNifs>() != 1 ||
+            hdr.get<HeaderKey::kTsamp>() != tsamp) {
+            fmt::print(stderr, "Error: {} is not a time series like {}\n",
+                       filenames[ifile], filenames.front());
+            return 1;
+        }
+        nsamps = std::min(nsamps, hdr.get<HeaderKey::kNsamples>());
+        dms.push_back(hdr.get<HeaderKey::kRefdm>());
+    }
+    const auto ndms = static_cast<int>(dms.size());
+    // Blocks overlap so the boxcars of their last starts are complete
+    const int overlap = options.max_width - 1;
+    fmt::print(stderr, "{} DM trials of {} samples, boxcars up to {} "
+                       "samples\n",
+               ndms, nsamps, overlap + 1);
+
+    std::vector<float> block;
+    std::vector<SinglePulseCandidate> cands;
+    double search_sec = 0.0;
+    int64_t nsearched = 0;
+    const auto start  = std::chrono::steady_clock::now();
+    // Time series are searched kMaxOpenSeries at a time, so that many trials
+    // do not exhaust the file descriptors
+    const int batch_size = plane ? 1 : kMaxOpenSeries;
+    for (int first = 0; first < static_cast<int>(filenames.size());
+         first += batch_size) {
+        const int nfiles =
+            std::min(batch_size, static_cast<int>(filenames.size()) - first);
+        const auto batch_dms =
+            plane ? std::span<const double>(dms)
+                  : std::span<const double>(dms).subspan(first, nfiles);
+        const auto nrows = static_cast<int>(batch_dms.size());
+        std::vector<std::unique_ptr<FilReader>> readers;
+        std::vector<std::unique_ptr<OverlapReader>> streams;
+        for (int ifile = first; ifile < first + nfiles; ++ifile) {
+            readers.push_back(std::make_unique<FilReader>(filenames[ifile]));
+            if (plane) {
+                readers.back()->set_layout(BlockLayout::kChannelMajor);
+            }
+            streams.push_back(std::make_unique<OverlapReader>(
+                *readers.back(), gulp + overlap, overlap, 0, nsamps));
+        }
+        while (true) {
+            // [nrows][nsamps_in], gathered row by row from the time series
+            int64_t block_start = 0;
+            int nsamps_in       = 0;
+            const float* data   = nullptr;
+            bool done           = false;
+            for (std::size_t istream = 0; istream < streams.size();
+                 ++istream) {
+                const auto next = streams[istream]->next();
+                if (!next) {
+                    done = true;
+                    break;
+                }
+                block_start = next->start_sample;
+                nsamps_in   = next->nsamps;
+                if (plane) {
+                    data = next->data.data();
+                    break;
+                }
+                block.resize(static_cast<std::size_t>(nrows) * nsamps_in);
+                std::ranges::copy(
+                    next->data.first(nsamps_in),
+                    block.begin() +
+                        static_cast<std::ptrdiff_t>(istream * nsamps_in));
+                data = block.data();
+            }
+            if (done) {
+                break;
+            }
+            const bool last      = block_start + nsamps_in >= nsamps;
+            const int nsamps_out = last ? nsamps_in : nsamps_in - overlap;
+            if (nsamps_out <= 0) {
+                break;
+            }
+            const auto search_start = std::chrono::steady_clock::now();
+            const auto found        = single_pulse_search(
+                std::span(data, static_cast<std::size_t>(nrows) * nsamps_in),
+                nsamps_in, nsamps_out, batch_dms, block_start, options,
+                nthreads);
+            search_sec += std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - search_start)
+                              .count();
+            nsearched += static_cast<int64_t>(nsamps_out) * nrows;
+            cands.insert(cands.end(), found.begin(), found.end());
+            if (last) {
+                break;
+            }
+        }
+    }
+
+    // Pulses split by a block boundary, then in order of time
+    cands = merge_single_pulses(std::move(cands));
+    std::ranges::sort(cands, [](const auto& lhs, const auto& rhs) {
+        return lhs.sample != rhs.sample ? lhs.sample < rhs.sample
+                                        : lhs.dm < rhs.dm;
+    });
+    std::FILE* file =
+        outfile.empty() ? stdout : std::fopen(outfile.c_str(), "w");
+    if (file == nullptr) {
+        fmt::print(stderr, "Error: could not open {}\n", outfile);
+        return 1;
+    }
+    fmt::print(file, "# sample time(s) DM width S/N\n");
+    for (const auto& cand : cands) {
+        fmt::print(file, "{} {:.6f} {:.3f} {} {:.2f}\n", cand.sample,
+                   cand.sample * tsamp, cand.dm, cand.width, cand.snr);
+    }
+    if (file != stdout) {
+        std::fclose(file);
+    }
+
+    const double total_sec = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+    const auto work = static_cast<double>(nsearched);
+    fmt::print(stderr,
+               "{} candidates, {} samples x {} DMs searched in {:.3f} s "
+               "({:.3e} samples*DMs/s), total {:.3f} s\n",
+               cands.size(), nsearched / std::max(ndms, 1), ndms, search_sec,
+               work / std::max(search_sec, 1e-9), total_sec);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*
+    SPECTRUM  - power spectra of time series and filterbank channels
+*/
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <fmt/core.h>
+
+#include <sigproc/exceptions.hpp>
+#include <sigproc/fft.hpp>
+#include <sigproc/io.hpp>
+
+namespace {
+
+void write_spectra(const std::string& outfile, bool text, double df,
+                   int nrows, int nbins, const auto& power) {
+    if (text) {
+        std::FILE* file =
+            outfile.empty() ? stdout : std::fopen(outfile.c_str(), "w");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + outfile);
+        }
+        for (int ibin = 0; ibin < nbins; ++ibin) {
+            fmt::print(file, "{:.9g}", ibin * df);
+            for (int irow = 0; irow < nrows; ++irow) {
+                fmt::print(file, " {:.6g}",
+                           static_cast<double>(
+                               power[static_cast<std::size_t>(irow) * nbins +
+                                     ibin]));
+            }
+            fmt::print(file, "\n");
+        }
+        if (file != stdout) {
+            std::fclose(file);
+        }
+        return;
+    }
+    // float32 [nrows][nbins]
+    std::ofstream stream(outfile, std::ios::binary | std::ios::trunc);
+    ErrorChecker::check_stream(stream, outfile);
+    std::vector<float> row(nbins);
+    for (int irow = 0; irow < nrows; ++irow) {
+        for (int ibin = 0; ibin < nbins; ++ibin) {
+            row[ibin] = static_cast<float>(
+                power[static_cast<std::size_t>(irow) * nbins + ibin]);
+        }
+        stream.write(reinterpret_cast<const char*>(row.data()),
+                     static_cast<std::streamsize>(row.size() * sizeof(float)));
+    }
+    ErrorChecker::check_stream(stream, outfile);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CLI::App app{"spectrum - power spectrum of a time series, or of every "
+                 "channel of a filterbank"};
+
+    std::vector<std::string> filenames;
+    app.add_option("filenames", filenames,
+                   "the time series or filterbank file(s), consecutive "
+                   "files of one observation are read as a single stream")
+        ->required()
+        ->check(CLI::ExistingFile);
+
+    std::string outfile;
+    app.add_option("-o,--outfile", outfile,
+                   "output file, float32 [nchans][nbins] (def=text on "
+                   "stdout)");
+    bool text = false;
+    app.add_flag("-t,--text", text,
+                 "write text columns: frequency, then the power of each "
+                 "channel");
+    int nfft = 0;
+    app.add_option("-n,--nfft", nfft,
+                   "transform length (def=the whole series, 1024 per "
+                   "channel for filterbanks)")
+        ->check(CLI::NonNegativeNumber);
+    bool pad = false;
+    app.add_flag("-p,--pad", pad,
+                 "zero-pad a time series to the next power of two");
+    int nthreads = 0;
+    app.add_option("-j,--nthreads", nthreads,
+                   "number of FFT threads (def=0, all cores)")
+        ->check(CLI::NonNegativeNumber);
+    std::string wisdom = FFTPlanManager::default_wisdom_file();
+    app.add_option("-w,--wisdom", wisdom,
+                   "FFTW wisdom file, loaded and updated so later runs skip "
+                   "planning (def=$SIGPROC_WISDOM or ~/.sigproc_fftw_wisdom)");
+    std::string effort = "measure";
+    app.add_option("-e,--effort", effort,
+                   "FFTW planning effort: estimate, measure or patient "
+                   "(def=measure)")
+        ->check(CLI::IsMember({"estimate", "measure", "patient"}));
+    std::string engine = "buffered";
+    app.add_option("--engine", engine,
+                   "read engine: buffered, direct (O_DIRECT) or uring "
+                   "(def=buffered)")
+        ->check(CLI::IsMember({"buffered", "direct", "uring"}));
+    CLI11_PARSE(app, argc, argv);
+
+    if (outfile.empty()) {
+        text = true;
+    }
+    auto& manager = FFTPlanManager::default_manager();
+    const std::map<std::string, FFTEffort> efforts{
+        {"estimate", FFTEffort::kEstimate},
+        {"measure", FFTEffort::kMeasure},
+        {"patient", FFTEffort::kPatient}};
+    manager.set_effort(efforts.at(effort));
+    const bool have_wisdom = manager.set_wisdom_file(wisdom);
+
+    FilReader reader(filenames, false, read_engine_from_string(engine));
+    const int nrows = reader.hdr.get<HeaderKey::kNchans>() *
+                      reader.hdr.get<HeaderKey::kNifs>();
+    const int64_t nsamples = reader.hdr.get<HeaderKey::kNsamples>();
+    const double tsamp     = reader.hdr.get<HeaderKey::kTsamp>();
+
+    const auto start = std::chrono::steady_clock::now();
+    double fft_sec   = 0.0;
+    int64_t npoints  = 0;
+    if (nrows == 1) {
+        // One transform of the whole series, zero-padded
+        int64_t length = nfft > 0 ? nfft : nsamples;
+        if (pad) {
+            length = static_cast<int64_t>(
+                std::bit_ceil(static_cast<uint64_t>(length)));
+        }
+        if (length > std::numeric_limits<int>::max()) {
+            fmt::print(stderr, "Error: {} points exceed the FFT size limit\n",
+                       length);
+            return 1;
+        }
+        FFTWVector<float> series(length, 0.0F);
+        reader.seek_sample(0);
+        reader.read_samples(
+            std::span(series).first(std::min(length, nsamples)));
+
+        PowerSpectrum spectrum(static_cast<int>(length), 1, nthreads);
+        std::vector<float> power(spectrum.nbins());
+        const auto fft_start = std::chrono::steady_clock::now();
+        spectrum.compute(series, power);
+        fft_sec = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - fft_start)
+                      .count();
+        npoints = length;
+        write_spectra(outfile, text, 1.0 / (length * tsamp), 1,
+                      spectrum.nbins(), power);
+    } else {
+        const int length = nfft > 0 ? nfft : 1024;
+        const auto fft_start = std::chrono::steady_clock::now();
+        const auto spectra   = channel_spectra(reader, length, nthreads);
+        fft_sec = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - fft_start)
+                      .count();
+        npoints = spectra.nblocks * length * nrows;
+        write_spectra(outfile, text, 1.0 / (length * tsamp), nrows,
+                      length / 2 + 1, spectra.power);
+    }
+    manager.save_wisdom();
+
+    const double total_sec = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+    fmt::print(stderr,
+               "{} points in {:.3f} s ({:.3e} points/s), planning {:.3f} s "
+               "({}), total {:.3f} s\n",
+               npoints, fft_sec, npoints / std::max(fft_sec, 1e-9),
+               manager.planning_seconds(),
+               have_wisdom ? "with wisdom" : "no wisdom", total_sec);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Allocation counters of a BufferPool.
+ */
+struct PoolStats {
+    std::size_t nallocs{};        // buffers obtained from the system
+    std::size_t nreuses{};        // requests served from the free lists
+    std::size_t nfrees{};         // buffers returned to the system
+    std::size_t bytes_in_use{};   // capacity currently handed out
+    std::size_t bytes_reserved{}; // capacity held, in use or free
+    std::size_t peak_bytes{};     // high-water mark of bytes_reserved
+};
+
+class BufferPool;
+
+/**
+ * @brief Move-only handle to a 64-byte aligned buffer owned by a BufferPool.
+ *
+ * The memory goes back to the pool's free lists when the handle is destroyed
+ * or released, so it can be reused by the next block without touching the
+ * system allocator.
+ */
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    ~PooledBuffer();
+
+    PooledBuffer(const PooledBuffer&)            = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+    uint8_t* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    std::size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+
+    std::span<uint8_t> bytes() const { return {m_data, m_size}; }
+
+    template <typename T> std::span<T> as() const {
+        return {reinterpret_cast<T*>(m_data), m_size / sizeof(T)};
+    }
+
+    /**
+     * @brief Change the size, drawing a larger buffer from the pool if the
+     * current capacity is too small. Contents are not preserved on growth.
+     */
+    void resize(std::size_t nbytes);
+
+    // Return the memory to the pool now
+    void release();
+
+private:
+    friend class BufferPool;
+    PooledBuffer(BufferPool* pool, uint8_t* data, std::size_t size,
+                 std::size_t capacity);
+
+    BufferPool* m_pool{nullptr};
+    uint8_t* m_data{nullptr};
+    std::size_t m_size{};
+    std::size_t m_capacity{};
+};
+
+/**
+ * @brief Thread-safe arena of aligned buffers for block I/O.
+ *
+ * Requests are rounded up to power-of-two size classes and released buffers
+ * are kept on per-class free lists, so a loop reading same-sized blocks
+ * reaches a fixed footprint after the first iteration. With use_hugepages,
+ * buffers of kHugePageSize and larger are mmap-ed from explicit huge pages
+ * when available, or from transparent huge pages otherwise.
+ *
+ * The pool must outlive every buffer it hands out.
+ */
+class BufferPool {
+public:
+    static constexpr std::size_t kAlignment    = 64;
+    static constexpr std::size_t kMinCapacity  = 4096;
+    static constexpr std::size_t kHugePageSize = std::size_t{1} << 21;
+
+    explicit BufferPool(bool use_hugepages = false);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&)            = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    BufferPool(BufferPool&&)                 = delete;
+    BufferPool& operator=(BufferPool&&)      = delete;
+
+    /**
+     * @brief Get a buffer of at least nbytes bytes.
+     *
+     * @param nbytes Requested size
+     * @return PooledBuffer Handle whose size() is nbytes
+     */
+    PooledBuffer acquire(std::size_t nbytes);
+
+    PoolStats stats() const;
+
+    // Give all free buffers back to the system
+    void trim();
+
+    // Process-wide pool used by the readers and writers
+    static BufferPool& default_pool();
+
+private:
+    friend class PooledBuffer;
+
+    bool m_hugepages;
+    mutable std::mutex m_mutex;
+    std::map<std::size_t, std::vector<uint8_t*>> m_free;
+    PoolStats m_stats;
+
+    void give_back(uint8_t* data, std::size_t capacity);
+    uint8_t* allocate(std::size_t capacity) const;
+    void deallocate(uint8_t* data, std::size_t capacity) const;
+    bool use_mmap(std::size_t capacity) const;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Header summary of one file of a catalogue.
+ */
+struct CatalogueEntry {
+    std::string path;
+    int64_t mtime{};      // last write time, ticks of the filesystem clock
+    uint64_t file_size{};
+    bool valid{false};    // false if the file is not a readable sigproc file
+    std::string source_name;
+    int telescope_id{};
+    int machine_id{};
+    int data_type{};
+    int nchans{};
+    int nbits{};
+    int nifs{};
+    int64_t nsamples{};
+    double tstart{}; // MJD
+    double tsamp{};  // s
+    double fch1{};   // MHz
+    double foff{};   // MHz
+    double src_raj{};
+    double src_dej{};
+
+    double ftop() const { return fch1 - 0.5 * foff; }
+    double fbottom() const { return ftop() + foff * nchans; }
+    double tobs() const { return tsamp * static_cast<double>(nsamples); }
+    // MJD of the end of the data
+    double tend() const { return tstart + tobs() / 86400.0; }
+
+    bool covers_freq(double freq) const;
+    bool covers_mjd(double mjd) const;
+};
+
+/**
+ * @brief Counts and timing of HeaderCatalogue::scan().
+ */
+struct ScanStats {
+    std::size_t nfiles{};  // files found
+    std::size_t nparsed{}; // headers read from disk
+    std::size_t ncached{}; // unchanged files taken from the cache
+    std::size_t nfailed{}; // files that are not sigproc files
+    double seconds{};
+
+    double files_per_second() const;
+    double parsed_per_second() const;
+};
+
+/**
+ * @brief Catalogue of the headers of many filterbank files.
+ *
+ * scan() walks directories and reads only the header bytes of each file on
+ * a pool of threads. The catalogue can be saved as a binary cache keyed by
+ * path, modification time and size, so that a later scan only parses the
+ * files that were added or changed.
+ *
+ * @code
+ * auto catalogue = HeaderCatalogue::load(cache);
+ * const auto stats = catalogue.scan({"/data/survey"});
+ * catalogue.save(cache);
+ * catalogue.write_csv(std::cout);
+ * @endcode
+ */
+class HeaderCatalogue {
+public:
+    /**
+     * @brief Load a catalogue cache, empty if it is missing or unusable.
+     */
+    static HeaderCatalogue load(const std::string& filename);
+
+    void save(const std::string& filename) const;
+
+    /**
+     * @brief Rebuild the catalogue from the files under roots.
+     *
+     * Entries of files that are unchanged since the last scan are reused,
+     * entries of files that no longer exist are dropped.
+     *
+     * @param roots      Directories, walked recursively, or single files
+     * @param nthreads   Number of parsing threads, 0 for all cores
+     * @param extensions File name extensions to consider, all if empty
+     */
+    ScanStats scan(const std::vector<std::string>& roots, int nthreads = 0,
+                   const std::vector<std::string>& extensions = {".fil"});
+
+    // Entries sorted by path, including those of non-sigproc files
+    const std::vector<CatalogueEntry>& entries() const { return m_entries; }
+
+    // Write the valid entries
+    static void write_csv(std::ostream& stream,
+                          const std::vector<CatalogueEntry>& entries);
+    static void write_json(std::ostream& stream,
+                           const std::vector<CatalogueEntry>& entries);
+
+private:
+    std::vector<CatalogueEntry> m_entries;
+};
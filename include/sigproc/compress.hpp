@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sigproc/fileIO.hpp>
+#include <sigproc/header.hpp>
+
+namespace sigproc {
+
+/**
+ * @brief Losslessly compress one chunk of packed filterbank data.
+ *
+ * The chunk is first filtered so that its bytes become predictable: 8-bit
+ * data are stored as the zigzag-coded difference from a per-channel
+ * reference (the rounded channel mean of the chunk), 16 and 32-bit data are
+ * byte-shuffled into planes, packed 1/2/4-bit data are left as is. Each
+ * resulting byte stream is then entropy coded with a canonical Huffman code.
+ * A chunk that does not shrink is stored raw.
+ *
+ * @param raw         Packed samples, a whole number of samples
+ * @param nbits       Number of bits per value
+ * @param stride_size Size of one time sample in bytes
+ * @return std::vector<uint8_t> Self-contained compressed chunk
+ */
+std::vector<uint8_t> compress_chunk(std::span<const uint8_t> raw, int nbits,
+                                    std::size_t stride_size);
+
+/**
+ * @brief Inverse of compress_chunk().
+ *
+ * @param packed      Compressed chunk
+ * @param raw         Output of exactly the original size
+ * @param nbits       Number of bits per value
+ * @param stride_size Size of one time sample in bytes
+ * @throws std::runtime_error if the chunk is corrupt
+ */
+void decompress_chunk(std::span<const uint8_t> packed, std::span<uint8_t> raw,
+                      int nbits, std::size_t stride_size);
+
+} // namespace sigproc
+
+/**
+ * @brief Chunked, losslessly compressed filterbank file.
+ *
+ * The file starts with an ordinary sigproc header. The data region holds a
+ * container header (magic, version, chunk length, nsamples, offset of the
+ * chunk index), the independently compressed chunks of chunk_nsamps time
+ * samples each, and the chunk index (offset and size of every chunk,
+ * relative to the data region). Any sample range can be decoded by reading
+ * only the chunks it overlaps, and chunks are decoded in parallel.
+ *
+ * FilReader reads these files transparently.
+ */
+class CompressedFile {
+public:
+    /**
+     * @brief Whether the data region of a sigproc file is a chunk container.
+     *
+     * @param filename    Sigproc file
+     * @param data_offset Size of its sigproc header
+     */
+    static bool is_compressed(const std::string& filename,
+                              std::size_t data_offset);
+
+    /**
+     * @brief Map a compressed file and load its chunk index.
+     *
+     * @param filename    Sigproc file
+     * @param data_offset Size of its sigproc header
+     * @param nbits       Number of bits per value
+     * @param stride_size Size of one time sample in bytes
+     */
+    CompressedFile(const std::string& filename, std::size_t data_offset,
+                   int nbits, std::size_t stride_size);
+
+    std::size_t nsamples() const { return m_nsamples; }
+    std::size_t chunk_nsamps() const { return m_chunk_nsamps; }
+    std::size_t nchunks() const { return m_index.size(); }
+    // Size of the compressed data region in bytes
+    std::size_t compressed_size() const;
+
+    /**
+     * @brief Decode the packed bytes of [start_sample, start_sample + nsamps).
+     *
+     * The last partially read chunk is cached, so consecutive reads smaller
+     * than a chunk decode each chunk once. Not safe for concurrent calls.
+     *
+     * @param out Output of nsamps * stride_size bytes
+     */
+    void read(std::size_t start_sample, std::size_t nsamps,
+              std::span<uint8_t> out) const;
+
+private:
+    struct ChunkEntry {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    MappedFile m_file;
+    std::size_t m_data_offset;
+    int m_nbits;
+    std::size_t m_stride_size;
+    std::size_t m_chunk_nsamps{};
+    std::size_t m_nsamples{};
+    std::vector<ChunkEntry> m_index;
+    mutable std::vector<uint8_t> m_cache;
+    mutable std::size_t m_cached_chunk;
+
+    std::size_t chunk_samples(std::size_t ichunk) const;
+    void decode(std::size_t ichunk, std::span<uint8_t> out) const;
+};
+
+/**
+ * @brief Writer of CompressedFile filterbanks.
+ *
+ * Blocks are packed to nbits, gathered into chunks and compressed in
+ * batches, one chunk per thread. The chunk index is written by close().
+ */
+class CompressedFilterbankWriter {
+public:
+    /**
+     * @brief Write the sigproc header and start the container.
+     *
+     * @param filename     File to create
+     * @param hdr          Header of the data
+     * @param chunk_nsamps Number of time samples per compressed chunk
+     */
+    CompressedFilterbankWriter(const std::string& filename,
+                               const SigprocHeader& hdr,
+                               std::size_t chunk_nsamps = 4096);
+    ~CompressedFilterbankWriter();
+
+    // Disable copy and move constructors
+    CompressedFilterbankWriter(const CompressedFilterbankWriter&) = delete;
+    CompressedFilterbankWriter&
+    operator=(const CompressedFilterbankWriter&)             = delete;
+    CompressedFilterbankWriter(CompressedFilterbankWriter&&) = delete;
+    CompressedFilterbankWriter&
+    operator=(CompressedFilterbankWriter&&) = delete;
+
+    /**
+     * @brief Append block_len values, a whole number of time samples.
+     */
+    void write_block(std::span<const float> block, int block_len);
+
+    /**
+     * @brief Compress the remaining data and write the chunk index.
+     */
+    void close();
+
+    std::size_t raw_bytes() const { return m_nsamples * m_stride_size; }
+    std::size_t compressed_bytes() const { return m_offset; }
+
+private:
+    std::string m_filename;
+    std::fstream m_stream;
+    int m_nbits;
+    std::size_t m_stride_size;
+    std::size_t m_chunk_nsamps;
+    std::size_t m_data_offset;
+    std::size_t m_offset{};
+    std::size_t m_nsamples{};
+    std::vector<uint8_t> m_raw;
+    std::vector<uint64_t> m_index;
+    bool m_closed{false};
+
+    void flush_chunks(bool final);
+};
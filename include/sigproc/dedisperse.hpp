@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include <sigproc/dmplan.hpp>
+#include <sigproc/io.hpp>
+
+/**
+ * @brief Brute-force dedispersion of one channel-major block.
+ *
+ * Output sample t of trial idm is the sum over channels of input sample
+ * t + delay(idm, chan) of that channel, so a block of nsamps_in samples
+ * yields nsamps_in - plan.max_delay() samples per trial. IFs are summed.
+ *
+ * The work is split into tiles of a few trials by a run of output samples.
+ * The accumulators of a tile stay in cache while every channel is added,
+ * and trials of a tile read nearly the same input rows. Tiles are spread
+ * over threads, the inner loop is vectorised over time.
+ *
+ * @param plan      Trials and their delays, all non-negative (e.g. from
+ * the top of the band)
+ * @param in        Channel-major [nifs][nchans][nsamps_in] block
+ * @param nsamps_in Number of time samples in the block
+ * @param nifs      Number of IFs in the block
+ * @param out       Output [ndms][nsamps_in - max_delay]
+ */
+void dedisperse_brute(const DMPlan& plan, std::span<const float> in,
+                      int nsamps_in, int nifs, std::span<float> out);
+
+/**
+ * @brief Algorithm used by dedisperse_stream().
+ *
+ * kBrute sums every trial of the plan, see dedisperse_brute(). kSubband
+ * dedisperses subbands at coarse DMs first, see SubbandDedisperser. kFDMT
+ * runs the FDMT, whose cost does not grow with the number of trials but
+ * which only resolves whole-sample delays across the band, see
+ * FDMT::dm_list().
+ */
+enum class DedispersionEngine { kBrute, kSubband, kFDMT };
+
+struct DedispersionOptions {
+    DedispersionEngine engine{DedispersionEngine::kBrute};
+    // kSubband: delay error allowed within a subband, in samples
+    double smearing{1.0};
+    // kSubband: number of subbands, 0 to choose it
+    int nsub{0};
+};
+
+/**
+ * @brief Overlap between blocks, in samples, needed by an engine.
+ */
+int dedispersion_overlap(const DMPlan& plan,
+                         const DedispersionOptions& options);
+
+/**
+ * @brief Receives each block of dedispersed time series.
+ *
+ * @param out          [ndms][nsamps] block of time series
+ * @param start_sample Time sample of the first output sample
+ * @param nsamps       Number of samples per trial in the block
+ */
+using DedispersionSink =
+    std::function<void(std::span<const float> out, int64_t start_sample,
+                       int nsamps)>;
+
+/**
+ * @brief Dedisperse [start, start + nsamps) of a stream, gulp by gulp.
+ *
+ * Blocks of gulp + overlap samples, overlapping by the maximum delay of
+ * the engine, are read with an OverlapReader in channel-major layout, so
+ * every input sample is read once. The series cover nsamples - overlap
+ * samples, see dedispersion_overlap().
+ *
+ * @param reader  Source of the data, its layout is restored on return
+ * @param plan    Trials and their delays
+ * @param gulp    Output samples per trial and block
+ * @param sink    Called with each block of output
+ * @param options Dedispersion algorithm and its settings
+ * @return int64_t Number of output samples per trial
+ */
+int64_t dedisperse_stream(FilReader& reader, const DMPlan& plan, int gulp,
+                          const DedispersionSink& sink, int64_t start = 0,
+                          int64_t nsamps                     = 0,
+                          const DedispersionOptions& options = {});
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+/**
+ * @brief Engine used by FileReader to fetch bytes from disk.
+ *
+ * kBuffered goes through std::fstream and the page cache. kDirect bypasses
+ * the page cache with O_DIRECT and issues aligned pread(2) requests from a
+ * small thread team. kUring submits the same aligned requests through
+ * io_uring and falls back to kDirect if the kernel does not support it.
+ */
+enum class ReadEngine { kBuffered, kDirect, kUring };
+
+ReadEngine read_engine_from_string(const std::string& name);
+
+/**
+ * @brief Positional reader for a single file bypassing the page cache.
+ *
+ * A read is split into chunk_size requests aligned to kAlignment, with up to
+ * queue_depth of them in flight at once. Data land in aligned bounce buffers
+ * and are copied out, so callers can use any offset, length and buffer.
+ */
+class DirectReader {
+public:
+    static constexpr std::size_t kAlignment = 4096;
+
+    DirectReader(const std::string& filename, ReadEngine engine,
+                 std::size_t queue_depth = 8,
+                 std::size_t chunk_size  = std::size_t{1} << 20);
+    ~DirectReader();
+
+    // Disable copy and move constructors
+    DirectReader(const DirectReader&)            = delete;
+    DirectReader& operator=(const DirectReader&) = delete;
+    DirectReader(DirectReader&&)                 = delete;
+    DirectReader& operator=(DirectReader&&)      = delete;
+
+    /**
+     * @brief Switch to another file, keeping the buffers and the ring.
+     *
+     * Readers of a multi-file stream move from file to file with this
+     * instead of setting up a new reader for each.
+     */
+    void open(const std::string& filename);
+
+    /**
+     * @brief The engine actually in use after any fallback.
+     */
+    ReadEngine engine() const { return m_engine; }
+    std::size_t size() const { return m_size; }
+
+    /**
+     * @brief Read up to buffer.size() bytes starting at offset.
+     *
+     * @param offset Byte offset in the file
+     * @param buffer Destination buffer
+     * @return std::size_t Number of bytes read, short only at end of file.
+     * Short io_uring completions before that are resubmitted for the rest.
+     */
+    std::size_t pread(std::size_t offset, std::span<uint8_t> buffer);
+
+private:
+    struct AlignedDeleter {
+        void operator()(uint8_t* ptr) const;
+    };
+    class Uring;
+
+    std::string m_filename;
+    ReadEngine m_engine;
+    std::size_t m_queue_depth;
+    std::size_t m_chunk_size;
+    int m_fd{-1};
+    std::size_t m_size{};
+    std::unique_ptr<uint8_t[], AlignedDeleter> m_bounce;
+    std::unique_ptr<Uring> m_uring;
+
+    void close_file();
+    std::size_t pread_threads(std::size_t offset, std::span<uint8_t> buffer);
+    std::size_t pread_uring(std::size_t offset, std::span<uint8_t> buffer);
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sigproc/header.hpp>
+
+/**
+ * @brief Trial DMs and their per-channel delays in samples.
+ *
+ * The delays of all trials are computed once into a contiguous
+ * [ndms][nchans] table of integer sample shifts relative to a reference
+ * frequency, the input of the dedispersers. Plans can be saved and reloaded,
+ * see load_or_build().
+ */
+class DMPlan {
+public:
+    /**
+     * @brief Generate a DM grid from smearing tolerances.
+     *
+     * Consecutive trials are spaced so that the smearing from being off by
+     * half a step stays within tolerance of the effective pulse width, the
+     * quadrature sum of the sampling time, the pulse width and the
+     * intra-channel dispersion smearing at each DM (as in dedisp).
+     *
+     * @param hdr         Header of the data, for tsamp and the band
+     * @param dm_min      First trial DM (pc cm^-3)
+     * @param dm_max      Last trial DM, the grid reaches at least this value
+     * @param pulse_width Intrinsic pulse width (s)
+     * @param tolerance   Allowed smearing, as a ratio of the effective width
+     */
+    static std::vector<double> generate_dm_list(const SigprocHeader& hdr,
+                                                double dm_min, double dm_max,
+                                                double pulse_width = 40e-6,
+                                                double tolerance   = 1.25);
+
+    /**
+     * @brief Compute the delay table of the given trials.
+     *
+     * @param hdr      Header of the data, for tsamp and the channel
+     * frequencies
+     * @param dms      Trial DMs
+     * @param ref_freq Reference frequency, see SigprocHeader::get_ref_freq()
+     */
+    DMPlan(const SigprocHeader& hdr, std::vector<double> dms,
+           const std::string& ref_freq = "top");
+
+    static DMPlan load(const std::string& filename);
+
+    /**
+     * @brief Load a saved plan if it was made for the same trials and data
+     * geometry, otherwise compute it and save it to filename.
+     */
+    static DMPlan load_or_build(const std::string& filename,
+                                const SigprocHeader& hdr,
+                                const std::vector<double>& dms,
+                                const std::string& ref_freq = "top");
+
+    void save(const std::string& filename) const;
+
+    std::size_t ndms() const { return m_dms.size(); }
+    int nchans() const { return m_nchans; }
+    double tsamp() const { return m_tsamp; }
+    double fch1() const { return m_fch1; }
+    double foff() const { return m_foff; }
+    double ref_freq() const { return m_ref_freq; }
+    const std::vector<double>& dms() const { return m_dms; }
+
+    // Delays of trial idm in samples, one per channel
+    std::span<const int32_t> delays(std::size_t idm) const;
+    // The whole [ndms][nchans] table
+    std::span<const int32_t> table() const { return m_delays; }
+
+    /**
+     * @brief Largest delay of the plan in samples.
+     *
+     * Blocks must overlap by this many samples to dedisperse every trial.
+     */
+    int32_t max_delay() const { return m_max_delay; }
+
+private:
+    int m_nchans{};
+    double m_tsamp{};
+    double m_fch1{};
+    double m_foff{};
+    double m_ref_freq{};
+    std::vector<double> m_dms;
+    std::vector<int32_t> m_delays;
+    int32_t m_max_delay{};
+
+    DMPlan() = default;
+    void compute_delays();
+    bool matches(const SigprocHeader& hdr, const std::vector<double>& dms,
+                 double ref_freq) const;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <sigproc/dmplan.hpp>
+
+/**
+ * @brief Fast Dispersion Measure Transform (Zackay & Ofek 2017).
+ *
+ * Sub-bands are merged pairwise in log2(nchans) iterations, each
+ * dedispersing every delay across a band from two halves, in
+ * O(nsamps * nchans * log nchans) rather than O(ndms * nchans * nsamps).
+ * The transform computes every whole-sample delay across the band up to
+ * that of the largest trial of the plan. Each trial reads the delay closest
+ * to its own, see dm_list() for the native grid.
+ *
+ * Delays refer to the top edge of the band and each channel is summed over
+ * its own intra-channel smearing, so output sample t of a trial matches
+ * that of a brute-force plan referenced to "top" within rounding.
+ */
+class FDMT {
+public:
+    /**
+     * @brief One trial per sample of delay across the band.
+     *
+     * @param hdr    Header of the data, for tsamp and the band
+     * @param dm_min First trial DM (pc cm^-3)
+     * @param dm_max Last trial DM, the grid reaches at least this value
+     */
+    static std::vector<double> dm_list(const SigprocHeader& hdr,
+                                       double dm_min, double dm_max);
+
+    /**
+     * @brief Build the iteration tables for the trials of a plan.
+     *
+     * Only the band and the trial DMs of the plan are used.
+     */
+    explicit FDMT(const DMPlan& plan);
+
+    std::size_t ndms() const { return m_rows.size(); }
+
+    /**
+     * @brief Delay across the band of the largest trial in samples.
+     *
+     * Blocks must overlap by this many samples, it can exceed the
+     * max_delay() of the plan by the smearing of the lowest channel.
+     */
+    int max_delay() const { return m_max_delay; }
+
+    // Row of the transform read by each trial, its delay across the band
+    std::span<const int> trial_delays() const { return m_rows; }
+
+    /**
+     * @brief Dedisperse one channel-major block, as dedisperse_brute().
+     *
+     * Iterations are threaded over their rows and vectorised over time.
+     * The state of the transform is kept between calls, so the memory use
+     * is set by the largest block.
+     *
+     * @param in        Channel-major [nifs][nchans][nsamps_in] block
+     * @param nsamps_in Number of time samples in the block
+     * @param nifs      Number of IFs in the block, they are summed
+     * @param out       Output [ndms][nsamps_in - max_delay()]
+     */
+    void execute(std::span<const float> in, int nsamps_in, int nifs,
+                 std::span<float> out);
+
+private:
+    // A row of an iteration: the sum of a row of the upper half and one of
+    // the lower half shifted by the delay across the upper half
+    struct MergeRow {
+        int64_t out_row;
+        int64_t upper_row;
+        int64_t lower_row; // -1 copies the upper row, for an unpaired band
+        int shift;
+        int delay; // across the merged band, the row is valid for
+                   // nsamps - delay samples
+    };
+
+    int m_nchans;
+    int m_max_delay{};
+    std::vector<int> m_chan_order;   // input channel of each band, ascending
+    std::vector<int> m_chan_delays;  // intra-channel delays of the first state
+    std::vector<int64_t> m_chan_rows; // first row of each channel
+    std::vector<std::vector<MergeRow>> m_iterations;
+    int64_t m_max_rows{};
+    std::vector<int> m_rows;
+    std::vector<float> m_state;
+    std::vector<float> m_next;
+
+    void init_state(std::span<const float> in, int nsamps, int nifs);
+};
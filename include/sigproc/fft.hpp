@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fftw3.h>
+
+#include <sigproc/io.hpp>
+
+/**
+ * @brief std::allocator replacement returning fftwf_malloc-ed memory.
+ *
+ * FFTW plans run on new arrays only when they are aligned like the arrays
+ * they were planned with, which fftwf_malloc guarantees.
+ */
+template <class T> struct FFTWAllocator {
+    using value_type = T;
+
+    FFTWAllocator() = default;
+    template <class U> FFTWAllocator(const FFTWAllocator<U>& /*other*/) {}
+
+    T* allocate(std::size_t n) {
+        void* ptr = fftwf_malloc(n * sizeof(T));
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+    void deallocate(T* ptr, std::size_t /*n*/) { fftwf_free(ptr); }
+
+    template <class U>
+    bool operator==(const FFTWAllocator<U>& /*other*/) const {
+        return true;
+    }
+};
+
+template <class T> using FFTWVector = std::vector<T, FFTWAllocator<T>>;
+
+// Interleaved re, im pair with the layout of fftwf_complex
+struct FFTComplex {
+    float re;
+    float im;
+};
+
+enum class FFTEffort { kEstimate, kMeasure, kPatient };
+
+/**
+ * @brief Thread-safe cache of FFTW plans with persistent wisdom.
+ *
+ * Plans are made once per transform size, batch count and thread count and
+ * kept until the manager is destroyed. Planning with kMeasure or kPatient
+ * times candidate algorithms, which can take much longer than the transform
+ * itself. The wisdom gathered is written to the wisdom file, so later runs
+ * on the same machine plan instantly.
+ */
+class FFTPlanManager {
+public:
+    FFTPlanManager() = default;
+    // Destroys the plans, the wisdom is saved first if it changed
+    ~FFTPlanManager();
+
+    FFTPlanManager(const FFTPlanManager&)            = delete;
+    FFTPlanManager& operator=(const FFTPlanManager&) = delete;
+    FFTPlanManager(FFTPlanManager&&)                 = delete;
+    FFTPlanManager& operator=(FFTPlanManager&&)      = delete;
+
+    // Process-wide manager shared by the spectrum functions
+    static FFTPlanManager& default_manager();
+
+    /**
+     * @brief Default wisdom file, $SIGPROC_WISDOM if set, otherwise
+     * $HOME/.sigproc_fftw_wisdom.
+     */
+    static std::string default_wisdom_file();
+
+    /**
+     * @brief Import the wisdom of filename, if it exists, and save new
+     * wisdom there.
+     *
+     * @return bool Whether wisdom was imported
+     */
+    bool set_wisdom_file(const std::string& filename);
+
+    // Export the wisdom if plans were made since it was loaded
+    void save_wisdom();
+
+    void set_effort(FFTEffort effort);
+
+    /**
+     * @brief Plan of howmany contiguous real-to-complex transforms of size
+     * n, from [howmany][n] floats to [howmany][n / 2 + 1] complex values.
+     *
+     * @param nthreads FFTW threads, 0 for all cores
+     */
+    fftwf_plan r2c(int n, int howmany = 1, int nthreads = 0);
+
+    std::size_t nplans() const;
+    // Wall time spent planning so far
+    double planning_seconds() const;
+
+private:
+    using PlanKey = std::tuple<int, int, int, FFTEffort>;
+
+    mutable std::mutex m_mutex;
+    std::map<PlanKey, fftwf_plan> m_plans;
+    FFTEffort m_effort{FFTEffort::kMeasure};
+    std::string m_wisdom_file;
+    bool m_dirty{false};
+    double m_planning_sec{};
+};
+
+/**
+ * @brief Power spectra of a batch of equal-length real series.
+ *
+ * @code
+ * PowerSpectrum spectrum(nfft, nchans);
+ * spectrum.accumulate(block, sums); // once per block
+ * @endcode
+ */
+class PowerSpectrum {
+public:
+    /**
+     * @param n        Points per series
+     * @param howmany  Series per batch
+     * @param nthreads FFTW and OpenMP threads, 0 for all cores
+     * @param manager  Source of the plan
+     */
+    PowerSpectrum(int n, int howmany = 1, int nthreads = 0,
+                  FFTPlanManager& manager = FFTPlanManager::default_manager());
+
+    int size() const { return m_n; }
+    int howmany() const { return m_howmany; }
+    // Frequency bins per series, DC to Nyquist
+    int nbins() const { return m_n / 2 + 1; }
+
+    /**
+     * @brief Complex spectra of [howmany][n] series, [howmany][nbins].
+     *
+     * Aligned input (e.g. an FFTWVector) is transformed in place of a copy.
+     * The result stays valid until the next call.
+     */
+    std::span<const FFTComplex> transform(std::span<const float> in);
+
+    // Power |X(f)|^2 of [howmany][n] series into [howmany][nbins]
+    void compute(std::span<const float> in, std::span<float> power);
+
+    // Add the power of [howmany][n] series to [howmany][nbins] sums
+    void accumulate(std::span<const float> in, std::span<double> sums);
+
+private:
+    int m_n;
+    int m_howmany;
+    int m_nthreads;
+    fftwf_plan m_plan;
+    FFTWVector<float> m_in;
+    FFTWVector<FFTComplex> m_out;
+};
+
+/**
+ * @brief Averaged per-channel spectra of a filterbank.
+ */
+struct ChannelSpectra {
+    int nfft{};
+    int nrows{};       // nifs * nchans, IF-major
+    int64_t nblocks{}; // number of nfft-sample blocks averaged
+    std::vector<double> power; // [nrows][nfft / 2 + 1]
+};
+
+/**
+ * @brief Average the power spectra of every channel over consecutive
+ * blocks of nfft samples.
+ *
+ * Blocks are read in channel-major layout and transformed as one batch of
+ * nifs * nchans series each. A partial last block is dropped.
+ *
+ * @param reader   Source of the data, its layout is restored on return
+ * @param nfft     Samples per transform
+ * @param nthreads FFTW and OpenMP threads, 0 for all cores
+ */
+ChannelSpectra channel_spectra(FilReader& reader, int nfft,
+                               int nthreads = 0);
@@ -1,10 +1,64 @@
 #pragma once
 
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <sigproc/buffer.hpp>
+#include <sigproc/direct_io.hpp>
 #include <sigproc/params.hpp>
 
+struct FileInfo {
+    std::string filename;
+    std::size_t hdrlen;  // header length in bytes
+    std::size_t datalen; // data length in bytes
+    std::size_t nsamples{};
+    double tstart{}; // MJD
+    double tsamp{};  // seconds
+    int nchans{1};
+    int nifs{1};
+    int nbits{8};
+};
+
+/**
+ * @brief Layout of a stream of data split over one or more files.
+ */
+class StreamInfo {
+public:
+    explicit StreamInfo(std::vector<FileInfo> entries);
+
+    const std::vector<FileInfo>& entries() const { return m_entries; }
+    std::vector<std::string> filenames() const;
+    std::size_t nsamples() const;
+
+    /**
+     * @brief Check that the files form one uninterrupted observation.
+     *
+     * All files must share nchans, nifs, nbits and tsamp, and each tstart
+     * must follow on from the end of the previous file to within half a
+     * sample. Throws std::runtime_error describing the first mismatch.
+     */
+    void check_contiguity() const;
+
+    /**
+     * @brief Offset of the first data byte of each file in the stream.
+     *
+     * Has one more element than entries(), the last being the total stream
+     * data length.
+     */
+    const std::vector<std::size_t>& cumsum_datalens() const {
+        return m_cumsum_datalens;
+    }
+
+private:
+    std::vector<FileInfo> m_entries;
+    std::vector<std::size_t> m_cumsum_datalens;
+};
+
 class FileBase {
 public:
     FileBase(const std::vector<std::string>& filenames, std::string mode);
@@ -17,38 +71,55 @@ public:
     FileBase(FileBase&&)                 = delete;
     FileBase& operator=(FileBase&&)      = delete;
 
-private:
+protected:
     std::vector<std::string> m_filenames;
     std::string m_mode;
-    std::fstream m_file_stream;
-    size_t m_ifileCur = SIZE_MAX;
+    mutable std::fstream m_file_stream;
+    mutable size_t m_ifileCur = SIZE_MAX;
+
+    void open_file(size_t ifile) const;
+    void close_current() const;
 
+private:
     std::unordered_map<std::string, std::ios_base::openmode> m_modeMap = {
         {"r", std::ios::in | std::ios::binary},
         {"w", std::ios::out | std::ios::binary}};
-
-    void open_file(size_t ifile);
-    void close_current();
 };
 
 class FileReader : public FileBase {
 public:
+    /**
+     * @brief Construct a new File Reader object
+     *
+     * @param stream_info Layout of the files making up the stream
+     * @param mode   File mode, only "r" makes sense here
+     * @param nbits  Number of bits per sample
+     * @param engine Engine used to fetch the bytes, see ReadEngine
+     */
     FileReader(const StreamInfo& stream_info, const std::string& mode = "r",
-               int nbits = 8);
-    int cur_data_pos_file() const;
-    int cur_data_pos_stream() const;
-    std::vector<uint8_t> cread(int nunits) const;
-    int creadinto(std::vector<uint8_t>& read_buffer,
-                  std::vector<uint8_t>& unpack_buffer);
-    void seek(int offset, int whence = 0) const;
+               int nbits = 8, ReadEngine engine = ReadEngine::kBuffered);
+    // Byte positions are 64-bit, files and streams can exceed 2 GB
+    int64_t cur_data_pos_file() const;
+    int64_t cur_data_pos_stream() const;
+    std::vector<uint8_t> cread(std::size_t nunits) const;
+    std::size_t creadinto(std::vector<uint8_t>& read_buffer,
+                          std::vector<uint8_t>& unpack_buffer);
+    // Raw read without unpacking, for callers converting straight to float
+    std::size_t creadinto(std::span<uint8_t> read_buffer);
+    void seek(int64_t offset, int whence = 0) const;
+    ReadEngine engine() const;
 
 private:
     StreamInfo sinfo;
     int nbits;
     BitsInfo bitsinfo;
+    ReadEngine engine_type;
+    mutable std::unique_ptr<DirectReader> direct;
 
     void _seek2hdr(int fileid) const;
-    void _seek_set(int offset) const;
+    void _seek_set(int64_t offset) const;
+    std::size_t read_stream(uint8_t* buffer, std::size_t nbytes) const;
+    std::size_t read_current(uint8_t* buffer, std::size_t nbytes) const;
 };
 
 class FileIO {
@@ -58,8 +129,10 @@ public:
      *
      * @param filename The name of filename to read/write
      * @param nbits number of bits in the data
+     * @param mode "r" to read, "w" to truncate and write, "a" to append
      */
-    FileIO(const std::string& filename, int nbits);
+    FileIO(const std::string& filename, int nbits,
+           const std::string& mode = "r");
 
     /**
      * @brief Destroy the File IO object
@@ -71,13 +144,110 @@ public:
     void read_data(std::vector<float>& block, int nread);
 
     /* write block of data to stream */
-    void write_data(const std::vector<float>& block, int nwrite);
+    void write_data(std::span<const float> block, int nwrite);
+
+    /* push buffered bytes to the OS, throws if any write failed */
+    void flush();
 
     /* get to the right place in the file stream. */
-    void seek_bytes(int nbytes, bool offset = false);
+    void seek_bytes(int64_t nbytes, bool offset = false);
 
 private:
+    std::string filename;
     int nbits;
     BitsInfo bitsinfo;
     std::fstream file_stream;
+    // Packed bytes of the current block, reused across calls
+    PooledBuffer scratch;
+};
+
+/**
+ * @brief Access pattern hints passed on to the kernel for mapped files.
+ *
+ * These map directly onto the corresponding madvise(2) advice values.
+ */
+enum class AccessPattern { kNormal, kSequential, kRandom, kWillNeed };
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The mapping stays valid for the lifetime of the object, so spans handed out
+ * by data() must not outlive it.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    // Disable copy and move constructors
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&)                 = delete;
+    MappedFile& operator=(MappedFile&&)      = delete;
+
+    size_t size() const { return m_size; }
+
+    /**
+     * @brief Get a view of the mapped bytes in [offset, offset + nbytes).
+     *
+     * @param offset Byte offset from the start of the file
+     * @param nbytes Number of bytes in the view
+     * @return std::span<const uint8_t> View of the mapped region
+     */
+    std::span<const uint8_t> data(size_t offset, size_t nbytes) const;
+
+    /**
+     * @brief Advise the kernel how the given byte range will be accessed.
+     *
+     * The range is expanded to page boundaries and clipped to the file size.
+     * Advice is only a hint, so failures are silently ignored.
+     *
+     * @param offset  Byte offset from the start of the file
+     * @param nbytes  Number of bytes in the range
+     * @param pattern Expected access pattern
+     */
+    void advise(size_t offset, size_t nbytes, AccessPattern pattern) const;
+
+private:
+    std::string m_filename;
+    int m_fd{-1};
+    uint8_t* m_addr{nullptr};
+    size_t m_size{0};
+};
+
+/**
+ * @brief Fixed-size output file written at arbitrary offsets with pwrite(2).
+ *
+ * The file is extended to size bytes when opened (existing leading bytes,
+ * e.g. a header, are kept), so several threads can fill disjoint byte ranges
+ * concurrently without any locking.
+ */
+class PositionalWriter {
+public:
+    PositionalWriter(const std::string& filename, size_t size);
+    ~PositionalWriter();
+
+    // Disable copy and move constructors
+    PositionalWriter(const PositionalWriter&)            = delete;
+    PositionalWriter& operator=(const PositionalWriter&) = delete;
+    PositionalWriter(PositionalWriter&&)                 = delete;
+    PositionalWriter& operator=(PositionalWriter&&)      = delete;
+
+    size_t size() const { return m_size; }
+
+    /**
+     * @brief Write all of data at the given byte offset.
+     *
+     * Safe to call from several threads as long as the ranges do not
+     * overlap.
+     */
+    void pwrite(size_t offset, std::span<const uint8_t> data) const;
+
+    // Flush written data to the device
+    void sync() const;
+
+private:
+    std::string m_filename;
+    int m_fd{-1};
+    size_t m_size{0};
 };
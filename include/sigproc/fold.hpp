@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sigproc/header.hpp>
+#include <sigproc/parallel.hpp>
+
+struct FoldParams {
+    double period{};  // folding period at the first sample (s)
+    double pdot{0.0}; // period derivative (s/s)
+    double dm{0.0};   // dispersion delays removed from each channel
+    int nbins{64};    // phase bins per period
+    int nsubints{1};  // sub-integrations, equal shares of the samples
+};
+
+/**
+ * @brief Folds time-major blocks into phase-resolved profiles.
+ *
+ * Sample n of channel c covers the phase interval of the emission times
+ * [n tsamp - d_c, (n + 1) tsamp - d_c), with d_c the dispersion delay of
+ * the channel from the top of the band. The phase follows
+ * phi(t) = t / P - pdot t^2 / (2 P^2) from the first sample of the data.
+ * Each sample is shared among the bins its interval overlaps in
+ * proportion to the overlap, and the same fractions are added to the
+ * weights of the bins, so profiles() is the mean sample value in each bin
+ * whatever the ratio of bin width to sampling time.
+ *
+ * Sums are kept per [nsubints][nifs][nchans][nbins]. Folders of the same
+ * data and parameters can be merged, see fold_stream().
+ */
+class Folder {
+public:
+    /**
+     * @param hdr    Header of the data, for the sampling and the channels
+     * @param params Ephemeris, DM and output shape
+     * @param start  First sample folded, sub-integrations split the range
+     * @param nsamps Number of samples folded, 0 for the rest of the data,
+     * which must then be known (not a live ring)
+     */
+    Folder(const SigprocHeader& hdr, const FoldParams& params,
+           int64_t start = 0, int64_t nsamps = 0);
+
+    /**
+     * @brief Fold nsamps time-major samples of nifs * nchans values.
+     *
+     * Samples outside the range of the folder are skipped.
+     *
+     * @param block        [nsamps][nifs][nchans] samples
+     * @param start_sample Index of the first sample in the data
+     * @param nsamps       Number of samples in block
+     */
+    void add(std::span<const float> block, int64_t start_sample, int nsamps);
+
+    // Add the sums of a folder of the same data and parameters
+    void merge(const Folder& other);
+
+    int nbins() const { return m_params.nbins; }
+    int nsubints() const { return m_params.nsubints; }
+    // Profiles per sub-integration, nifs * nchans
+    int nrows() const { return m_nrows; }
+    const FoldParams& params() const { return m_params; }
+
+    // Rotation number at time t (s) from the first sample
+    double phase(double t) const;
+
+    /**
+     * @brief Mean profiles, [nsubints][nifs][nchans][nbins].
+     *
+     * Bins no sample reached are 0.
+     */
+    std::vector<float> profiles() const;
+    std::span<const double> sums() const { return m_sums; }
+    std::span<const double> weights() const { return m_weights; }
+    // Whole rotations between the start and the end of the range
+    int64_t npulses() const;
+
+    /**
+     * @brief Header of the folded data, data_type 3 (pulse profiles).
+     *
+     * nbins, period and npuls (pulses folded) describe the fold and refdm
+     * is the folding DM. The data are nsubints blocks of nifs * nchans
+     * float32 profiles, so nsamples counts nsubints * nbins values per
+     * profile.
+     */
+    SigprocHeader profile_header() const;
+
+private:
+    SigprocHeader m_hdr;
+    FoldParams m_params;
+    int m_nchans{};
+    int m_nrows{};
+    int64_t m_start{};
+    int64_t m_end{};
+    double m_tsamp{};
+    std::vector<double> m_delays; // s, one per channel
+    std::vector<double> m_sums;
+    std::vector<double> m_weights;
+};
+
+/**
+ * @brief Fold [start, start + nsamps) of a stream on several threads.
+ *
+ * The range is split among workers (see parallel_map_reduce()), each
+ * folding its share into its own partial Folder. The partial sums are
+ * merged at the end, in sample order.
+ *
+ * @param filenames Files of the data, read as one stream
+ * @param params    Ephemeris, DM and output shape
+ * @param opts      Threads, gulp and memory mapping
+ * @param start     First sample
+ * @param nsamps    Number of samples, 0 for the rest of the data
+ */
+Folder fold_stream(const std::vector<std::string>& filenames,
+                   const FoldParams& params, const MapReduceOptions& opts = {},
+                   int64_t start = 0, int64_t nsamps = 0);
@@ -1,23 +1,79 @@
 #pragma once
 
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <map>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <sigproc/params.hpp>
 
+/**
+ * @brief Typed storage of the header keys, one array per value type.
+ *
+ * The field of each key is fixed at compile time by kKeySlots.
+ */
+struct HeaderFields {
+    std::array<int, count_keys(KeyType::kSInt)> ints{};
+    std::array<int64_t, count_keys(KeyType::kSLong)> longs{};
+    std::array<double, count_keys(KeyType::kSDouble)> doubles{};
+    std::array<bool, count_keys(KeyType::kSBool)> bools{};
+    std::array<std::string, count_keys(KeyType::kSString)> strings{};
+
+    template <KeyType Type> auto& of() {
+        if constexpr (Type == KeyType::kSInt) {
+            return ints;
+        } else if constexpr (Type == KeyType::kSLong) {
+            return longs;
+        } else if constexpr (Type == KeyType::kSDouble) {
+            return doubles;
+        } else if constexpr (Type == KeyType::kSBool) {
+            return bools;
+        } else {
+            return strings;
+        }
+    }
+    template <KeyType Type> const auto& of() const {
+        return const_cast<HeaderFields*>(this)->of<Type>();
+    }
+};
+
 class SigprocHeader {
 public:
-    SigprocHeader();
+    SigprocHeader() = default;
+
+    /**
+     * @brief Typed access to a known key, a plain field load.
+     *
+     * @code
+     * const int nchans = hdr.get<HeaderKey::kNchans>();
+     * @endcode
+     */
+    template <HeaderKey Key> const key_value_t<Key>& get() const {
+        return m_fields.of<key_info(Key).type>()
+            [kKeySlots[static_cast<std::size_t>(Key)]];
+    }
+
+    template <HeaderKey Key> void set(key_value_t<Key> value) {
+        m_fields.of<key_info(Key).type>()
+            [kKeySlots[static_cast<std::size_t>(Key)]] = std::move(value);
+    }
 
     /**
      * @brief Get the sigproc header value for given key.
      *
-     * It will throw boost::bad_get exception if you try to get it with
-     * the wrong type. Yeah, that's the price we pay for static typing.
+     * String-keyed compatibility layer over the typed fields, prefer
+     * get<HeaderKey>() in loops. Keys not in kHeaderKeys are looked up among
+     * those added with set().
      *
-     * It will throw Invalid_argument exception if the key cannot be found.
+     * It will throw std::runtime_error if the key cannot be found or if you
+     * try to get it with the wrong type.
      *
      * @tparam T  The data type of the value stored.
      * @param key The key to read.
@@ -28,7 +84,11 @@ public:
     /**
      * @brief Update/write the sigproc header value for given key.
      *
-     * TODO: Should we check types before updating?
+     * Values are converted to the type of a known key, so set("nsamples",
+     * 100) stores an int64_t and set("tsamp", 1) a double. Throws
+     * std::out_of_range if the value does not fit an int key and
+     * std::invalid_argument if it cannot be converted. Unknown keys are
+     * stored as given.
      *
      * @tparam T    The data type of the value.
      * @param key   The key to write/update the mapped value.
@@ -37,22 +97,60 @@ public:
     template <typename T> void set(const std::string& key, const T& value);
 
     [[nodiscard]] std::vector<float> get_freqs() const;
+
+    /**
+     * @brief Frequency (MHz) that dispersion delays are measured from.
+     *
+     * @param ref_freq "top" (upper edge of the band), "ch1" (centre of the
+     * first channel) or "center" (centre of the band)
+     */
+    [[nodiscard]] double get_ref_freq(const std::string& ref_freq) const;
+
+    /**
+     * @brief Dispersion delays (s) of each channel for a single DM.
+     *
+     * See DMPlan for the integer sample delays of many DMs.
+     */
     [[nodiscard]] std::vector<double>
     get_dm_delays(double dm, std::string ref_freq = "top") const;
 
     template <typename T>
-    SigprocHeader new_header(const std::map<std::string, T>& newmap);
+    SigprocHeader new_header(const std::map<std::string, T>& newmap) const;
 
     template <class BinaryStream> void tostream(BinaryStream& stream);
 
     bool fromfile(const std::string& filename);
 
+    /**
+     * @brief Parse the header at the start of a byte buffer, e.g. a mapping.
+     *
+     * Keys are matched in place and values copied straight into their typed
+     * fields, only string values allocate. The sizes are derived as for a
+     * file of file_size bytes, by default the size of the buffer.
+     *
+     * @param buffer    Bytes starting with HEADER_START
+     * @param file_size Size of the whole file, if the buffer holds less
+     * @return std::size_t Header size in bytes, 0 if the buffer does not
+     * start with a sigproc header
+     * @throws std::runtime_error if the header is truncated or corrupt
+     */
+    std::size_t frombuffer(std::span<const uint8_t> buffer,
+                           int64_t file_size = -1);
+
+    /**
+     * @brief Write the header to a file, truncating any existing content.
+     *
+     * @param filename The file to create.
+     */
+    void tofile(const std::string& filename) const;
+
     /**
      * @brief Read header data into a SigprocHeader (or similar) structure.
      *
      * Function attempts to read all standard sigproc header keywords.
      * Only header attributes with matching keywords are updated in the
-     * given Header object.
+     * given Header object. The stream is read to its end, which is taken as
+     * the end of the file, and parsed with frombuffer().
      *
      * @tparam BinaryStream
      * @param stream A binary stream to read header from.
@@ -62,31 +160,28 @@ public:
     template <class BinaryStream> bool fromstream(BinaryStream& stream);
 
 private:
-    std::map<std::string, SighdrTypes> m_data;
+    enum class ParseStatus { kOk, kNotSigproc, kTruncated };
+
+    HeaderFields m_fields;
+    // Keys outside kHeaderKeys, added with set()
+    std::map<std::string, SighdrTypes> m_custom;
 
     void update_internal();
     [[nodiscard]] std::vector<char> tobuffer() const;
 
-    /**
-     * @brief Read a string from a binary stream.
-     *
-     * @tparam BinaryStream  A binary stream type.
-     * @param stream  A binary stream to read data.
-     * @return std::string A string read from the stream.
-     */
-    template <class BinaryStream> std::string read_string(BinaryStream& stream);
+    template <typename T> void set_field(HeaderKey key, const T& value);
 
     /**
-     * @brief Read a key with value from a binary stream.
+     * @brief Parse the keys of a header held in buffer.
      *
-     * @tparam DataType   A data type of the value: int, long, float, double,
-     * unsigned char.
-     * @tparam BinaryStream A binary stream type.
-     * @param stream  A binary stream to read data.
-     * @return DataType  A value read from the stream.
+     * @param buffer      Bytes starting with HEADER_START
+     * @param header_size Set to the header size when complete
      */
-    template <class DataType, class BinaryStream>
-    DataType read_value(BinaryStream& stream);
+    ParseStatus parse_keys(std::span<const uint8_t> buffer,
+                           std::size_t& header_size);
+
+    // Set the sizes and the derived keys once the keys are parsed
+    void finish_parse(std::size_t header_size, int64_t file_size);
 
     /**
      * @brief Write a string to a binary stream.
@@ -96,7 +191,7 @@ private:
      * @param str     A string to be written.
      */
     template <class BinaryStream>
-    static void write_string(BinaryStream& stream, const std::string& str);
+    static void write_string(BinaryStream& stream, std::string_view str);
 
     /**
      * @brief Write a string to a buffer.
@@ -104,7 +199,7 @@ private:
      * @param buffer A buffer to write data.
      * @param str  A string to be written.
      */
-    static void write_string(std::vector<char>& buffer, const std::string& str);
+    static void write_string(std::vector<char>& buffer, std::string_view str);
 
     /**
      * @brief Write key with value to a binary stream.
@@ -117,7 +212,7 @@ private:
      * @param val     Keyword value.
      */
     template <class DataType, class BinaryStream>
-    static void write_value(BinaryStream& stream, const std::string& name,
+    static void write_value(BinaryStream& stream, std::string_view name,
                             const DataType& val);
 
     /**
@@ -130,6 +225,6 @@ private:
      * @param val Keyword value.
      */
     template <class DataType>
-    static void write_value(std::vector<char>& buffer, const std::string& name,
+    static void write_value(std::vector<char>& buffer, std::string_view name,
                             const DataType& val);
 };
@@ -6,53 +6,385 @@
 #include <algorithm>
 #include <stdexcept>
 #include <climits>  // CHAR_BIT (bits_per_byte)
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
 
+#include <sigproc/compress.hpp>
 #include <sigproc/fileIO.hpp>
 #include <sigproc/header.hpp>
+#include <sigproc/ringbuffer.hpp>
 
 using readplan_tuple = std::tuple<int, int, int>;
 
+/**
+ * @brief Order of the float blocks handed out by FilReader.
+ *
+ * kTimeMajor is the on-disk order [nsamps][nifs][nchans]. kChannelMajor is
+ * the corner-turned order [nifs][nchans][nsamps], where each channel of the
+ * block is a contiguous time series.
+ */
+enum class BlockLayout { kTimeMajor, kChannelMajor };
+
+/**
+ * @brief Read the headers of a list of files making up one stream.
+ *
+ * @param filenames Files in stream order
+ * @return StreamInfo Layout of the stream, not yet checked for contiguity
+ */
+StreamInfo read_stream_info(const std::vector<std::string>& filenames);
+
 class FilReader {
 public:
-    FilReader(std::string filename);
+    /**
+     * @brief Construct a new filterbank reader.
+     *
+     * @param filename The filterbank file to read, or a "shm:<name>" ring
+     * created by ShmRingWriter, whose header blob is a sigproc header. A
+     * ring can only be read forwards, or back within the retained slots.
+     * Compressed files (see CompressedFile) are decoded transparently.
+     * @param use_mmap Map the file into memory instead of streaming it. This
+     * enables the zero-copy view_block()/view_plan() accessors.
+     * @param engine Engine used to read the file when not mapped
+     */
+    explicit FilReader(const std::string& filename, bool use_mmap = false,
+                       ReadEngine engine = ReadEngine::kBuffered);
+
+    /**
+     * @brief Construct a reader over consecutive files of one observation.
+     *
+     * The files are presented as a single stream of samples: each file's
+     * header is skipped and reads may straddle file boundaries. The headers
+     * must describe a contiguous observation (see
+     * StreamInfo::check_contiguity). hdr is taken from the first file, with
+     * nsamples covering the whole stream. mmap mode needs a single file.
+     */
+    explicit FilReader(const std::vector<std::string>& filenames,
+                       bool use_mmap = false,
+                       ReadEngine engine = ReadEngine::kBuffered);
 
     ~FilReader();
 
+    // Disable copy and move constructors
+    FilReader(const FilReader&)            = delete;
+    FilReader& operator=(const FilReader&) = delete;
+    FilReader(FilReader&&)                 = delete;
+    FilReader& operator=(FilReader&&)      = delete;
+
+    /**
+     * @brief Plan the blocks covering [start, start + nsamps).
+     *
+     * Sample positions are 64-bit; block_len and skip of each block count
+     * values within one gulp and stay int.
+     */
     std::vector<readplan_tuple> get_readplan(int gulp, int skipback = 0,
-                                             int start = 0, int nsamps = 0);
+                                             int64_t start  = 0,
+                                             int64_t nsamps = 0);
 
     void read_plan(int block_len, std::vector<float>& block, int skip);
 
-    void read_block(int start_sample, int nsamps, std::vector<float>& block);
+    void read_block(int64_t start_sample, int nsamps,
+                    std::vector<float>& block);
+
+    void seek_sample(int64_t sample);
+
+    /**
+     * @brief Read whole time samples at the current position into out.
+     *
+     * Fills out in time-major order whatever the layout set with
+     * set_layout(), without an intermediate block.
+     *
+     * @param out Destination, its size is rounded down to whole samples
+     * @return int64_t Number of time samples read, short at the end of data
+     */
+    int64_t read_samples(std::span<float> out);
+
+    bool is_mapped() const { return mapfile != nullptr; }
+
+    /**
+     * @brief True for a live ring whose header carries no nsamples.
+     *
+     * hdr then reports 0 samples and the stream is read until the producer
+     * finishes it, i.e. until a read comes back short. Plans need an
+     * explicit sample count, stream such sources with PrefetchReader(reader,
+     * gulp) or OverlapReader instead.
+     */
+    bool is_unbounded() const {
+        return ring != nullptr && hdr.get<HeaderKey::kNsamples>() == 0;
+    }
+
+    /**
+     * @brief Set the layout of blocks returned by read_plan()/read_block().
+     *
+     * Channel-major blocks are corner-turned with a cache-blocked transpose
+     * after unpacking. Note that block_len and skip in read plans still
+     * count values, which are the same in both layouts.
+     */
+    void set_layout(BlockLayout new_layout) { layout = new_layout; }
+    BlockLayout get_layout() const { return layout; }
+
+    // Files, or the shm: ring, the reader was opened on
+    const std::vector<std::string>& get_sources() const { return sources; }
+
+    /**
+     * @brief Zero-copy view of the packed bytes of a block of samples.
+     *
+     * Only available in mmap mode. The view stays valid for the lifetime of
+     * the reader.
+     *
+     * @param start_sample First time sample of the block
+     * @param nsamps Number of time samples in the block
+     * @return std::span<const uint8_t> Raw (packed) bytes of the block
+     */
+    std::span<const uint8_t> view_block(int64_t start_sample,
+                                        int nsamps) const;
 
-    void seek_sample(int sample);
+    /**
+     * @brief Zero-copy typed view of a block of 8, 16 or 32-bit samples.
+     *
+     * @tparam T uint8_t, uint16_t or float, matching nbits of the file.
+     * Throws if the mapped data region is not suitably aligned for T.
+     */
+    template <typename T>
+    std::span<const T> view_block_as(int64_t start_sample, int nsamps) const {
+        if (sizeof(T) * CHAR_BIT != static_cast<size_t>(nbits)) {
+            throw std::invalid_argument(std::format(
+                "Cannot view {}-bit data as {}-bit type", nbits,
+                sizeof(T) * CHAR_BIT));
+        }
+        auto bytes = view_block(start_sample, nsamps);
+        if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(T) != 0) {
+            throw std::runtime_error(
+                "Mapped data region is not aligned for typed access, use "
+                "view_block() instead");
+        }
+        return {reinterpret_cast<const T*>(bytes.data()),
+                bytes.size() / sizeof(T)};
+    }
+
+    /**
+     * @brief Zero-copy counterpart of read_plan() for mmap mode.
+     *
+     * Returns a view of the next block_len units and advances the current
+     * position by block_len + skip units, hinting the kernel to prefetch the
+     * following block.
+     */
+    std::span<const uint8_t> view_plan(int block_len, int skip);
+
+    SigprocHeader hdr;
 
 private:
+    std::vector<std::string> sources;
     std::size_t bitfact;
     std::size_t itemsize;
     std::size_t stride_len;
     std::size_t stride_size;
+    std::size_t header_size;
     int nbits;
 
-    FileReader* fileio;
-    SigprocHeader* hdr;
+    std::unique_ptr<FileReader> fileio;
+    std::unique_ptr<MappedFile> mapfile;
+    std::unique_ptr<ShmRingReader> ring;
+    std::unique_ptr<CompressedFile> zfile;
+    PooledBuffer read_buf;
+    BlockLayout layout{BlockLayout::kTimeMajor};
+    std::vector<float> turn_buf;
+    // Current byte offset into the data region (mmap mode only)
+    std::size_t map_pos{0};
+    // Current time sample (compressed files only)
+    std::size_t z_sample{0};
+
+    std::size_t units_to_bytes(int nunits) const {
+        return static_cast<std::size_t>(nunits) * itemsize / bitfact;
+    }
+    // Signed byte offset of a read plan skip, negative to overlap blocks
+    int64_t skip_to_bytes(int skip) const {
+        const auto nbytes =
+            static_cast<int64_t>(units_to_bytes(std::abs(skip)));
+        return skip < 0 ? -nbytes : nbytes;
+    }
+    void unpack_to_float(std::span<const uint8_t> bytes,
+                         std::vector<float>& block, int nunits) const;
+    void read_stream(int nunits, std::vector<float>& block);
+    // Returns the number of values read into out
+    std::size_t read_stream(std::span<float> out);
+    void apply_layout(std::vector<float>& block);
 };
 
-class FilterbankWriter {
+/**
+ * @brief Channel-major float32 copy of a filterbank stream.
+ *
+ * Analyses that sweep the channels of the same data repeatedly can map this
+ * sidecar and read each channel as one contiguous time series. The file
+ * holds a kHeaderSize-byte block (magic, version, nchans, nifs, nsamples)
+ * followed by [nifs][nchans][nsamples] floats.
+ */
+class ChannelMajorFile {
 public:
-    FilterbankWriter(std::string filename, SigprocHeader& hdr) {
-        nbits = hdr.get<int>("nbits");
-        // Write the header
-        hdr.tofile(filename);
-        FileIO fileio(filename, nbits);
-    }
+    static constexpr std::size_t kHeaderSize = 4096;
 
-    ~FilterbankWriter() {}
+    /**
+     * @brief Corner-turn everything reader can read into a sidecar file.
+     *
+     * The reader is rewound and read to the end, its layout is restored.
+     *
+     * @param reader   Source of the data
+     * @param filename Sidecar to create, see sidecar_name()
+     * @param gulp     Number of time samples to corner-turn at a time
+     */
+    static void create(FilReader& reader, const std::string& filename,
+                       int gulp = 4096);
 
-    void write_block(const std::vector<float>& block, int block_len) {
-        fileio.write_data(block, block_len);
+    static std::string sidecar_name(const std::string& filename) {
+        return filename + ".cmaj";
     }
 
+    explicit ChannelMajorFile(const std::string& filename);
+
+    int nchans() const { return m_nchans; }
+    int nifs() const { return m_nifs; }
+    std::size_t nsamples() const { return m_nsamples; }
+
+    /**
+     * @brief Time series of one channel, valid for the object lifetime.
+     */
+    std::span<const float> channel(int ichan, int ipol = 0) const;
+
 private:
-    int nbits;
+    MappedFile m_file;
+    int m_nchans{};
+    int m_nifs{};
+    std::size_t m_nsamples{};
+};
+
+/**
+ * @brief Write a sigproc header followed by blocks of float data.
+ *
+ * With nbuffers > 0 the writer runs in write-behind mode: write_block copies
+ * the block into one of nbuffers queued buffers and returns, while a
+ * dedicated thread packs and writes them in order. write_block only waits
+ * when all buffers are queued, so memory stays bounded. An I/O error on the
+ * writer thread is rethrown by the next write_block, flush or close call.
+ */
+class FilterbankWriter {
+public:
+    /**
+     * @brief Create the file and write the header.
+     *
+     * @param filename Output file, truncated if it exists
+     * @param hdr      Header to write, its nbits sets the output format
+     * @param nbuffers Number of blocks that may be queued, 0 writes in the
+     * calling thread
+     */
+    FilterbankWriter(const std::string& filename, const SigprocHeader& hdr,
+                     std::size_t nbuffers = 0);
+
+    /**
+     * @brief Close the file. Errors are reported as warnings here, call
+     * close() explicitly to handle them.
+     */
+    ~FilterbankWriter();
+
+    // Disable copy and move constructors
+    FilterbankWriter(const FilterbankWriter&)            = delete;
+    FilterbankWriter& operator=(const FilterbankWriter&) = delete;
+    FilterbankWriter(FilterbankWriter&&)                 = delete;
+    FilterbankWriter& operator=(FilterbankWriter&&)      = delete;
+
+    /**
+     * @brief Write the first block_len values of block.
+     *
+     * The block can be reused as soon as the call returns.
+     */
+    void write_block(std::span<const float> block, int block_len);
+
+    /**
+     * @brief Wait until all queued blocks are written and flushed.
+     */
+    void flush();
+
+    /**
+     * @brief Flush, stop the writer thread and close the file.
+     *
+     * Further writes throw. Calling close() again has no effect.
+     */
+    void close();
+
+    bool is_async() const { return m_nbuffers > 0; }
+
+private:
+    struct Pending {
+        std::vector<float> data;
+        int block_len{};
+    };
+
+    std::string m_filename;
+    std::unique_ptr<FileIO> m_fileio;
+    std::size_t m_nbuffers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv_queued;
+    std::condition_variable m_cv_written;
+    std::deque<Pending> m_queue;
+    std::vector<std::vector<float>> m_spare; // recycled block buffers
+    bool m_busy{false};  // writer thread is writing a block
+    bool m_stop{false};
+    bool m_closed{false};
+    std::exception_ptr m_error;
+    std::thread m_thread;
+
+    void run();
+    // Wait for the queue to drain, then rethrow any writer error
+    void drain(std::unique_lock<std::mutex>& lock);
+};
+
+/**
+ * @brief Filterbank output of known length whose samples can be written in
+ * any order.
+ *
+ * The header is written and the file pre-sized to hold nsamples samples, so
+ * threads processing independent sample ranges can write their results
+ * straight to their final place with write_samples().
+ */
+class FilterbankRangeWriter {
+public:
+    /**
+     * @brief Create the file, write the header and size the data region.
+     *
+     * @param filename Output file, truncated if it exists
+     * @param hdr      Header to write, nsamples is set from the argument
+     * @param nsamples Number of time samples the file will hold
+     */
+    FilterbankRangeWriter(const std::string& filename,
+                          const SigprocHeader& hdr, std::size_t nsamples);
+
+    std::size_t nsamples() const { return m_nsamples; }
+    std::size_t stride_len() const { return m_stride_len; }
+
+    /**
+     * @brief Pack and write whole samples starting at start_sample.
+     *
+     * block.size() must be a multiple of stride_len(). Thread-safe for
+     * disjoint sample ranges.
+     */
+    void write_samples(std::size_t start_sample,
+                       std::span<const float> block) const;
+
+    // Flush everything to the device and close the file
+    void close();
+
+private:
+    std::size_t m_nsamples;
+    std::size_t m_stride_len;
+    std::size_t m_stride_size;
+    std::size_t m_header_size;
+    int m_nbits;
+    std::unique_ptr<PositionalWriter> m_file;
 };
@@ -79,4 +79,54 @@ void pack(std::span<const uint8_t> inbuffer, std::span<uint8_t> outbuffer,
 void pack_inplace(std::span<uint8_t> inbuffer, size_t nbits,
                   const std::string& bitorder);
 
+/**
+ * @brief Converts packed 1, 2, 4, 8, 16 or 32 bit data straight to float
+ *
+ * Packed data are expanded through per-byte float lookup tables and wider
+ * samples are converted with AVX2/AVX-512 where available, so the input is
+ * only read once.
+ *
+ * @param inbuffer Input buffer containing packed samples
+ * @param outbuffer Output buffer, its size is the number of samples
+ * @param nbits Number of bits per sample
+ * @param bitorder Bit order of the input packed data
+ */
+void unpack_to_float(std::span<const uint8_t> inbuffer,
+                     std::span<float> outbuffer, size_t nbits,
+                     const std::string& bitorder = "little");
+
+/**
+ * @brief Converts packed data to float, applying a per-channel scale/offset
+ *
+ * Computes out[i] = in[i] * scale[ichan] + offset[ichan], where ichan is
+ * i % scale.size(), i.e. the input must start at channel 0.
+ *
+ * @param inbuffer Input buffer containing packed samples
+ * @param outbuffer Output buffer, its size is the number of samples
+ * @param nbits Number of bits per sample
+ * @param scale Per-channel scale factors
+ * @param offset Per-channel offsets, same size as scale
+ * @param bitorder Bit order of the input packed data
+ */
+void unpack_to_float(std::span<const uint8_t> inbuffer,
+                     std::span<float> outbuffer, size_t nbits,
+                     std::span<const float> scale,
+                     std::span<const float> offset,
+                     const std::string& bitorder = "little");
+
+/**
+ * @brief Quantises float data to nbits and packs them into bytes
+ *
+ * Values are rounded and clipped to [0, 2^nbits - 1] (except for 32 bits,
+ * which are copied as is).
+ *
+ * @param inbuffer Input float samples
+ * @param outbuffer Output buffer of inbuffer.size() * nbits / 8 bytes
+ * @param nbits Number of bits per output sample
+ * @param bitorder Bit order of the output packed data
+ */
+void pack_from_float(std::span<const float> inbuffer,
+                     std::span<uint8_t> outbuffer, size_t nbits,
+                     const std::string& bitorder = "little");
+
 } // namespace sigproc
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <sigproc/io.hpp>
+
+/**
+ * @brief A block of gulp samples with its history from the previous block.
+ */
+struct OverlapBlock {
+    int64_t start_sample; // first time sample of data
+    int nsamps;           // time samples in data, history included
+    int nhistory;         // leading samples carried over from the last block
+    std::span<const float> data;
+};
+
+/**
+ * @brief Stream blocks that overlap by a fixed number of samples.
+ *
+ * This is the streaming counterpart of get_readplan(gulp, overlap): block i
+ * starts at start + i * (gulp - overlap) and consecutive blocks share
+ * overlap samples. Instead of seeking back and reading the shared samples
+ * again, the tail of each block is kept in memory and moved to the front of
+ * the next one, so every sample is read from the source exactly once.
+ *
+ * Blocks follow the reader's layout. The reader is positioned at start and
+ * must not be used by anyone else while the blocks are streamed. Each block
+ * stays valid until the following call to next().
+ *
+ * @code
+ * OverlapReader blocks(reader, gulp, max_delay);
+ * for (const auto& block : blocks) {
+ *     process(block.data, block.nsamps);
+ * }
+ * @endcode
+ */
+class OverlapReader {
+public:
+    /**
+     * @brief Set up the stream over [start, start + nsamps).
+     *
+     * @param reader  Source of the data
+     * @param gulp    Time samples per block, history included
+     * @param overlap Time samples shared by consecutive blocks, < gulp
+     * @param start   First time sample
+     * @param nsamps  Number of time samples, 0 for the rest of the data
+     */
+    OverlapReader(FilReader& reader, int gulp, int overlap,
+                  int64_t start = 0, int64_t nsamps = 0);
+
+    /**
+     * @brief Read the next block.
+     *
+     * @return std::optional<OverlapBlock> The next block, or empty once the
+     * range is exhausted.
+     */
+    std::optional<OverlapBlock> next();
+
+    // Time samples read from the source so far, each counted once
+    int64_t nsamples_read() const { return m_next - m_start; }
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = OverlapBlock;
+        using difference_type   = std::ptrdiff_t;
+
+        explicit Iterator(OverlapReader* owner) : m_owner(owner) { ++*this; }
+
+        const OverlapBlock& operator*() const { return *m_block; }
+        const OverlapBlock* operator->() const { return &*m_block; }
+        Iterator& operator++() {
+            m_block = m_owner->next();
+            return *this;
+        }
+        bool operator==(std::default_sentinel_t /*end*/) const {
+            return !m_block.has_value();
+        }
+
+    private:
+        OverlapReader* m_owner;
+        std::optional<OverlapBlock> m_block;
+    };
+
+    Iterator begin() { return Iterator(this); }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    FilReader& m_reader;
+    int m_gulp;
+    int m_overlap;
+    std::size_t m_stride_len;
+    int64_t m_start;
+    int64_t m_end;
+    int64_t m_next;          // next sample to read from the source
+    int64_t m_block_start{}; // first sample of the buffered block
+    int m_nbuffered{};       // time samples in m_buffer
+    bool m_started{false};
+    std::vector<float> m_buffer;
+    std::vector<float> m_turned;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sigproc/io.hpp>
+
+/**
+ * @brief A contiguous range of time samples.
+ */
+struct SampleRange {
+    int64_t start;
+    int64_t nsamps;
+};
+
+/**
+ * @brief Split [start, start + nsamps) into at most nparts ranges.
+ *
+ * Every range but the last starts and ends on a multiple of align samples
+ * from start, so that blocks of align samples never straddle two ranges.
+ * Empty ranges are dropped.
+ */
+std::vector<SampleRange> partition_samples(int64_t start, int64_t nsamps,
+                                           int nparts, int64_t align = 1);
+
+/**
+ * @brief Number of worker threads to use for a request of nthreads.
+ *
+ * 0 selects the hardware concurrency.
+ */
+int resolve_nthreads(int nthreads);
+
+/**
+ * @brief Run the OpenMP kernels of the calling thread on nthreads threads.
+ *
+ * Workers of parallel_map_reduce() use this so that nested kernels do not
+ * oversubscribe the cores. The previous setting is restored on destruction.
+ */
+class KernelThreadLimit {
+public:
+    explicit KernelThreadLimit(int nthreads);
+    ~KernelThreadLimit();
+
+    KernelThreadLimit(const KernelThreadLimit&)            = delete;
+    KernelThreadLimit& operator=(const KernelThreadLimit&) = delete;
+    KernelThreadLimit(KernelThreadLimit&&)                 = delete;
+    KernelThreadLimit& operator=(KernelThreadLimit&&)      = delete;
+
+private:
+    int m_previous;
+};
+
+/**
+ * @brief Options of parallel_map_reduce().
+ */
+struct MapReduceOptions {
+    int nthreads      = 0;     // worker threads, 0 for the hardware concurrency
+    int gulp          = 4096;  // time samples per block given to map
+    int64_t align     = 1;     // ranges split on multiples of align samples
+    bool use_mmap     = false; // map the file instead of streaming it
+    ReadEngine engine = ReadEngine::kBuffered; // read engine when not mapped
+};
+
+/**
+ * @brief Apply map to every block of a sample range, in parallel.
+ *
+ * [start, start + nsamps) is split into one range per worker (see
+ * partition_samples()). Each worker opens its own FilReader on filenames,
+ * so reads are positional and share no state, starts from a copy of init
+ * and streams its range in time-major blocks of up to gulp samples:
+ *
+ *     map(state, block, start_sample, nsamps)
+ *
+ * with block holding nsamps whole time samples. The state of the first
+ * worker is returned after folding the others into it in sample order with
+ * reduce(first, state), so the result does not depend on scheduling when
+ * reduce is associative. init should thus be an identity of reduce, e.g.
+ * zeroed sums. nsamps = 0 reads to the end of the data.
+ *
+ * A shm: ring can only be read by one consumer and is processed by a single
+ * worker, to its end when its header carries no nsamples. The first
+ * exception thrown by a worker is rethrown.
+ *
+ * @code
+ * auto bandpass = parallel_map_reduce(
+ *     filenames, 0, 0, std::vector<double>(nchans), opts,
+ *     [&](auto& sum, auto block, int64_t, int nsamps) {
+ *         sigproc::get_bpass(block, sum, nchans, nsamps);
+ *     },
+ *     [](auto& total, const auto& sum) { ... });
+ * @endcode
+ */
+template <typename State, typename Map, typename Reduce>
+State parallel_map_reduce(const std::vector<std::string>& filenames,
+                          int64_t start, int64_t nsamps, State init,
+                          const MapReduceOptions& opts, Map map,
+                          Reduce reduce) {
+    int nthreads = resolve_nthreads(opts.nthreads);
+    if (filenames.size() == 1 && is_shm_source(filenames[0])) {
+        nthreads = 1;
+    }
+
+    int64_t end;
+    int stride_len;
+    {
+        FilReader reader(filenames);
+        // A live ring is read until it ends
+        const int64_t nsamples = reader.is_unbounded()
+                                     ? std::numeric_limits<int64_t>::max()
+                                     : reader.hdr.get<HeaderKey::kNsamples>();
+        start = std::clamp<int64_t>(start, 0, nsamples);
+        end   = nsamps == 0 ? nsamples : std::min(nsamples, start + nsamps);
+        stride_len = reader.hdr.get<HeaderKey::kNchans>() *
+                     reader.hdr.get<HeaderKey::kNifs>();
+    }
+    // One worker needs no split, which also holds the open range of a ring
+    const auto ranges
+        = nthreads == 1
+              ? std::vector<SampleRange>{{start, end - start}}
+              : partition_samples(start, end - start, nthreads, opts.align);
+
+    auto run_range = [&](const SampleRange& range, State& state) {
+        FilReader reader(filenames, opts.use_mmap, opts.engine);
+        reader.seek_sample(range.start);
+        std::vector<float> block(static_cast<std::size_t>(opts.gulp) *
+                                 stride_len);
+        int64_t pos = range.start;
+        while (pos < range.start + range.nsamps) {
+            const auto want = static_cast<std::size_t>(std::min<int64_t>(
+                opts.gulp, range.start + range.nsamps - pos));
+            const int64_t nread = reader.read_samples(
+                std::span(block).first(want * stride_len));
+            if (nread <= 0) {
+                break;
+            }
+            map(state, std::span<const float>(block).first(nread * stride_len),
+                pos, static_cast<int>(nread));
+            pos += nread;
+        }
+    };
+
+    if (ranges.size() <= 1) {
+        for (const auto& range : ranges) {
+            run_range(range, init);
+        }
+        return init;
+    }
+
+    // Kernels called from map share the cores with the other workers
+    const int kernel_threads
+        = std::max(1, resolve_nthreads(0) / static_cast<int>(ranges.size()));
+    std::vector<State> states(ranges.size(), init);
+    std::vector<std::exception_ptr> errors(ranges.size());
+    std::vector<std::thread> threads;
+    threads.reserve(ranges.size());
+    for (std::size_t irange = 0; irange < ranges.size(); ++irange) {
+        threads.emplace_back([&, irange] {
+            try {
+                KernelThreadLimit limit(kernel_threads);
+                run_range(ranges[irange], states[irange]);
+            } catch (...) {
+                errors[irange] = std::current_exception();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    for (std::size_t irange = 1; irange < states.size(); ++irange) {
+        reduce(states[0], states[irange]);
+    }
+    return std::move(states[0]);
+}
@@ -1,76 +1,241 @@
 #pragma once
 
+#include <array>
 #include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <format>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 
 constexpr double kDMConst = 4.148808e3; // MHz^2 cm^3 pc^-1 s
 
-using SighdrTypes = std::variant<int, double, bool, std::string>;
-enum class KeyType { kSInt, kSDouble, kSBool, kSString };
+using SighdrTypes = std::variant<int, int64_t, double, bool, std::string>;
+
+/**
+ * @brief Type of a header key.
+ *
+ * kSLong keys hold sizes and counts that exceed 2^31 for large files. They
+ * are int64_t in memory; those stored in the file (nsamples) keep the
+ * standard 4-byte int there, written as 0 ("unknown, use the file size")
+ * when the value does not fit.
+ */
+enum class KeyType { kSInt, kSLong, kSDouble, kSBool, kSString };
+
+/**
+ * @brief Keys of SigprocHeader, in the order of kHeaderKeys.
+ */
+enum class HeaderKey : std::uint8_t {
+    kRawdatafile,
+    kSourceName,
+    kMachineId,
+    kTelescopeId,
+    kDataType,
+    kNchans,
+    kNbits,
+    kNifs,
+    kNbeams,
+    kIbeam,
+    kNsamples,
+    kNpuls,
+    kNbins,
+    kBarycentric,
+    kPulsarcentric,
+    kSigned,
+    kTstart,
+    kTsamp,
+    kFch1,
+    kFoff,
+    kRefdm,
+    kAzStart,
+    kZaStart,
+    kSrcRaj,
+    kSrcDej,
+    kPeriod,
+    // Derived keys, not stored in the file
+    kTelescope,
+    kBackend,
+    kDatatype,
+    kFrame,
+    kTobs,
+    kTobsStr,
+    kBandwidth,
+    kFtop,
+    kFbottom,
+    kFcenter,
+    kRa,
+    kDec,
+    kRaRad,
+    kDecRad,
+    kObsDate,
+    kHeaderSize,
+    kDataSize,
+    kFileSize,
+};
 
 struct KeyInfo {
+    HeaderKey key;
+    std::string_view name;
     KeyType type;
-    std::string helpstr;
+    bool in_file; // read from and written to sigproc files
+    std::string_view helpstr;
+};
+
+inline constexpr auto kHeaderKeys = std::to_array<KeyInfo>({
+    {HeaderKey::kRawdatafile, "rawdatafile", KeyType::kSString, true,
+     "original data file name"},
+    {HeaderKey::kSourceName, "source_name", KeyType::kSString, true,
+     "source name"},
+    {HeaderKey::kMachineId, "machine_id", KeyType::kSInt, true,
+     "sigproc backend ID"},
+    {HeaderKey::kTelescopeId, "telescope_id", KeyType::kSInt, true,
+     "sigproc telescope ID"},
+    {HeaderKey::kDataType, "data_type", KeyType::kSInt, true,
+     "sigproc data type ID"},
+    {HeaderKey::kNchans, "nchans", KeyType::kSInt, true,
+     "number of frequency channels"},
+    {HeaderKey::kNbits, "nbits", KeyType::kSInt, true,
+     "number of bits per time sample"},
+    {HeaderKey::kNifs, "nifs", KeyType::kSInt, true,
+     "number of seperate IF channels"},
+    {HeaderKey::kNbeams, "nbeams", KeyType::kSInt, true, "number of beams"},
+    {HeaderKey::kIbeam, "ibeam", KeyType::kSInt, true, "beam number"},
+    {HeaderKey::kNsamples, "nsamples", KeyType::kSLong, true,
+     "number of time samples"},
+    {HeaderKey::kNpuls, "npuls", KeyType::kSInt, true, " "},
+    {HeaderKey::kNbins, "nbins", KeyType::kSInt, true, " "},
+    {HeaderKey::kBarycentric, "barycentric", KeyType::kSBool, true,
+     "if data are barycentric"},
+    {HeaderKey::kPulsarcentric, "pulsarcentric", KeyType::kSBool, true,
+     "if data are pulsarcentric"},
+    {HeaderKey::kSigned, "signed", KeyType::kSBool, true,
+     "if data are signed"},
+    {HeaderKey::kTstart, "tstart", KeyType::kSDouble, true,
+     "time stamp of first sample (MJD)"},
+    {HeaderKey::kTsamp, "tsamp", KeyType::kSDouble, true, "sample time (us)"},
+    {HeaderKey::kFch1, "fch1", KeyType::kSDouble, true,
+     "frequency of channel 1 in MHz"},
+    {HeaderKey::kFoff, "foff", KeyType::kSDouble, true,
+     "channel bandwidth in MHz"},
+    {HeaderKey::kRefdm, "refdm", KeyType::kSDouble, true,
+     "reference dispersion measure"},
+    {HeaderKey::kAzStart, "az_start", KeyType::kSDouble, true,
+     "telescope Azimuth angle (deg)"},
+    {HeaderKey::kZaStart, "za_start", KeyType::kSDouble, true,
+     "telescope Zenith angle (deg)"},
+    {HeaderKey::kSrcRaj, "src_raj", KeyType::kSDouble, true,
+     "right ascension (J2000 hhmmss.ss)"},
+    {HeaderKey::kSrcDej, "src_dej", KeyType::kSDouble, true,
+     "declination (J2000 ddmmss.ss)"},
+    {HeaderKey::kPeriod, "period", KeyType::kSDouble, true,
+     "folding period (s)"},
+    {HeaderKey::kTelescope, "telescope", KeyType::kSString, false,
+     "Telescope name."},
+    {HeaderKey::kBackend, "backend", KeyType::kSString, false,
+     "Backend name."},
+    {HeaderKey::kDatatype, "datatype", KeyType::kSString, false,
+     "Data type."},
+    {HeaderKey::kFrame, "frame", KeyType::kSString, false,
+     "pulsar/bary/topocentric."},
+    {HeaderKey::kTobs, "tobs", KeyType::kSDouble, false, "Obs. length (s)."},
+    {HeaderKey::kTobsStr, "tobs_str", KeyType::kSString, false,
+     "Obs. length (readable)."},
+    {HeaderKey::kBandwidth, "bandwidth", KeyType::kSDouble, false,
+     "Frequency bandwidth (MHz)."},
+    {HeaderKey::kFtop, "ftop", KeyType::kSDouble, false, " "},
+    {HeaderKey::kFbottom, "fbottom", KeyType::kSDouble, false, " "},
+    {HeaderKey::kFcenter, "fcenter", KeyType::kSDouble, false,
+     "Centre frequency."},
+    {HeaderKey::kRa, "ra", KeyType::kSString, false,
+     "Right ascension ('hh:mm:ss.sss')."},
+    {HeaderKey::kDec, "dec", KeyType::kSString, false,
+     "Declination ('dd:mm:ss.sss')"},
+    {HeaderKey::kRaRad, "ra_rad", KeyType::kSDouble, false,
+     "Right ascension (radian)."},
+    {HeaderKey::kDecRad, "dec_rad", KeyType::kSDouble, false,
+     "Declination (radian))."},
+    {HeaderKey::kObsDate, "obs_date", KeyType::kSString, false,
+     "Gregorian date (YYYY-MM-DD)."},
+    {HeaderKey::kHeaderSize, "header_size", KeyType::kSLong, false,
+     "Header size in bytes."},
+    {HeaderKey::kDataSize, "data_size", KeyType::kSLong, false,
+     "Data size in bytes."},
+    {HeaderKey::kFileSize, "file_size", KeyType::kSLong, false,
+     "File size in bytes."},
+});
+
+constexpr const KeyInfo& key_info(HeaderKey key) {
+    return kHeaderKeys[static_cast<std::size_t>(key)];
+}
+
+static_assert(
+    [] {
+        for (std::size_t ii = 0; ii < kHeaderKeys.size(); ++ii) {
+            if (static_cast<std::size_t>(kHeaderKeys[ii].key) != ii) {
+                return false;
+            }
+        }
+        return true;
+    }(),
+    "kHeaderKeys must follow the order of HeaderKey");
+
+/**
+ * @brief Look up a key by name.
+ */
+constexpr std::optional<HeaderKey> find_key(std::string_view name) {
+    for (const auto& info : kHeaderKeys) {
+        if (info.name == name) {
+            return info.key;
+        }
+    }
+    return std::nullopt;
+}
+
+constexpr std::size_t count_keys(KeyType type) {
+    std::size_t count = 0;
+    for (const auto& info : kHeaderKeys) {
+        count += info.type == type ? 1 : 0;
+    }
+    return count;
+}
+
+/**
+ * @brief Position of each key among the keys of the same type, i.e. its
+ * field in the typed storage of SigprocHeader.
+ */
+inline constexpr auto kKeySlots = [] {
+    std::array<std::size_t, kHeaderKeys.size()> slots{};
+    std::array<std::size_t, 5> next{};
+    for (std::size_t ii = 0; ii < kHeaderKeys.size(); ++ii) {
+        slots[ii] = next[static_cast<std::size_t>(kHeaderKeys[ii].type)]++;
+    }
+    return slots;
+}();
+
+template <KeyType Type> struct KeyValue;
+template <> struct KeyValue<KeyType::kSInt> {
+    using type = int;
+};
+template <> struct KeyValue<KeyType::kSLong> {
+    using type = int64_t;
+};
+template <> struct KeyValue<KeyType::kSDouble> {
+    using type = double;
+};
+template <> struct KeyValue<KeyType::kSBool> {
+    using type = bool;
+};
+template <> struct KeyValue<KeyType::kSString> {
+    using type = std::string;
 };
 
-const std::unordered_map<KeyType, SighdrTypes> kDefaultKeyValues = {
-    {KeyType::kSInt, 0},
-    {KeyType::kSDouble, 0.0},
-    {KeyType::kSBool, false},
-    {KeyType::kSString, std::string()}};
-
-const std::unordered_map<std::string, KeyInfo> kSigprocKeys = {
-    {"rawdatafile", {KeyType::kSString, "original data file name"}},
-    {"source_name", {KeyType::kSString, "source name"}},
-    {"machine_id", {KeyType::kSInt, "sigproc backend ID"}},
-    {"telescope_id", {KeyType::kSInt, "sigproc telescope ID"}},
-    {"data_type", {KeyType::kSInt, "sigproc data type ID"}},
-    {"nchans", {KeyType::kSInt, "number of frequency channels"}},
-    {"nbits", {KeyType::kSInt, "number of bits per time sample"}},
-    {"nifs", {KeyType::kSInt, "number of seperate IF channels"}},
-    {"nbeams", {KeyType::kSInt, "number of beams"}},
-    {"ibeam", {KeyType::kSInt, "beam number"}},
-    {"nsamples", {KeyType::kSInt, "number of time samples"}},
-    {"npuls", {KeyType::kSInt, " "}},
-    {"nbins", {KeyType::kSInt, " "}},
-    {"barycentric", {KeyType::kSBool, "if data are barycentric"}},
-    {"pulsarcentric", {KeyType::kSBool, "if data are pulsarcentric"}},
-    {"signed", {KeyType::kSBool, "if data are signed"}},
-    {"tstart", {KeyType::kSDouble, "time stamp of first sample (MJD)"}},
-    {"tsamp", {KeyType::kSDouble, "sample time (us)"}},
-    {"fch1", {KeyType::kSDouble, "frequency of channel 1 in MHz"}},
-    {"foff", {KeyType::kSDouble, "channel bandwidth in MHz"}},
-    {"refdm", {KeyType::kSDouble, "reference dispersion measure"}},
-    {"az_start", {KeyType::kSDouble, "telescope Azimuth angle (deg)"}},
-    {"za_start", {KeyType::kSDouble, "telescope Zenith angle (deg)"}},
-    {"src_raj", {KeyType::kSDouble, "right ascension (J2000 hhmmss.ss)"}},
-    {"src_dej", {KeyType::kSDouble, "declination (J2000 ddmmss.ss)"}},
-    {"period", {KeyType::kSDouble, "folding period (s)"}}};
-
-const std::unordered_map<std::string, KeyInfo> kExtraKeys = {
-    {"telescope", {KeyType::kSString, "Telescope name."}},
-    {"backend", {KeyType::kSString, "Backend name."}},
-    {"datatype", {KeyType::kSString, "Data type."}},
-    {"frame", {KeyType::kSString, "pulsar/bary/topocentric."}},
-    {"tobs", {KeyType::kSDouble, "Obs. length (s)."}},
-    {"tobs_str", {KeyType::kSString, "Obs. length (readable)."}},
-    {"bandwidth", {KeyType::kSDouble, "Frequency bandwidth (MHz)."}},
-    {"ftop", {KeyType::kSDouble, " "}},
-    {"fbottom", {KeyType::kSDouble, " "}},
-    {"fcenter", {KeyType::kSDouble, "Centre frequency."}},
-    {"ra", {KeyType::kSString, "Right ascension ('hh:mm:ss.sss')."}},
-    {"dec", {KeyType::kSString, "Declination ('dd:mm:ss.sss')"}},
-    {"ra_rad", {KeyType::kSDouble, "Right ascension (radian)."}},
-    {"dec_rad", {KeyType::kSDouble, "Declination (radian))."}},
-    {"obs_date", {KeyType::kSString, "Gregorian date (YYYY-MM-DD)."}},
-    {"header_size", {KeyType::kSInt, "Header size in bytes."}},
-    {"data_size", {KeyType::kSInt, "Data size in bytes."}},
-    {"file_size", {KeyType::kSInt, "File size in bytes."}}};
+// C++ type of the value of a key
+template <HeaderKey Key>
+using key_value_t = typename KeyValue<key_info(Key).type>::type;
 
 const std::unordered_map<int, std::string> kTelescopeIds = {
     {0, "Fake"},       {1, "Arecibo"}, {2, "Ooty"},     {3, "Nancay"},
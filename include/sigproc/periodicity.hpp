@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sigproc/fft.hpp>
+
+/**
+ * @brief One periodicity candidate, as stored in a candidate file.
+ */
+struct PeriodCandidate {
+    double freq;   // fundamental frequency (Hz)
+    float dm;      // DM of the time series
+    float power;   // summed normalised power of the harmonics
+    float sigma;   // Gaussian-equivalent significance of power
+    int32_t nharm; // number of harmonics summed
+};
+
+struct PeriodSearchOptions {
+    // Most harmonics summed, a power of two up to 32
+    int max_harmonics{16};
+    // Detection threshold, in Gaussian sigma
+    double threshold{6.0};
+    // Range of fundamental frequencies searched (Hz), fmax 0 for Nyquist
+    double fmin{0.1};
+    double fmax{0.0};
+    // Candidates kept per time series, strongest first, 0 for all
+    int max_candidates{100};
+};
+
+/**
+ * @brief Normalise a power spectrum to unit mean noise power.
+ *
+ * The spectrum is split into blocks whose width grows from a few bins at
+ * low frequencies, where red noise varies quickly, to a few hundred bins.
+ * The local mean of each block is estimated from its median, which bright
+ * signals hardly move, and interpolated linearly between block centres.
+ * The DC bin is zeroed.
+ */
+void whiten_spectrum(std::span<float> power);
+
+/**
+ * @brief Gaussian-equivalent significance of a sum of nharm normalised
+ * noise powers reaching power.
+ *
+ * Such sums follow a Gamma(nharm, 1) distribution, whose tail probability
+ * is converted to the number of sigma with the same Gaussian tail.
+ */
+double harmonic_sum_sigma(double power, int nharm);
+
+/**
+ * @brief Power a sum of nharm normalised noise powers exceeds with the
+ * tail probability of sigma Gaussian sigma, the inverse of
+ * harmonic_sum_sigma().
+ */
+double harmonic_sum_threshold(double sigma, int nharm);
+
+/**
+ * @brief FFT periodicity search with incoherent harmonic summing.
+ *
+ * Each time series is mean-subtracted, zero-padded or truncated to nfft
+ * samples, transformed, whitened (see whiten_spectrum()) and summed over
+ * 1, 2, 4, ... max_harmonics harmonics. Local maxima above the threshold
+ * of each fold are candidates.
+ *
+ * The sum of h harmonics at bin k adds the powers at round(j * k / h) for
+ * j = 1 .. h. With k = h * q + r that bin is j * q + round(j * r / h), so
+ * each fold needs only a table of h offsets per harmonic. The tables fit
+ * in L1, every harmonic is read as a sequential stretched stream and the
+ * sum of 2h harmonics reuses that of h, adding only the odd j.
+ *
+ * @code
+ * PeriodicitySearch search(nfft, tsamp);
+ * auto cands = search.search_many(series, nsamps, dms);
+ * write_period_candidates("seek.cands", cands);
+ * @endcode
+ */
+class PeriodicitySearch {
+public:
+    /**
+     * @param nfft    Transform length, even
+     * @param tsamp   Sampling time of the series (s)
+     * @param options Harmonics, threshold and frequency range
+     */
+    PeriodicitySearch(int nfft, double tsamp, PeriodSearchOptions options = {});
+    ~PeriodicitySearch();
+
+    PeriodicitySearch(const PeriodicitySearch&)            = delete;
+    PeriodicitySearch& operator=(const PeriodicitySearch&) = delete;
+    PeriodicitySearch(PeriodicitySearch&&)                 = delete;
+    PeriodicitySearch& operator=(PeriodicitySearch&&)      = delete;
+
+    int nfft() const { return m_nfft; }
+    int nbins() const { return m_nfft / 2 + 1; }
+    // Frequency step of the spectrum (Hz)
+    double bin_width() const { return 1.0 / (m_nfft * m_tsamp); }
+    // Harmonics summed by each fold, 1, 2, 4, ...
+    const std::vector<int>& folds() const { return m_folds; }
+    // Summed-power threshold of each fold
+    const std::vector<double>& thresholds() const { return m_thresholds; }
+
+    /**
+     * @brief Search one time series.
+     *
+     * @param series Time series, any length
+     * @param dm     DM recorded in the candidates
+     */
+    std::vector<PeriodCandidate> search(std::span<const float> series,
+                                        double dm);
+
+    /**
+     * @brief Search many time series of equal length, spread over threads.
+     *
+     * @param series   [ndms][nsamps] time series
+     * @param nsamps   Samples per series
+     * @param dms      DM of each series
+     * @param nthreads Threads, 0 for all cores
+     * @return Candidates of every series, in the order of dms
+     */
+    std::vector<PeriodCandidate> search_many(std::span<const float> series,
+                                             int nsamps,
+                                             std::span<const double> dms,
+                                             int nthreads = 0);
+
+private:
+    struct Workspace;
+
+    int m_nfft;
+    double m_tsamp;
+    PeriodSearchOptions m_options;
+    int m_kmin{};
+    int m_kmax{};
+    std::vector<int> m_folds;
+    std::vector<double> m_thresholds;
+    // Per fold h, [h / 2][h] offsets of the odd harmonics
+    std::vector<std::vector<int32_t>> m_offsets;
+    std::unique_ptr<Workspace> m_work;
+
+    std::vector<PeriodCandidate> run(Workspace& work,
+                                     std::span<const float> series,
+                                     double dm) const;
+    void harmonic_sum(int ifold, std::span<const float> power,
+                      std::span<float> sums) const;
+};
+
+/**
+ * @brief Write candidates to a compact binary file: a short header and
+ * fixed-size records.
+ */
+void write_period_candidates(const std::string& filename,
+                             std::span<const PeriodCandidate> cands);
+
+std::vector<PeriodCandidate> read_period_candidates(
+    const std::string& filename);
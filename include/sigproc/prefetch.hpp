@@ -0,0 +1,114 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <sigproc/io.hpp>
+
+/**
+ * @brief Counters describing how well I/O and compute overlap.
+ *
+ * A large consumer stall means the pipeline is I/O bound, a large producer
+ * stall means it is compute bound and more buffers will not help.
+ */
+struct PrefetchStats {
+    std::size_t nblocks{};         // blocks handed to the consumer
+    std::size_t max_queue_depth{}; // most ready blocks seen at once
+    double mean_queue_depth{};     // ready blocks, averaged over pulls
+    double consumer_stall_sec{};   // time next() waited for data
+    double producer_stall_sec{};   // time the I/O thread waited for a buffer
+};
+
+struct PrefetchBlock {
+    int iread;
+    int block_len;
+    std::span<const float> data;
+};
+
+/**
+ * @brief Execute a read plan on a background I/O thread.
+ *
+ * Blocks are read into nbuffers rotating buffers while the consumer processes
+ * earlier ones, so the steady-state throughput is max(I/O, compute) rather
+ * than their sum. The reader must already be positioned at the start of the
+ * plan (seek_sample) and must not be used by anyone else until the prefetcher
+ * is destroyed.
+ */
+class PrefetchReader {
+public:
+    PrefetchReader(FilReader& reader, std::vector<readplan_tuple> plan,
+                   std::size_t nbuffers = 4);
+
+    /**
+     * @brief Read whole gulps from the current position instead of a plan.
+     *
+     * Reading stops after nsamps time samples, or at the first short block,
+     * which also covers streams of unknown length such as live rings (see
+     * FilReader::is_unbounded()).
+     *
+     * @param gulp   Time samples per block
+     * @param nsamps Time samples to read, 0 for the rest of the stream
+     */
+    PrefetchReader(FilReader& reader, int gulp, int64_t nsamps = 0,
+                   std::size_t nbuffers = 4);
+    ~PrefetchReader();
+
+    // Disable copy and move constructors
+    PrefetchReader(const PrefetchReader&)            = delete;
+    PrefetchReader& operator=(const PrefetchReader&) = delete;
+    PrefetchReader(PrefetchReader&&)                 = delete;
+    PrefetchReader& operator=(PrefetchReader&&)      = delete;
+
+    /**
+     * @brief Get the next block of the plan, waiting for it if needed.
+     *
+     * The returned block stays valid until the following call to next().
+     * Exceptions raised on the I/O thread are rethrown here.
+     *
+     * @return std::optional<PrefetchBlock> The next block, or empty at the
+     * end of the plan.
+     */
+    std::optional<PrefetchBlock> next();
+
+    PrefetchStats stats() const;
+
+private:
+    struct Slot {
+        int iread{};
+        int block_len{};
+        std::vector<float> data;
+    };
+
+    FilReader& m_reader;
+    std::vector<readplan_tuple> m_plan;
+    // Gulp mode when m_gulp_len > 0, values per block and in all
+    int m_gulp_len{};
+    int64_t m_total_len{};
+    std::vector<Slot> m_slots;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv_ready;
+    std::condition_variable m_cv_free;
+    std::size_t m_head{};  // next slot to hand to the consumer
+    std::size_t m_nready{};
+    bool m_holding{false}; // consumer still owns the slot before m_head
+    bool m_done{false};
+    bool m_stop{false};
+    std::exception_ptr m_error;
+
+    PrefetchStats m_stats;
+    double m_queue_depth_sum{};
+    std::thread m_thread;
+
+    void run();
+    // Wait for a free slot, false once the reader is being destroyed
+    bool wait_for_slot();
+    void publish();
+};
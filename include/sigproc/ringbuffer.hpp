@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Prefix marking a data source as a shared-memory ring, e.g.
+ * "shm:/beam0". Anything else is treated as a file name.
+ */
+inline constexpr std::string_view kShmPrefix = "shm:";
+
+bool is_shm_source(const std::string& source);
+
+/**
+ * @brief POSIX shared memory name of a "shm:" source, with a leading '/'.
+ */
+std::string shm_name(const std::string& source);
+
+struct RingControl;
+struct RingSlot;
+
+/**
+ * @brief Producer side of a shared-memory ring of fixed-size slots.
+ *
+ * The segment starts with a control block holding the ring geometry, an
+ * opaque header blob (the raw sigproc header) and the count of published
+ * slots, followed by per-slot sequence numbers and the slot data. The
+ * producer never waits for consumers: each slot is guarded by a sequence
+ * number (seqlock), so a consumer that falls more than nslots behind detects
+ * the overwrite instead of reading torn data. Any number of consumers can
+ * attach, each with its own read position.
+ *
+ * The segment is unlinked when the writer is destroyed.
+ */
+class ShmRingWriter {
+public:
+    /**
+     * @brief Create the shared memory segment.
+     *
+     * @param name      Shared memory name, see shm_name()
+     * @param header    Header blob made available to consumers
+     * @param nslots    Number of slots in the ring
+     * @param slot_size Size of each slot in bytes
+     */
+    ShmRingWriter(const std::string& name, std::span<const uint8_t> header,
+                  std::size_t nslots    = 64,
+                  std::size_t slot_size = std::size_t{1} << 20);
+    ~ShmRingWriter();
+
+    // Disable copy and move constructors
+    ShmRingWriter(const ShmRingWriter&)            = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+    ShmRingWriter(ShmRingWriter&&)                 = delete;
+    ShmRingWriter& operator=(ShmRingWriter&&)      = delete;
+
+    /**
+     * @brief Append bytes to the stream. Full slots are published at once,
+     * a partial slot waits for more data or finish().
+     */
+    void write(std::span<const uint8_t> data);
+
+    /**
+     * @brief Publish any partial slot and mark the end of the stream.
+     */
+    void finish();
+
+    std::uint64_t nslots_published() const;
+
+private:
+    std::string m_name;
+    std::size_t m_map_size{};
+    RingControl* m_control{nullptr};
+    RingSlot* m_slots{nullptr};
+    uint8_t* m_data{nullptr};
+    std::size_t m_fill{}; // bytes in the slot being filled
+    bool m_finished{false};
+
+    void begin_slot();
+    void publish_slot();
+};
+
+/**
+ * @brief Consumer side of a ShmRingWriter ring, read as a byte stream.
+ *
+ * The stream position is absolute, so a consumer can seek backwards as long
+ * as the data are still in the ring (the last nslots slots).
+ */
+class ShmRingReader {
+public:
+    /**
+     * @brief Attach to an existing ring.
+     *
+     * @param name    Shared memory name, see shm_name()
+     * @param timeout Seconds to wait for the ring to appear and, later, for
+     * each new slot before giving up
+     */
+    explicit ShmRingReader(const std::string& name, double timeout = 10.0);
+    ~ShmRingReader();
+
+    // Disable copy and move constructors
+    ShmRingReader(const ShmRingReader&)            = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+    ShmRingReader(ShmRingReader&&)                 = delete;
+    ShmRingReader& operator=(ShmRingReader&&)      = delete;
+
+    const std::vector<uint8_t>& header() const { return m_header; }
+    std::size_t nslots() const { return m_nslots; }
+    std::size_t slot_size() const { return m_slot_size; }
+
+    /**
+     * @brief Read up to buffer.size() bytes, waiting for the producer.
+     *
+     * @return std::size_t Bytes read, short only at the end of the stream
+     * @throws std::runtime_error if the producer overwrote unread data or no
+     * data arrived within the timeout
+     */
+    std::size_t read(std::span<uint8_t> buffer);
+
+    void seek(std::size_t pos) { m_pos = pos; }
+    std::size_t tell() const { return m_pos; }
+
+private:
+    std::string m_name;
+    double m_timeout;
+    std::size_t m_map_size{};
+    const RingControl* m_control{nullptr};
+    const RingSlot* m_slots{nullptr};
+    const uint8_t* m_data{nullptr};
+    std::size_t m_nslots{};
+    std::size_t m_slot_size{};
+    std::vector<uint8_t> m_header;
+    std::size_t m_pos{};
+
+    // Wait until slot seq is published, false if the stream ended before it
+    bool wait_for(std::uint64_t seq) const;
+};
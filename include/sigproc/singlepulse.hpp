@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief One single-pulse candidate.
+ */
+struct SinglePulseCandidate {
+    int64_t sample; // first sample of the boxcar
+    float dm;       // DM of the time series
+    int32_t width;  // boxcar width in samples
+    float snr;      // boxcar S/N
+};
+
+struct SinglePulseOptions {
+    // Widest boxcar in samples
+    int max_width{64};
+    // Every width 1 .. max_width, otherwise steps of about 1.5x
+    bool all_widths{false};
+    // Detection threshold in S/N
+    double threshold{6.0};
+    // Samples per block of the running median and MAD
+    int norm_window{4096};
+};
+
+/**
+ * @brief Boxcar widths of a search, 1, 2, 3, 4, 6, 8, 12, ... up to and
+ * including max_width, or every width when all_widths is set.
+ *
+ * A boxcar pulse between two of the stepped widths loses at most about
+ * 10 per cent of its S/N.
+ */
+std::vector<int> boxcar_widths(int max_width, bool all_widths = false);
+
+/**
+ * @brief Normalise a time series to zero median and unit robust rms.
+ *
+ * The median and the MAD of consecutive blocks of window samples are
+ * interpolated linearly between block centres, which follows baseline
+ * drifts while pulses and RFI spikes hardly move the estimates.
+ */
+void normalise_series(std::span<float> series, int window);
+
+/**
+ * @brief Boxcar search of a block of dedispersed time series.
+ *
+ * Each series is normalised (see normalise_series()) and turned into one
+ * prefix sum, from which every boxcar width costs a subtraction per sample
+ * (see sigproc::boxcar_max()). Only the best width of each start sample is
+ * kept, never the output of every boxcar. Runs of start samples above the
+ * threshold, together with starts inside the boxcar of their peak, give one
+ * candidate at the peak. Series are spread over threads.
+ *
+ * @param block        [ndms][nsamps_in] time series
+ * @param nsamps_in    Samples per series
+ * @param nsamps_out   Start samples searched, the first nsamps_out; the
+ * rest of the block only completes their boxcars
+ * @param dms          DM of each series
+ * @param start_sample Sample number of the first sample of the block
+ * @param options      Widths, threshold and normalisation
+ * @param nthreads     Threads, 0 for all cores
+ * @return Candidates ordered by DM trial, then by sample
+ */
+std::vector<SinglePulseCandidate> single_pulse_search(
+    std::span<const float> block, int nsamps_in, int nsamps_out,
+    std::span<const double> dms, int64_t start_sample,
+    const SinglePulseOptions& options = {}, int nthreads = 0);
+
+/**
+ * @brief Merge candidates of the same DM whose boxcars overlap or lie
+ * within gap samples, keeping the strongest, e.g. pulses split by a block
+ * boundary.
+ *
+ * @return Candidates ordered by DM, then by sample
+ */
+std::vector<SinglePulseCandidate> merge_single_pulses(
+    std::vector<SinglePulseCandidate> cands, int64_t gap = 0);
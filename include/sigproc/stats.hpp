@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sigproc/io.hpp>
+
+/**
+ * @brief Running summary of the values of one channel.
+ */
+struct ChannelStats {
+    double sum{};
+    double sumsq{};
+    float min{std::numeric_limits<float>::max()};
+    float max{std::numeric_limits<float>::lowest()};
+    uint64_t count{};
+
+    void merge(const ChannelStats& other);
+    double mean() const;
+    double stddev() const;
+};
+
+/**
+ * @brief Add a time-major block of nsamps x stride_len values to stats.
+ *
+ * @param block  Values in [nsamps][stride_len] order
+ * @param stats  One entry per element of a sample (nifs * nchans)
+ */
+void accumulate_stats(std::span<const float> block,
+                      std::span<ChannelStats> stats);
+
+/**
+ * @brief Per-chunk, per-channel summaries of a filterbank stream.
+ *
+ * Built in one pass over the data, the index answers statistics over any
+ * sample range by merging the summaries of the chunks it covers, reading
+ * raw samples only for the partial chunks at its edges. It is stored as a
+ * sidecar next to the data (see sidecar_name()) and checked against the
+ * data shape, file sizes and modification times when loaded.
+ */
+class ChunkStatsIndex {
+public:
+    /**
+     * @brief Build the index by reading the whole stream once.
+     *
+     * @param reader    Source of the data, rewound and read to the end
+     * @param chunk_len Number of time samples summarised per chunk
+     */
+    static ChunkStatsIndex build(FilReader& reader, int chunk_len = 32768);
+
+    /**
+     * @brief Load an index, checking that it describes reader's data.
+     *
+     * @throws std::runtime_error if the file is not an index, or the data
+     * changed shape, size or modification time since it was built
+     */
+    static ChunkStatsIndex load(const std::string& filename,
+                                const FilReader& reader);
+
+    /**
+     * @brief Load the sidecar if it is usable and has chunks of chunk_len
+     * samples, otherwise build and save it.
+     */
+    static ChunkStatsIndex load_or_build(const std::string& filename,
+                                         FilReader& reader,
+                                         int chunk_len = 32768);
+
+    static std::string sidecar_name(const std::string& filename) {
+        return filename + ".stats";
+    }
+
+    void save(const std::string& filename) const;
+
+    int chunk_len() const { return m_chunk_len; }
+    std::size_t stride_len() const { return m_stride_len; }
+    std::size_t nsamples() const { return m_nsamples; }
+    std::size_t nchunks() const;
+
+    // Summaries of chunk ichunk, one per element of a sample
+    std::span<const ChannelStats> chunk(std::size_t ichunk) const;
+
+    /**
+     * @brief Statistics of every channel over [start, start + nsamps).
+     *
+     * @param reader Source of the raw samples at the range edges
+     * @param start  First time sample
+     * @param nsamps Number of time samples, 0 for the rest of the stream
+     * @return std::vector<ChannelStats> One entry per element of a sample
+     */
+    std::vector<ChannelStats> query(FilReader& reader, std::size_t start,
+                                    std::size_t nsamps = 0) const;
+
+private:
+    int m_chunk_len{};
+    std::size_t m_stride_len{};
+    std::size_t m_nsamples{};
+    int m_nbits{};
+    // Total size and latest modification time of the data files
+    uint64_t m_data_size{};
+    int64_t m_data_mtime{};
+    std::vector<ChannelStats> m_stats;
+
+    void add_raw(FilReader& reader, std::size_t start, std::size_t nsamps,
+                 std::span<ChannelStats> stats) const;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <sigproc/dmplan.hpp>
+
+/**
+ * @brief Two-stage subband dedispersion.
+ *
+ * Channels are first dedispersed into nsub subbands at a coarse grid of
+ * DMs, each relative to the top channel of its subband. The subbands are
+ * then dedispersed at every trial of the plan, using the nearest coarse DM.
+ *
+ * The smearing budget bounds the delay error in samples that using the
+ * coarse DM adds within the widest subband (in delay), so it sets the
+ * coarse step. When nsub is not given, it is chosen among the divisors of
+ * nchans to minimise the work of both stages.
+ */
+class SubbandDedisperser {
+public:
+    /**
+     * @brief Choose the subbands and coarse grid for the trials of a plan.
+     *
+     * @param plan     Trials and the band, with non-negative delays
+     * @param smearing Delay error allowed within a subband, in samples
+     * @param nsub     Number of subbands dividing nchans, 0 to choose it
+     */
+    explicit SubbandDedisperser(const DMPlan& plan, double smearing = 1.0,
+                                int nsub = 0);
+
+    int nsub() const { return m_nsub; }
+    std::size_t ndms() const { return m_groups.size(); }
+    const std::vector<double>& coarse_dms() const { return m_coarse_dms; }
+
+    /**
+     * @brief Delay of the largest trial in samples, the sum of the largest
+     * delays of both stages.
+     *
+     * Blocks must overlap by this many samples.
+     */
+    int max_delay() const { return m_max_delay1 + m_max_delay2; }
+
+    // Brute-force additions per output sample over those of both stages
+    double speedup() const { return m_speedup; }
+
+    /**
+     * @brief Dedisperse one channel-major block, as dedisperse_brute().
+     *
+     * The subband series are kept between calls, so the memory use is set
+     * by the largest block.
+     *
+     * @param in        Channel-major [nifs][nchans][nsamps_in] block
+     * @param nsamps_in Number of time samples in the block
+     * @param nifs      Number of IFs in the block, they are summed
+     * @param out       Output [ndms][nsamps_in - max_delay()]
+     */
+    void execute(std::span<const float> in, int nsamps_in, int nifs,
+                 std::span<float> out);
+
+private:
+    int m_nchans;
+    int m_nsub{};
+    double m_speedup{};
+    std::vector<double> m_coarse_dms;
+    std::vector<int> m_groups;          // coarse DM of each trial
+    std::vector<int32_t> m_delays1;     // [nsub][ncoarse][nchans / nsub]
+    std::vector<int32_t> m_delays2;     // [ndms][nsub]
+    int m_max_delay1{};
+    int m_max_delay2{};
+    std::vector<float> m_subbands;      // [nsub][ncoarse][nsamps]
+};
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#include <sys/mman.h>
+
+#include <sigproc/buffer.hpp>
+
+PooledBuffer::PooledBuffer(BufferPool* pool, uint8_t* data, std::size_t size,
+                           std::size_t capacity)
+    : m_pool(pool), m_data(data), m_size(size), m_capacity(capacity) {}
+
+PooledBuffer::~PooledBuffer() { release(); }
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : m_pool(std::exchange(other.m_pool, nullptr)),
+      m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_capacity(std::exchange(other.m_capacity, 0)) {}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_pool     = std::exchange(other.m_pool, nullptr);
+        m_data     = std::exchange(other.m_data, nullptr);
+        m_size     = std::exchange(other.m_size, 0);
+        m_capacity = std::exchange(other.m_capacity, 0);
+    }
+    return *this;
+}
+
+void PooledBuffer::resize(std::size_t nbytes) {
+    if (nbytes <= m_capacity) {
+        m_size = nbytes;
+        return;
+    }
+    BufferPool& pool = m_pool != nullptr ? *m_pool : BufferPool::default_pool();
+    *this            = pool.acquire(nbytes);
+}
+
+void PooledBuffer::release() {
+    if (m_pool != nullptr && m_data != nullptr) {
+        m_pool->give_back(m_data, m_capacity);
+    }
+    m_pool     = nullptr;
+    m_data     = nullptr;
+    m_size     = 0;
+    m_capacity = 0;
+}
+
+BufferPool::BufferPool(bool use_hugepages) : m_hugepages(use_hugepages) {}
+
+BufferPool::~BufferPool() { trim(); }
+
+PooledBuffer BufferPool::acquire(std::size_t nbytes) {
+    const std::size_t capacity =
+        std::bit_ceil(std::max(nbytes, kMinCapacity));
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_free.find(capacity);
+        if (it != m_free.end() && !it->second.empty()) {
+            uint8_t* data = it->second.back();
+            it->second.pop_back();
+            m_stats.nreuses++;
+            m_stats.bytes_in_use += capacity;
+            return {this, data, nbytes, capacity};
+        }
+    }
+    uint8_t* data = allocate(capacity);
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.nallocs++;
+    m_stats.bytes_in_use += capacity;
+    m_stats.bytes_reserved += capacity;
+    m_stats.peak_bytes = std::max(m_stats.peak_bytes, m_stats.bytes_reserved);
+    return {this, data, nbytes, capacity};
+}
+
+PoolStats BufferPool::stats() const {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void BufferPool::trim() {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [capacity, buffers] : m_free) {
+        for (uint8_t* data : buffers) {
+            deallocate(data, capacity);
+            m_stats.nfrees++;
+            m_stats.bytes_reserved -= capacity;
+        }
+    }
+    m_free.clear();
+}
+
+BufferPool& BufferPool::default_pool() {
+    static BufferPool pool;
+    return pool;
+}
+
+void BufferPool::give_back(uint8_t* data, std::size_t capacity) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_free[capacity].push_back(data);
+    m_stats.bytes_in_use -= capacity;
+}
+
+uint8_t* BufferPool::allocate(std::size_t capacity) const {
+    if (use_mmap(capacity)) {
+        void* ptr = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED) {
+            // No reserved huge pages, ask for transparent ones instead
+            ptr = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            ::madvise(ptr, capacity, MADV_HUGEPAGE);
+        }
+        return static_cast<uint8_t*>(ptr);
+    }
+    void* ptr = std::aligned_alloc(kAlignment, capacity);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return static_cast<uint8_t*>(ptr);
+}
+
+void BufferPool::deallocate(uint8_t* data, std::size_t capacity) const {
+    if (use_mmap(capacity)) {
+        ::munmap(data, capacity);
+    } else {
+        std::free(data);
+    }
+}
+
+bool BufferPool::use_mmap(std::size_t capacity) const {
+    return m_hugepages && capacity >= kHugePageSize;
+}
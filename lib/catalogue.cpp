@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include <fmt/core.h>
+
+#include <sigproc/catalogue.hpp>
+#include <sigproc/exceptions.hpp>
+#include <sigproc/header.hpp>
+#include <sigproc/parallel.hpp>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::array<char, 8> kCatalogueMagic{'S', 'I', 'G', 'P',
+                                              'C', 'A', 'T', 'L'};
+constexpr uint32_t kCatalogueVersion = 1;
+
+struct CatalogueFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t nentries;
+};
+
+// Fixed-size part of a cached entry, followed by the path and source name
+struct EntryRecord {
+    int64_t mtime;
+    uint64_t file_size;
+    int64_t nsamples;
+    double tstart;
+    double tsamp;
+    double fch1;
+    double foff;
+    double src_raj;
+    double src_dej;
+    int32_t telescope_id;
+    int32_t machine_id;
+    int32_t data_type;
+    int32_t nchans;
+    int32_t nbits;
+    int32_t nifs;
+    uint32_t valid;
+    uint32_t path_len;
+    uint32_t source_len;
+    uint32_t reserved;
+};
+
+bool has_extension(const fs::path& path,
+                   const std::vector<std::string>& extensions) {
+    if (extensions.empty()) {
+        return true;
+    }
+    const auto ext = path.extension().string();
+    return std::ranges::find(extensions, ext) != extensions.end();
+}
+
+void add_file(const fs::directory_entry& file,
+              std::vector<CatalogueEntry>& found) {
+    CatalogueEntry entry;
+    entry.path      = file.path().string();
+    entry.file_size = file.file_size();
+    entry.mtime     = file.last_write_time().time_since_epoch().count();
+    found.push_back(std::move(entry));
+}
+
+// Regular files under roots with one of the extensions, sorted by path
+std::vector<CatalogueEntry>
+find_files(const std::vector<std::string>& roots,
+           const std::vector<std::string>& extensions) {
+    std::vector<CatalogueEntry> found;
+    for (const auto& root : roots) {
+        const fs::directory_entry root_entry(root);
+        if (root_entry.is_regular_file()) {
+            add_file(root_entry, found);
+            continue;
+        }
+        if (!root_entry.is_directory()) {
+            throw std::invalid_argument(
+                std::format("{} is not a file or directory", root));
+        }
+        for (const auto& file : fs::recursive_directory_iterator(
+                 root, fs::directory_options::skip_permission_denied)) {
+            if (file.is_regular_file() &&
+                has_extension(file.path(), extensions)) {
+                add_file(file, found);
+            }
+        }
+    }
+    std::ranges::sort(found, {}, &CatalogueEntry::path);
+    const auto [first, last] = std::ranges::unique(
+        found, [](const auto& lhs, const auto& rhs) {
+            return lhs.path == rhs.path;
+        });
+    found.erase(first, last);
+    return found;
+}
+
+// Read the header of entry.path, only the header bytes are read
+void parse_entry(CatalogueEntry& entry) {
+    SigprocHeader hdr;
+    try {
+        entry.valid = hdr.fromfile(entry.path);
+    } catch (const std::exception&) {
+        entry.valid = false;
+    }
+    if (!entry.valid) {
+        return;
+    }
+    entry.source_name  = hdr.get<HeaderKey::kSourceName>();
+    entry.telescope_id = hdr.get<HeaderKey::kTelescopeId>();
+    entry.machine_id   = hdr.get<HeaderKey::kMachineId>();
+    entry.data_type    = hdr.get<HeaderKey::kDataType>();
+    entry.nchans       = hdr.get<HeaderKey::kNchans>();
+    entry.nbits        = hdr.get<HeaderKey::kNbits>();
+    entry.nifs         = hdr.get<HeaderKey::kNifs>();
+    entry.nsamples     = hdr.get<HeaderKey::kNsamples>();
+    entry.tstart       = hdr.get<HeaderKey::kTstart>();
+    entry.tsamp        = hdr.get<HeaderKey::kTsamp>();
+    entry.fch1         = hdr.get<HeaderKey::kFch1>();
+    entry.foff         = hdr.get<HeaderKey::kFoff>();
+    entry.src_raj      = hdr.get<HeaderKey::kSrcRaj>();
+    entry.src_dej      = hdr.get<HeaderKey::kSrcDej>();
+}
+
+std::string csv_field(std::string_view str) {
+    if (str.find_first_of(",\"\n") == std::string_view::npos) {
+        return std::string(str);
+    }
+    std::string quoted = "\"";
+    for (const char ch : str) {
+        quoted += ch == '"' ? std::string("\"\"") : std::string(1, ch);
+    }
+    return quoted + '"';
+}
+
+std::string json_string(std::string_view str) {
+    std::string escaped = "\"";
+    for (const char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+            escaped += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            escaped += std::format("\\u{:04x}", static_cast<int>(ch));
+        } else {
+            escaped += ch;
+        }
+    }
+    return escaped + '"';
+}
+
+} // namespace
+
+bool CatalogueEntry::covers_freq(double freq) const {
+    const double flow  = std::min(ftop(), fbottom());
+    const double fhigh = std::max(ftop(), fbottom());
+    return valid && freq >= flow && freq <= fhigh;
+}
+
+bool CatalogueEntry::covers_mjd(double mjd) const {
+    return valid && mjd >= tstart && mjd <= tend();
+}
+
+double ScanStats::files_per_second() const {
+    return seconds > 0 ? static_cast<double>(nfiles) / seconds : 0.0;
+}
+
+double ScanStats::parsed_per_second() const {
+    return seconds > 0 ? static_cast<double>(nparsed) / seconds : 0.0;
+}
+
+HeaderCatalogue HeaderCatalogue::load(const std::string& filename) {
+    HeaderCatalogue catalogue;
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream) {
+        return catalogue;
+    }
+    CatalogueFileHeader header{};
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!stream || header.magic != kCatalogueMagic ||
+        header.version != kCatalogueVersion) {
+        fmt::print(stderr, "Warning: ignoring catalogue cache {}\n",
+                   filename);
+        return catalogue;
+    }
+    catalogue.m_entries.reserve(
+        std::min<uint64_t>(header.nentries, uint64_t{1} << 20));
+    for (uint64_t ientry = 0; ientry < header.nentries; ++ientry) {
+        EntryRecord record{};
+        stream.read(reinterpret_cast<char*>(&record), sizeof(record));
+        if (!stream) {
+            break;
+        }
+        CatalogueEntry entry;
+        entry.path.resize(record.path_len);
+        entry.source_name.resize(record.source_len);
+        stream.read(entry.path.data(), record.path_len);
+        stream.read(entry.source_name.data(), record.source_len);
+        if (!stream) {
+            break;
+        }
+        entry.mtime        = record.mtime;
+        entry.file_size    = record.file_size;
+        entry.valid        = record.valid != 0;
+        entry.telescope_id = record.telescope_id;
+        entry.machine_id   = record.machine_id;
+        entry.data_type    = record.data_type;
+        entry.nchans       = record.nchans;
+        entry.nbits        = record.nbits;
+        entry.nifs         = record.nifs;
+        entry.nsamples     = record.nsamples;
+        entry.tstart       = record.tstart;
+        entry.tsamp        = record.tsamp;
+        entry.fch1         = record.fch1;
+        entry.foff         = record.foff;
+        entry.src_raj      = record.src_raj;
+        entry.src_dej      = record.src_dej;
+        catalogue.m_entries.push_back(std::move(entry));
+    }
+    if (catalogue.m_entries.size() != header.nentries) {
+        fmt::print(stderr, "Warning: catalogue cache {} is truncated\n",
+                   filename);
+        catalogue.m_entries.clear();
+    }
+    return catalogue;
+}
+
+void HeaderCatalogue::save(const std::string& filename) const {
+    // Write aside and rename, so that an interrupted save keeps the old cache
+    const std::string tmpname = filename + ".tmp";
+    {
+        std::ofstream stream(tmpname, std::ios::binary | std::ios::trunc);
+        ErrorChecker::check_stream(stream, tmpname);
+        const CatalogueFileHeader header{kCatalogueMagic, kCatalogueVersion,
+                                         0, m_entries.size()};
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& entry : m_entries) {
+            const EntryRecord record{
+                entry.mtime,
+                entry.file_size,
+                entry.nsamples,
+                entry.tstart,
+                entry.tsamp,
+                entry.fch1,
+                entry.foff,
+                entry.src_raj,
+                entry.src_dej,
+                entry.telescope_id,
+                entry.machine_id,
+                entry.data_type,
+                entry.nchans,
+                entry.nbits,
+                entry.nifs,
+                entry.valid ? 1U : 0U,
+                static_cast<uint32_t>(entry.path.size()),
+                static_cast<uint32_t>(entry.source_name.size()),
+                0};
+            stream.write(reinterpret_cast<const char*>(&record),
+                         sizeof(record));
+            stream.write(entry.path.data(),
+                         static_cast<std::streamsize>(entry.path.size()));
+            stream.write(entry.source_name.data(),
+                         static_cast<std::streamsize>(
+                             entry.source_name.size()));
+        }
+        ErrorChecker::check_stream(stream, tmpname);
+    }
+    fs::rename(tmpname, filename);
+}
+
+ScanStats HeaderCatalogue::scan(const std::vector<std::string>& roots,
+                                int nthreads,
+                                const std::vector<std::string>& extensions) {
+    const auto t_start = std::chrono::steady_clock::now();
+    auto found         = find_files(roots, extensions);
+
+    std::unordered_map<std::string_view, const CatalogueEntry*> cached;
+    cached.reserve(m_entries.size());
+    for (const auto& entry : m_entries) {
+        cached.emplace(entry.path, &entry);
+    }
+    ScanStats stats;
+    stats.nfiles = found.size();
+    std::vector<std::size_t> to_parse;
+    for (std::size_t ifile = 0; ifile < found.size(); ++ifile) {
+        auto& entry   = found[ifile];
+        const auto it = cached.find(entry.path);
+        if (it != cached.end() && it->second->mtime == entry.mtime &&
+            it->second->file_size == entry.file_size) {
+            entry = *it->second;
+            ++stats.ncached;
+        } else {
+            to_parse.push_back(ifile);
+        }
+    }
+
+    // Workers take the next file to parse until none is left
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (std::size_t ii = next++; ii < to_parse.size(); ii = next++) {
+            parse_entry(found[to_parse[ii]]);
+        }
+    };
+    const auto nworkers = std::min<std::size_t>(
+        static_cast<std::size_t>(resolve_nthreads(nthreads)),
+        to_parse.size());
+    std::vector<std::thread> threads;
+    threads.reserve(nworkers);
+    for (std::size_t iworker = 0; iworker < nworkers; ++iworker) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    stats.nparsed = to_parse.size();
+    stats.nfailed = static_cast<std::size_t>(
+        std::ranges::count(found, false, &CatalogueEntry::valid));
+    m_entries     = std::move(found);
+    stats.seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - t_start)
+                        .count();
+    return stats;
+}
+
+void HeaderCatalogue::write_csv(std::ostream& stream,
+                                const std::vector<CatalogueEntry>& entries) {
+    stream << "path,source_name,telescope_id,machine_id,data_type,nchans,"
+              "nbits,nifs,nsamples,tstart,tsamp,fch1,foff,ftop,fbottom,"
+              "tobs,src_raj,src_dej\n";
+    for (const auto& entry : entries) {
+        if (!entry.valid) {
+            continue;
+        }
+        stream << std::format(
+            "{},{},{},{},{},{},{},{},{},{:.12f},{:.9g},{:.9g},{:.9g},{:.9g},"
+            "{:.9g},{:.6f},{:.4f},{:.4f}\n",
+            csv_field(entry.path), csv_field(entry.source_name),
+            entry.telescope_id, entry.machine_id, entry.data_type,
+            entry.nchans, entry.nbits, entry.nifs, entry.nsamples,
+            entry.tstart, entry.tsamp, entry.fch1, entry.foff, entry.ftop(),
+            entry.fbottom(), entry.tobs(), entry.src_raj, entry.src_dej);
+    }
+}
+
+void HeaderCatalogue::write_json(std::ostream& stream,
+                                 const std::vector<CatalogueEntry>& entries) {
+    stream << "[";
+    bool first = true;
+    for (const auto& entry : entries) {
+        if (!entry.valid) {
+            continue;
+        }
+        stream << (first ? "\n" : ",\n");
+        first = false;
+        stream << std::format(
+            "  {{\"path\": {}, \"source_name\": {}, \"telescope_id\": {}, "
+            "\"machine_id\": {}, \"data_type\": {}, \"nchans\": {}, "
+            "\"nbits\": {}, \"nifs\": {}, \"nsamples\": {}, "
+            "\"tstart\": {:.12f}, \"tsamp\": {:.9g}, \"fch1\": {:.9g}, "
+            "\"foff\": {:.9g}, \"ftop\": {:.9g}, \"fbottom\": {:.9g}, "
+            "\"tobs\": {:.6f}, \"src_raj\": {:.4f}, \"src_dej\": {:.4f}}}",
+            json_string(entry.path), json_string(entry.source_name),
+            entry.telescope_id, entry.machine_id, entry.data_type,
+            entry.nchans, entry.nbits, entry.nifs, entry.nsamples,
+            entry.tstart, entry.tsamp, entry.fch1, entry.foff, entry.ftop(),
+            entry.fbottom(), entry.tobs(), entry.src_raj, entry.src_dej);
+    }
+    stream << "\n]\n";
+}
@@ -0,0 +1,608 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include <sigproc/compress.hpp>
+#include <sigproc/exceptions.hpp>
+#include <sigproc/numbits.hpp>
+
+namespace {
+
+constexpr std::array<char, 8> kContainerMagic{'S', 'I', 'G', 'P',
+                                              'Z', 'C', 'H', 'K'};
+constexpr uint32_t kContainerVersion = 1;
+
+struct ContainerHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t chunk_nsamps;
+    uint64_t nsamples;
+    uint64_t nchunks;
+    uint64_t index_offset;
+};
+
+enum class ChunkMethod : uint8_t { kStored = 0, kHuffman = 1 };
+
+// Longest Huffman code, sets the size of the decoding table
+constexpr int kMaxCodeLen = 12;
+constexpr std::size_t kNumSymbols = 256;
+// Code lengths are stored as nibbles
+constexpr std::size_t kLengthsSize = kNumSymbols / 2;
+// Chunks compressed together by the writer, one per thread
+constexpr std::size_t kBatchChunks = 16;
+
+template <typename T>
+void append_scalar(std::vector<uint8_t>& out, T value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T read_scalar(std::span<const uint8_t> in, std::size_t& pos) {
+    if (pos + sizeof(T) > in.size()) {
+        throw std::runtime_error("Corrupt compressed chunk: truncated");
+    }
+    T value;
+    std::memcpy(&value, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+std::array<uint8_t, kNumSymbols>
+huffman_lengths(std::array<uint64_t, kNumSymbols> freqs) {
+    std::array<uint8_t, kNumSymbols> lengths{};
+    while (true) {
+        // Leaves are nodes [0, 256), internal nodes are appended
+        std::vector<int> parent(kNumSymbols, -1);
+        using Node = std::pair<uint64_t, int>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<>> heap;
+        for (std::size_t isym = 0; isym < kNumSymbols; ++isym) {
+            if (freqs[isym] > 0) {
+                heap.emplace(freqs[isym], static_cast<int>(isym));
+            }
+        }
+        if (heap.empty()) {
+            return lengths;
+        }
+        if (heap.size() == 1) {
+            lengths[heap.top().second] = 1;
+            return lengths;
+        }
+        while (heap.size() > 1) {
+            const auto [freq_a, node_a] = heap.top();
+            heap.pop();
+            const auto [freq_b, node_b] = heap.top();
+            heap.pop();
+            const int node = static_cast<int>(parent.size());
+            parent.push_back(-1);
+            parent[node_a] = node;
+            parent[node_b] = node;
+            heap.emplace(freq_a + freq_b, node);
+        }
+        int max_len = 0;
+        for (std::size_t isym = 0; isym < kNumSymbols; ++isym) {
+            if (freqs[isym] == 0) {
+                lengths[isym] = 0;
+                continue;
+            }
+            int len = 0;
+            for (int node = static_cast<int>(isym); parent[node] >= 0;
+                 node  = parent[node]) {
+                ++len;
+            }
+            lengths[isym] = static_cast<uint8_t>(len);
+            max_len       = std::max(max_len, len);
+        }
+        if (max_len <= kMaxCodeLen) {
+            return lengths;
+        }
+        // Flatten the distribution until the codes fit the table
+        for (auto& freq : freqs) {
+            if (freq > 0) {
+                freq = (freq + 1) / 2;
+            }
+        }
+    }
+}
+
+std::array<uint16_t, kNumSymbols>
+canonical_codes(const std::array<uint8_t, kNumSymbols>& lengths) {
+    std::array<uint16_t, kNumSymbols> codes{};
+    uint32_t code = 0;
+    for (int len = 1; len <= kMaxCodeLen; ++len) {
+        for (std::size_t isym = 0; isym < kNumSymbols; ++isym) {
+            if (lengths[isym] == len) {
+                codes[isym] = static_cast<uint16_t>(code++);
+            }
+        }
+        code <<= 1;
+    }
+    return codes;
+}
+
+void huffman_encode(std::span<const uint8_t> in, std::vector<uint8_t>& out) {
+    std::array<uint64_t, kNumSymbols> freqs{};
+    for (const uint8_t value : in) {
+        ++freqs[value];
+    }
+    const auto lengths = huffman_lengths(freqs);
+    const auto codes   = canonical_codes(lengths);
+    for (std::size_t isym = 0; isym < kNumSymbols; isym += 2) {
+        out.push_back(static_cast<uint8_t>(lengths[isym] |
+                                           (lengths[isym + 1] << 4)));
+    }
+    const std::size_t size_pos = out.size();
+    append_scalar<uint32_t>(out, 0);
+    uint64_t acc   = 0;
+    int acc_bits   = 0;
+    for (const uint8_t value : in) {
+        acc = (acc << lengths[value]) | codes[value];
+        acc_bits += lengths[value];
+        while (acc_bits >= 8) {
+            acc_bits -= 8;
+            out.push_back(static_cast<uint8_t>(acc >> acc_bits));
+        }
+    }
+    if (acc_bits > 0) {
+        out.push_back(static_cast<uint8_t>(acc << (8 - acc_bits)));
+    }
+    const auto nbytes =
+        static_cast<uint32_t>(out.size() - size_pos - sizeof(uint32_t));
+    std::memcpy(out.data() + size_pos, &nbytes, sizeof(nbytes));
+}
+
+void huffman_decode(std::span<const uint8_t> in, std::size_t& pos,
+                    std::span<uint8_t> out) {
+    if (pos + kLengthsSize > in.size()) {
+        throw std::runtime_error("Corrupt compressed chunk: truncated");
+    }
+    std::array<uint8_t, kNumSymbols> lengths{};
+    for (std::size_t isym = 0; isym < kNumSymbols; isym += 2) {
+        lengths[isym]     = in[pos + isym / 2] & 0x0F;
+        lengths[isym + 1] = in[pos + isym / 2] >> 4;
+    }
+    pos += kLengthsSize;
+    const auto codes = canonical_codes(lengths);
+    // Entry: symbol in the low byte, code length in the high byte
+    std::array<uint16_t, 1U << kMaxCodeLen> table{};
+    for (std::size_t isym = 0; isym < kNumSymbols; ++isym) {
+        const int len = lengths[isym];
+        if (len == 0) {
+            continue;
+        }
+        if (len > kMaxCodeLen) {
+            throw std::runtime_error("Corrupt compressed chunk: code length");
+        }
+        const std::size_t first = std::size_t{codes[isym]}
+                                  << (kMaxCodeLen - len);
+        const std::size_t last =
+            first + (std::size_t{1} << (kMaxCodeLen - len));
+        if (last > table.size()) {
+            throw std::runtime_error("Corrupt compressed chunk: code table");
+        }
+        std::fill(table.begin() + first, table.begin() + last,
+                  static_cast<uint16_t>(isym | (len << 8)));
+    }
+    const auto nbytes = read_scalar<uint32_t>(in, pos);
+    if (pos + nbytes > in.size()) {
+        throw std::runtime_error("Corrupt compressed chunk: truncated");
+    }
+    const uint8_t* bits = in.data() + pos;
+    std::size_t ibyte   = 0;
+    uint64_t acc        = 0;
+    int acc_bits        = 0;
+    // Top up acc to at least 57 bits, zeros past the end of the stream
+    const auto refill = [&] {
+        if (ibyte + sizeof(uint64_t) <= nbytes) {
+            uint64_t next;
+            std::memcpy(&next, bits + ibyte, sizeof(next));
+            next            = __builtin_bswap64(next);
+            const int nfill = (64 - acc_bits) / 8;
+            acc |= (next >> (64 - 8 * nfill)) << (64 - 8 * nfill - acc_bits);
+            ibyte += nfill;
+            acc_bits += 8 * nfill;
+            return;
+        }
+        while (acc_bits <= 56) {
+            const uint64_t next = ibyte < nbytes ? bits[ibyte] : 0;
+            acc |= next << (56 - acc_bits);
+            ++ibyte;
+            acc_bits += 8;
+        }
+    };
+    const auto decode_one = [&](uint8_t& value) {
+        const uint16_t entry = table[acc >> (64 - kMaxCodeLen)];
+        const int len        = entry >> 8;
+        if (len == 0) {
+            throw std::runtime_error("Corrupt compressed chunk: bad code");
+        }
+        value = static_cast<uint8_t>(entry);
+        acc <<= len;
+        acc_bits -= len;
+    };
+    // 57 bits hold four codes of at most kMaxCodeLen bits
+    constexpr std::size_t kCodesPerRefill = 4;
+    std::size_t ii                        = 0;
+    for (; ii + kCodesPerRefill <= out.size(); ii += kCodesPerRefill) {
+        refill();
+        decode_one(out[ii]);
+        decode_one(out[ii + 1]);
+        decode_one(out[ii + 2]);
+        decode_one(out[ii + 3]);
+    }
+    for (; ii < out.size(); ++ii) {
+        refill();
+        decode_one(out[ii]);
+    }
+    const std::size_t bits_used =
+        ibyte * 8 - static_cast<std::size_t>(acc_bits);
+    if (bits_used > std::size_t{nbytes} * 8) {
+        throw std::runtime_error("Corrupt compressed chunk: overrun");
+    }
+    pos += nbytes;
+}
+
+std::size_t bytes_per_value(int nbits) {
+    return nbits > 8 ? static_cast<std::size_t>(nbits) / 8 : 1;
+}
+
+// Per-channel rounded mean of 8-bit samples
+std::vector<uint8_t> channel_references(std::span<const uint8_t> raw,
+                                        std::size_t stride_size) {
+    const std::size_t nsamps = raw.size() / stride_size;
+    std::vector<uint64_t> sums(stride_size, 0);
+    for (std::size_t isamp = 0; isamp < nsamps; ++isamp) {
+        const uint8_t* row = raw.data() + isamp * stride_size;
+        for (std::size_t ichan = 0; ichan < stride_size; ++ichan) {
+            sums[ichan] += row[ichan];
+        }
+    }
+    std::vector<uint8_t> refs(stride_size);
+    for (std::size_t ichan = 0; ichan < stride_size; ++ichan) {
+        refs[ichan] =
+            static_cast<uint8_t>((sums[ichan] + nsamps / 2) / nsamps);
+    }
+    return refs;
+}
+
+} // namespace
+
+std::vector<uint8_t> sigproc::compress_chunk(std::span<const uint8_t> raw,
+                                             int nbits,
+                                             std::size_t stride_size) {
+    std::vector<uint8_t> out;
+    out.reserve(raw.size() + kLengthsSize + 16);
+    out.push_back(static_cast<uint8_t>(ChunkMethod::kHuffman));
+    const std::size_t itemsize = bytes_per_value(nbits);
+    if (nbits == 8 && !raw.empty()) {
+        const auto refs = channel_references(raw, stride_size);
+        out.insert(out.end(), refs.begin(), refs.end());
+        std::vector<uint8_t> residuals(raw.size());
+        for (std::size_t row = 0; row < raw.size(); row += stride_size) {
+            for (std::size_t ichan = 0; ichan < stride_size; ++ichan) {
+                const auto diff =
+                    static_cast<int8_t>(raw[row + ichan] - refs[ichan]);
+                // zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+                residuals[row + ichan] =
+                    static_cast<uint8_t>((diff << 1) ^ (diff >> 7));
+            }
+        }
+        huffman_encode(residuals, out);
+    } else if (itemsize > 1) {
+        const std::size_t nvalues = raw.size() / itemsize;
+        std::vector<uint8_t> plane(nvalues);
+        for (std::size_t iplane = 0; iplane < itemsize; ++iplane) {
+            for (std::size_t ii = 0; ii < nvalues; ++ii) {
+                plane[ii] = raw[ii * itemsize + iplane];
+            }
+            huffman_encode(plane, out);
+        }
+    } else {
+        huffman_encode(raw, out);
+    }
+    if (out.size() >= raw.size() + 1) {
+        out.assign(1, static_cast<uint8_t>(ChunkMethod::kStored));
+        out.insert(out.end(), raw.begin(), raw.end());
+    }
+    return out;
+}
+
+void sigproc::decompress_chunk(std::span<const uint8_t> packed,
+                               std::span<uint8_t> raw, int nbits,
+                               std::size_t stride_size) {
+    if (packed.empty()) {
+        throw std::runtime_error("Corrupt compressed chunk: empty");
+    }
+    const auto method = static_cast<ChunkMethod>(packed[0]);
+    std::size_t pos   = 1;
+    if (method == ChunkMethod::kStored) {
+        if (packed.size() - pos != raw.size()) {
+            throw std::runtime_error("Corrupt compressed chunk: stored size");
+        }
+        std::memcpy(raw.data(), packed.data() + pos, raw.size());
+        return;
+    }
+    if (method != ChunkMethod::kHuffman) {
+        throw std::runtime_error(
+            std::format("Corrupt compressed chunk: unknown method {}",
+                        packed[0]));
+    }
+    const std::size_t itemsize = bytes_per_value(nbits);
+    if (nbits == 8 && !raw.empty()) {
+        if (pos + stride_size > packed.size()) {
+            throw std::runtime_error("Corrupt compressed chunk: truncated");
+        }
+        const auto refs = packed.subspan(pos, stride_size);
+        pos += stride_size;
+        huffman_decode(packed, pos, raw);
+        for (std::size_t row = 0; row < raw.size(); row += stride_size) {
+            for (std::size_t ichan = 0; ichan < stride_size; ++ichan) {
+                const uint8_t zz = raw[row + ichan];
+                const auto diff  = static_cast<uint8_t>((zz >> 1) ^ -(zz & 1));
+                raw[row + ichan] = static_cast<uint8_t>(diff + refs[ichan]);
+            }
+        }
+    } else if (itemsize > 1) {
+        const std::size_t nvalues = raw.size() / itemsize;
+        std::vector<uint8_t> plane(nvalues);
+        for (std::size_t iplane = 0; iplane < itemsize; ++iplane) {
+            huffman_decode(packed, pos, plane);
+            for (std::size_t ii = 0; ii < nvalues; ++ii) {
+                raw[ii * itemsize + iplane] = plane[ii];
+            }
+        }
+    } else {
+        huffman_decode(packed, pos, raw);
+    }
+}
+
+bool CompressedFile::is_compressed(const std::string& filename,
+                                   std::size_t data_offset) {
+    std::ifstream stream(filename, std::ios::binary);
+    std::array<char, 8> magic{};
+    stream.seekg(static_cast<std::streamoff>(data_offset));
+    stream.read(magic.data(), magic.size());
+    return stream && magic == kContainerMagic;
+}
+
+CompressedFile::CompressedFile(const std::string& filename,
+                               std::size_t data_offset, int nbits,
+                               std::size_t stride_size)
+    : m_file(filename),
+      m_data_offset(data_offset),
+      m_nbits(nbits),
+      m_stride_size(stride_size),
+      m_cached_chunk(std::numeric_limits<std::size_t>::max()) {
+    if (m_file.size() < data_offset + sizeof(ContainerHeader)) {
+        throw std::runtime_error(
+            std::format("{} is not a compressed filterbank", filename));
+    }
+    ContainerHeader header{};
+    std::memcpy(&header, m_file.data(data_offset, sizeof(header)).data(),
+                sizeof(header));
+    if (header.magic != kContainerMagic ||
+        header.version != kContainerVersion || header.chunk_nsamps == 0) {
+        throw std::runtime_error(
+            std::format("{} is not a compressed filterbank", filename));
+    }
+    m_chunk_nsamps = header.chunk_nsamps;
+    m_nsamples     = header.nsamples;
+    const std::size_t region = m_file.size() - data_offset;
+    const std::size_t nchunks =
+        (m_nsamples + m_chunk_nsamps - 1) / m_chunk_nsamps;
+    if (header.nchunks != nchunks ||
+        header.index_offset + nchunks * sizeof(ChunkEntry) > region) {
+        throw std::runtime_error(
+            std::format("{} has a corrupt chunk index", filename));
+    }
+    m_index.resize(nchunks);
+    std::memcpy(m_index.data(),
+                m_file.data(data_offset + header.index_offset,
+                            nchunks * sizeof(ChunkEntry))
+                    .data(),
+                nchunks * sizeof(ChunkEntry));
+    for (const auto& entry : m_index) {
+        if (entry.offset + entry.size > header.index_offset) {
+            throw std::runtime_error(
+                std::format("{} has a corrupt chunk index", filename));
+        }
+    }
+}
+
+std::size_t CompressedFile::compressed_size() const {
+    return m_file.size() - m_data_offset;
+}
+
+std::size_t CompressedFile::chunk_samples(std::size_t ichunk) const {
+    return std::min(m_chunk_nsamps, m_nsamples - ichunk * m_chunk_nsamps);
+}
+
+void CompressedFile::decode(std::size_t ichunk, std::span<uint8_t> out) const {
+    const auto& entry = m_index[ichunk];
+    sigproc::decompress_chunk(
+        m_file.data(m_data_offset + entry.offset, entry.size), out, m_nbits,
+        m_stride_size);
+}
+
+void CompressedFile::read(std::size_t start_sample, std::size_t nsamps,
+                          std::span<uint8_t> out) const {
+    if (start_sample + nsamps > m_nsamples) {
+        throw std::out_of_range(std::format(
+            "Samples [{}, {}) out of range ({} samples)", start_sample,
+            start_sample + nsamps, m_nsamples));
+    }
+    if (out.size() != nsamps * m_stride_size) {
+        throw std::invalid_argument(
+            std::format("Output size {} does not match {} samples",
+                        out.size(), nsamps));
+    }
+    if (nsamps == 0) {
+        return;
+    }
+    const std::size_t end         = start_sample + nsamps;
+    const std::size_t first_chunk = start_sample / m_chunk_nsamps;
+    const std::size_t nwork =
+        (end - 1) / m_chunk_nsamps + 1 - first_chunk;
+    // Chunks only partly inside the range are decoded on the side
+    std::vector<std::vector<uint8_t>> partial(nwork);
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t iwork = 0; iwork < nwork; ++iwork) {
+        const std::size_t ichunk = first_chunk + iwork;
+        const std::size_t chunk0 = ichunk * m_chunk_nsamps;
+        const std::size_t lo     = std::max(start_sample, chunk0);
+        const std::size_t hi =
+            std::min(end, chunk0 + chunk_samples(ichunk));
+        if (hi - lo == chunk_samples(ichunk)) {
+            decode(ichunk, out.subspan((lo - start_sample) * m_stride_size,
+                                       (hi - lo) * m_stride_size));
+        } else if (ichunk != m_cached_chunk) {
+            partial[iwork].resize(chunk_samples(ichunk) * m_stride_size);
+            decode(ichunk, partial[iwork]);
+        }
+    }
+    // Copy from the cache before a newly decoded chunk replaces it
+    const std::size_t cached = m_cached_chunk;
+    for (const bool from_cache : {true, false}) {
+        for (std::size_t iwork = 0; iwork < nwork; ++iwork) {
+            const std::size_t ichunk = first_chunk + iwork;
+            const std::size_t chunk0 = ichunk * m_chunk_nsamps;
+            const std::size_t lo     = std::max(start_sample, chunk0);
+            const std::size_t hi =
+                std::min(end, chunk0 + chunk_samples(ichunk));
+            if (hi - lo == chunk_samples(ichunk) ||
+                (ichunk == cached) != from_cache) {
+                continue;
+            }
+            if (!from_cache) {
+                m_cache        = std::move(partial[iwork]);
+                m_cached_chunk = ichunk;
+            }
+            std::memcpy(out.data() + (lo - start_sample) * m_stride_size,
+                        m_cache.data() + (lo - chunk0) * m_stride_size,
+                        (hi - lo) * m_stride_size);
+        }
+    }
+}
+
+CompressedFilterbankWriter::CompressedFilterbankWriter(
+    const std::string& filename, const SigprocHeader& hdr,
+    std::size_t chunk_nsamps)
+    : m_filename(filename),
+      m_nbits(hdr.get<HeaderKey::kNbits>()),
+      m_chunk_nsamps(chunk_nsamps) {
+    const auto stride_bits = static_cast<std::size_t>(
+        hdr.get<HeaderKey::kNchans>() * hdr.get<HeaderKey::kNifs>() * m_nbits);
+    if (stride_bits % 8 != 0) {
+        throw std::invalid_argument(std::format(
+            "A time sample of {} bits is not a whole number of bytes",
+            stride_bits));
+    }
+    if (chunk_nsamps == 0 ||
+        chunk_nsamps > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument(
+            std::format("Invalid chunk length {}", chunk_nsamps));
+    }
+    m_stride_size = stride_bits / 8;
+    hdr.tofile(filename);
+    m_data_offset = std::filesystem::file_size(filename);
+    m_stream.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    ErrorChecker::check_stream(m_stream, filename);
+    m_stream.seekp(0, std::ios::end);
+    // Placeholder, completed by close()
+    const ContainerHeader header{};
+    m_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ErrorChecker::check_stream(m_stream, filename);
+    m_offset = sizeof(header);
+}
+
+CompressedFilterbankWriter::~CompressedFilterbankWriter() {
+    try {
+        close();
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "Warning: CompressedFilterbankWriter: {}\n",
+                   e.what());
+    }
+}
+
+void CompressedFilterbankWriter::write_block(std::span<const float> block,
+                                             int block_len) {
+    if (m_closed) {
+        throw std::runtime_error(
+            std::format("{} is already closed", m_filename));
+    }
+    const auto nbytes =
+        static_cast<std::size_t>(block_len) * m_nbits / 8;
+    if (nbytes % m_stride_size != 0) {
+        throw std::invalid_argument(std::format(
+            "Block of {} values is not a whole number of samples",
+            block_len));
+    }
+    const std::size_t old_size = m_raw.size();
+    m_raw.resize(old_size + nbytes);
+    sigproc::pack_from_float(block.first(block_len),
+                             std::span(m_raw).subspan(old_size), m_nbits,
+                             "little");
+    m_nsamples += nbytes / m_stride_size;
+    if (m_raw.size() >= kBatchChunks * m_chunk_nsamps * m_stride_size) {
+        flush_chunks(false);
+    }
+}
+
+void CompressedFilterbankWriter::close() {
+    if (m_closed) {
+        return;
+    }
+    m_closed = true;
+    flush_chunks(true);
+    const std::size_t index_offset = m_offset;
+    m_stream.write(reinterpret_cast<const char*>(m_index.data()),
+                   static_cast<std::streamsize>(m_index.size() *
+                                                sizeof(uint64_t)));
+    m_offset += m_index.size() * sizeof(uint64_t);
+    const ContainerHeader header{kContainerMagic,
+                                 kContainerVersion,
+                                 static_cast<uint32_t>(m_chunk_nsamps),
+                                 m_nsamples,
+                                 m_index.size() / 2,
+                                 index_offset};
+    m_stream.seekp(static_cast<std::streamoff>(m_data_offset));
+    m_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_stream.flush();
+    ErrorChecker::check_stream(m_stream, m_filename);
+    m_stream.close();
+}
+
+void CompressedFilterbankWriter::flush_chunks(bool final) {
+    const std::size_t chunk_size = m_chunk_nsamps * m_stride_size;
+    std::size_t nchunks          = m_raw.size() / chunk_size;
+    if (final && m_raw.size() % chunk_size != 0) {
+        ++nchunks;
+    }
+    std::vector<std::vector<uint8_t>> packed(nchunks);
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t ichunk = 0; ichunk < nchunks; ++ichunk) {
+        const std::size_t offset = ichunk * chunk_size;
+        const std::size_t size = std::min(chunk_size, m_raw.size() - offset);
+        packed[ichunk] = sigproc::compress_chunk(
+            std::span(m_raw).subspan(offset, size), m_nbits, m_stride_size);
+    }
+    for (const auto& chunk : packed) {
+        m_stream.write(reinterpret_cast<const char*>(chunk.data()),
+                       static_cast<std::streamsize>(chunk.size()));
+        m_index.push_back(m_offset);
+        m_index.push_back(chunk.size());
+        m_offset += chunk.size();
+    }
+    ErrorChecker::check_stream(m_stream, m_filename);
+    m_raw.erase(m_raw.begin(),
+                m_raw.begin() + static_cast<std::ptrdiff_t>(std::min(
+                                    nchunks * chunk_size, m_raw.size())));
+}
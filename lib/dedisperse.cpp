@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include <sigproc/dedisperse.hpp>
+#include <sigproc/fdmt.hpp>
+#include <sigproc/kernels.hpp>
+#include <sigproc/overlap.hpp>
+#include <sigproc/subband.hpp>
+
+void dedisperse_brute(const DMPlan& plan, std::span<const float> in,
+                      int nsamps_in, int nifs, std::span<float> out) {
+    const int nchans     = plan.nchans();
+    const int nrows      = nchans * nifs;
+    const auto ndms      = static_cast<int>(plan.ndms());
+    const int nsamps_out = nsamps_in - plan.max_delay();
+    if (nsamps_out <= 0) {
+        throw std::invalid_argument(std::format(
+            "Block of {} samples is shorter than the maximum delay {}",
+            nsamps_in, plan.max_delay()));
+    }
+    if (in.size() < static_cast<std::size_t>(nrows) * nsamps_in ||
+        out.size() < static_cast<std::size_t>(ndms) * nsamps_out) {
+        throw std::invalid_argument(std::format(
+            "Buffers too small for {} rows x {} samples into {} trials",
+            nrows, nsamps_in, ndms));
+    }
+    const auto table = plan.table();
+    if (std::ranges::any_of(table, [](int32_t delay) { return delay < 0; })) {
+        throw std::invalid_argument(
+            "Brute-force dedispersion needs non-negative delays");
+    }
+
+    sigproc::shift_add_channels(in, out, table, ndms, 0, nchans, nchans, nifs,
+                                nsamps_in, nsamps_out);
+}
+
+int dedispersion_overlap(const DMPlan& plan,
+                         const DedispersionOptions& options) {
+    switch (options.engine) {
+    case DedispersionEngine::kSubband:
+        return SubbandDedisperser(plan, options.smearing, options.nsub)
+            .max_delay();
+    case DedispersionEngine::kFDMT:
+        return FDMT(plan).max_delay();
+    default:
+        return plan.max_delay();
+    }
+}
+
+int64_t dedisperse_stream(FilReader& reader, const DMPlan& plan, int gulp,
+                          const DedispersionSink& sink, int64_t start,
+                          int64_t nsamps, const DedispersionOptions& options) {
+    if (plan.nchans() != reader.hdr.get<HeaderKey::kNchans>()) {
+        throw std::invalid_argument(std::format(
+            "DM plan is for {} channels, the data have {}", plan.nchans(),
+            reader.hdr.get<HeaderKey::kNchans>()));
+    }
+    if (gulp <= 0) {
+        throw std::invalid_argument(
+            std::format("Gulp must be positive, got {}", gulp));
+    }
+    const int nifs = reader.hdr.get<HeaderKey::kNifs>();
+    std::optional<SubbandDedisperser> subband;
+    std::optional<FDMT> fdmt;
+    int max_delay = plan.max_delay();
+    if (options.engine == DedispersionEngine::kSubband) {
+        subband.emplace(plan, options.smearing, options.nsub);
+        max_delay = subband->max_delay();
+    } else if (options.engine == DedispersionEngine::kFDMT) {
+        fdmt.emplace(plan);
+        max_delay = fdmt->max_delay();
+    }
+    const auto old_layout = reader.get_layout();
+    reader.set_layout(BlockLayout::kChannelMajor);
+
+    std::vector<float> out(plan.ndms() * static_cast<std::size_t>(gulp));
+    int64_t nsamps_out = 0;
+    try {
+        OverlapReader blocks(reader, gulp + max_delay, max_delay, start,
+                             nsamps);
+        for (const auto& block : blocks) {
+            const int nout = block.nsamps - max_delay;
+            if (nout <= 0) {
+                break;
+            }
+            const auto block_out = std::span(out).first(plan.ndms() * nout);
+            if (subband) {
+                subband->execute(block.data, block.nsamps, nifs, block_out);
+            } else if (fdmt) {
+                fdmt->execute(block.data, block.nsamps, nifs, block_out);
+            } else {
+                dedisperse_brute(plan, block.data, block.nsamps, nifs,
+                                 block_out);
+            }
+            sink(block_out, block.start_sample, nout);
+            nsamps_out += nout;
+        }
+    } catch (...) {
+        reader.set_layout(old_layout);
+        throw;
+    }
+    reader.set_layout(old_layout);
+    return nsamps_out;
+}
@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SIGPROC_HAVE_IO_URING
+#endif
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <fmt/core.h>
+
+#include <sigproc/direct_io.hpp>
+
+namespace {
+
+constexpr std::size_t align_down(std::size_t value, std::size_t alignment) {
+    return value - (value % alignment);
+}
+
+constexpr std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return align_down(value + alignment - 1, alignment);
+}
+
+// pread until count bytes are read or end of file is reached.
+ssize_t pread_full(int fd, uint8_t* buf, std::size_t count, off_t offset) {
+    std::size_t done = 0;
+    while (done < count) {
+        const ssize_t ret = ::pread(fd, buf + done, count - done,
+                                    offset + static_cast<off_t>(done));
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(ret);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+/*
+ * Copy the part of a completed chunk [chunk_off, chunk_off + nread) that
+ * overlaps the requested range [offset, offset + buffer.size()).
+ */
+std::size_t copy_overlap(const uint8_t* chunk, std::size_t chunk_off,
+                         std::size_t nread, std::size_t offset,
+                         std::span<uint8_t> buffer) {
+    const std::size_t lo = std::max(chunk_off, offset);
+    const std::size_t hi = std::min(chunk_off + nread, offset + buffer.size());
+    if (hi <= lo) {
+        return 0;
+    }
+    std::memcpy(buffer.data() + (lo - offset), chunk + (lo - chunk_off),
+                hi - lo);
+    return hi - lo;
+}
+
+} // namespace
+
+ReadEngine read_engine_from_string(const std::string& name) {
+    if (name == "buffered") {
+        return ReadEngine::kBuffered;
+    }
+    if (name == "direct") {
+        return ReadEngine::kDirect;
+    }
+    if (name == "uring") {
+        return ReadEngine::kUring;
+    }
+    throw std::invalid_argument(std::format("Unknown read engine: {}", name));
+}
+
+#ifdef SIGPROC_HAVE_IO_URING
+/*
+ * Minimal io_uring wrapper using the raw system calls, so we do not need
+ * liburing. Only the pieces needed for batches of IORING_OP_READ are here.
+ */
+class DirectReader::Uring {
+public:
+    explicit Uring(unsigned entries) {
+        io_uring_params params{};
+        m_ring_fd = static_cast<int>(
+            ::syscall(__NR_io_uring_setup, entries, &params));
+        if (m_ring_fd < 0) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "io_uring_setup failed");
+        }
+        m_sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_len =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            m_sq_len = m_cq_len = std::max(m_sq_len, m_cq_len);
+        }
+        m_sq_ptr = map(m_sq_len, IORING_OFF_SQ_RING);
+        m_cq_ptr = single ? m_sq_ptr : map(m_cq_len, IORING_OFF_CQ_RING);
+        m_sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = static_cast<io_uring_sqe*>(map(m_sqes_len, IORING_OFF_SQES));
+
+        auto* sq     = static_cast<uint8_t*>(m_sq_ptr);
+        auto* cq     = static_cast<uint8_t*>(m_cq_ptr);
+        m_sq_tail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sq_mask    = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sq_array   = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        m_cq_head    = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cq_tail    = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cq_mask    = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes       = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~Uring() {
+        if (m_sqes != nullptr) {
+            ::munmap(m_sqes, m_sqes_len);
+        }
+        if (m_cq_ptr != nullptr && m_cq_ptr != m_sq_ptr) {
+            ::munmap(m_cq_ptr, m_cq_len);
+        }
+        if (m_sq_ptr != nullptr) {
+            ::munmap(m_sq_ptr, m_sq_len);
+        }
+        if (m_ring_fd >= 0) {
+            ::close(m_ring_fd);
+        }
+    }
+
+    Uring(const Uring&)            = delete;
+    Uring& operator=(const Uring&) = delete;
+    Uring(Uring&&)                 = delete;
+    Uring& operator=(Uring&&)      = delete;
+
+    void prep_read(int fd, uint8_t* buf, unsigned len, std::size_t offset,
+                   uint64_t user_data) {
+        const unsigned tail = *m_sq_tail;
+        const unsigned idx  = tail & m_sq_mask;
+        io_uring_sqe& sqe   = m_sqes[idx];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode    = IORING_OP_READ;
+        sqe.fd        = fd;
+        sqe.addr      = reinterpret_cast<uint64_t>(buf);
+        sqe.len       = len;
+        sqe.off       = offset;
+        sqe.user_data = user_data;
+        m_sq_array[idx] = idx;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        m_pending++;
+    }
+
+    void submit_and_wait(unsigned min_complete) {
+        while (true) {
+            const long ret =
+                ::syscall(__NR_io_uring_enter, m_ring_fd, m_pending,
+                          min_complete, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret >= 0) {
+                m_pending -= static_cast<unsigned>(ret);
+                return;
+            }
+            if (errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(),
+                                        "io_uring_enter failed");
+            }
+        }
+    }
+
+    template <typename Callback> void reap(Callback&& callback) {
+        unsigned head       = *m_cq_head;
+        const unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+            callback(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int m_ring_fd{-1};
+    void* m_sq_ptr{nullptr};
+    void* m_cq_ptr{nullptr};
+    std::size_t m_sq_len{};
+    std::size_t m_cq_len{};
+    io_uring_sqe* m_sqes{nullptr};
+    std::size_t m_sqes_len{};
+    unsigned* m_sq_tail{};
+    unsigned m_sq_mask{};
+    unsigned* m_sq_array{};
+    unsigned* m_cq_head{};
+    unsigned* m_cq_tail{};
+    unsigned m_cq_mask{};
+    io_uring_cqe* m_cqes{};
+    unsigned m_pending{};
+
+    void* map(std::size_t len, off_t offset) const {
+        void* ptr = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, m_ring_fd, offset);
+        if (ptr == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "io_uring ring mmap failed");
+        }
+        return ptr;
+    }
+};
+#else
+class DirectReader::Uring {};
+#endif
+
+void DirectReader::AlignedDeleter::operator()(uint8_t* ptr) const {
+    std::free(ptr); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+DirectReader::DirectReader(const std::string& filename, ReadEngine engine,
+                           std::size_t queue_depth, std::size_t chunk_size)
+    : m_engine(engine),
+      m_queue_depth(std::max<std::size_t>(queue_depth, 1)),
+      m_chunk_size(align_up(std::max(chunk_size, kAlignment), kAlignment)) {
+    if (engine == ReadEngine::kBuffered) {
+        throw std::invalid_argument(
+            "DirectReader does not implement the buffered engine");
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-no-malloc)
+    m_bounce.reset(static_cast<uint8_t*>(
+        std::aligned_alloc(kAlignment, m_queue_depth * m_chunk_size)));
+    if (!m_bounce) {
+        throw std::bad_alloc();
+    }
+
+    if (m_engine == ReadEngine::kUring) {
+#ifdef SIGPROC_HAVE_IO_URING
+        try {
+            m_uring = std::make_unique<Uring>(
+                static_cast<unsigned>(m_queue_depth));
+        } catch (const std::system_error& err) {
+            fmt::print(stderr,
+                       "Warning: {}, falling back to the direct engine\n",
+                       err.what());
+            m_engine = ReadEngine::kDirect;
+        }
+#else
+        m_engine = ReadEngine::kDirect;
+#endif
+    }
+    open(filename);
+}
+
+DirectReader::~DirectReader() {
+    m_uring.reset();
+    close_file();
+}
+
+void DirectReader::open(const std::string& filename) {
+    close_file();
+    m_filename = filename;
+    m_size     = 0;
+    m_fd       = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    if (m_fd < 0 && errno == EINVAL) {
+        // e.g. tmpfs, which has no O_DIRECT support
+        fmt::print(stderr,
+                   "Warning: O_DIRECT not supported for {}, reading through "
+                   "the page cache\n",
+                   filename);
+        m_fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (m_fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                std::format("Could not open {}", filename));
+    }
+    struct stat st {};
+    if (::fstat(m_fd, &st) != 0) {
+        const int err = errno;
+        close_file();
+        throw std::system_error(err, std::generic_category(),
+                                std::format("Could not stat {}", filename));
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+}
+
+void DirectReader::close_file() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+std::size_t DirectReader::pread(std::size_t offset,
+                                std::span<uint8_t> buffer) {
+    if (offset >= m_size || buffer.empty()) {
+        return 0;
+    }
+    if (m_engine == ReadEngine::kUring) {
+        return pread_uring(offset, buffer);
+    }
+    return pread_threads(offset, buffer);
+}
+
+std::size_t DirectReader::pread_threads(std::size_t offset,
+                                        std::span<uint8_t> buffer) {
+    const std::size_t begin   = align_down(offset, kAlignment);
+    const std::size_t end     = align_up(offset + buffer.size(), kAlignment);
+    const std::size_t valid   = std::min(offset + buffer.size(), m_size);
+    const std::size_t nchunks = (end - begin + m_chunk_size - 1) / m_chunk_size;
+    const auto nthreads =
+        static_cast<int>(std::min(m_queue_depth, nchunks));
+    std::atomic<int> error{0};
+    std::atomic<std::size_t> ncopied{0};
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+#endif
+    for (std::size_t ichunk = 0; ichunk < nchunks; ++ichunk) {
+#ifdef USE_OPENMP
+        const auto slot = static_cast<std::size_t>(omp_get_thread_num());
+#else
+        const std::size_t slot = 0;
+#endif
+        uint8_t* bounce           = m_bounce.get() + slot * m_chunk_size;
+        const std::size_t coff    = begin + ichunk * m_chunk_size;
+        const std::size_t clen    = std::min(m_chunk_size, end - coff);
+        const ssize_t nread       = pread_full(m_fd, bounce, clen,
+                                               static_cast<off_t>(coff));
+        if (nread < 0) {
+            error.store(errno);
+            continue;
+        }
+        const auto got = static_cast<std::size_t>(nread);
+        if (got < clen && coff + got < valid) {
+            error.store(EIO);
+            continue;
+        }
+        ncopied += copy_overlap(bounce, coff, got, offset, buffer);
+    }
+    if (error.load() != 0) {
+        throw std::system_error(error.load(), std::generic_category(),
+                                std::format("Read failed on {}", m_filename));
+    }
+    return ncopied.load();
+}
+
+std::size_t DirectReader::pread_uring(std::size_t offset,
+                                      std::span<uint8_t> buffer) {
+#ifdef SIGPROC_HAVE_IO_URING
+    const std::size_t begin   = align_down(offset, kAlignment);
+    const std::size_t end     = align_up(offset + buffer.size(), kAlignment);
+    const std::size_t valid   = std::min(offset + buffer.size(), m_size);
+    const std::size_t nchunks = (end - begin + m_chunk_size - 1) / m_chunk_size;
+
+    std::vector<std::size_t> free_slots(m_queue_depth);
+    for (std::size_t islot = 0; islot < m_queue_depth; ++islot) {
+        free_slots[islot] = m_queue_depth - 1 - islot;
+    }
+    // Bytes of its chunk already in each slot, after short completions
+    std::vector<std::size_t> slot_done(m_queue_depth, 0);
+    std::size_t next     = 0;
+    std::size_t inflight = 0;
+    std::size_t ncopied  = 0;
+    int error            = 0;
+
+    // user_data packs the chunk index in the upper and slot in the lower half
+    while (inflight > 0 || (next < nchunks && error == 0)) {
+        while (error == 0 && next < nchunks && !free_slots.empty()) {
+            const std::size_t slot = free_slots.back();
+            free_slots.pop_back();
+            const std::size_t coff = begin + next * m_chunk_size;
+            const std::size_t clen = std::min(m_chunk_size, end - coff);
+            m_uring->prep_read(m_fd, m_bounce.get() + slot * m_chunk_size,
+                               static_cast<unsigned>(clen), coff,
+                               (static_cast<uint64_t>(next) << 32) | slot);
+            ++next;
+            ++inflight;
+        }
+        m_uring->submit_and_wait(1);
+        m_uring->reap([&](uint64_t user_data, int res) {
+            const std::size_t ichunk = user_data >> 32;
+            const std::size_t slot   = user_data & 0xFFFFFFFFU;
+            const std::size_t coff   = begin + ichunk * m_chunk_size;
+            const std::size_t clen   = std::min(m_chunk_size, end - coff);
+            uint8_t* bounce          = m_bounce.get() + slot * m_chunk_size;
+            const std::size_t done =
+                slot_done[slot] + static_cast<std::size_t>(std::max(res, 0));
+            if (res > 0 && done < clen && coff + done < valid) {
+                // Short before the end of the file, read the rest
+                slot_done[slot] = done;
+                m_uring->prep_read(m_fd, bounce + done,
+                                   static_cast<unsigned>(clen - done),
+                                   coff + done, user_data);
+                return;
+            }
+            slot_done[slot] = 0;
+            --inflight;
+            free_slots.push_back(slot);
+            if (res < 0) {
+                error = -res;
+                return;
+            }
+            if (done < clen && coff + done < valid) {
+                // End of file before its size, e.g. truncated under us
+                error = EIO;
+                return;
+            }
+            ncopied += copy_overlap(bounce, coff, done, offset, buffer);
+        });
+    }
+    if (error != 0) {
+        throw std::system_error(error, std::generic_category(),
+                                std::format("Read failed on {}", m_filename));
+    }
+    return ncopied;
+#else
+    return pread_threads(offset, buffer);
+#endif
+}
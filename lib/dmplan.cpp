@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include <sigproc/dmplan.hpp>
+#include <sigproc/exceptions.hpp>
+
+namespace {
+
+constexpr std::array<char, 8> kPlanMagic{'S', 'I', 'G', 'P',
+                                         'D', 'M', 'P', 'L'};
+constexpr uint32_t kPlanVersion = 1;
+
+struct PlanFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    int32_t nchans;
+    uint64_t ndms;
+    double tsamp;
+    double fch1;
+    double foff;
+    double ref_freq;
+};
+
+} // namespace
+
+std::vector<double> DMPlan::generate_dm_list(const SigprocHeader& hdr,
+                                             double dm_min, double dm_max,
+                                             double pulse_width,
+                                             double tolerance) {
+    if (dm_min < 0 || dm_max < dm_min) {
+        throw std::invalid_argument(std::format(
+            "Need 0 <= dm_min <= dm_max, got {} and {}", dm_min, dm_max));
+    }
+    if (tolerance <= 1.0) {
+        throw std::invalid_argument(
+            std::format("Smearing tolerance must be > 1, got {}", tolerance));
+    }
+    // Smearing terms in us, frequencies in GHz
+    const double tsamp  = hdr.get<HeaderKey::kTsamp>() * 1e6;
+    const double width  = pulse_width * 1e6;
+    const double fcen   = hdr.get<HeaderKey::kFcenter>() * 1e-3;
+    const double nchans = hdr.get<HeaderKey::kNchans>();
+    const double tol2   = tolerance * tolerance;
+    // intra-channel smearing per unit DM
+    const double a  = 8.3 * std::abs(hdr.get<HeaderKey::kFoff>()) /
+                     (fcen * fcen * fcen);
+    const double a2 = a * a;
+    // smearing across the band from being off by one DM step
+    const double b2 = a2 * nchans * nchans / 16.0;
+    const double c  = (tsamp * tsamp + width * width) * (tol2 - 1.0);
+
+    std::vector<double> dms{dm_min};
+    while (dms.back() < dm_max) {
+        const double prev  = dms.back();
+        const double prev2 = prev * prev;
+        const double k     = c + tol2 * a2 * prev2;
+        const double dm =
+            (b2 * prev + std::sqrt(-a2 * b2 * prev2 + (a2 + b2) * k)) /
+            (a2 + b2);
+        if (!(dm > prev)) {
+            throw std::runtime_error(
+                std::format("DM grid does not advance beyond {}", prev));
+        }
+        dms.push_back(dm);
+    }
+    return dms;
+}
+
+DMPlan::DMPlan(const SigprocHeader& hdr, std::vector<double> dms,
+               const std::string& ref_freq)
+    : m_nchans(hdr.get<HeaderKey::kNchans>()),
+      m_tsamp(hdr.get<HeaderKey::kTsamp>()),
+      m_fch1(hdr.get<HeaderKey::kFch1>()),
+      m_foff(hdr.get<HeaderKey::kFoff>()),
+      m_ref_freq(hdr.get_ref_freq(ref_freq)),
+      m_dms(std::move(dms)) {
+    if (m_nchans <= 0 || m_tsamp <= 0) {
+        throw std::invalid_argument(std::format(
+            "Need nchans > 0 and tsamp > 0, got {} and {}", m_nchans,
+            m_tsamp));
+    }
+    compute_delays();
+}
+
+void DMPlan::compute_delays() {
+    const auto nchans = static_cast<std::size_t>(m_nchans);
+    // Delay of each channel per unit DM, in samples
+    std::vector<double> factors(nchans);
+    const double inv_ref2 = 1.0 / (m_ref_freq * m_ref_freq);
+    for (std::size_t ichan = 0; ichan < nchans; ++ichan) {
+        const double freq = m_fch1 + static_cast<double>(ichan) * m_foff;
+        factors[ichan] =
+            kDMConst * (1.0 / (freq * freq) - inv_ref2) / m_tsamp;
+    }
+
+    m_delays.resize(m_dms.size() * nchans);
+    const auto ndms      = static_cast<int64_t>(m_dms.size());
+    const double* fac    = factors.data();
+    const double* dmlist = m_dms.data();
+    int32_t* table       = m_delays.data();
+#pragma omp parallel for
+    for (int64_t idm = 0; idm < ndms; ++idm) {
+        const double dm = dmlist[idm];
+        int32_t* row    = table + idm * static_cast<int64_t>(nchans);
+#pragma omp simd
+        for (std::size_t ichan = 0; ichan < nchans; ++ichan) {
+            row[ichan] =
+                static_cast<int32_t>(std::floor(dm * fac[ichan] + 0.5));
+        }
+    }
+    m_max_delay = 0;
+    for (const auto delay : m_delays) {
+        m_max_delay = std::max(m_max_delay, std::abs(delay));
+    }
+}
+
+std::span<const int32_t> DMPlan::delays(std::size_t idm) const {
+    if (idm >= m_dms.size()) {
+        throw std::out_of_range(std::format("DM trial {} out of range ({})",
+                                            idm, m_dms.size()));
+    }
+    const auto nchans = static_cast<std::size_t>(m_nchans);
+    return std::span(m_delays).subspan(idm * nchans, nchans);
+}
+
+bool DMPlan::matches(const SigprocHeader& hdr, const std::vector<double>& dms,
+                     double ref_freq) const {
+    return m_nchans == hdr.get<HeaderKey::kNchans>() &&
+           m_tsamp == hdr.get<HeaderKey::kTsamp>() &&
+           m_fch1 == hdr.get<HeaderKey::kFch1>() &&
+           m_foff == hdr.get<HeaderKey::kFoff>() && m_ref_freq == ref_freq &&
+           m_dms == dms;
+}
+
+DMPlan DMPlan::load(const std::string& filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    ErrorChecker::check_stream(stream, filename);
+    PlanFileHeader header{};
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!stream || header.magic != kPlanMagic ||
+        header.version != kPlanVersion || header.nchans <= 0) {
+        throw std::runtime_error(std::format("{} is not a DM plan", filename));
+    }
+    DMPlan plan;
+    plan.m_nchans   = header.nchans;
+    plan.m_tsamp    = header.tsamp;
+    plan.m_fch1     = header.fch1;
+    plan.m_foff     = header.foff;
+    plan.m_ref_freq = header.ref_freq;
+    const auto nbytes = std::filesystem::file_size(filename) - sizeof(header);
+    if (nbytes != header.ndms * (sizeof(double) +
+                                 header.nchans * sizeof(int32_t))) {
+        throw std::runtime_error(std::format("{} is truncated", filename));
+    }
+    plan.m_dms.resize(header.ndms);
+    plan.m_delays.resize(header.ndms * header.nchans);
+    stream.read(reinterpret_cast<char*>(plan.m_dms.data()),
+                static_cast<std::streamsize>(plan.m_dms.size() *
+                                             sizeof(double)));
+    stream.read(reinterpret_cast<char*>(plan.m_delays.data()),
+                static_cast<std::streamsize>(plan.m_delays.size() *
+                                             sizeof(int32_t)));
+    if (!stream) {
+        throw std::runtime_error(std::format("{} is truncated", filename));
+    }
+    for (const auto delay : plan.m_delays) {
+        plan.m_max_delay = std::max(plan.m_max_delay, std::abs(delay));
+    }
+    return plan;
+}
+
+DMPlan DMPlan::load_or_build(const std::string& filename,
+                             const SigprocHeader& hdr,
+                             const std::vector<double>& dms,
+                             const std::string& ref_freq) {
+    if (std::filesystem::exists(filename)) {
+        try {
+            auto plan = load(filename);
+            if (plan.matches(hdr, dms, hdr.get_ref_freq(ref_freq))) {
+                return plan;
+            }
+            fmt::print(stderr, "Warning: rebuilding DM plan {}: made for "
+                               "other trials or data\n",
+                       filename);
+        } catch (const std::runtime_error& e) {
+            fmt::print(stderr, "Warning: rebuilding DM plan: {}\n", e.what());
+        }
+    }
+    DMPlan plan(hdr, dms, ref_freq);
+    plan.save(filename);
+    return plan;
+}
+
+void DMPlan::save(const std::string& filename) const {
+    std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+    ErrorChecker::check_stream(stream, filename);
+    const PlanFileHeader header{kPlanMagic, kPlanVersion, m_nchans,
+                                m_dms.size(), m_tsamp,    m_fch1,
+                                m_foff,       m_ref_freq};
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(m_dms.data()),
+                 static_cast<std::streamsize>(m_dms.size() * sizeof(double)));
+    stream.write(reinterpret_cast<const char*>(m_delays.data()),
+                 static_cast<std::streamsize>(m_delays.size() *
+                                              sizeof(int32_t)));
+    ErrorChecker::check_stream(stream, filename);
+}
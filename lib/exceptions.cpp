@@ -1,4 +1,5 @@
 #include <format>
+#include <fstream>
 #include <stdexcept>
 
 #include <sigproc/exceptions.hpp>
@@ -19,3 +20,10 @@ void ErrorChecker::check_stream(Tstream& stream, const std::string& filename) {
         throw std::runtime_error(error_msg);
     }
 }
+
+template void ErrorChecker::check_stream<std::fstream>(std::fstream&,
+                                                       const std::string&);
+template void ErrorChecker::check_stream<std::ifstream>(std::ifstream&,
+                                                        const std::string&);
+template void ErrorChecker::check_stream<std::ofstream>(std::ofstream&,
+                                                        const std::string&);
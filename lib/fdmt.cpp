@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+#include <sigproc/fdmt.hpp>
+
+namespace {
+
+// A sub-band of the transform, between two channel edges
+struct Band {
+    double f_lo;
+    double f_hi;
+    int max_delay;
+    int64_t first_row;
+};
+
+// Delay across [f_lo, f_hi] per unit of kDMConst * DM / tsamp
+double band_factor(double f_lo, double f_hi) {
+    return 1.0 / (f_lo * f_lo) - 1.0 / (f_hi * f_hi);
+}
+
+int ceil_delay(double delay) {
+    // round-off must not add a whole row
+    return static_cast<int>(std::ceil(delay - 1e-9));
+}
+
+} // namespace
+
+std::vector<double> FDMT::dm_list(const SigprocHeader& hdr, double dm_min,
+                                  double dm_max) {
+    if (dm_min < 0 || dm_max < dm_min) {
+        throw std::invalid_argument(std::format(
+            "Need 0 <= dm_min <= dm_max, got {} and {}", dm_min, dm_max));
+    }
+    // ftop is the first channel edge, the lower one if foff > 0
+    const auto [f_lo, f_hi] = std::minmax(hdr.get<HeaderKey::kFbottom>(),
+                                          hdr.get<HeaderKey::kFtop>());
+    const double dm_step =
+        hdr.get<HeaderKey::kTsamp>() / (kDMConst * band_factor(f_lo, f_hi));
+    if (!(dm_step > 0)) {
+        throw std::invalid_argument("FDMT needs a band of non-zero width");
+    }
+    std::vector<double> dms;
+    for (auto delay = static_cast<int64_t>(std::ceil(dm_min / dm_step));;
+         ++delay) {
+        dms.push_back(static_cast<double>(delay) * dm_step);
+        if (dms.back() >= dm_max) {
+            break;
+        }
+    }
+    return dms;
+}
+
+FDMT::FDMT(const DMPlan& plan) : m_nchans(plan.nchans()) {
+    if (plan.ndms() == 0 || plan.foff() == 0) {
+        throw std::invalid_argument(
+            "FDMT needs at least one trial and a non-zero channel width");
+    }
+    const double half_width = std::abs(plan.foff()) / 2;
+    const double dm_max = *std::ranges::max_element(plan.dms());
+    const double scale  = dm_max * kDMConst / plan.tsamp();
+
+    // One band per channel, in ascending frequency
+    std::vector<Band> bands;
+    int64_t nrows = 0;
+    for (int iband = 0; iband < m_nchans; ++iband) {
+        const int chan = plan.foff() < 0 ? m_nchans - 1 - iband : iband;
+        const double freq = plan.fch1() + chan * plan.foff();
+        const double f_lo = freq - half_width;
+        const double f_hi = freq + half_width;
+        const int delay   = ceil_delay(scale * band_factor(f_lo, f_hi));
+        bands.push_back({f_lo, f_hi, delay, nrows});
+        m_chan_order.push_back(chan);
+        m_chan_delays.push_back(delay);
+        m_chan_rows.push_back(nrows);
+        nrows += delay + 1;
+    }
+    m_max_rows = nrows;
+
+    // Merge neighbouring bands until one is left
+    while (bands.size() > 1) {
+        std::vector<Band> merged;
+        std::vector<MergeRow> rows;
+        nrows = 0;
+        for (std::size_t iband = 0; iband < bands.size(); iband += 2) {
+            if (iband + 1 == bands.size()) {
+                const Band& band = bands[iband];
+                for (int delay = 0; delay <= band.max_delay; ++delay) {
+                    rows.push_back({nrows + delay, band.first_row + delay, -1,
+                                    0, delay});
+                }
+                merged.push_back({band.f_lo, band.f_hi, band.max_delay,
+                                  nrows});
+                nrows += band.max_delay + 1;
+                continue;
+            }
+            const Band& lower = bands[iband];
+            const Band& upper = bands[iband + 1];
+            const double whole = band_factor(lower.f_lo, upper.f_hi);
+            const double ratio = band_factor(upper.f_lo, upper.f_hi) / whole;
+            const int max_delay = ceil_delay(scale * whole);
+            for (int delay = 0; delay <= max_delay; ++delay) {
+                int upper_delay = std::min(
+                    static_cast<int>(std::lround(delay * ratio)),
+                    upper.max_delay);
+                upper_delay = std::max(upper_delay, delay - lower.max_delay);
+                const int lower_delay = delay - upper_delay;
+                rows.push_back({nrows + delay, upper.first_row + upper_delay,
+                                lower.first_row + lower_delay, upper_delay,
+                                delay});
+            }
+            merged.push_back({lower.f_lo, upper.f_hi, max_delay, nrows});
+            nrows += max_delay + 1;
+        }
+        m_max_rows = std::max(m_max_rows, nrows);
+        m_iterations.push_back(std::move(rows));
+        bands = std::move(merged);
+    }
+
+    m_max_delay = bands.front().max_delay;
+    const double whole = band_factor(bands.front().f_lo, bands.front().f_hi);
+    for (const double dm : plan.dms()) {
+        const auto delay = std::lround(dm * kDMConst / plan.tsamp() * whole);
+        m_rows.push_back(static_cast<int>(
+            std::min<long>(delay, static_cast<long>(m_max_delay))));
+    }
+}
+
+void FDMT::init_state(std::span<const float> in, int nsamps, int nifs) {
+    float* state     = m_state.data();
+    const float* inbuf = in.data();
+#pragma omp parallel for schedule(dynamic)
+    for (int iband = 0; iband < m_nchans; ++iband) {
+        float* row0 = state + m_chan_rows[iband] * nsamps;
+        std::fill_n(row0, nsamps, 0.0F);
+        for (int ifno = 0; ifno < nifs; ++ifno) {
+            const float* src =
+                inbuf + (static_cast<int64_t>(ifno) * m_nchans +
+                         m_chan_order[iband]) *
+                            nsamps;
+#pragma omp simd
+            for (int t = 0; t < nsamps; ++t) {
+                row0[t] += src[t];
+            }
+        }
+        // Sum over the smearing within the channel
+        for (int delay = 1; delay <= m_chan_delays[iband]; ++delay) {
+            const float* prev = row0 + static_cast<int64_t>(delay - 1) * nsamps;
+            float* row        = row0 + static_cast<int64_t>(delay) * nsamps;
+            const int nvalid  = nsamps - delay;
+#pragma omp simd
+            for (int t = 0; t < nvalid; ++t) {
+                row[t] = prev[t] + row0[t + delay];
+            }
+        }
+    }
+}
+
+void FDMT::execute(std::span<const float> in, int nsamps_in, int nifs,
+                   std::span<float> out) {
+    const int nsamps_out = nsamps_in - m_max_delay;
+    if (nsamps_out <= 0) {
+        throw std::invalid_argument(std::format(
+            "Block of {} samples is shorter than the maximum delay {}",
+            nsamps_in, m_max_delay));
+    }
+    if (in.size() < static_cast<std::size_t>(m_nchans) * nifs * nsamps_in ||
+        out.size() < ndms() * nsamps_out) {
+        throw std::invalid_argument(std::format(
+            "Buffers too small for {} rows x {} samples into {} trials",
+            m_nchans * nifs, nsamps_in, ndms()));
+    }
+    const auto state_size = static_cast<std::size_t>(m_max_rows) * nsamps_in;
+    if (m_state.size() < state_size) {
+        m_state.resize(state_size);
+        m_next.resize(state_size);
+    }
+    init_state(in, nsamps_in, nifs);
+
+    for (const auto& rows : m_iterations) {
+        const float* state = m_state.data();
+        float* next        = m_next.data();
+        const auto nrows   = static_cast<int64_t>(rows.size());
+#pragma omp parallel for schedule(static)
+        for (int64_t irow = 0; irow < nrows; ++irow) {
+            const MergeRow& row = rows[irow];
+            float* dst          = next + row.out_row * nsamps_in;
+            const float* upper  = state + row.upper_row * nsamps_in;
+            const int nvalid    = nsamps_in - row.delay;
+            if (row.lower_row < 0) {
+                std::copy_n(upper, nvalid, dst);
+                continue;
+            }
+            const float* lower =
+                state + row.lower_row * nsamps_in + row.shift;
+#pragma omp simd
+            for (int t = 0; t < nvalid; ++t) {
+                dst[t] = upper[t] + lower[t];
+            }
+        }
+        std::swap(m_state, m_next);
+    }
+
+    const float* state = m_state.data();
+    float* outbuf      = out.data();
+    const auto ntrials = static_cast<int64_t>(ndms());
+#pragma omp parallel for
+    for (int64_t idm = 0; idm < ntrials; ++idm) {
+        std::copy_n(state + static_cast<int64_t>(m_rows[idm]) * nsamps_in,
+                    nsamps_out, outbuf + idm * nsamps_out);
+    }
+}
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include <sigproc/fft.hpp>
+#include <sigproc/overlap.hpp>
+#include <sigproc/parallel.hpp>
+
+namespace {
+
+// fftwf_malloc alignment is at most this, so such arrays can run any plan
+constexpr std::uintptr_t kFFTAlignment = 64;
+
+static_assert(sizeof(FFTComplex) == sizeof(fftwf_complex));
+
+unsigned effort_flags(FFTEffort effort) {
+    switch (effort) {
+    case FFTEffort::kEstimate:
+        return FFTW_ESTIMATE;
+    case FFTEffort::kPatient:
+        return FFTW_PATIENT;
+    default:
+        return FFTW_MEASURE;
+    }
+}
+
+void init_fftw_threads() {
+#ifdef USE_FFTW_THREADS
+    static std::once_flag once;
+    std::call_once(once, [] {
+        if (fftwf_init_threads() == 0) {
+            throw std::runtime_error("Could not initialise FFTW threads");
+        }
+    });
+#endif
+}
+
+} // namespace
+
+FFTPlanManager::~FFTPlanManager() {
+    try {
+        save_wisdom();
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "Warning: {}\n", e.what());
+    }
+    for (auto& [key, plan] : m_plans) {
+        fftwf_destroy_plan(plan);
+    }
+}
+
+FFTPlanManager& FFTPlanManager::default_manager() {
+    static FFTPlanManager manager;
+    return manager;
+}
+
+std::string FFTPlanManager::default_wisdom_file() {
+    if (const char* path = std::getenv("SIGPROC_WISDOM")) {
+        return path;
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::format("{}/.sigproc_fftw_wisdom", home);
+    }
+    return {};
+}
+
+bool FFTPlanManager::set_wisdom_file(const std::string& filename) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_wisdom_file = filename;
+    if (filename.empty() || !std::filesystem::exists(filename)) {
+        return false;
+    }
+    if (fftwf_import_wisdom_from_filename(filename.c_str()) == 0) {
+        fmt::print(stderr, "Warning: could not import FFTW wisdom from {}\n",
+                   filename);
+        return false;
+    }
+    return true;
+}
+
+void FFTPlanManager::save_wisdom() {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_dirty || m_wisdom_file.empty()) {
+        return;
+    }
+    // Replace the old wisdom only once the new one is complete
+    const std::string tmpname = m_wisdom_file + ".tmp";
+    if (fftwf_export_wisdom_to_filename(tmpname.c_str()) == 0) {
+        throw std::runtime_error(
+            std::format("Could not write FFTW wisdom to {}", tmpname));
+    }
+    std::filesystem::rename(tmpname, m_wisdom_file);
+    m_dirty = false;
+}
+
+void FFTPlanManager::set_effort(FFTEffort effort) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_effort = effort;
+}
+
+fftwf_plan FFTPlanManager::r2c(int n, int howmany, int nthreads) {
+    if (n < 2 || howmany < 1) {
+        throw std::invalid_argument(std::format(
+            "Need n >= 2 and howmany >= 1, got {} and {}", n, howmany));
+    }
+    nthreads = resolve_nthreads(nthreads);
+    // FFTW planning is not thread-safe, only execution is
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const PlanKey key{n, howmany, nthreads, m_effort};
+    if (const auto it = m_plans.find(key); it != m_plans.end()) {
+        return it->second;
+    }
+
+    init_fftw_threads();
+#ifdef USE_FFTW_THREADS
+    fftwf_plan_with_nthreads(nthreads);
+#endif
+    // Measuring overwrites the arrays, so plan on scratch ones
+    const int nbins = n / 2 + 1;
+    FFTWVector<float> in(static_cast<std::size_t>(n) * howmany);
+    FFTWVector<FFTComplex> out(static_cast<std::size_t>(nbins) * howmany);
+    const auto start = std::chrono::steady_clock::now();
+    fftwf_plan plan  = fftwf_plan_many_dft_r2c(
+        1, &n, howmany, in.data(), nullptr, 1, n,
+        reinterpret_cast<fftwf_complex*>(out.data()), nullptr, 1, nbins,
+        effort_flags(m_effort));
+    m_planning_sec += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    if (plan == nullptr) {
+        throw std::runtime_error(std::format(
+            "FFTW could not plan {} transforms of {} points", howmany, n));
+    }
+    m_plans.emplace(key, plan);
+    m_dirty = true;
+    return plan;
+}
+
+std::size_t FFTPlanManager::nplans() const {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_plans.size();
+}
+
+double FFTPlanManager::planning_seconds() const {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_planning_sec;
+}
+
+PowerSpectrum::PowerSpectrum(int n, int howmany, int nthreads,
+                             FFTPlanManager& manager)
+    : m_n(n),
+      m_howmany(howmany),
+      m_nthreads(resolve_nthreads(nthreads)),
+      m_plan(manager.r2c(n, howmany, m_nthreads)),
+      m_out(static_cast<std::size_t>(nbins()) * howmany) {}
+
+std::span<const FFTComplex>
+PowerSpectrum::transform(std::span<const float> in) {
+    const auto size = static_cast<std::size_t>(m_n) * m_howmany;
+    if (in.size() < size) {
+        throw std::invalid_argument(std::format(
+            "Need {} x {} samples, got {}", m_howmany, m_n, in.size()));
+    }
+    const float* src = in.data();
+    if (reinterpret_cast<std::uintptr_t>(src) % kFFTAlignment != 0) {
+        m_in.resize(size);
+        std::copy_n(src, size, m_in.begin());
+        src = m_in.data();
+    }
+    // Out-of-place real-to-complex plans leave the input untouched
+    fftwf_execute_dft_r2c(m_plan, const_cast<float*>(src),
+                          reinterpret_cast<fftwf_complex*>(m_out.data()));
+    return m_out;
+}
+
+void PowerSpectrum::compute(std::span<const float> in,
+                            std::span<float> power) {
+    const auto spectra = transform(in);
+    if (power.size() < spectra.size()) {
+        throw std::invalid_argument(
+            std::format("Need {} power bins, got {}", spectra.size(),
+                        power.size()));
+    }
+    const FFTComplex* bins = spectra.data();
+    float* out             = power.data();
+    const auto nvalues     = static_cast<int64_t>(spectra.size());
+#pragma omp parallel for simd num_threads(m_nthreads)
+    for (int64_t ii = 0; ii < nvalues; ++ii) {
+        out[ii] = bins[ii].re * bins[ii].re + bins[ii].im * bins[ii].im;
+    }
+}
+
+void PowerSpectrum::accumulate(std::span<const float> in,
+                               std::span<double> sums) {
+    const auto spectra = transform(in);
+    if (sums.size() < spectra.size()) {
+        throw std::invalid_argument(
+            std::format("Need {} power bins, got {}", spectra.size(),
+                        sums.size()));
+    }
+    const FFTComplex* bins = spectra.data();
+    double* out            = sums.data();
+    const auto nvalues     = static_cast<int64_t>(spectra.size());
+#pragma omp parallel for simd num_threads(m_nthreads)
+    for (int64_t ii = 0; ii < nvalues; ++ii) {
+        out[ii] += bins[ii].re * bins[ii].re + bins[ii].im * bins[ii].im;
+    }
+}
+
+ChannelSpectra channel_spectra(FilReader& reader, int nfft, int nthreads) {
+    ChannelSpectra result;
+    result.nfft  = nfft;
+    result.nrows = reader.hdr.get<HeaderKey::kNchans>() *
+                   reader.hdr.get<HeaderKey::kNifs>();
+    PowerSpectrum spectrum(nfft, result.nrows, nthreads);
+    result.power.assign(
+        static_cast<std::size_t>(result.nrows) * spectrum.nbins(), 0.0);
+
+    const auto old_layout = reader.get_layout();
+    reader.set_layout(BlockLayout::kChannelMajor);
+    try {
+        OverlapReader blocks(reader, nfft, 0);
+        for (const auto& block : blocks) {
+            if (block.nsamps < nfft) {
+                break;
+            }
+            spectrum.accumulate(block.data, result.power);
+            ++result.nblocks;
+        }
+    } catch (...) {
+        reader.set_layout(old_layout);
+        throw;
+    }
+    reader.set_layout(old_layout);
+
+    if (result.nblocks > 0) {
+        const double scale = 1.0 / static_cast<double>(result.nblocks);
+        for (auto& value : result.power) {
+            value *= scale;
+        }
+    }
+    return result;
+}
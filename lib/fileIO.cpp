@@ -1,7 +1,15 @@
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <format>
+#include <system_error>
 #include <utility>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <sigproc/exceptions.hpp>
 #include <sigproc/numbits.hpp>
 #include <sigproc/utils.hpp>
@@ -10,97 +18,413 @@
 
 namespace fs = std::filesystem;
 
+StreamInfo::StreamInfo(std::vector<FileInfo> entries)
+    : m_entries(std::move(entries)) {
+    if (m_entries.empty()) {
+        throw std::invalid_argument("Empty file list");
+    }
+    m_cumsum_datalens.reserve(m_entries.size() + 1);
+    m_cumsum_datalens.push_back(0);
+    for (const auto& entry : m_entries) {
+        m_cumsum_datalens.push_back(m_cumsum_datalens.back() + entry.datalen);
+    }
+}
+
+void StreamInfo::check_contiguity() const {
+    const auto& first = m_entries.front();
+    for (size_t ifile = 1; ifile < m_entries.size(); ++ifile) {
+        const auto& prev  = m_entries[ifile - 1];
+        const auto& entry = m_entries[ifile];
+        if (entry.nchans != first.nchans || entry.nifs != first.nifs ||
+            entry.nbits != first.nbits) {
+            throw std::runtime_error(std::format(
+                "{}: data layout (nchans={}, nifs={}, nbits={}) differs from "
+                "{} (nchans={}, nifs={}, nbits={})",
+                entry.filename, entry.nchans, entry.nifs, entry.nbits,
+                first.filename, first.nchans, first.nifs, first.nbits));
+        }
+        if (std::abs(entry.tsamp - first.tsamp) > 1e-9 * first.tsamp) {
+            throw std::runtime_error(std::format(
+                "{}: tsamp {} differs from {} ({})", entry.filename,
+                entry.tsamp, first.filename, first.tsamp));
+        }
+        // Allow half a sample of rounding in the MJD time stamps
+        const double expected_sec =
+            static_cast<double>(prev.nsamples) * prev.tsamp;
+        const double actual_sec = (entry.tstart - prev.tstart) * 86400.0;
+        if (std::abs(actual_sec - expected_sec) > 0.5 * first.tsamp) {
+            throw std::runtime_error(std::format(
+                "{} does not follow on from {}: gap of {} s ({} samples)",
+                entry.filename, prev.filename, actual_sec - expected_sec,
+                (actual_sec - expected_sec) / first.tsamp));
+        }
+    }
+}
+
+size_t StreamInfo::nsamples() const {
+    size_t total = 0;
+    for (const auto& entry : m_entries) {
+        total += entry.nsamples;
+    }
+    return total;
+}
+
+std::vector<std::string> StreamInfo::filenames() const {
+    std::vector<std::string> names;
+    names.reserve(m_entries.size());
+    for (const auto& entry : m_entries) {
+        names.push_back(entry.filename);
+    }
+    return names;
+}
+
 FileBase::FileBase(const std::vector<std::string>& filenames, std::string mode)
-    : filenames(filenames), mode(std::move(mode)) {
-    if (filenames.empty()) {
+    : m_filenames(filenames), m_mode(std::move(mode)) {
+    if (m_filenames.empty()) {
         throw std::invalid_argument("Empty file list");
     }
-    openFile(0);
+    open_file(0);
 }
-FileBase::~FileBase() { closeCurrent(); }
+FileBase::~FileBase() { close_current(); }
 
 bool FileBase::eos() const {
     // First check if we are at the end of the current file
-    bool eof = file_stream.tellg() == fs::file_size(filenames[ifileCur]);
+    bool eof = static_cast<size_t>(m_file_stream.tellg()) ==
+               fs::file_size(m_filenames[m_ifileCur]);
     // Now check if we are at the end of the list of files
-    bool eol = ifileCur == filenames.size() - 1;
+    bool eol = m_ifileCur == m_filenames.size() - 1;
     return eof && eol;
 }
 
-void FileBase::openFile(size_t ifile) {
-    if (ifile < 0 || ifile >= filenames.size()) {
+void FileBase::open_file(size_t ifile) const {
+    if (ifile >= m_filenames.size()) {
         throw std::out_of_range(std::format("Invalid file index: {}", ifile));
     }
-    if (!fs::exists(filenames[ifile])) {
+    if (!fs::exists(m_filenames[ifile])) {
         throw std::invalid_argument(
-            std::format("File does not exist: {}", filenames[ifile]));
+            std::format("File does not exist: {}", m_filenames[ifile]));
     }
 
-    if (ifile != ifileCur) {
-        closeCurrent();
-        auto file_mode = MapUtils::get_value(modeMap, mode);
-        file_stream.open(filenames[ifile].c_str(), file_mode);
-        ErrorChecker::check_stream(file_stream, filenames[ifile]);
-        ifileCur = ifile;
+    if (ifile != m_ifileCur) {
+        close_current();
+        auto file_mode = map_utils::get_value(m_modeMap, m_mode);
+        m_file_stream.open(m_filenames[ifile].c_str(), file_mode);
+        ErrorChecker::check_stream(m_file_stream, m_filenames[ifile]);
+        m_ifileCur = ifile;
     }
 }
 
-void FileBase::closeCurrent() {
-    if (file_stream.is_open()) {
-        file_stream.close();
+void FileBase::close_current() const {
+    if (m_file_stream.is_open()) {
+        m_file_stream.close();
     }
 }
 
-FileIO::FileIO(const std::string& filename, int nbits)
-    : nbits(nbits), bitsinfo(nbits) {
-    file_stream.open(filename.c_str(),
-                     std::ifstream::in | std::ifstream::binary);
-    ErrorChecker::check_file(file_stream, filename);
+FileReader::FileReader(const StreamInfo& stream_info, const std::string& mode,
+                       int nbits, ReadEngine engine)
+    : FileBase(stream_info.filenames(), mode), sinfo(stream_info),
+      nbits(nbits), bitsinfo(nbits), engine_type(engine) {
+    _seek2hdr(0);
 }
 
-FileIO::~FileIO() { file_stream.close(); }
+int64_t FileReader::cur_data_pos_file() const {
+    return static_cast<int64_t>(m_file_stream.tellg()) -
+           static_cast<int64_t>(sinfo.entries()[m_ifileCur].hdrlen);
+}
 
-/* read nread units of data from stream */
-void FileIO::read_data(std::vector<float>& block, int nread) {
-    // decide how to read the data based on the number of bits per sample
-    // read n/nbits bytes into character block containing n nbits-bit pairs
-    std::vector<uint8_t> buffer(nread * bitsinfo.itemsize());
-    file_stream.read(reinterpret_cast<char*>(buffer.data()),
-                     buffer.size() / bitsinfo.bitfact());
+int64_t FileReader::cur_data_pos_stream() const {
+    return static_cast<int64_t>(sinfo.cumsum_datalens()[m_ifileCur]) +
+           cur_data_pos_file();
+}
 
+ReadEngine FileReader::engine() const {
+    return direct ? direct->engine() : engine_type;
+}
+
+std::vector<uint8_t> FileReader::cread(std::size_t nunits) const {
+    const size_t nbytes = nunits * bitsinfo.itemsize() / bitsinfo.bitfact();
+    std::vector<uint8_t> data(nbytes);
+    data.resize(read_stream(data.data(), nbytes));
+    if (!bitsinfo.packunpack()) {
+        return data;
+    }
+    std::vector<uint8_t> unpacked(data.size() * bitsinfo.bitfact());
+    sigproc::unpack(data, unpacked, nbits, "little");
+    return unpacked;
+}
+
+std::size_t FileReader::creadinto(std::vector<uint8_t>& read_buffer,
+                                  std::vector<uint8_t>& unpack_buffer) {
+    const size_t nbytes = read_stream(read_buffer.data(), read_buffer.size());
     if (bitsinfo.packunpack()) {
-        sigproc::unpackInPlace(buffer.data(), nbits, buffer.size());
+        unpack_buffer.resize(read_buffer.size() * bitsinfo.bitfact());
+        sigproc::unpack(std::span(read_buffer).first(nbytes), unpack_buffer,
+                        nbits, "little");
     }
+    return nbytes;
+}
 
-    float* buffer_ptr = reinterpret_cast<float*>(buffer.data());
+std::size_t FileReader::creadinto(std::span<uint8_t> read_buffer) {
+    return read_stream(read_buffer.data(), read_buffer.size());
+}
 
-    block.clear();
-    block.resize(nread);
-    block.assign(buffer_ptr, buffer_ptr + block.size());
+void FileReader::seek(int64_t offset, int whence) const {
+    if (whence == 1) {
+        offset += cur_data_pos_stream();
+    } else if (whence != 0) {
+        throw std::invalid_argument(
+            std::format("whence must be 0 or 1, got {}", whence));
+    }
+    _seek_set(offset);
 }
 
-/* write block of data to stream */
-void FileIO::write_data(const std::vector<float>& block, int nwrite) {
-    // decide how to read the data based on the number of bits per sample
-    // write n/nbits bytes into character block containing n nbits-bit pairs
-    std::vector<uint8_t> buffer(nwrite * sizeof(float) / sizeof(uint8_t));
+void FileReader::_seek2hdr(int fileid) const {
+    open_file(fileid);
+    m_file_stream.seekg(sinfo.entries()[fileid].hdrlen, std::ios::beg);
+    if (engine_type == ReadEngine::kBuffered) {
+        return;
+    }
+    // One reader, its bounce buffers and ring serve every file of the stream
+    if (direct) {
+        direct->open(m_filenames[fileid]);
+    } else {
+        direct = std::make_unique<DirectReader>(m_filenames[fileid],
+                                                engine_type);
+    }
+}
 
-    const uint8_t* block_ptr = reinterpret_cast<const uint8_t*>(block.data());
-    buffer.assign(block_ptr, block_ptr + buffer.size());
+void FileReader::_seek_set(int64_t offset) const {
+    const auto& cumsum = sinfo.cumsum_datalens();
+    if (offset < 0 || static_cast<size_t>(offset) > cumsum.back()) {
+        throw std::out_of_range(std::format(
+            "Seek offset {} outside stream of {} bytes", offset, cumsum.back()));
+    }
+    // File holding the byte at offset (the last file at end of stream)
+    auto it = std::upper_bound(cumsum.begin() + 1, cumsum.end() - 1,
+                               static_cast<size_t>(offset));
+    const auto fileid = static_cast<int>(it - cumsum.begin() - 1);
+    if (static_cast<size_t>(fileid) != m_ifileCur) {
+        _seek2hdr(fileid);
+    }
+    m_file_stream.seekg(
+        static_cast<std::streamoff>(sinfo.entries()[fileid].hdrlen +
+                                    static_cast<size_t>(offset) -
+                                    cumsum[fileid]),
+        std::ios::beg);
+}
 
-    if (bitsinfo.packunpack()) {
-        sigproc::packInPlace(buffer.data(), nbits, buffer.size());
+/*
+ * Read across file boundaries, skipping the header of each following file,
+ * straight into the caller's buffer.
+ */
+std::size_t FileReader::read_stream(uint8_t* buffer,
+                                    std::size_t nbytes) const {
+    std::size_t nread = 0;
+    while (true) {
+        nread += read_current(buffer + nread, nbytes - nread);
+        if (nread == nbytes || m_ifileCur + 1 >= sinfo.entries().size()) {
+            break;
+        }
+        _seek2hdr(static_cast<int>(m_ifileCur + 1));
     }
+    return nread;
+}
 
-    file_stream.write(reinterpret_cast<const char*>(buffer.data()),
-                      buffer.size() / bitsinfo.bitfact());
+/*
+ * Read from the current file at the current stream position. The fstream
+ * position is the single source of truth; the direct engines read at it and
+ * move it forward afterwards.
+ */
+std::size_t FileReader::read_current(uint8_t* buffer,
+                                     std::size_t nbytes) const {
+    const auto& entry = sinfo.entries()[m_ifileCur];
+    const auto pos    = static_cast<size_t>(m_file_stream.tellg());
+    nbytes = std::min(nbytes, entry.hdrlen + entry.datalen - pos);
+    if (direct) {
+        const size_t nread = direct->pread(pos, {buffer, nbytes});
+        m_file_stream.seekg(static_cast<std::streamoff>(pos + nread),
+                            std::ios::beg);
+        return nread;
+    }
+    m_file_stream.read(reinterpret_cast<char*>(buffer),
+                       static_cast<std::streamsize>(nbytes));
+    return static_cast<size_t>(m_file_stream.gcount());
+}
+
+FileIO::FileIO(const std::string& filename, int nbits, const std::string& mode)
+    : filename(filename), nbits(nbits), bitsinfo(nbits) {
+    const std::unordered_map<std::string, std::ios_base::openmode> mode_map = {
+        {"r", std::ios::in | std::ios::binary},
+        {"w", std::ios::out | std::ios::trunc | std::ios::binary},
+        {"a", std::ios::out | std::ios::app | std::ios::binary}};
+    file_stream.open(filename.c_str(), map_utils::get_value(mode_map, mode));
+    ErrorChecker::check_stream(file_stream, filename);
+}
+
+FileIO::~FileIO() { file_stream.close(); }
+
+/* read nread units of data from stream */
+void FileIO::read_data(std::vector<float>& block, int nread) {
+    // read n*nbits/8 bytes and convert them to float in a single pass
+    scratch.resize(nread * bitsinfo.itemsize() / bitsinfo.bitfact());
+    file_stream.read(reinterpret_cast<char*>(scratch.data()),
+                     static_cast<std::streamsize>(scratch.size()));
+    block.resize(nread);
+    sigproc::unpack_to_float(scratch.bytes(), block, nbits, "little");
+}
+
+/* write block of data to stream */
+void FileIO::write_data(std::span<const float> block, int nwrite) {
+    // quantise and pack the floats into n*nbits/8 bytes
+    scratch.resize(nwrite * bitsinfo.itemsize() / bitsinfo.bitfact());
+    sigproc::pack_from_float(block.first(nwrite), scratch.bytes(), nbits,
+                             "little");
+    file_stream.write(reinterpret_cast<const char*>(scratch.data()),
+                      static_cast<std::streamsize>(scratch.size()));
+    if (!file_stream) {
+        throw std::runtime_error(std::format(
+            "Failed to write {} bytes to {}", scratch.size(), filename));
+    }
+}
+
+void FileIO::flush() {
+    file_stream.flush();
+    if (!file_stream) {
+        throw std::runtime_error(
+            std::format("Failed to flush data to {}", filename));
+    }
 }
 
 /* get to the right place in the file stream. */
-void FileIO::seek_bytes(int nbytes, bool offset = false) {
+void FileIO::seek_bytes(int64_t nbytes, bool offset) {
     if (offset) {
         file_stream.seekg(nbytes, std::ios_base::cur);
     } else {
         file_stream.seekg(nbytes);
     }
 }
+
+MappedFile::MappedFile(const std::string& filename) : m_filename(filename) {
+    m_fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                std::format("Could not open {}", filename));
+    }
+    struct stat st {};
+    if (::fstat(m_fd, &st) != 0) {
+        const int err = errno;
+        ::close(m_fd);
+        throw std::system_error(err, std::generic_category(),
+                                std::format("Could not stat {}", filename));
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size == 0) {
+        return;
+    }
+    void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (addr == MAP_FAILED) {
+        const int err = errno;
+        ::close(m_fd);
+        throw std::system_error(err, std::generic_category(),
+                                std::format("Could not map {}", filename));
+    }
+    m_addr = static_cast<uint8_t*>(addr);
+}
+
+MappedFile::~MappedFile() {
+    if (m_addr != nullptr) {
+        ::munmap(m_addr, m_size);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+std::span<const uint8_t> MappedFile::data(size_t offset, size_t nbytes) const {
+    if (offset > m_size || nbytes > m_size - offset) {
+        throw std::out_of_range(
+            std::format("Mapped range [{}, {}) exceeds size of {} ({} bytes)",
+                        offset, offset + nbytes, m_filename, m_size));
+    }
+    return {m_addr + offset, nbytes};
+}
+
+void MappedFile::advise(size_t offset, size_t nbytes,
+                        AccessPattern pattern) const {
+    if (m_addr == nullptr || offset >= m_size || nbytes == 0) {
+        return;
+    }
+    static const auto kPageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+
+    const size_t end   = std::min(m_size, offset + nbytes);
+    const size_t begin = offset - (offset % kPageSize);
+    int advice         = MADV_NORMAL;
+    switch (pattern) {
+    case AccessPattern::kNormal:
+        advice = MADV_NORMAL;
+        break;
+    case AccessPattern::kSequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case AccessPattern::kRandom:
+        advice = MADV_RANDOM;
+        break;
+    case AccessPattern::kWillNeed:
+        advice = MADV_WILLNEED;
+        break;
+    }
+    ::madvise(m_addr + begin, end - begin, advice);
+}
+
+PositionalWriter::PositionalWriter(const std::string& filename, size_t size)
+    : m_filename(filename), m_size(size) {
+    m_fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                std::format("Could not open {}", filename));
+    }
+    if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+        const int err = errno;
+        ::close(m_fd);
+        throw std::system_error(
+            err, std::generic_category(),
+            std::format("Could not resize {} to {} bytes", filename, size));
+    }
+}
+
+PositionalWriter::~PositionalWriter() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+void PositionalWriter::pwrite(size_t offset,
+                              std::span<const uint8_t> data) const {
+    if (offset > m_size || data.size() > m_size - offset) {
+        throw std::out_of_range(
+            std::format("Write range [{}, {}) exceeds size of {} ({} bytes)",
+                        offset, offset + data.size(), m_filename, m_size));
+    }
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t ret =
+            ::pwrite(m_fd, data.data() + done, data.size() - done,
+                     static_cast<off_t>(offset + done));
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(
+                errno, std::generic_category(),
+                std::format("Could not write to {}", m_filename));
+        }
+        done += static_cast<size_t>(ret);
+    }
+}
+
+void PositionalWriter::sync() const {
+    if (::fdatasync(m_fd) != 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                std::format("Could not sync {}", m_filename));
+    }
+}
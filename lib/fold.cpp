@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <map>
+#include <stdexcept>
+
+#include <sigproc/fold.hpp>
+
+namespace {
+
+/*
+ * Share value among the bins of [pos, pos + width) bins, pos in [0, nbins),
+ * wrapping at the end of the period.
+ */
+void spread(float value, double pos, double width, int nbins, double* sums,
+            double* weights) {
+    auto ibin     = static_cast<int>(pos);
+    double offset = pos - ibin;
+    if (ibin >= nbins) {
+        ibin   = 0;
+        offset = 0.0;
+    }
+    double remaining = width;
+    while (remaining > 1e-12 * width) {
+        const double take = std::min(1.0 - offset, remaining);
+        const double frac = take / width;
+        sums[ibin] += value * frac;
+        weights[ibin] += frac;
+        remaining -= take;
+        offset = 0.0;
+        ibin   = ibin + 1 == nbins ? 0 : ibin + 1;
+    }
+}
+
+} // namespace
+
+Folder::Folder(const SigprocHeader& hdr, const FoldParams& params,
+               int64_t start, int64_t nsamps)
+    : m_hdr(hdr),
+      m_params(params),
+      m_nchans(hdr.get<HeaderKey::kNchans>()),
+      m_nrows(hdr.get<HeaderKey::kNchans>() * hdr.get<HeaderKey::kNifs>()),
+      m_tsamp(hdr.get<HeaderKey::kTsamp>()) {
+    if (params.period <= 0 || params.nbins < 1 || params.nsubints < 1) {
+        throw std::invalid_argument(std::format(
+            "Need a positive period, nbins and nsubints, got {}, {} and {}",
+            params.period, params.nbins, params.nsubints));
+    }
+    if (m_tsamp <= 0 || m_nrows < 1) {
+        throw std::invalid_argument("Folding needs tsamp and channels");
+    }
+    // A live ring has no nsamples, sub-integrations need the range up front
+    int64_t nsamples = hdr.get<HeaderKey::kNsamples>();
+    if (nsamples == 0) {
+        if (nsamps == 0) {
+            throw std::invalid_argument(
+                "Folding a stream of unknown length needs nsamps");
+        }
+        nsamples = start + nsamps;
+    }
+    m_start = std::clamp<int64_t>(start, 0, nsamples);
+    m_end   = nsamps == 0 ? nsamples : std::min(nsamples, m_start + nsamps);
+    m_delays = params.dm != 0.0 ? hdr.get_dm_delays(params.dm, "top")
+                                : std::vector<double>(m_nchans, 0.0);
+    const auto size = static_cast<std::size_t>(params.nsubints) * m_nrows *
+                      params.nbins;
+    m_sums.assign(size, 0.0);
+    m_weights.assign(size, 0.0);
+}
+
+double Folder::phase(double t) const {
+    const double period = m_params.period;
+    return t / period - 0.5 * m_params.pdot * t * t / (period * period);
+}
+
+void Folder::add(std::span<const float> block, int64_t start_sample,
+                 int nsamps) {
+    if (block.size() < static_cast<std::size_t>(nsamps) * m_nrows) {
+        throw std::invalid_argument(std::format(
+            "Need {} samples of {} values, got {}", nsamps, m_nrows,
+            block.size()));
+    }
+    const int nbins     = m_params.nbins;
+    const int nsubints  = m_params.nsubints;
+    const double period = m_params.period;
+    const int64_t first = std::max(start_sample, m_start);
+    const int64_t last  = std::min(start_sample + nsamps, m_end);
+    for (int64_t isamp = first; isamp < last; ++isamp) {
+        const auto subint = static_cast<int>((isamp - m_start) * nsubints /
+                                             (m_end - m_start));
+        const double t = static_cast<double>(isamp) * m_tsamp;
+        // Channel delays shift the phase at the local frequency, the
+        // curvature over a delay is far below a bin
+        const double freq =
+            1.0 / period - m_params.pdot * t / (period * period);
+        const double base   = phase(t);
+        const double width  = m_tsamp * freq * nbins;
+        const float* sample = block.data() + (isamp - start_sample) * m_nrows;
+        const auto offset = static_cast<std::size_t>(subint) * m_nrows * nbins;
+        for (int irow = 0; irow < m_nrows; ++irow) {
+            const double rotation = base - m_delays[irow % m_nchans] * freq;
+            const double pos = (rotation - std::floor(rotation)) * nbins;
+            const auto row = offset + static_cast<std::size_t>(irow) * nbins;
+            spread(sample[irow], pos, width, nbins, m_sums.data() + row,
+                   m_weights.data() + row);
+        }
+    }
+}
+
+void Folder::merge(const Folder& other) {
+    if (other.m_sums.size() != m_sums.size() || other.m_start != m_start ||
+        other.m_end != m_end) {
+        throw std::invalid_argument("Cannot merge folds of other shapes");
+    }
+    for (std::size_t ii = 0; ii < m_sums.size(); ++ii) {
+        m_sums[ii] += other.m_sums[ii];
+        m_weights[ii] += other.m_weights[ii];
+    }
+}
+
+std::vector<float> Folder::profiles() const {
+    std::vector<float> means(m_sums.size());
+    for (std::size_t ii = 0; ii < m_sums.size(); ++ii) {
+        means[ii] = m_weights[ii] > 0.0
+                        ? static_cast<float>(m_sums[ii] / m_weights[ii])
+                        : 0.0F;
+    }
+    return means;
+}
+
+int64_t Folder::npulses() const {
+    return static_cast<int64_t>(
+        std::floor(phase(static_cast<double>(m_end) * m_tsamp) -
+                   phase(static_cast<double>(m_start) * m_tsamp)));
+}
+
+SigprocHeader Folder::profile_header() const {
+    const double tstart = m_hdr.get<HeaderKey::kTstart>() +
+                          static_cast<double>(m_start) * m_tsamp / 86400.0;
+    return m_hdr.new_header(std::map<std::string, SighdrTypes>{
+        {"data_type", 3},
+        {"nbits", 32},
+        {"nbins", m_params.nbins},
+        {"npuls", static_cast<int>(npulses())},
+        {"period", m_params.period},
+        {"refdm", m_params.dm},
+        {"tstart", tstart},
+        {"nsamples",
+         static_cast<int64_t>(m_params.nsubints) * m_params.nbins}});
+}
+
+Folder fold_stream(const std::vector<std::string>& filenames,
+                   const FoldParams& params, const MapReduceOptions& opts,
+                   int64_t start, int64_t nsamps) {
+    Folder init = [&] {
+        const FilReader reader(filenames);
+        return Folder(reader.hdr, params, start, nsamps);
+    }();
+    return parallel_map_reduce(
+        filenames, start, nsamps, std::move(init), opts,
+        [](Folder& folder, std::span<const float> block,
+           int64_t start_sample, int nsamps_block) {
+            folder.add(block, start_sample, nsamps_block);
+        },
+        [](Folder& total, const Folder& part) { total.merge(part); });
+}
@@ -1,39 +1,162 @@
-#pragma once
-
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <sstream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
 
 #include <sigproc/angles.hpp>
 #include <sigproc/exceptions.hpp>
 #include <sigproc/header.hpp>
 #include <sigproc/utils.hpp>
 
-// Default constructor, initializes all keys to default values
-SigprocHeader::SigprocHeader() {
-    std::unordered_map<std::string, KeyInfo> header_keys = kSigprocKeys;
-    header_keys.insert(kExtraKeys.begin(), kExtraKeys.end());
-    for (const auto& [key, keyInfo] : header_keys) {
-        set(key, map_utils::get_value(kDefaultKeyValues, keyInfo.type));
+namespace {
+
+// Longest key or string value accepted in a header
+constexpr std::size_t kMaxStringLen = std::size_t{1} << 16;
+// Bytes read at first by fromfile(), headers are rarely larger
+constexpr std::size_t kHeaderReadSize = 4096;
+
+constexpr std::string_view kHeaderStart = "HEADER_START";
+constexpr std::string_view kHeaderEnd   = "HEADER_END";
+
+// Type of the keys holding values of type T
+template <typename T> constexpr KeyType key_type_of() {
+    if constexpr (std::is_same_v<T, int>) {
+        return KeyType::kSInt;
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return KeyType::kSLong;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return KeyType::kSDouble;
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return KeyType::kSBool;
+    } else {
+        static_assert(std::is_same_v<T, std::string>);
+        return KeyType::kSString;
     }
 }
 
+// Bounds-checked reads of unaligned values from the header bytes
+class ByteCursor {
+public:
+    explicit ByteCursor(std::span<const uint8_t> buffer) : m_buffer(buffer) {}
+
+    std::size_t pos() const { return m_pos; }
+
+    template <typename T> bool read(T& value) {
+        if (sizeof(T) > m_buffer.size() - m_pos) {
+            return false;
+        }
+        std::memcpy(&value, m_buffer.data() + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return true;
+    }
+
+    bool read_string(std::string_view& str) {
+        std::size_t len = 0;
+        if (!read(len)) {
+            return false;
+        }
+        if (len > kMaxStringLen) {
+            throw std::runtime_error("Invalid string length in header.");
+        }
+        if (len > m_buffer.size() - m_pos) {
+            return false;
+        }
+        str = {reinterpret_cast<const char*>(m_buffer.data() + m_pos), len};
+        m_pos += len;
+        return true;
+    }
+
+private:
+    std::span<const uint8_t> m_buffer;
+    std::size_t m_pos{};
+};
+
+} // namespace
+
 template <typename T> T SigprocHeader::get(const std::string& key) const {
-    return map_utils::get_value_variant<std::string, T>(m_data, key);
+    const auto hkey = find_key(key);
+    if (!hkey) {
+        return map_utils::get_value_variant<std::string, T>(m_custom, key);
+    }
+    if (key_info(*hkey).type != key_type_of<T>()) {
+        throw std::runtime_error(
+            fmt::format("Header key {} is not of expected type {}.", key,
+                        map_utils::print_name_of_type<T>()));
+    }
+    return m_fields.of<key_type_of<T>()>()
+        [kKeySlots[static_cast<std::size_t>(*hkey)]];
 }
 
 template <typename T>
 void SigprocHeader::set(const std::string& key, const T& value) {
-    m_data[key] = value;
+    if (const auto hkey = find_key(key)) {
+        set_field(*hkey, value);
+        return;
+    }
+    m_custom[key] = value;
+}
+
+template <typename T>
+void SigprocHeader::set_field(HeaderKey key, const T& value) {
+    const auto& info = key_info(key);
+    const auto slot  = kKeySlots[static_cast<std::size_t>(key)];
+    if constexpr (std::is_same_v<T, SighdrTypes>) {
+        std::visit([&](const auto& alt) { set_field(key, alt); }, value);
+        return;
+    } else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+        if (info.type == KeyType::kSInt || info.type == KeyType::kSLong) {
+            if (info.type == KeyType::kSInt ? !std::in_range<int>(value)
+                                            : !std::in_range<int64_t>(value)) {
+                throw std::out_of_range(std::format(
+                    "Value {} of header key {} does not fit an int", value,
+                    info.name));
+            }
+            if (info.type == KeyType::kSInt) {
+                m_fields.ints[slot] = static_cast<int>(value);
+            } else {
+                m_fields.longs[slot] = static_cast<int64_t>(value);
+            }
+            return;
+        }
+    }
+    if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+        if (info.type == KeyType::kSDouble) {
+            m_fields.doubles[slot] = static_cast<double>(value);
+            return;
+        }
+    } else if constexpr (std::is_same_v<T, bool>) {
+        if (info.type == KeyType::kSBool) {
+            m_fields.bools[slot] = value;
+            return;
+        }
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        if (info.type == KeyType::kSString) {
+            m_fields.strings[slot] = std::string_view(value);
+            return;
+        }
+    }
+    if constexpr (!std::is_same_v<T, SighdrTypes>) {
+        throw std::invalid_argument(std::format(
+            "Header key {} cannot hold a value of type {}", info.name,
+            map_utils::print_name_of_type<T>()));
+    }
 }
 
 std::vector<float> SigprocHeader::get_freqs() const {
-    auto nchans = get<int>("nchans");
-    auto fch1   = get<double>("fch1");
-    auto foff   = get<double>("foff");
+    const auto nchans = get<HeaderKey::kNchans>();
+    const auto fch1   = get<HeaderKey::kFch1>();
+    const auto foff   = get<HeaderKey::kFoff>();
     std::vector<float> freqs(nchans);
     for (auto i = 0; i < nchans; ++i) {
         freqs[i] = fch1 + i * foff;
@@ -41,21 +164,27 @@ std::vector<float> SigprocHeader::get_freqs() const {
     return freqs;
 }
 
+double SigprocHeader::get_ref_freq(const std::string& ref_freq) const {
+    if (ref_freq == "top") {
+        // ftop is the edge beyond fch1, the lower edge when foff > 0
+        return std::max(get<HeaderKey::kFtop>(), get<HeaderKey::kFbottom>());
+    }
+    if (ref_freq == "ch1") {
+        return get<HeaderKey::kFch1>();
+    }
+    if (ref_freq == "center") {
+        return get<HeaderKey::kFcenter>();
+    }
+    throw std::invalid_argument(
+        fmt::format("Unknown reference frequency: {}", ref_freq));
+}
+
 std::vector<double> SigprocHeader::get_dm_delays(double dm,
                                                  std::string ref_freq) const {
-    auto nchans = get<int>("nchans");
-    auto freqs  = get_freqs();
+    const auto nchans    = get<HeaderKey::kNchans>();
+    const auto freqs     = get_freqs();
+    const double fch_ref = get_ref_freq(ref_freq);
     std::vector<double> delays(nchans);
-    double fch_ref = 0.0;
-
-    if (ref_freq == "ch1") {
-        fch_ref = get<double>("fch1");
-    } else if (ref_freq == "center") {
-        fch_ref = get<double>("fcenter");
-    } else {
-        throw std::invalid_argument(
-            fmt::format("Unknown reference frequency: {}", ref_freq));
-    }
     for (auto i = 0; i < nchans; ++i) {
         delays[i] = kDMConst * dm *
                     (1.0 / (freqs[i] * freqs[i]) - 1.0 / (fch_ref * fch_ref));
@@ -65,7 +194,7 @@ std::vector<double> SigprocHeader::get_dm_delays(double dm,
 
 template <typename T>
 SigprocHeader
-SigprocHeader::new_header(const std::map<std::string, T>& newmap) {
+SigprocHeader::new_header(const std::map<std::string, T>& newmap) const {
     SigprocHeader newhdr(*this); // Copy the current header
     for (const auto& param : newmap) {
         newhdr.set(param.first, param.second);
@@ -81,170 +210,237 @@ void SigprocHeader::tostream(BinaryStream& stream) {
 }
 
 bool SigprocHeader::fromfile(const std::string& filename) {
-    std::fstream file_stream;
-    file_stream.open(filename.c_str(),
-                     std::ifstream::in | std::ifstream::binary);
-    ErrorChecker::check_file(file_stream, filename);
-    bool success = fromstream(file_stream);
-    file_stream.close();
-    return success;
+    std::ifstream file_stream(filename.c_str(),
+                              std::ifstream::in | std::ifstream::binary);
+    ErrorChecker::check_stream(file_stream, filename);
+    const auto file_size = std::filesystem::file_size(filename);
+    std::vector<uint8_t> buffer;
+    std::size_t nbytes = kHeaderReadSize;
+    while (true) {
+        nbytes = std::min<std::size_t>(nbytes, file_size);
+        buffer.resize(nbytes);
+        file_stream.seekg(0, std::ios::beg);
+        file_stream.read(reinterpret_cast<char*>(buffer.data()),
+                         static_cast<std::streamsize>(nbytes));
+        ErrorChecker::check_stream(file_stream, filename);
+        std::size_t header_size = 0;
+        switch (parse_keys(buffer, header_size)) {
+        case ParseStatus::kOk:
+            finish_parse(header_size, static_cast<int64_t>(file_size));
+            return true;
+        case ParseStatus::kNotSigproc:
+            return false;
+        case ParseStatus::kTruncated:
+            if (nbytes == file_size) {
+                throw std::runtime_error(
+                    std::format("Truncated sigproc header in {}", filename));
+            }
+            nbytes *= 4;
+            break;
+        }
+    }
+}
+
+std::size_t SigprocHeader::frombuffer(std::span<const uint8_t> buffer,
+                                      int64_t file_size) {
+    std::size_t header_size = 0;
+    switch (parse_keys(buffer, header_size)) {
+    case ParseStatus::kOk:
+        break;
+    case ParseStatus::kNotSigproc:
+        return 0;
+    case ParseStatus::kTruncated:
+        throw std::runtime_error("Truncated sigproc header.");
+    }
+    finish_parse(header_size, file_size < 0
+                                  ? static_cast<int64_t>(buffer.size())
+                                  : file_size);
+    return header_size;
+}
+
+void SigprocHeader::tofile(const std::string& filename) const {
+    std::ofstream file_stream(filename.c_str(),
+                              std::ios::out | std::ios::trunc |
+                                  std::ios::binary);
+    ErrorChecker::check_stream(file_stream, filename);
+    const auto buffer = tobuffer();
+    file_stream.write(buffer.data(),
+                      static_cast<std::streamsize>(buffer.size()));
+    ErrorChecker::check_stream(file_stream, filename);
 }
 
 template <class BinaryStream>
 bool SigprocHeader::fromstream(BinaryStream& stream) {
-    int header_size{}, data_size{}, file_size{};
-    std::string token;
-    token = read_string(stream);
-    if (token != "HEADER_START") {
-        stream.seekg(0, std::ios::beg);
-        return false;
+    const std::vector<uint8_t> buffer{std::istreambuf_iterator<char>(stream),
+                                      std::istreambuf_iterator<char>()};
+    stream.clear();
+    const auto header_size = frombuffer(buffer);
+    // Seek back to the end of the header
+    stream.seekg(static_cast<std::streamoff>(header_size), std::ios::beg);
+    return header_size > 0;
+}
+
+SigprocHeader::ParseStatus
+SigprocHeader::parse_keys(std::span<const uint8_t> buffer,
+                          std::size_t& header_size) {
+    // Anything but the length of HEADER_START is not a sigproc file
+    std::size_t len = 0;
+    if (buffer.size() >= sizeof(len)) {
+        std::memcpy(&len, buffer.data(), sizeof(len));
+        if (len != kHeaderStart.size()) {
+            return ParseStatus::kNotSigproc;
+        }
+    }
+    ByteCursor cursor(buffer);
+    std::string_view token;
+    if (!cursor.read_string(token)) {
+        return ParseStatus::kTruncated;
+    }
+    if (token != kHeaderStart) {
+        return ParseStatus::kNotSigproc;
     }
 
     while (true) {
-        token = read_string(stream);
-        if (token == "HEADER_END") {
-            header_size = static_cast<int>(stream.tellg());
-            break;
+        if (!cursor.read_string(token)) {
+            return ParseStatus::kTruncated;
         }
-        auto it = kSigprocKeys.find(token);
-        if (it != kSigprocKeys.end()) {
-            KeyType type = it->second.type;
-            switch (type) {
-            case KeyType::kSInt:
-                set(token, read_value<int>(stream));
-                break;
-
-            case KeyType::kSDouble:
-                set(token, read_value<double>(stream));
-                break;
-
-            case KeyType::kSBool:
-                set(token, read_value<bool>(stream));
-                break;
-
-            case KeyType::kSString:
-                set(token, read_string(stream));
-                break;
-            }
-        } else {
+        if (token == kHeaderEnd) {
+            header_size = cursor.pos();
+            return ParseStatus::kOk;
+        }
+        const auto key = find_key(token);
+        if (!key || !key_info(*key).in_file) {
             fmt::print(stderr, "Warning: read_header: unknown parameter {}\n",
                        token);
+            continue;
+        }
+        const auto slot = kKeySlots[static_cast<std::size_t>(*key)];
+        bool complete   = false;
+        switch (key_info(*key).type) {
+        case KeyType::kSInt:
+            complete = cursor.read(m_fields.ints[slot]);
+            break;
+
+        case KeyType::kSLong: {
+            // 4-byte int in the file
+            int value = 0;
+            complete  = cursor.read(value);
+            m_fields.longs[slot] = value;
+            break;
+        }
+
+        case KeyType::kSDouble:
+            complete = cursor.read(m_fields.doubles[slot]);
+            break;
+
+        case KeyType::kSBool: {
+            uint8_t value = 0;
+            complete      = cursor.read(value);
+            m_fields.bools[slot] = value != 0;
+            break;
         }
-    }
 
-    if (!stream.good()) {
-        throw std::runtime_error("Stream error while reading header.");
+        case KeyType::kSString: {
+            std::string_view value;
+            complete = cursor.read_string(value);
+            m_fields.strings[slot].assign(value);
+            break;
+        }
+        }
+        if (!complete) {
+            return ParseStatus::kTruncated;
+        }
     }
+}
 
-    stream.seekg(0, std::ios::end);
-    file_size     = static_cast<int>(stream.tellg());
-    data_size     = file_size - header_size;
-    auto nsamples = get<int>("nsamples");
-    if (nsamples == 0) {
+void SigprocHeader::finish_parse(std::size_t header_size, int64_t file_size) {
+    const auto data_size = file_size - static_cast<int64_t>(header_size);
+    const int64_t bits_per_sample = int64_t{get<HeaderKey::kNchans>()} *
+                                    get<HeaderKey::kNifs>() *
+                                    get<HeaderKey::kNbits>();
+    if (get<HeaderKey::kNsamples>() <= 0 && bits_per_sample > 0) {
         // Compute the number of samples from the file size
-        nsamples = data_size / get<int>("nchans") / get<int>("nifs") * 8 /
-                   get<int>("nbits");
-        set("nsamples", nsamples);
+        set<HeaderKey::kNsamples>(data_size * 8 / bits_per_sample);
     }
-    set("header_size", header_size);
-    set("data_size", data_size);
-    set("file_size", file_size);
+    set<HeaderKey::kHeaderSize>(static_cast<int64_t>(header_size));
+    set<HeaderKey::kDataSize>(data_size);
+    set<HeaderKey::kFileSize>(file_size);
     update_internal();
-
-    // Seek back to the end of the header
-    stream.seekg(header_size, std::ios::beg);
-    return true;
 }
 
 void SigprocHeader::update_internal() {
-    set("telescope",
-        map_utils::get_value(kTelescopeIds, get<int>("telescope_id")));
-    set("backend", map_utils::get_value(kMachineIds, get<int>("machine_id")));
-    set("datatype", map_utils::get_value(kDataTypes, get<int>("data_type")));
-    set("frame",
-        get<bool>("barycentric")
-            ? "barycentric"
-            : (get<bool>("pulsarcentric") ? "pulsarcentric" : "topocentric"));
-    set("tobs", get<double>("tsamp") * get<int>("nsamples"));
-    set("tobs_str", dates::get_duration_string(get<double>("tobs")));
-    set("bandwidth", std::abs(get<double>("foff")) * get<int>("nchans"));
-    set("ftop", get<double>("fch1") - 0.5 * get<double>("foff"));
-    set("fbottom",
-        get<double>("ftop") + get<double>("foff") * get<int>("nchans"));
-    set("fcenter",
-        get<double>("ftop") + 0.5 * get<double>("foff") * get<int>("nchans"));
-    set("ra", angles::radec_to_str(get<double>("src_raj")));
-    set("dec", angles::radec_to_str(get<double>("src_dej")));
-    set("ra_rad", angles::ra_to_rad(get<std::string>("ra")));
-    set("dec_rad", angles::dec_to_rad(get<std::string>("dec")));
-    set("obs_date", dates::mjd_to_gregorian(get<double>("tstart")));
+    using enum HeaderKey;
+    const int nchans  = get<kNchans>();
+    const double foff = get<kFoff>();
+    set<kTelescope>(map_utils::get_value(kTelescopeIds, get<kTelescopeId>()));
+    set<kBackend>(map_utils::get_value(kMachineIds, get<kMachineId>()));
+    set<kDatatype>(map_utils::get_value(kDataTypes, get<kDataType>()));
+    set<kFrame>(get<kBarycentric>()
+                    ? "barycentric"
+                    : (get<kPulsarcentric>() ? "pulsarcentric"
+                                             : "topocentric"));
+    set<kTobs>(get<kTsamp>() * static_cast<double>(get<kNsamples>()));
+    set<kTobsStr>(dates::get_duration_string(get<kTobs>()));
+    set<kBandwidth>(std::abs(foff) * nchans);
+    set<kFtop>(get<kFch1>() - 0.5 * foff);
+    set<kFbottom>(get<kFtop>() + foff * nchans);
+    set<kFcenter>(get<kFtop>() + 0.5 * foff * nchans);
+    set<kRa>(angles::radec_to_str(get<kSrcRaj>()));
+    set<kDec>(angles::radec_to_str(get<kSrcDej>()));
+    set<kRaRad>(angles::ra_to_rad(get<kRa>()));
+    set<kDecRad>(angles::dec_to_rad(get<kDec>()));
+    set<kObsDate>(dates::mjd_to_gregorian(get<kTstart>()));
 }
 
 std::vector<char> SigprocHeader::tobuffer() const {
     std::vector<char> buffer;
-    write_string(buffer, "HEADER_START");
-    for (const auto& [key, keyInfo] : kSigprocKeys) {
-        switch (keyInfo.type) {
+    write_string(buffer, kHeaderStart);
+    for (const auto& info : kHeaderKeys) {
+        if (!info.in_file) {
+            continue;
+        }
+        const auto slot = kKeySlots[static_cast<std::size_t>(info.key)];
+        switch (info.type) {
         case KeyType::kSInt:
-            write_value(buffer, key, get<int>(key));
+            write_value(buffer, info.name, m_fields.ints[slot]);
             break;
 
+        case KeyType::kSLong: {
+            // 0 tells readers to derive the value from the file size
+            const auto value = m_fields.longs[slot];
+            write_value(buffer, info.name,
+                        value <= INT_MAX ? static_cast<int>(value) : 0);
+            break;
+        }
+
         case KeyType::kSDouble:
-            write_value(buffer, key, get<double>(key));
+            write_value(buffer, info.name, m_fields.doubles[slot]);
             break;
 
         case KeyType::kSBool:
-            write_value(buffer, key, get<bool>(key));
+            write_value(buffer, info.name, m_fields.bools[slot]);
             break;
 
         case KeyType::kSString:
-            write_string(buffer, key);
-            write_string(buffer, get<std::string>(key));
+            write_string(buffer, info.name);
+            write_string(buffer, m_fields.strings[slot]);
             break;
         }
     }
-    write_string(buffer, "HEADER_END");
+    write_string(buffer, kHeaderEnd);
     return buffer;
 }
 
 template <class BinaryStream>
-std::string SigprocHeader::read_string(BinaryStream& stream) {
-    size_t len = 0;
-    stream.read(static_cast<char*>(static_cast<void*>(&len)), sizeof(size_t));
-    if (!stream || len < 0) {
-        throw std::runtime_error("Invalid string length in stream.");
-    }
-    std::string str(len, '\0');
-    if (len > 0) {
-        stream.read(str.c_str(), len);
-        if (!stream) {
-            throw std::runtime_error("Failed to read string from stream.");
-        }
-    }
-    return str;
-}
-
-template <class DataType, class BinaryStream>
-DataType SigprocHeader::read_value(BinaryStream& stream) {
-    DataType value;
-    stream.read(static_cast<char*>(static_cast<void*>(&value)),
-                sizeof(DataType));
-    if (!stream) {
-        throw std::runtime_error("Failed to read value from stream.");
-    }
-    return value;
-}
-
-template <class BinaryStream>
-void SigprocHeader::write_string(BinaryStream& stream, const std::string& str) {
+void SigprocHeader::write_string(BinaryStream& stream, std::string_view str) {
     size_t len = str.size();
     stream.write(static_cast<const char*>(static_cast<const void*>(&len)),
                  sizeof(size_t));
-    stream.write(str.c_str(), len * sizeof(char));
+    stream.write(str.data(), len * sizeof(char));
 }
 
 void SigprocHeader::write_string(std::vector<char>& buffer,
-                                 const std::string& str) {
+                                 std::string_view str) {
     size_t len = str.size();
     const char* len_bytes =
         static_cast<const char*>(static_cast<const void*>(&len));
@@ -253,7 +449,7 @@ void SigprocHeader::write_string(std::vector<char>& buffer,
 }
 
 template <class DataType, class BinaryStream>
-void SigprocHeader::write_value(BinaryStream& stream, const std::string& name,
+void SigprocHeader::write_value(BinaryStream& stream, std::string_view name,
                                 const DataType& val) {
     write_string(stream, name);
     stream.write(static_cast<const char*>(static_cast<const void*>(&val)),
@@ -262,9 +458,36 @@ void SigprocHeader::write_value(BinaryStream& stream, const std::string& name,
 
 template <class DataType>
 void SigprocHeader::write_value(std::vector<char>& buffer,
-                                const std::string& name, const DataType& val) {
+                                std::string_view name, const DataType& val) {
     write_string(buffer, name);
     const char* len_bytes =
         static_cast<const char*>(static_cast<const void*>(&val));
     buffer.insert(buffer.end(), len_bytes, len_bytes + sizeof(DataType));
-}
\ No newline at end of file
+}
+
+template int SigprocHeader::get<int>(const std::string&) const;
+template int64_t SigprocHeader::get<int64_t>(const std::string&) const;
+template double SigprocHeader::get<double>(const std::string&) const;
+template bool SigprocHeader::get<bool>(const std::string&) const;
+template std::string SigprocHeader::get<std::string>(const std::string&) const;
+
+template void SigprocHeader::set<int>(const std::string&, const int&);
+template void SigprocHeader::set<int64_t>(const std::string&, const int64_t&);
+template void SigprocHeader::set<double>(const std::string&, const double&);
+template void SigprocHeader::set<bool>(const std::string&, const bool&);
+template void SigprocHeader::set<std::string>(const std::string&,
+                                              const std::string&);
+template void SigprocHeader::set<SighdrTypes>(const std::string&,
+                                              const SighdrTypes&);
+
+template SigprocHeader
+SigprocHeader::new_header<int>(const std::map<std::string, int>&) const;
+template SigprocHeader SigprocHeader::new_header<int64_t>(
+    const std::map<std::string, int64_t>&) const;
+template SigprocHeader
+SigprocHeader::new_header<double>(const std::map<std::string, double>&) const;
+template SigprocHeader SigprocHeader::new_header<SighdrTypes>(
+    const std::map<std::string, SighdrTypes>&) const;
+
+// Headers carried in memory, e.g. by a shared memory ring
+template bool SigprocHeader::fromstream<std::stringstream>(std::stringstream&);
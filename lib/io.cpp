@@ -1,87 +1,564 @@
+#include <array>
 #include <fstream>
 #include <vector>
 #include <tuple>
 #include <algorithm>
 #include <stdexcept>
-#include <climits> 
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <sstream>
+
+#include <fmt/core.h>
 
 #include <sigproc/io.hpp>
+#include <sigproc/kernels.hpp>
+#include <sigproc/numbits.hpp>
+
+StreamInfo read_stream_info(const std::vector<std::string>& filenames) {
+    std::vector<FileInfo> entries;
+    entries.reserve(filenames.size());
+    for (const auto& filename : filenames) {
+        SigprocHeader file_hdr;
+        if (!file_hdr.fromfile(filename)) {
+            throw std::runtime_error(
+                std::format("{} is not a sigproc file", filename));
+        }
+        FileInfo info{filename,
+                      static_cast<std::size_t>(
+                          file_hdr.get<HeaderKey::kHeaderSize>()),
+                      static_cast<std::size_t>(
+                          file_hdr.get<HeaderKey::kDataSize>())};
+        info.nsamples = file_hdr.get<HeaderKey::kNsamples>();
+        info.tstart   = file_hdr.get<HeaderKey::kTstart>();
+        info.tsamp    = file_hdr.get<HeaderKey::kTsamp>();
+        info.nchans   = file_hdr.get<HeaderKey::kNchans>();
+        info.nifs     = file_hdr.get<HeaderKey::kNifs>();
+        info.nbits    = file_hdr.get<HeaderKey::kNbits>();
+        entries.push_back(std::move(info));
+    }
+    return StreamInfo(std::move(entries));
+}
 
-using readplan_tuple = std::tuple<int, int, int>;
+FilReader::FilReader(const std::string& filename, bool use_mmap,
+                     ReadEngine engine)
+    : FilReader(std::vector<std::string>{filename}, use_mmap, engine) {}
 
-FilReader::FilReader(std::string filename) {
-    hdr.fromfile(filename);
-    nbits       = hdr.get<int>("nbits");
-    bitfact     = fileio.bitsinfo.bitfact();
-    itemsize    = fileio.bitsinfo.itemsize();
-    stride_len  = hdr.get<int>("nchans") * hdr.get<int>("nifs");
+FilReader::FilReader(const std::vector<std::string>& filenames, bool use_mmap,
+                     ReadEngine engine)
+    : sources(filenames) {
+    if (filenames.empty()) {
+        throw std::invalid_argument("Empty file list");
+    }
+    if (is_shm_source(filenames.front())) {
+        if (filenames.size() != 1 || use_mmap) {
+            throw std::invalid_argument(
+                "A shared memory ring must be read on its own, without mmap");
+        }
+        ring = std::make_unique<ShmRingReader>(filenames.front());
+        const auto& blob = ring->header();
+        std::stringstream stream(std::string(blob.begin(), blob.end()));
+        if (!hdr.fromstream(stream)) {
+            throw std::runtime_error(std::format(
+                "{} does not carry a sigproc header", filenames.front()));
+        }
+    } else if (use_mmap && filenames.size() == 1) {
+        // Parse the header in place from the mapping
+        mapfile = std::make_unique<MappedFile>(filenames.front());
+        if (hdr.frombuffer(mapfile->data(0, mapfile->size())) == 0) {
+            throw std::runtime_error(
+                std::format("{} is not a sigproc file", filenames.front()));
+        }
+    } else {
+        hdr.fromfile(filenames.front());
+    }
+    nbits = hdr.get<HeaderKey::kNbits>();
+    const BitsInfo bitsinfo(nbits);
+    bitfact     = bitsinfo.bitfact();
+    itemsize    = bitsinfo.itemsize();
+    stride_len  = hdr.get<HeaderKey::kNchans>() * hdr.get<HeaderKey::kNifs>();
     stride_size = stride_len * itemsize / bitfact;
+    header_size = hdr.get<HeaderKey::kHeaderSize>();
+    if (ring) {
+        // ring positions count data bytes only
+        header_size = 0;
+        return;
+    }
+    if (CompressedFile::is_compressed(filenames.front(), header_size)) {
+        if (filenames.size() != 1 || use_mmap) {
+            throw std::invalid_argument(
+                "A compressed file must be read on its own, without mmap");
+        }
+        zfile = std::make_unique<CompressedFile>(filenames.front(),
+                                                 header_size, nbits,
+                                                 stride_size);
+        hdr = hdr.new_header(std::map<std::string, int64_t>{
+            {"nsamples", static_cast<int64_t>(zfile->nsamples())},
+            {"data_size",
+             static_cast<int64_t>(zfile->nsamples() * stride_size)}});
+        return;
+    }
+    if (use_mmap) {
+        if (filenames.size() != 1) {
+            throw std::invalid_argument("mmap mode reads a single file");
+        }
+        return;
+    }
+    const StreamInfo sinfo = read_stream_info(filenames);
+    sinfo.check_contiguity();
+    if (filenames.size() > 1) {
+        const auto& cumsum = sinfo.cumsum_datalens();
+        hdr = hdr.new_header(std::map<std::string, int64_t>{
+            {"nsamples", static_cast<int64_t>(sinfo.nsamples())},
+            {"data_size", static_cast<int64_t>(cumsum.back())}});
+    }
+    fileio = std::make_unique<FileReader>(sinfo, "r", nbits, engine);
 }
 
-FilReader::~FilReader() { delete fileio; }
+FilReader::~FilReader() = default;
 
-std::vector<readplan_tuple> FilReader::get_readplan(int gulp, int skipback = 0,
-                                                    int start  = 0,
-                                                    int nsamps = 0) {
+std::vector<readplan_tuple> FilReader::get_readplan(int gulp, int skipback,
+                                                    int64_t start,
+                                                    int64_t nsamps) {
     if (nsamps == 0) {
-        nsamps = hdr.get<int>("nsamples") - start;
+        if (is_unbounded()) {
+            throw std::invalid_argument(
+                "A live ring has no sample count to plan, give nsamps");
+        }
+        nsamps = hdr.get<HeaderKey::kNsamples>() - start;
     }
-    gulp     = std::min(nsamps, gulp);
+    gulp     = static_cast<int>(std::min<int64_t>(nsamps, gulp));
     skipback = std::abs(skipback);
     if (skipback >= gulp) {
-        std::runtime_error("readsamps must be > skipback value");
+        throw std::runtime_error("readsamps must be > skipback value");
     }
-    int nreads   = (int)nsamps / (gulp - skipback);
-    int lastread = nsamps - (nreads * (gulp - skipback));
+    int64_t nreads   = nsamps / (gulp - skipback);
+    int64_t lastread = nsamps - (nreads * (gulp - skipback));
     if (lastread < skipback) {
         nreads -= 1;
         lastread = nsamps - (nreads * (gulp - skipback));
     }
     std::vector<readplan_tuple> blocks;
-    for (int iread = 0; iread < nreads; ++iread) {
-        blocks.push_back(
-            readplan_tuple(iread, gulp * stride_len, -skipback * stride_len));
+    for (int64_t iread = 0; iread < nreads; ++iread) {
+        blocks.push_back(readplan_tuple(static_cast<int>(iread),
+                                        gulp * stride_len,
+                                        -skipback * stride_len));
     }
     if (lastread != 0) {
-        blocks.push_back(readplan_tuple(nreads, lastread * stride_len, 0));
+        blocks.push_back(readplan_tuple(static_cast<int>(nreads),
+                                        lastread * stride_len, 0));
+    }
+    if (mapfile) {
+        // The plan walks [start, start + nsamps) front to back.
+        mapfile->advise(header_size + start * stride_size,
+                        nsamps * stride_size, AccessPattern::kSequential);
     }
     return blocks;
 }
 
 void FilReader::read_plan(int block_len, std::vector<float>& block, int skip) {
-    fileio.read_data(block, block_len);
-    fileio.seek_bytes(skip * itemsize / bitfact, offset = true);
+    if (mapfile) {
+        unpack_to_float(view_plan(block_len, skip), block, block_len);
+        apply_layout(block);
+        return;
+    }
+    read_stream(block_len, block);
+    apply_layout(block);
+    if (skip == 0) {
+        return;
+    }
+    // skip is negative when the plan overlaps consecutive blocks, positive
+    // when it steps over units between them
+    const int64_t offset = skip_to_bytes(skip);
+    if (ring) {
+        ring->seek(static_cast<std::size_t>(
+            static_cast<int64_t>(ring->tell()) + offset));
+        return;
+    }
+    if (zfile) {
+        z_sample = static_cast<std::size_t>(
+            static_cast<int64_t>(z_sample) +
+            skip / static_cast<int64_t>(stride_len));
+        return;
+    }
+    fileio->seek(offset, 1);
 }
 
-void FilReader::read_block(int start_sample, int nsamps,
+void FilReader::read_block(int64_t start_sample, int nsamps,
                            std::vector<float>& block) {
-    seek_sample(start_sample);
-    fileio.read_data(block, nsamps * stride_len);
+    if (mapfile) {
+        unpack_to_float(view_block(start_sample, nsamps), block,
+                        nsamps * stride_len);
+    } else {
+        seek_sample(start_sample);
+        read_stream(nsamps * stride_len, block);
+    }
+    apply_layout(block);
 }
 
-void FilReader::seek_sample(int sample) {
-    fileio.seek_bytes(hdr.get<int>("header_size") + start_sample * stride_size);
+void FilReader::seek_sample(int64_t sample) {
+    if (mapfile) {
+        map_pos = sample * stride_size;
+        return;
+    }
+    if (ring) {
+        ring->seek(sample * stride_size);
+        return;
+    }
+    if (zfile) {
+        z_sample = sample;
+        return;
+    }
+    fileio->seek(sample * static_cast<int64_t>(stride_size));
 }
 
-class FilterbankWriter {
-public:
-    FilterbankWriter(std::string filename, SigprocHeader& hdr) {
-        nbits = hdr.get<int>("nbits");
-        // Write the header
-        hdr.tofile(filename);
-        FileIO fileio(filename, nbits);
+std::span<const uint8_t> FilReader::view_block(int64_t start_sample,
+                                               int nsamps) const {
+    if (!mapfile) {
+        throw std::runtime_error("view_block() requires mmap mode");
     }
+    return mapfile->data(header_size + start_sample * stride_size,
+                         nsamps * stride_size);
+}
 
-    ~FilterbankWriter() {}
+std::span<const uint8_t> FilReader::view_plan(int block_len, int skip) {
+    if (!mapfile) {
+        throw std::runtime_error("view_plan() requires mmap mode");
+    }
+    const std::size_t nbytes = units_to_bytes(block_len);
+    auto view                = mapfile->data(header_size + map_pos, nbytes);
+    // skip steps back over an overlap, or forwards over unread units
+    map_pos = static_cast<std::size_t>(static_cast<int64_t>(map_pos + nbytes) +
+                                       skip_to_bytes(skip));
+    mapfile->advise(header_size + map_pos, nbytes, AccessPattern::kWillNeed);
+    return view;
+}
 
-    void write_block(const std::vector<float>& block, int block_len) {
-        fileio.write_data(block, block_len);
+int64_t FilReader::read_samples(std::span<float> out) {
+    const std::size_t nsamps = out.size() / stride_len;
+    if (mapfile) {
+        const std::size_t data_size = mapfile->size() - header_size;
+        const std::size_t navail =
+            (data_size - std::min(map_pos, data_size)) / stride_size;
+        const std::size_t nread = std::min(nsamps, navail);
+        const auto bytes =
+            mapfile->data(header_size + map_pos, nread * stride_size);
+        map_pos += bytes.size();
+        sigproc::unpack_to_float(bytes, out.first(nread * stride_len), nbits,
+                                 "little");
+        return static_cast<int64_t>(nread);
     }
+    return static_cast<int64_t>(read_stream(out.first(nsamps * stride_len)) /
+                                stride_len);
+}
 
-private:
-    int nbits;
+void FilReader::read_stream(int nunits, std::vector<float>& block) {
+    block.resize(nunits);
+    block.resize(read_stream(block));
+}
+
+std::size_t FilReader::read_stream(std::span<float> out) {
+    if (zfile) {
+        const std::size_t nsamps =
+            std::min(out.size() / stride_len,
+                     zfile->nsamples() - std::min(z_sample, zfile->nsamples()));
+        read_buf.resize(nsamps * stride_size);
+        zfile->read(z_sample, nsamps, read_buf.bytes());
+        z_sample += nsamps;
+        sigproc::unpack_to_float(read_buf.bytes(),
+                                 out.first(nsamps * stride_len), nbits,
+                                 "little");
+        return nsamps * stride_len;
+    }
+    read_buf.resize(out.size() * itemsize / bitfact);
+    const std::size_t nread = ring ? ring->read(read_buf.bytes())
+                                   : fileio->creadinto(read_buf.bytes());
+    const std::size_t nunits = nread * bitfact / itemsize;
+    sigproc::unpack_to_float(read_buf.bytes().first(nread), out.first(nunits),
+                             nbits, "little");
+    return nunits;
+}
+
+void FilReader::apply_layout(std::vector<float>& block) {
+    if (layout == BlockLayout::kTimeMajor) {
+        return;
+    }
+    const int nifs    = hdr.get<HeaderKey::kNifs>();
+    const int nchans  = hdr.get<HeaderKey::kNchans>();
+    const auto nsamps = static_cast<int>(block.size() / stride_len);
+    turn_buf.resize(block.size());
+    sigproc::corner_turn(block, turn_buf, nchans, nsamps, nifs);
+    block.swap(turn_buf);
+}
+
+void FilReader::unpack_to_float(std::span<const uint8_t> bytes,
+                                std::vector<float>& block, int nunits) const {
+    block.resize(nunits);
+    sigproc::unpack_to_float(bytes, block, nbits, "little");
+}
+
+namespace {
+
+constexpr std::array<char, 8> kChannelMajorMagic{'S', 'I', 'G', 'P',
+                                                 'C', 'M', 'A', 'J'};
+constexpr uint32_t kChannelMajorVersion = 1;
+
+struct ChannelMajorHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    int32_t nchans;
+    int32_t nifs;
+    uint32_t reserved;
+    uint64_t nsamples;
 };
 
+} // namespace
+
+void ChannelMajorFile::create(FilReader& reader, const std::string& filename,
+                              int gulp) {
+    const int nchans    = reader.hdr.get<HeaderKey::kNchans>();
+    const int nifs      = reader.hdr.get<HeaderKey::kNifs>();
+    const auto nsamples =
+        static_cast<std::size_t>(reader.hdr.get<HeaderKey::kNsamples>());
+    const int stride_len = nchans * nifs;
+    const PositionalWriter writer(
+        filename, kHeaderSize + nsamples * stride_len * sizeof(float));
+
+    const ChannelMajorHeader header{kChannelMajorMagic, kChannelMajorVersion,
+                                    nchans, nifs, 0, nsamples};
+    writer.pwrite(0, {reinterpret_cast<const uint8_t*>(&header),
+                      sizeof(header)});
+
+    const BlockLayout old_layout = reader.get_layout();
+    reader.set_layout(BlockLayout::kChannelMajor);
+    reader.seek_sample(0);
+    std::vector<float> block;
+    std::size_t start = 0;
+    for (const auto& [iread, block_len, skip] : reader.get_readplan(gulp)) {
+        reader.read_plan(block_len, block, skip);
+        const std::size_t nsamps = block_len / stride_len;
+        // one contiguous run per channel lands in its row of the sidecar
+        for (int irow = 0; irow < stride_len; ++irow) {
+            const auto row = std::span(block).subspan(irow * nsamps, nsamps);
+            writer.pwrite(kHeaderSize +
+                              (irow * nsamples + start) * sizeof(float),
+                          {reinterpret_cast<const uint8_t*>(row.data()),
+                           row.size_bytes()});
+        }
+        start += nsamps;
+    }
+    reader.set_layout(old_layout);
+    writer.sync();
+}
+
+ChannelMajorFile::ChannelMajorFile(const std::string& filename)
+    : m_file(filename) {
+    ChannelMajorHeader header{};
+    const auto bytes = m_file.data(0, sizeof(header));
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != kChannelMajorMagic ||
+        header.version != kChannelMajorVersion) {
+        throw std::runtime_error(
+            std::format("{} is not a channel-major sidecar", filename));
+    }
+    m_nchans   = header.nchans;
+    m_nifs     = header.nifs;
+    m_nsamples = header.nsamples;
+    const std::size_t expected =
+        kHeaderSize + m_nsamples * m_nchans * m_nifs * sizeof(float);
+    if (m_file.size() != expected) {
+        throw std::runtime_error(
+            std::format("{} is truncated: {} bytes, expected {}", filename,
+                        m_file.size(), expected));
+    }
+}
+
+std::span<const float> ChannelMajorFile::channel(int ichan, int ipol) const {
+    if (ichan < 0 || ichan >= m_nchans || ipol < 0 || ipol >= m_nifs) {
+        throw std::out_of_range(std::format(
+            "Channel {} of IF {} out of range ({} channels, {} IFs)", ichan,
+            ipol, m_nchans, m_nifs));
+    }
+    const std::size_t irow = static_cast<std::size_t>(ipol) * m_nchans + ichan;
+    const auto bytes       = m_file.data(
+        kHeaderSize + irow * m_nsamples * sizeof(float),
+        m_nsamples * sizeof(float));
+    // kHeaderSize keeps every row 4-byte aligned within the page-aligned map
+    return {reinterpret_cast<const float*>(bytes.data()), m_nsamples};
+}
+
+FilterbankWriter::FilterbankWriter(const std::string& filename,
+                                   const SigprocHeader& hdr,
+                                   std::size_t nbuffers)
+    : m_filename(filename), m_nbuffers(nbuffers) {
+    hdr.tofile(filename);
+    m_fileio =
+        std::make_unique<FileIO>(filename, hdr.get<HeaderKey::kNbits>(), "a");
+    if (is_async()) {
+        m_thread = std::thread(&FilterbankWriter::run, this);
+    }
+}
+
+FilterbankWriter::~FilterbankWriter() {
+    try {
+        close();
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "Warning: FilterbankWriter: {}\n", e.what());
+    }
+}
+
+void FilterbankWriter::write_block(std::span<const float> block,
+                                   int block_len) {
+    if (m_closed) {
+        throw std::runtime_error(
+            std::format("{} is already closed", m_filename));
+    }
+    if (!is_async()) {
+        m_fileio->write_data(block, block_len);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv_written.wait(lock, [this] {
+        return m_queue.size() < m_nbuffers || m_error != nullptr;
+    });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    Pending pending;
+    if (!m_spare.empty()) {
+        pending.data = std::move(m_spare.back());
+        m_spare.pop_back();
+    }
+    pending.data.assign(block.begin(), block.begin() + block_len);
+    pending.block_len = block_len;
+    m_queue.push_back(std::move(pending));
+    lock.unlock();
+    m_cv_queued.notify_one();
+}
+
+void FilterbankWriter::flush() {
+    if (m_closed) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    drain(lock);
+    // The writer thread is idle, so the stream is ours
+    m_fileio->flush();
+}
+
+void FilterbankWriter::close() {
+    if (m_closed) {
+        return;
+    }
+    m_closed = true;
+    std::exception_ptr error;
+    if (is_async()) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_written.wait(lock, [this] {
+                return (m_queue.empty() && !m_busy) || m_error != nullptr;
+            });
+            m_stop = true;
+            error  = m_error;
+        }
+        m_cv_queued.notify_all();
+        m_thread.join();
+    }
+    if (error) {
+        m_fileio.reset();
+        std::rethrow_exception(error);
+    }
+    m_fileio->flush();
+    m_fileio.reset();
+}
+
+void FilterbankWriter::drain(std::unique_lock<std::mutex>& lock) {
+    m_cv_written.wait(lock, [this] {
+        return (m_queue.empty() && !m_busy) || m_error != nullptr;
+    });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void FilterbankWriter::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv_queued.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+        Pending pending = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_busy = true;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            m_fileio->write_data(pending.data, pending.block_len);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        m_busy = false;
+        m_spare.push_back(std::move(pending.data));
+        if (error) {
+            m_error = error;
+            m_queue.clear();
+        }
+        m_cv_written.notify_all();
+        if (m_error) {
+            return;
+        }
+    }
+}
+
+FilterbankRangeWriter::FilterbankRangeWriter(const std::string& filename,
+                                             const SigprocHeader& hdr,
+                                             std::size_t nsamples)
+    : m_nsamples(nsamples), m_nbits(hdr.get<HeaderKey::kNbits>()) {
+    m_stride_len = static_cast<std::size_t>(hdr.get<HeaderKey::kNchans>() *
+                                            hdr.get<HeaderKey::kNifs>());
+    if ((m_stride_len * m_nbits) % CHAR_BIT != 0) {
+        throw std::invalid_argument(std::format(
+            "{} channels of {} bits do not fill whole bytes", m_stride_len,
+            m_nbits));
+    }
+    m_stride_size = m_stride_len * m_nbits / CHAR_BIT;
+    const SigprocHeader out_hdr = hdr.new_header(
+        std::map<std::string, int64_t>{
+            {"nsamples", static_cast<int64_t>(nsamples)}});
+    out_hdr.tofile(filename);
+    m_header_size = std::filesystem::file_size(filename);
+    m_file        = std::make_unique<PositionalWriter>(
+        filename, m_header_size + nsamples * m_stride_size);
+}
+
+void FilterbankRangeWriter::write_samples(std::size_t start_sample,
+                                          std::span<const float> block) const {
+    if (!m_file) {
+        throw std::runtime_error("FilterbankRangeWriter is closed");
+    }
+    if (block.size() % m_stride_len != 0) {
+        throw std::invalid_argument(
+            std::format("Block of {} values is not a whole number of samples",
+                        block.size()));
+    }
+    const std::size_t nsamps = block.size() / m_stride_len;
+    PooledBuffer packed =
+        BufferPool::default_pool().acquire(nsamps * m_stride_size);
+    sigproc::pack_from_float(block, packed.bytes(), m_nbits, "little");
+    m_file->pwrite(m_header_size + start_sample * m_stride_size,
+                   packed.bytes());
+}
+
+void FilterbankRangeWriter::close() {
+    if (m_file) {
+        m_file->sync();
+        m_file.reset();
+    }
+}
+
 /*
 class FilterbankBlock {
 public:
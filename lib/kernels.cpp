@@ -1,6 +1,115 @@
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
 #include <sigproc/kernels.hpp>
 
+namespace {
+
+// Tile edge, a 64 x 64 float tile pair (in + out) fits in L1
+constexpr int kTransposeTile = 64;
+
+// Trials per dedispersion tile, they share most of the input rows they read
+constexpr int kDMTile = 8;
+// Output samples per dedispersion tile, kDMTile accumulator rows fit in L2
+constexpr int kTimeTile = 1024;
+
+// Start samples per boxcar tile, their maxima and widths fit in L1
+constexpr int kBoxcarTile = 2048;
+
+#if defined(__AVX__)
+void transpose_8x8(const float* in, std::size_t in_stride, float* out,
+                   std::size_t out_stride) {
+    const __m256 r0 = _mm256_loadu_ps(in + 0 * in_stride);
+    const __m256 r1 = _mm256_loadu_ps(in + 1 * in_stride);
+    const __m256 r2 = _mm256_loadu_ps(in + 2 * in_stride);
+    const __m256 r3 = _mm256_loadu_ps(in + 3 * in_stride);
+    const __m256 r4 = _mm256_loadu_ps(in + 4 * in_stride);
+    const __m256 r5 = _mm256_loadu_ps(in + 5 * in_stride);
+    const __m256 r6 = _mm256_loadu_ps(in + 6 * in_stride);
+    const __m256 r7 = _mm256_loadu_ps(in + 7 * in_stride);
+
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    const __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    const __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    const __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    const __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _mm256_storeu_ps(out + 0 * out_stride,
+                     _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(out + 1 * out_stride,
+                     _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(out + 2 * out_stride,
+                     _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(out + 3 * out_stride,
+                     _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(out + 4 * out_stride,
+                     _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(out + 5 * out_stride,
+                     _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(out + 6 * out_stride,
+                     _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(out + 7 * out_stride,
+                     _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+#endif
+
+/*
+ * out[jj * out_stride + ii] = in[ii * in_stride + jj] for an nrows x ncols
+ * matrix, walked in tiles so both sides stay in cache. Full 8 x 8 blocks use
+ * the AVX kernel, edges fall back to scalar copies.
+ */
+void transpose_strided(const float* in, std::size_t in_stride, float* out,
+                       std::size_t out_stride, int nrows, int ncols) {
+#pragma omp parallel for collapse(2) default(none)                             \
+    shared(in, in_stride, out, out_stride, nrows, ncols)
+    for (int row0 = 0; row0 < nrows; row0 += kTransposeTile) {
+        for (int col0 = 0; col0 < ncols; col0 += kTransposeTile) {
+            const int row1 = std::min(row0 + kTransposeTile, nrows);
+            const int col1 = std::min(col0 + kTransposeTile, ncols);
+            int ii         = row0;
+#if defined(__AVX__)
+            for (; ii + 8 <= row1; ii += 8) {
+                int jj = col0;
+                for (; jj + 8 <= col1; jj += 8) {
+                    transpose_8x8(in + ii * in_stride + jj, in_stride,
+                                  out + jj * out_stride + ii, out_stride);
+                }
+                for (; jj < col1; jj++) {
+                    for (int kk = ii; kk < ii + 8; kk++) {
+                        out[jj * out_stride + kk] = in[kk * in_stride + jj];
+                    }
+                }
+            }
+#endif
+            for (; ii < row1; ii++) {
+                for (int jj = col0; jj < col1; jj++) {
+                    out[jj * out_stride + ii] = in[ii * in_stride + jj];
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
 namespace sigproc {
 
 void add_channels(std::span<const float> inbuffer, std::span<float> outbuffer,
@@ -20,8 +129,8 @@ void add_samples(std::span<const float> inbuffer, std::span<double> outbuffer,
 #pragma omp parallel for default(none)                                         \
     shared(inbuffer, outbuffer, nchans, nsamps, nifs)
     for (int ipol = 0; ipol < nifs; ipol++) {
-        for (int jj = 0; jj < nchans; jj++) {
-            for (int ii = 0; ii < nsamps; ii++) {
+        for (int ii = 0; ii < nsamps; ii++) {
+            for (int jj = 0; jj < nchans; jj++) {
                 outbuffer[(nchans * ipol) + jj] +=
                     inbuffer[(nifs * nchans * ii) + (nchans * ipol) + jj];
             }
@@ -31,11 +140,15 @@ void add_samples(std::span<const float> inbuffer, std::span<double> outbuffer,
 
 void get_bpass(std::span<const float> inbuffer, std::span<double> outbuffer,
                int nchans, int nsamps) {
-#pragma omp parallel for default(none)                                         \
-    shared(inbuffer, outbuffer, nchans, nsamps)
-    for (int jj = 0; jj < nchans; jj++) {
-        for (int ii = 0; ii < nsamps; ii++) {
-            outbuffer[jj] += inbuffer[(nchans * ii) + jj];
+    // Walk the time-major data in memory order, each thread summing a run of
+    // samples into its own copy of the bandpass.
+    const float* in = inbuffer.data();
+    double* out     = outbuffer.data();
+#pragma omp parallel for reduction(+ : out[:nchans]) default(none)             \
+    shared(in, nchans, nsamps)
+    for (int ii = 0; ii < nsamps; ii++) {
+        for (int jj = 0; jj < nchans; jj++) {
+            out[jj] += in[(nchans * ii) + jj];
         }
     }
 }
@@ -63,6 +176,112 @@ void downsample(std::span<const float> inbuffer, std::span<float> outbuffer,
     }
 }
 
+void transpose(std::span<const float> inbuffer, std::span<float> outbuffer,
+               int nrows, int ncols) {
+    transpose_strided(inbuffer.data(), ncols, outbuffer.data(), nrows, nrows,
+                      ncols);
+}
+
+void corner_turn(std::span<const float> inbuffer, std::span<float> outbuffer,
+                 int nchans, int nsamps, int nifs) {
+    const auto stride_len = static_cast<std::size_t>(nifs) * nchans;
+    for (int ipol = 0; ipol < nifs; ipol++) {
+        transpose_strided(inbuffer.data() + ipol * nchans, stride_len,
+                          outbuffer.data() +
+                              static_cast<std::size_t>(ipol) * nchans * nsamps,
+                          nsamps, nsamps, nchans);
+    }
+}
+
+void corner_turn_inverse(std::span<const float> inbuffer,
+                         std::span<float> outbuffer, int nchans, int nsamps,
+                         int nifs) {
+    const auto stride_len = static_cast<std::size_t>(nifs) * nchans;
+    for (int ipol = 0; ipol < nifs; ipol++) {
+        transpose_strided(inbuffer.data() +
+                              static_cast<std::size_t>(ipol) * nchans * nsamps,
+                          nsamps, outbuffer.data() + ipol * nchans,
+                          stride_len, nchans, nsamps);
+    }
+}
+
+void shift_add_channels(std::span<const float> inbuffer,
+                        std::span<float> outbuffer,
+                        std::span<const int32_t> delays, int ntrials,
+                        int chan_start, int nchans_range, int nchans,
+                        int nifs, int nsamps_in, int nsamps_out) {
+    const float* inbuf       = inbuffer.data();
+    float* outbuf            = outbuffer.data();
+    const int32_t* delay_tab = delays.data();
+    const int nrows          = nchans_range * nifs;
+    const int ntrial_tiles   = (ntrials + kDMTile - 1) / kDMTile;
+    const int ntime_tiles    = (nsamps_out + kTimeTile - 1) / kTimeTile;
+#pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int trial_tile = 0; trial_tile < ntrial_tiles; ++trial_tile) {
+        for (int time_tile = 0; time_tile < ntime_tiles; ++time_tile) {
+            const int trial0 = trial_tile * kDMTile;
+            const int trial1 = std::min(trial0 + kDMTile, ntrials);
+            const int t0     = time_tile * kTimeTile;
+            const int nt     = std::min(kTimeTile, nsamps_out - t0);
+            for (int itrial = trial0; itrial < trial1; ++itrial) {
+                std::fill_n(outbuf + static_cast<int64_t>(itrial) *
+                                         nsamps_out +
+                                t0,
+                            nt, 0.0F);
+            }
+            for (int irow = 0; irow < nrows; ++irow) {
+                const int ifno      = irow / nchans_range;
+                const int ichan     = irow % nchans_range;
+                const float* in_row = inbuf +
+                                      (static_cast<int64_t>(ifno) * nchans +
+                                       chan_start + ichan) *
+                                          nsamps_in +
+                                      t0;
+                for (int itrial = trial0; itrial < trial1; ++itrial) {
+                    const float* src =
+                        in_row +
+                        delay_tab[static_cast<int64_t>(itrial) * nchans_range +
+                                  ichan];
+                    float* dst =
+                        outbuf + static_cast<int64_t>(itrial) * nsamps_out + t0;
+#pragma omp simd
+                    for (int t = 0; t < nt; ++t) {
+                        dst[t] += src[t];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void boxcar_max(std::span<const double> prefix, std::span<const int> widths,
+                std::span<float> best_snr, std::span<int32_t> best_width,
+                int nsamps_in, int nsamps_out) {
+    const auto nwidths = static_cast<int>(widths.size());
+    for (int t0 = 0; t0 < nsamps_out; t0 += kBoxcarTile) {
+        const int nt  = std::min(kBoxcarTile, nsamps_out - t0);
+        float* snr    = best_snr.data() + t0;
+        int32_t* widx = best_width.data() + t0;
+        std::fill_n(snr, nt, std::numeric_limits<float>::lowest());
+        std::fill_n(widx, nt, 0);
+        for (int iwidth = 0; iwidth < nwidths; ++iwidth) {
+            const int width   = widths[iwidth];
+            const int nvalid  = std::min(nt, nsamps_in - width + 1 - t0);
+            const double* lo  = prefix.data() + t0;
+            const double* hi  = lo + width;
+            const double norm = 1.0 / std::sqrt(static_cast<double>(width));
+#pragma omp simd
+            for (int t = 0; t < nvalid; ++t) {
+                const auto value = static_cast<float>((hi[t] - lo[t]) * norm);
+                if (value > snr[t]) {
+                    snr[t]  = value;
+                    widx[t] = iwidth;
+                }
+            }
+        }
+    }
+}
+
 } // namespace sigproc
 
 /*
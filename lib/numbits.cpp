@@ -1,11 +1,18 @@
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <span>
 #include <stdexcept>
+#include <type_traits>
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
 #include <sigproc/numbits.hpp>
 
@@ -41,6 +48,38 @@ constexpr LookupTableGenerate<1> kLookup1bit{};
 constexpr LookupTableGenerate<2> kLookup2bit{};
 constexpr LookupTableGenerate<4> kLookup4bit{};
 
+// Same tables as float, so packed bytes convert without a byte pass
+template <size_t NBits> struct FloatLookupTableGenerate {
+    static constexpr size_t kSize     = 256;
+    static constexpr size_t kElements = 8 / NBits;
+    alignas(64) std::array<std::array<float, kElements>, kSize> table_big{};
+    alignas(64) std::array<std::array<float, kElements>, kSize> table_little{};
+
+    constexpr explicit FloatLookupTableGenerate(
+        const LookupTableGenerate<NBits>& lookup) {
+        for (size_t ii = 0; ii < kSize; ii++) {
+            for (size_t jj = 0; jj < kElements; jj++) {
+                table_big[ii][jj]    = lookup.table_big[ii][jj];
+                table_little[ii][jj] = lookup.table_little[ii][jj];
+            }
+        }
+    }
+};
+
+constexpr FloatLookupTableGenerate<1> kFloatLookup1bit{kLookup1bit};
+constexpr FloatLookupTableGenerate<2> kFloatLookup2bit{kLookup2bit};
+constexpr FloatLookupTableGenerate<4> kFloatLookup4bit{kLookup4bit};
+
+template <size_t NBits> constexpr const auto& float_lookup() {
+    if constexpr (NBits == 1) {
+        return kFloatLookup1bit;
+    } else if constexpr (NBits == 2) {
+        return kFloatLookup2bit;
+    } else {
+        return kFloatLookup4bit;
+    }
+}
+
 template <bool Parallel, bool BigEndian>
 void unpack_1bit_lookup(std::span<const uint8_t> inbuffer,
                         std::span<uint8_t> outbuffer) {
@@ -61,7 +100,7 @@ void unpack_2bit_lookup(std::span<const uint8_t> inbuffer,
     const auto& table =
         BigEndian ? kLookup2bit.table_big : kLookup2bit.table_little;
 #ifdef USE_OPENMP
-#pragma omp parallel for if (parallel) default(none)                           \
+#pragma omp parallel for if (Parallel) default(none)                           \
     shared(inbuffer, outbuffer, table)
 #endif
     for (size_t ii = 0; ii < inbuffer.size(); ii++) {
@@ -320,6 +359,201 @@ template <bool BigEndian> void pack_4bit_inplace(std::span<uint8_t> buffer) {
     }
 }
 
+/*
+ * Fused conversion of packed samples to float.
+ *
+ * The input is processed in runs of nchans samples, each starting at channel
+ * 0, so the per-channel scale/offset line up with the output. Without scaling
+ * the whole buffer is a single run.
+ */
+template <size_t NBits, bool BigEndian, bool Scaled>
+void unpack_float_run(const uint8_t* inbuffer, float* outbuffer,
+                      size_t nbytes, const float* scale,
+                      const float* offset) {
+    constexpr size_t kElements = 8 / NBits;
+    const auto& lookup         = float_lookup<NBits>();
+    const auto& table = BigEndian ? lookup.table_big : lookup.table_little;
+    size_t ii         = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    if constexpr (NBits == 1) {
+        // one byte expands to exactly one 8-float vector
+        for (; ii < nbytes; ii++) {
+            __m256 vals = _mm256_load_ps(table[inbuffer[ii]].data());
+            if constexpr (Scaled) {
+                vals = _mm256_fmadd_ps(vals, _mm256_loadu_ps(scale + ii * 8),
+                                       _mm256_loadu_ps(offset + ii * 8));
+            }
+            _mm256_storeu_ps(outbuffer + ii * 8, vals);
+        }
+    } else if constexpr (NBits == 2) {
+        // two bytes expand to one 8-float vector
+        for (; ii + 2 <= nbytes; ii += 2) {
+            __m256 vals =
+                _mm256_set_m128(_mm_load_ps(table[inbuffer[ii + 1]].data()),
+                                _mm_load_ps(table[inbuffer[ii]].data()));
+            if constexpr (Scaled) {
+                vals = _mm256_fmadd_ps(vals, _mm256_loadu_ps(scale + ii * 4),
+                                       _mm256_loadu_ps(offset + ii * 4));
+            }
+            _mm256_storeu_ps(outbuffer + ii * 4, vals);
+        }
+    }
+#endif
+    for (; ii < nbytes; ii++) {
+        const float* vals = table[inbuffer[ii]].data();
+        float* out        = outbuffer + ii * kElements;
+        for (size_t jj = 0; jj < kElements; jj++) {
+            if constexpr (Scaled) {
+                out[jj] = vals[jj] * scale[ii * kElements + jj] +
+                          offset[ii * kElements + jj];
+            } else {
+                out[jj] = vals[jj];
+            }
+        }
+    }
+}
+
+// Load sample ii of type T from a possibly unaligned byte buffer
+template <typename T> float load_sample(const uint8_t* inbuffer, size_t ii) {
+    T value;
+    std::memcpy(&value, inbuffer + ii * sizeof(T), sizeof(T));
+    return static_cast<float>(value);
+}
+
+template <typename T, bool Scaled>
+void convert_float_run(const uint8_t* inbuffer, float* outbuffer,
+                       size_t nsamps, const float* scale,
+                       const float* offset) {
+    size_t ii = 0;
+#if defined(__AVX512F__)
+    for (; ii + 16 <= nsamps; ii += 16) {
+        const uint8_t* src = inbuffer + ii * sizeof(T);
+        __m512 vals;
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            vals = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+        } else if constexpr (std::is_same_v<T, uint16_t>) {
+            vals = _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src))));
+        } else {
+            vals = _mm512_loadu_ps(src);
+        }
+        if constexpr (Scaled) {
+            vals = _mm512_fmadd_ps(vals, _mm512_loadu_ps(scale + ii),
+                                   _mm512_loadu_ps(offset + ii));
+        }
+        _mm512_storeu_ps(outbuffer + ii, vals);
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    for (; ii + 8 <= nsamps; ii += 8) {
+        const uint8_t* src = inbuffer + ii * sizeof(T);
+        __m256 vals;
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            vals = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+        } else if constexpr (std::is_same_v<T, uint16_t>) {
+            vals = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+        } else {
+            vals = _mm256_loadu_ps(reinterpret_cast<const float*>(src));
+        }
+        if constexpr (Scaled) {
+            vals = _mm256_fmadd_ps(vals, _mm256_loadu_ps(scale + ii),
+                                   _mm256_loadu_ps(offset + ii));
+        }
+        _mm256_storeu_ps(outbuffer + ii, vals);
+    }
+#endif
+    for (; ii < nsamps; ii++) {
+        float value = load_sample<T>(inbuffer, ii);
+        if constexpr (Scaled) {
+            value = value * scale[ii] + offset[ii];
+        }
+        outbuffer[ii] = value;
+    }
+}
+
+template <size_t NBits, bool BigEndian, bool Scaled>
+void unpack_float(std::span<const uint8_t> inbuffer,
+                  std::span<float> outbuffer, std::span<const float> scale,
+                  std::span<const float> offset) {
+    const size_t nsamps = outbuffer.size();
+    const size_t nchans = Scaled ? scale.size() : nsamps;
+    for (size_t start = 0; start < nsamps; start += nchans) {
+        const size_t nrun = std::min(nchans, nsamps - start);
+        if constexpr (NBits < 8) {
+            constexpr size_t kElements = 8 / NBits;
+            const uint8_t* in          = inbuffer.data() + start / kElements;
+            float* out                 = outbuffer.data() + start;
+            const size_t nfull         = nrun / kElements;
+            unpack_float_run<NBits, BigEndian, Scaled>(
+                in, out, nfull, scale.data(), offset.data());
+            // A last partial byte holds the first nrun % kElements values
+            const auto& lookup = float_lookup<NBits>();
+            const auto& table =
+                BigEndian ? lookup.table_big : lookup.table_little;
+            for (size_t ii = nfull * kElements; ii < nrun; ii++) {
+                const float value = table[in[nfull]][ii - nfull * kElements];
+                if constexpr (Scaled) {
+                    out[ii] = value * scale[ii] + offset[ii];
+                } else {
+                    out[ii] = value;
+                }
+            }
+        } else {
+            using SampleType = std::conditional_t<
+                NBits == 8, uint8_t,
+                std::conditional_t<NBits == 16, uint16_t, float>>;
+            convert_float_run<SampleType, Scaled>(
+                inbuffer.data() + start * sizeof(SampleType),
+                outbuffer.data() + start, nrun, scale.data(), offset.data());
+        }
+    }
+}
+
+/*
+ * Quantise floats to nbits unsigned integers (rounding and clipping to the
+ * digitiser range) and pack them into bytes in a single pass.
+ */
+template <size_t NBits, bool BigEndian>
+void pack_float(std::span<const float> inbuffer,
+                std::span<uint8_t> outbuffer) {
+    static constexpr auto kMax = static_cast<float>((1UL << NBits) - 1);
+    const auto quantise = [](float value) {
+        return static_cast<uint32_t>(
+            std::nearbyint(std::clamp(value, 0.0F, kMax)));
+    };
+    if constexpr (NBits < 8) {
+        constexpr size_t kElements = 8 / NBits;
+        // A last partial byte is padded with zeros
+        const size_t nbytes = (inbuffer.size() + kElements - 1) / kElements;
+        for (size_t ii = 0; ii < nbytes; ii++) {
+            uint32_t byte = 0;
+            const size_t nvals =
+                std::min(kElements, inbuffer.size() - ii * kElements);
+            for (size_t jj = 0; jj < nvals; jj++) {
+                const size_t shift = BigEndian ? (kElements - 1 - jj) * NBits
+                                               : jj * NBits;
+                byte |= quantise(inbuffer[ii * kElements + jj]) << shift;
+            }
+            outbuffer[ii] = static_cast<uint8_t>(byte);
+        }
+    } else if constexpr (NBits == 8) {
+        for (size_t ii = 0; ii < inbuffer.size(); ii++) {
+            outbuffer[ii] = static_cast<uint8_t>(quantise(inbuffer[ii]));
+        }
+    } else if constexpr (NBits == 16) {
+        for (size_t ii = 0; ii < inbuffer.size(); ii++) {
+            const auto value = static_cast<uint16_t>(quantise(inbuffer[ii]));
+            std::memcpy(outbuffer.data() + ii * sizeof(uint16_t), &value,
+                        sizeof(uint16_t));
+        }
+    } else {
+        std::memcpy(outbuffer.data(), inbuffer.data(),
+                    inbuffer.size() * sizeof(float));
+    }
+}
+
 using PackUnpackFunc = void (*)(std::span<const uint8_t>, std::span<uint8_t>);
 using PackUnpackFuncInPlace = void (*)(std::span<uint8_t>);
 
@@ -387,6 +621,69 @@ constexpr std::array<std::array<PackUnpackFuncInPlace, 2>, 3>
         {{pack_4bit_inplace<false>, pack_4bit_inplace<true>}},
     }};
 
+using UnpackFloatFunc = void (*)(std::span<const uint8_t>, std::span<float>,
+                                std::span<const float>,
+                                std::span<const float>);
+using PackFloatFunc = void (*)(std::span<const float>, std::span<uint8_t>);
+
+// Indexed by [nbits index][bitorder][scaled]
+constexpr std::array<std::array<std::array<UnpackFloatFunc, 2>, 2>, 6>
+    kUnpackFloatDispatcher = {{
+        {{
+            {{unpack_float<1, false, false>, unpack_float<1, false, true>}},
+            {{unpack_float<1, true, false>, unpack_float<1, true, true>}},
+        }},
+        {{
+            {{unpack_float<2, false, false>, unpack_float<2, false, true>}},
+            {{unpack_float<2, true, false>, unpack_float<2, true, true>}},
+        }},
+        {{
+            {{unpack_float<4, false, false>, unpack_float<4, false, true>}},
+            {{unpack_float<4, true, false>, unpack_float<4, true, true>}},
+        }},
+        {{
+            {{unpack_float<8, false, false>, unpack_float<8, false, true>}},
+            {{unpack_float<8, true, false>, unpack_float<8, true, true>}},
+        }},
+        {{
+            {{unpack_float<16, false, false>, unpack_float<16, false, true>}},
+            {{unpack_float<16, true, false>, unpack_float<16, true, true>}},
+        }},
+        {{
+            {{unpack_float<32, false, false>, unpack_float<32, false, true>}},
+            {{unpack_float<32, true, false>, unpack_float<32, true, true>}},
+        }},
+    }};
+
+constexpr std::array<std::array<PackFloatFunc, 2>, 6> kPackFloatDispatcher = {{
+    {{pack_float<1, false>, pack_float<1, true>}},
+    {{pack_float<2, false>, pack_float<2, true>}},
+    {{pack_float<4, false>, pack_float<4, true>}},
+    {{pack_float<8, false>, pack_float<8, true>}},
+    {{pack_float<16, false>, pack_float<16, true>}},
+    {{pack_float<32, false>, pack_float<32, true>}},
+}};
+
+size_t get_nbits_index(size_t nbits) {
+    switch (nbits) {
+    case 1:
+        return 0;
+    case 2:
+        return 1;
+    case 4:
+        return 2;
+    case 8:
+        return 3;
+    case 16:
+        return 4;
+    case 32:
+        return 5;
+    default:
+        throw std::invalid_argument(
+            "Number of bits must be 1, 2, 4, 8, 16 or 32");
+    }
+}
+
 size_t get_bitorder_index(const std::string& bitorder) {
     if (bitorder.empty() || (bitorder[0] != 'l' && bitorder[0] != 'b')) {
         throw std::invalid_argument(
@@ -453,3 +750,48 @@ void sigproc::pack_inplace(std::span<uint8_t> inbuffer, size_t nbits,
     const size_t nbits_index    = nbits >> 1;
     kPackInPlaceDispatcher[nbits_index][bitorder_index](inbuffer);
 }
+
+void sigproc::unpack_to_float(std::span<const uint8_t> inbuffer,
+                              std::span<float> outbuffer, size_t nbits,
+                              const std::string& bitorder) {
+    const size_t nbits_index = get_nbits_index(nbits);
+    if (inbuffer.size() * 8 < outbuffer.size() * nbits) {
+        throw std::invalid_argument("Input buffer too small for output");
+    }
+    const size_t bitorder_index = get_bitorder_index(bitorder);
+    kUnpackFloatDispatcher[nbits_index][bitorder_index][0](inbuffer, outbuffer,
+                                                           {}, {});
+}
+
+void sigproc::unpack_to_float(std::span<const uint8_t> inbuffer,
+                              std::span<float> outbuffer, size_t nbits,
+                              std::span<const float> scale,
+                              std::span<const float> offset,
+                              const std::string& bitorder) {
+    const size_t nbits_index = get_nbits_index(nbits);
+    if (inbuffer.size() * 8 < outbuffer.size() * nbits) {
+        throw std::invalid_argument("Input buffer too small for output");
+    }
+    if (scale.empty() || scale.size() != offset.size()) {
+        throw std::invalid_argument(
+            "scale and offset must have one value per channel");
+    }
+    if (nbits < 8 && (scale.size() * nbits) % 8 != 0) {
+        throw std::invalid_argument(
+            "Channels must fill whole bytes to scale packed data");
+    }
+    const size_t bitorder_index = get_bitorder_index(bitorder);
+    kUnpackFloatDispatcher[nbits_index][bitorder_index][1](inbuffer, outbuffer,
+                                                           scale, offset);
+}
+
+void sigproc::pack_from_float(std::span<const float> inbuffer,
+                              std::span<uint8_t> outbuffer, size_t nbits,
+                              const std::string& bitorder) {
+    const size_t nbits_index = get_nbits_index(nbits);
+    if (outbuffer.size() * 8 < inbuffer.size() * nbits) {
+        throw std::invalid_argument("Output buffer too small for input");
+    }
+    const size_t bitorder_index = get_bitorder_index(bitorder);
+    kPackFloatDispatcher[nbits_index][bitorder_index](inbuffer, outbuffer);
+}
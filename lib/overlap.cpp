@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include <sigproc/kernels.hpp>
+#include <sigproc/overlap.hpp>
+
+OverlapReader::OverlapReader(FilReader& reader, int gulp, int overlap,
+                             int64_t start, int64_t nsamps)
+    : m_reader(reader),
+      m_gulp(gulp),
+      m_overlap(overlap),
+      m_stride_len(
+          static_cast<std::size_t>(reader.hdr.get<HeaderKey::kNchans>() *
+                                   reader.hdr.get<HeaderKey::kNifs>())),
+      m_start(start),
+      m_next(start) {
+    if (gulp <= 0 || overlap < 0 || overlap >= gulp) {
+        throw std::invalid_argument(std::format(
+            "Need 0 <= overlap < gulp, got overlap={} gulp={}", overlap,
+            gulp));
+    }
+    // A live ring is read until it ends
+    const int64_t nsamples = reader.is_unbounded()
+                                 ? std::numeric_limits<int64_t>::max()
+                                 : reader.hdr.get<HeaderKey::kNsamples>();
+    if (start < 0 || start > nsamples) {
+        throw std::out_of_range(std::format(
+            "Start sample {} outside the data ({} samples)", start, nsamples));
+    }
+    m_end = nsamps == 0 ? nsamples : std::min(nsamples, start + nsamps);
+    m_buffer.resize(static_cast<std::size_t>(gulp) * m_stride_len);
+    m_reader.seek_sample(start);
+}
+
+std::optional<OverlapBlock> OverlapReader::next() {
+    int nhistory = 0;
+    if (m_started) {
+        // Carry the tail over instead of reading it again
+        nhistory = std::min(m_overlap, m_nbuffered);
+        std::memmove(m_buffer.data(),
+                     m_buffer.data() +
+                         static_cast<std::size_t>(m_nbuffered - nhistory) *
+                             m_stride_len,
+                     static_cast<std::size_t>(nhistory) * m_stride_len *
+                         sizeof(float));
+        m_block_start += m_nbuffered - nhistory;
+    } else {
+        m_block_start = m_start;
+        m_started     = true;
+    }
+    const auto nwant = static_cast<int>(
+        std::min<int64_t>(m_gulp - nhistory, m_end - m_next));
+    if (nwant <= 0) {
+        m_nbuffered = 0;
+        return std::nullopt;
+    }
+    const auto dest = std::span(m_buffer).subspan(
+        static_cast<std::size_t>(nhistory) * m_stride_len,
+        static_cast<std::size_t>(nwant) * m_stride_len);
+    const auto nread = static_cast<int>(m_reader.read_samples(dest));
+    if (nread == 0) {
+        m_nbuffered = 0;
+        return std::nullopt;
+    }
+    m_next += nread;
+    m_nbuffered = nhistory + nread;
+
+    const std::size_t block_len =
+        static_cast<std::size_t>(m_nbuffered) * m_stride_len;
+    std::span<const float> data = std::span(m_buffer).first(block_len);
+    if (m_reader.get_layout() == BlockLayout::kChannelMajor) {
+        // Turn a copy, the buffer must stay time-major for the next block
+        m_turned.resize(block_len);
+        sigproc::corner_turn(data, m_turned,
+                             m_reader.hdr.get<HeaderKey::kNchans>(),
+                             m_nbuffered,
+                             m_reader.hdr.get<HeaderKey::kNifs>());
+        data = m_turned;
+    }
+    return OverlapBlock{m_block_start, m_nbuffered, nhistory, data};
+}
@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <thread>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <sigproc/parallel.hpp>
+
+std::vector<SampleRange> partition_samples(int64_t start, int64_t nsamps,
+                                           int nparts, int64_t align) {
+    if (nparts <= 0 || align <= 0 || nsamps < 0) {
+        throw std::invalid_argument(std::format(
+            "Cannot split {} samples into {} parts aligned to {}", nsamps,
+            nparts, align));
+    }
+    std::vector<SampleRange> ranges;
+    const int64_t nblocks   = (nsamps + align - 1) / align;
+    const int64_t per_range = (nblocks + nparts - 1) / nparts;
+    for (int64_t first = 0; first < nsamps; first += per_range * align) {
+        const int64_t count = std::min(per_range * align, nsamps - first);
+        ranges.push_back({start + first, count});
+    }
+    return ranges;
+}
+
+int resolve_nthreads(int nthreads) {
+    if (nthreads < 0) {
+        throw std::invalid_argument(
+            std::format("Number of threads must be >= 0, got {}", nthreads));
+    }
+    if (nthreads == 0) {
+        nthreads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    return std::max(1, nthreads);
+}
+
+#ifdef USE_OPENMP
+KernelThreadLimit::KernelThreadLimit(int nthreads)
+    : m_previous(omp_get_max_threads()) {
+    omp_set_num_threads(std::max(1, nthreads));
+}
+
+KernelThreadLimit::~KernelThreadLimit() { omp_set_num_threads(m_previous); }
+#else
+KernelThreadLimit::KernelThreadLimit(int /*nthreads*/) : m_previous(1) {}
+
+KernelThreadLimit::~KernelThreadLimit() = default;
+#endif
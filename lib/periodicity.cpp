@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numbers>
+#include <stdexcept>
+
+#include <sigproc/exceptions.hpp>
+#include <sigproc/parallel.hpp>
+#include <sigproc/periodicity.hpp>
+
+namespace {
+
+// Whitening blocks span a quarter of their start frequency, within these
+constexpr std::size_t kMinWhitenWidth = 16;
+constexpr std::size_t kMaxWhitenWidth = 512;
+
+constexpr int kMaxHarmonics = 32;
+
+constexpr std::array<char, 8> kCandMagic{'S', 'I', 'G', 'P',
+                                         'P', 'C', 'N', 'D'};
+constexpr uint32_t kCandVersion = 1;
+
+struct CandFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t ncands;
+};
+
+static_assert(sizeof(PeriodCandidate) == 24);
+
+// log P(X > x) of a standard normal variable
+double gaussian_log_sf(double sigma) {
+    if (sigma < 30.0) {
+        return std::log(0.5 * std::erfc(sigma / std::numbers::sqrt2));
+    }
+    // erfc underflows, use its asymptotic series
+    return -0.5 * sigma * sigma -
+           std::log(sigma * std::sqrt(2.0 * std::numbers::pi)) +
+           std::log1p(-1.0 / (sigma * sigma));
+}
+
+// log P(X > x) of X ~ Gamma(n, 1), exp(-x) sum_{i < n} x^i / i!
+double gamma_log_sf(int n, double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    const double logx = std::log(x);
+    double max_term   = -std::numeric_limits<double>::infinity();
+    for (int i = 0; i < n; ++i) {
+        max_term = std::max(max_term, i * logx - std::lgamma(i + 1.0));
+    }
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        sum += std::exp(i * logx - std::lgamma(i + 1.0) - max_term);
+    }
+    return -x + max_term + std::log(sum);
+}
+
+// Root of a decreasing function f on [lo, hi]
+template <typename F> double bisect(F&& f, double lo, double hi) {
+    for (int iter = 0; iter < 200 && hi - lo > 1e-9 * (1.0 + hi); ++iter) {
+        const double mid = 0.5 * (lo + hi);
+        (f(mid) > 0.0 ? lo : hi) = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+} // namespace
+
+void whiten_spectrum(std::span<float> power) {
+    if (power.empty()) {
+        return;
+    }
+    power[0] = 0.0F;
+    const std::size_t nbins = power.size();
+    if (nbins < 2) {
+        return;
+    }
+
+    // Block edges, the last block absorbs a short remainder
+    std::vector<std::size_t> edges{1};
+    while (edges.back() < nbins) {
+        const std::size_t lo    = edges.back();
+        const std::size_t width = std::clamp(lo / 4, kMinWhitenWidth,
+                                             kMaxWhitenWidth);
+        edges.push_back(nbins - lo < width + width / 2 ? nbins : lo + width);
+    }
+    const std::size_t nblocks = edges.size() - 1;
+
+    // Mean of exponentially distributed noise power is median / ln 2
+    std::vector<double> centres(nblocks);
+    std::vector<double> means(nblocks);
+    std::vector<float> scratch;
+    for (std::size_t iblock = 0; iblock < nblocks; ++iblock) {
+        const auto block = power.subspan(edges[iblock],
+                                         edges[iblock + 1] - edges[iblock]);
+        scratch.assign(block.begin(), block.end());
+        const auto mid = scratch.begin() + scratch.size() / 2;
+        std::nth_element(scratch.begin(), mid, scratch.end());
+        centres[iblock] = 0.5 * (edges[iblock] + edges[iblock + 1] - 1);
+        means[iblock]   = *mid / std::numbers::ln2;
+    }
+
+    std::size_t iblock = 0;
+    for (std::size_t ibin = 1; ibin < nbins; ++ibin) {
+        const auto pos = static_cast<double>(ibin);
+        while (iblock + 1 < nblocks && centres[iblock + 1] <= pos) {
+            ++iblock;
+        }
+        double mean = means[iblock];
+        if (iblock + 1 < nblocks && pos > centres[iblock]) {
+            const double frac = (pos - centres[iblock]) /
+                                (centres[iblock + 1] - centres[iblock]);
+            mean += frac * (means[iblock + 1] - means[iblock]);
+        }
+        power[ibin] =
+            mean > 0.0 ? static_cast<float>(power[ibin] / mean) : 0.0F;
+    }
+}
+
+double harmonic_sum_sigma(double power, int nharm) {
+    const double log_p = gamma_log_sf(nharm, power);
+    const double hi    = std::sqrt(std::max(-2.0 * log_p, 0.0)) + 10.0;
+    return bisect(
+        [&](double sigma) { return gaussian_log_sf(sigma) - log_p; }, -10.0,
+        hi);
+}
+
+double harmonic_sum_threshold(double sigma, int nharm) {
+    const double log_p = gaussian_log_sf(sigma);
+    double hi          = nharm + 10.0;
+    while (gamma_log_sf(nharm, hi) > log_p) {
+        hi *= 2.0;
+    }
+    return bisect(
+        [&](double power) { return gamma_log_sf(nharm, power) - log_p; },
+        0.0, hi);
+}
+
+struct PeriodicitySearch::Workspace {
+    PowerSpectrum spectrum;
+    FFTWVector<float> series;
+    std::vector<float> power;
+    std::vector<float> sums;
+
+    Workspace(int nfft, int nthreads)
+        : spectrum(nfft, 1, nthreads),
+          series(nfft),
+          power(spectrum.nbins()),
+          sums(spectrum.nbins()) {}
+};
+
+PeriodicitySearch::PeriodicitySearch(int nfft, double tsamp,
+                                     PeriodSearchOptions options)
+    : m_nfft(nfft), m_tsamp(tsamp), m_options(options) {
+    if (nfft < 2 || nfft % 2 != 0) {
+        throw std::invalid_argument(
+            std::format("FFT length must be even, got {}", nfft));
+    }
+    if (tsamp <= 0) {
+        throw std::invalid_argument(
+            std::format("Sampling time must be positive, got {}", tsamp));
+    }
+    const int nharm = options.max_harmonics;
+    if (nharm < 1 || nharm > kMaxHarmonics || !std::has_single_bit(
+                                                   static_cast<unsigned>(
+                                                       nharm))) {
+        throw std::invalid_argument(std::format(
+            "Harmonics must be a power of two up to {}, got {}",
+            kMaxHarmonics, nharm));
+    }
+    const double nyquist = 0.5 / tsamp;
+    const double fmax    = options.fmax > 0 ? options.fmax : nyquist;
+    if (options.fmin < 0 || fmax <= options.fmin) {
+        throw std::invalid_argument(std::format(
+            "Need 0 <= fmin < fmax, got {} and {}", options.fmin, fmax));
+    }
+    m_kmin = std::max(1, static_cast<int>(std::ceil(options.fmin /
+                                                    bin_width())));
+    m_kmax = std::min(nbins() - 1,
+                      static_cast<int>(std::floor(fmax / bin_width())));
+
+    for (int fold = 1; fold <= nharm; fold *= 2) {
+        m_folds.push_back(fold);
+        m_thresholds.push_back(
+            harmonic_sum_threshold(options.threshold, fold));
+        // round(j * r / h) of the odd harmonics j
+        std::vector<int32_t> offsets;
+        for (int j = 1; j < fold; j += 2) {
+            for (int r = 0; r < fold; ++r) {
+                offsets.push_back((2 * j * r + fold) / (2 * fold));
+            }
+        }
+        m_offsets.push_back(std::move(offsets));
+    }
+}
+
+PeriodicitySearch::~PeriodicitySearch() = default;
+
+void PeriodicitySearch::harmonic_sum(int ifold, std::span<const float> power,
+                                     std::span<float> sums) const {
+    const int fold = m_folds[ifold];
+    // Later folds only test higher bins, see run()
+    const int64_t k0 = static_cast<int64_t>(fold) * m_kmin;
+    const auto k1    = static_cast<int64_t>(nbins());
+    if (k0 >= k1) {
+        return;
+    }
+    const int32_t* offsets = m_offsets[ifold].data();
+    const float* src       = power.data();
+    float* dst             = sums.data();
+    const int nodd         = fold / 2;
+    for (int64_t q = k0 / fold; q * fold < k1; ++q) {
+        const int64_t kbase = q * fold;
+        const int r0        = static_cast<int>(std::max<int64_t>(
+            k0 - kbase, 0));
+        const int r1 = static_cast<int>(std::min<int64_t>(k1 - kbase, fold));
+        for (int jj = 0; jj < nodd; ++jj) {
+            const int32_t* row = offsets + static_cast<std::size_t>(jj) * fold;
+            const float* harm  = src + (2 * jj + 1) * q;
+            for (int r = r0; r < r1; ++r) {
+                dst[kbase + r] += harm[row[r]];
+            }
+        }
+    }
+}
+
+std::vector<PeriodCandidate>
+PeriodicitySearch::run(Workspace& work, std::span<const float> series,
+                       double dm) const {
+    const auto nsamps = std::min(series.size(), work.series.size());
+    double mean       = 0.0;
+    for (std::size_t ii = 0; ii < nsamps; ++ii) {
+        mean += series[ii];
+    }
+    mean /= static_cast<double>(std::max<std::size_t>(nsamps, 1));
+    for (std::size_t ii = 0; ii < nsamps; ++ii) {
+        work.series[ii] = static_cast<float>(series[ii] - mean);
+    }
+    std::fill(work.series.begin() + static_cast<std::ptrdiff_t>(nsamps),
+              work.series.end(), 0.0F);
+
+    work.spectrum.compute(work.series, work.power);
+    whiten_spectrum(work.power);
+    std::copy(work.power.begin() + m_kmin, work.power.end(),
+              work.sums.begin() + m_kmin);
+
+    // Bin k of fold h has the fundamental k / h
+    std::vector<PeriodCandidate> found;
+    const float* sums = work.sums.data();
+    for (std::size_t ifold = 0; ifold < m_folds.size(); ++ifold) {
+        const int fold = m_folds[ifold];
+        if (fold > 1) {
+            harmonic_sum(static_cast<int>(ifold), work.power, work.sums);
+        }
+        const int64_t lo = static_cast<int64_t>(fold) * m_kmin;
+        const int64_t hi = std::min(static_cast<int64_t>(fold) * m_kmax + 1,
+                                    static_cast<int64_t>(nbins()));
+        const auto threshold = static_cast<float>(m_thresholds[ifold]);
+        for (int64_t k = lo; k < hi; ++k) {
+            // Local maxima only, a signal spills into its neighbours
+            if (sums[k] <= threshold || (k > lo && sums[k - 1] > sums[k]) ||
+                (k + 1 < hi && sums[k + 1] >= sums[k])) {
+                continue;
+            }
+            found.push_back(
+                {static_cast<double>(k) * bin_width() / fold,
+                 static_cast<float>(dm), sums[k],
+                 static_cast<float>(harmonic_sum_sigma(sums[k], fold)),
+                 fold});
+        }
+    }
+
+    // A signal shows up in several folds, keep its most significant one
+    std::ranges::sort(found, [](const auto& lhs, const auto& rhs) {
+        return lhs.sigma > rhs.sigma;
+    });
+    std::vector<PeriodCandidate> kept;
+    for (const auto& cand : found) {
+        if (m_options.max_candidates > 0 &&
+            kept.size() >= static_cast<std::size_t>(m_options.max_candidates)) {
+            break;
+        }
+        const bool seen = std::ranges::any_of(kept, [&](const auto& other) {
+            return std::abs(other.freq - cand.freq) <= bin_width();
+        });
+        if (!seen) {
+            kept.push_back(cand);
+        }
+    }
+    return kept;
+}
+
+std::vector<PeriodCandidate>
+PeriodicitySearch::search(std::span<const float> series, double dm) {
+    if (!m_work) {
+        m_work = std::make_unique<Workspace>(m_nfft, 0);
+    }
+    return run(*m_work, series, dm);
+}
+
+std::vector<PeriodCandidate>
+PeriodicitySearch::search_many(std::span<const float> series, int nsamps,
+                               std::span<const double> dms, int nthreads) {
+    const auto nseries = static_cast<int>(dms.size());
+    if (nsamps <= 0 ||
+        series.size() < static_cast<std::size_t>(nseries) * nsamps) {
+        throw std::invalid_argument(std::format(
+            "Need {} series of {} samples, got {} values", nseries, nsamps,
+            series.size()));
+    }
+    std::vector<std::vector<PeriodCandidate>> found(nseries);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    const auto record = [&] {
+        const std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    };
+    // One series per thread at a time, each with its own buffers
+#pragma omp parallel num_threads(resolve_nthreads(nthreads))
+    {
+        std::unique_ptr<Workspace> work;
+        try {
+            work = std::make_unique<Workspace>(m_nfft, 1);
+        } catch (...) {
+            record();
+        }
+#pragma omp for schedule(dynamic)
+        for (int idm = 0; idm < nseries; ++idm) {
+            if (!work) {
+                continue;
+            }
+            try {
+                found[idm] = run(
+                    *work,
+                    series.subspan(static_cast<std::size_t>(idm) * nsamps,
+                                   nsamps),
+                    dms[idm]);
+            } catch (...) {
+                record();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    std::vector<PeriodCandidate> cands;
+    for (const auto& series_cands : found) {
+        cands.insert(cands.end(), series_cands.begin(), series_cands.end());
+    }
+    return cands;
+}
+
+void write_period_candidates(const std::string& filename,
+                             std::span<const PeriodCandidate> cands) {
+    std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+    ErrorChecker::check_stream(stream, filename);
+    const CandFileHeader header{kCandMagic, kCandVersion,
+                                sizeof(PeriodCandidate), cands.size()};
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(cands.data()),
+                 static_cast<std::streamsize>(cands.size_bytes()));
+    ErrorChecker::check_stream(stream, filename);
+}
+
+std::vector<PeriodCandidate> read_period_candidates(
+    const std::string& filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    ErrorChecker::check_stream(stream, filename);
+    CandFileHeader header{};
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!stream || header.magic != kCandMagic ||
+        header.version != kCandVersion ||
+        header.record_size != sizeof(PeriodCandidate)) {
+        throw std::runtime_error(
+            std::format("{} is not a periodicity candidate file", filename));
+    }
+    const auto nbytes = std::filesystem::file_size(filename) - sizeof(header);
+    if (nbytes != header.ncands * sizeof(PeriodCandidate)) {
+        throw std::runtime_error(std::format("{} is truncated", filename));
+    }
+    std::vector<PeriodCandidate> cands(header.ncands);
+    stream.read(reinterpret_cast<char*>(cands.data()),
+                static_cast<std::streamsize>(nbytes));
+    if (!stream) {
+        throw std::runtime_error(std::format("{} is truncated", filename));
+    }
+    return cands;
+}
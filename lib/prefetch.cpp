@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+#include <sigproc/prefetch.hpp>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+} // namespace
+
+PrefetchReader::PrefetchReader(FilReader& reader,
+                               std::vector<readplan_tuple> plan,
+                               std::size_t nbuffers)
+    : m_reader(reader), m_plan(std::move(plan)) {
+    if (nbuffers < 2) {
+        throw std::invalid_argument("PrefetchReader needs at least 2 buffers");
+    }
+    m_slots.resize(nbuffers);
+    m_thread = std::thread(&PrefetchReader::run, this);
+}
+
+PrefetchReader::PrefetchReader(FilReader& reader, int gulp, int64_t nsamps,
+                               std::size_t nbuffers)
+    : m_reader(reader) {
+    if (nbuffers < 2) {
+        throw std::invalid_argument("PrefetchReader needs at least 2 buffers");
+    }
+    if (gulp <= 0 || nsamps < 0) {
+        throw std::invalid_argument(std::format(
+            "Need a positive gulp and nsamps >= 0, got {} and {}", gulp,
+            nsamps));
+    }
+    const int64_t stride_len = reader.hdr.get<HeaderKey::kNchans>() *
+                               reader.hdr.get<HeaderKey::kNifs>();
+    m_gulp_len  = static_cast<int>(gulp * stride_len);
+    m_total_len = nsamps * stride_len;
+    m_slots.resize(nbuffers);
+    m_thread = std::thread(&PrefetchReader::run, this);
+}
+
+PrefetchReader::~PrefetchReader() {
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv_free.notify_all();
+    m_thread.join();
+}
+
+std::optional<PrefetchBlock> PrefetchReader::next() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_holding) {
+        // Hand the previously returned buffer back to the I/O thread
+        m_holding = false;
+        m_cv_free.notify_one();
+    }
+    const auto start = Clock::now();
+    m_cv_ready.wait(lock, [this] {
+        return m_nready > 0 || m_done || m_error != nullptr;
+    });
+    m_stats.consumer_stall_sec += seconds_since(start);
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    if (m_nready == 0) {
+        return std::nullopt;
+    }
+    m_queue_depth_sum += static_cast<double>(m_nready);
+    m_stats.max_queue_depth = std::max(m_stats.max_queue_depth, m_nready);
+    m_stats.nblocks++;
+
+    const Slot& slot = m_slots[m_head];
+    m_head           = (m_head + 1) % m_slots.size();
+    m_nready--;
+    m_holding = true;
+    return PrefetchBlock{slot.iread, slot.block_len,
+                         std::span<const float>(slot.data.data(),
+                                                slot.block_len)};
+}
+
+PrefetchStats PrefetchReader::stats() const {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    PrefetchStats stats = m_stats;
+    if (stats.nblocks > 0) {
+        stats.mean_queue_depth =
+            m_queue_depth_sum / static_cast<double>(stats.nblocks);
+    }
+    return stats;
+}
+
+bool PrefetchReader::wait_for_slot() {
+    const std::size_t nslots = m_slots.size();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const auto start = Clock::now();
+    // The slot held by the consumer is not free yet
+    m_cv_free.wait(lock, [this, nslots] {
+        return m_stop || m_nready + (m_holding ? 1 : 0) < nslots;
+    });
+    m_stats.producer_stall_sec += seconds_since(start);
+    return !m_stop;
+}
+
+void PrefetchReader::publish() {
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_nready++;
+    }
+    m_cv_ready.notify_one();
+}
+
+void PrefetchReader::run() {
+    const std::size_t nslots = m_slots.size();
+    std::size_t tail         = 0;
+    try {
+        // Only the I/O thread touches a slot that is not ready or held
+        for (const auto& [iread, block_len, skip] : m_plan) {
+            if (!wait_for_slot()) {
+                return;
+            }
+            Slot& slot = m_slots[tail];
+            slot.iread = iread;
+            m_reader.read_plan(block_len, slot.data, skip);
+            // Short only at the end of the data
+            slot.block_len = static_cast<int>(slot.data.size());
+            publish();
+            tail = (tail + 1) % nslots;
+        }
+        int64_t nread = 0;
+        for (int iread = 0; m_gulp_len > 0; ++iread) {
+            int want = m_gulp_len;
+            if (m_total_len > 0) {
+                want = static_cast<int>(
+                    std::min<int64_t>(want, m_total_len - nread));
+            }
+            if (want <= 0 || !wait_for_slot()) {
+                break;
+            }
+            Slot& slot = m_slots[tail];
+            slot.iread = iread;
+            m_reader.read_plan(want, slot.data, 0);
+            slot.block_len = static_cast<int>(slot.data.size());
+            if (slot.block_len == 0) {
+                break;
+            }
+            publish();
+            tail = (tail + 1) % nslots;
+            nread += slot.block_len;
+            if (slot.block_len < want) {
+                break;
+            }
+        }
+    } catch (...) {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+    }
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+    }
+    m_cv_ready.notify_all();
+}
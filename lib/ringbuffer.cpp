@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <sigproc/ringbuffer.hpp>
+
+namespace {
+
+constexpr std::uint64_t kRingMagic   = 0x53494750524F4352; // "SIGPROCR"
+constexpr std::uint32_t kRingVersion = 1;
+constexpr std::size_t kPageSize      = 4096;
+constexpr std::size_t kMaxHeaderLen  = 2 * kPageSize;
+
+constexpr std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+/*
+ * Shared layout: RingControl, nslots RingSlot, then nslots * slot_size data
+ * bytes. Slot seq is 2 * n + 1 while stream slot n is being written into it
+ * and 2 * n + 2 once it is published.
+ */
+struct RingControl {
+    std::atomic<std::uint64_t> magic; // set last, once the rest is in place
+    std::uint32_t version;
+    std::uint32_t nslots;
+    std::uint64_t slot_size;
+    std::uint64_t header_len;
+    alignas(64) std::atomic<std::uint64_t> write_seq; // slots published
+    std::atomic<std::uint32_t> finished;
+    alignas(64) uint8_t header[kMaxHeaderLen];
+};
+
+struct alignas(64) RingSlot {
+    std::atomic<std::uint64_t> seq;
+    std::uint64_t nbytes;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "ring buffer needs lock-free 64-bit atomics");
+
+namespace {
+
+std::size_t slots_offset() { return align_up(sizeof(RingControl), kPageSize); }
+
+std::size_t data_offset(std::size_t nslots) {
+    return align_up(slots_offset() + nslots * sizeof(RingSlot), kPageSize);
+}
+
+} // namespace
+
+bool is_shm_source(const std::string& source) {
+    return source.starts_with(kShmPrefix);
+}
+
+std::string shm_name(const std::string& source) {
+    std::string name =
+        is_shm_source(source) ? source.substr(kShmPrefix.size()) : source;
+    if (!name.starts_with('/')) {
+        name.insert(0, "/");
+    }
+    return name;
+}
+
+ShmRingWriter::ShmRingWriter(const std::string& name,
+                             std::span<const uint8_t> header,
+                             std::size_t nslots, std::size_t slot_size)
+    : m_name(shm_name(name)) {
+    if (header.size() > kMaxHeaderLen) {
+        throw std::invalid_argument(std::format(
+            "Header of {} bytes exceeds the ring limit of {} bytes",
+            header.size(), kMaxHeaderLen));
+    }
+    if (nslots < 2 || slot_size == 0) {
+        throw std::invalid_argument(
+            "Ring needs at least 2 slots of non-zero size");
+    }
+    m_map_size = data_offset(nslots) + nslots * slot_size;
+    const int fd =
+        ::shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        throw std::system_error(
+            errno, std::generic_category(),
+            std::format("Could not create shared memory {}", m_name));
+    }
+    if (::ftruncate(fd, static_cast<off_t>(m_map_size)) != 0) {
+        const int err = errno;
+        ::close(fd);
+        ::shm_unlink(m_name.c_str());
+        throw std::system_error(
+            err, std::generic_category(),
+            std::format("Could not size shared memory {}", m_name));
+    }
+    void* addr = ::mmap(nullptr, m_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        const int err = errno;
+        ::shm_unlink(m_name.c_str());
+        throw std::system_error(
+            err, std::generic_category(),
+            std::format("Could not map shared memory {}", m_name));
+    }
+    auto* base = static_cast<uint8_t*>(addr);
+    m_control  = new (base) RingControl{};
+    m_slots    = reinterpret_cast<RingSlot*>(base + slots_offset());
+    for (std::size_t islot = 0; islot < nslots; ++islot) {
+        new (&m_slots[islot]) RingSlot{};
+    }
+    m_data = base + data_offset(nslots);
+
+    m_control->version    = kRingVersion;
+    m_control->nslots     = static_cast<std::uint32_t>(nslots);
+    m_control->slot_size  = slot_size;
+    m_control->header_len = header.size();
+    std::ranges::copy(header, m_control->header);
+    // Consumers check the magic last, once the geometry is in place
+    m_control->magic.store(kRingMagic, std::memory_order_release);
+}
+
+ShmRingWriter::~ShmRingWriter() {
+    if (!m_finished) {
+        finish();
+    }
+    ::munmap(m_control, m_map_size);
+    ::shm_unlink(m_name.c_str());
+}
+
+void ShmRingWriter::write(std::span<const uint8_t> data) {
+    if (m_finished) {
+        throw std::runtime_error(
+            std::format("Ring {} is already finished", m_name));
+    }
+    const std::size_t slot_size = m_control->slot_size;
+    while (!data.empty()) {
+        if (m_fill == 0) {
+            begin_slot();
+        }
+        const std::uint64_t seq = m_control->write_seq.load(
+            std::memory_order_relaxed);
+        const std::size_t islot = seq % m_control->nslots;
+        const std::size_t ncopy = std::min(data.size(), slot_size - m_fill);
+        std::memcpy(m_data + islot * slot_size + m_fill, data.data(), ncopy);
+        m_fill += ncopy;
+        data = data.subspan(ncopy);
+        if (m_fill == slot_size) {
+            publish_slot();
+        }
+    }
+}
+
+void ShmRingWriter::finish() {
+    if (m_finished) {
+        return;
+    }
+    if (m_fill > 0) {
+        publish_slot();
+    }
+    m_finished = true;
+    m_control->finished.store(1, std::memory_order_release);
+}
+
+std::uint64_t ShmRingWriter::nslots_published() const {
+    return m_control->write_seq.load(std::memory_order_relaxed);
+}
+
+void ShmRingWriter::begin_slot() {
+    const std::uint64_t seq =
+        m_control->write_seq.load(std::memory_order_relaxed);
+    RingSlot& slot = m_slots[seq % m_control->nslots];
+    // Mark the slot busy before touching its data
+    slot.seq.store(2 * seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ShmRingWriter::publish_slot() {
+    const std::uint64_t seq =
+        m_control->write_seq.load(std::memory_order_relaxed);
+    RingSlot& slot = m_slots[seq % m_control->nslots];
+    slot.nbytes    = m_fill;
+    slot.seq.store(2 * seq + 2, std::memory_order_release);
+    m_control->write_seq.store(seq + 1, std::memory_order_release);
+    m_fill = 0;
+}
+
+ShmRingReader::ShmRingReader(const std::string& name, double timeout)
+    : m_name(shm_name(name)), m_timeout(timeout) {
+    using Clock       = std::chrono::steady_clock;
+    const auto expiry = Clock::now() + std::chrono::duration<double>(timeout);
+    int fd            = -1;
+    struct stat st {};
+    // The producer may not have created or initialised the ring yet
+    while (true) {
+        fd = ::shm_open(m_name.c_str(), O_RDONLY, 0);
+        if (fd >= 0 && ::fstat(fd, &st) == 0 &&
+            static_cast<std::size_t>(st.st_size) >= sizeof(RingControl)) {
+            break;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (Clock::now() > expiry) {
+            throw std::runtime_error(
+                std::format("Shared memory ring {} not found", m_name));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    m_map_size = static_cast<std::size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, m_map_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::system_error(
+            errno, std::generic_category(),
+            std::format("Could not map shared memory {}", m_name));
+    }
+    const auto* base = static_cast<const uint8_t*>(addr);
+    m_control        = reinterpret_cast<const RingControl*>(base);
+    while (m_control->magic.load(std::memory_order_acquire) != kRingMagic) {
+        if (Clock::now() > expiry) {
+            ::munmap(addr, m_map_size);
+            throw std::runtime_error(
+                std::format("{} is not an initialised ring", m_name));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (m_control->version != kRingVersion) {
+        ::munmap(addr, m_map_size);
+        throw std::runtime_error(
+            std::format("Ring {} has version {}, expected {}", m_name,
+                        m_control->version, kRingVersion));
+    }
+    m_nslots    = m_control->nslots;
+    m_slot_size = m_control->slot_size;
+    m_slots     = reinterpret_cast<const RingSlot*>(base + slots_offset());
+    m_data      = base + data_offset(m_nslots);
+    m_header.assign(m_control->header,
+                    m_control->header + m_control->header_len);
+}
+
+ShmRingReader::~ShmRingReader() {
+    ::munmap(const_cast<RingControl*>(m_control), m_map_size);
+}
+
+std::size_t ShmRingReader::read(std::span<uint8_t> buffer) {
+    std::size_t done = 0;
+    while (done < buffer.size()) {
+        const std::uint64_t seq = m_pos / m_slot_size;
+        const std::size_t offset = m_pos % m_slot_size;
+        if (!wait_for(seq)) {
+            break;
+        }
+        const RingSlot& slot = m_slots[seq % m_nslots];
+        const std::uint64_t expected = 2 * seq + 2;
+        if (slot.seq.load(std::memory_order_acquire) != expected) {
+            throw std::runtime_error(std::format(
+                "Ring {} overrun: data at byte {} were overwritten", m_name,
+                m_pos));
+        }
+        const std::size_t nbytes = slot.nbytes;
+        if (offset >= nbytes) {
+            // Only the final, partial slot can end early
+            break;
+        }
+        const std::size_t ncopy =
+            std::min(buffer.size() - done, nbytes - offset);
+        std::memcpy(buffer.data() + done,
+                    m_data + (seq % m_nslots) * m_slot_size + offset, ncopy);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != expected) {
+            throw std::runtime_error(std::format(
+                "Ring {} overrun: data at byte {} were overwritten", m_name,
+                m_pos));
+        }
+        done += ncopy;
+        m_pos += ncopy;
+    }
+    return done;
+}
+
+bool ShmRingReader::wait_for(std::uint64_t seq) const {
+    using Clock      = std::chrono::steady_clock;
+    auto last_change = Clock::now();
+    auto published   = m_control->write_seq.load(std::memory_order_acquire);
+    auto backoff     = std::chrono::microseconds(1);
+    while (published <= seq) {
+        if (m_control->finished.load(std::memory_order_acquire) != 0) {
+            // Re-check, the last slot is published before finished is set
+            return m_control->write_seq.load(std::memory_order_acquire) > seq;
+        }
+        if (Clock::now() - last_change >
+            std::chrono::duration<double>(m_timeout)) {
+            throw std::runtime_error(std::format(
+                "No data from ring {} for {} s", m_name, m_timeout));
+        }
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, std::chrono::microseconds(1000));
+        const auto now_published =
+            m_control->write_seq.load(std::memory_order_acquire);
+        if (now_published != published) {
+            published   = now_published;
+            last_change = Clock::now();
+        }
+    }
+    return true;
+}
@@ -1,3 +1,6 @@
+#pragma once
+
+#include <cstdint>
 #include <span>
 
 namespace sigproc {
@@ -14,4 +17,56 @@ void get_bpass(std::span<const float> inbuffer, std::span<double> outbuffer,
 void downsample(std::span<const float> inbuffer, std::span<float> outbuffer,
                 int tfactor, int ffactor, int nchans, int nsamps);
 
+/**
+ * @brief Cache-blocked transpose of a row-major nrows x ncols matrix.
+ */
+void transpose(std::span<const float> inbuffer, std::span<float> outbuffer,
+               int nrows, int ncols);
+
+/**
+ * @brief Corner-turn time-major [nsamps][nifs][nchans] data to channel-major
+ * [nifs][nchans][nsamps], one transpose per IF.
+ */
+void corner_turn(std::span<const float> inbuffer, std::span<float> outbuffer,
+                 int nchans, int nsamps, int nifs = 1);
+
+/**
+ * @brief Inverse of corner_turn: channel-major back to time-major.
+ */
+void corner_turn_inverse(std::span<const float> inbuffer,
+                         std::span<float> outbuffer, int nchans, int nsamps,
+                         int nifs = 1);
+
+/**
+ * @brief Sum a range of channels of a channel-major block at per-trial
+ * delays.
+ *
+ * out[itrial][t] is the sum over IFs and the channels c of
+ * [chan_start, chan_start + nchans_range) of in[c][t + delay], with the
+ * delay taken from delays[itrial][c - chan_start]. The block is
+ * [nifs][nchans][nsamps_in] and out is [ntrials][nsamps_out]. Work is tiled
+ * over trials and time so the accumulators stay in cache, tiles are
+ * threaded and the inner loop is vectorised over time.
+ */
+void shift_add_channels(std::span<const float> inbuffer,
+                        std::span<float> outbuffer,
+                        std::span<const int32_t> delays, int ntrials,
+                        int chan_start, int nchans_range, int nchans,
+                        int nifs, int nsamps_in, int nsamps_out);
+
+/**
+ * @brief Best boxcar of each start sample of a normalised series.
+ *
+ * prefix holds the nsamps_in + 1 running sums of the series, prefix[i]
+ * being the sum of its first i samples, so every width costs one
+ * subtraction. For each start t of [0, nsamps_out), best_snr[t] is the
+ * largest (prefix[t + w] - prefix[t]) / sqrt(w) over the widths w with
+ * t + w <= nsamps_in and best_width[t] the index of that width in widths.
+ * Time is tiled so the maxima stay in L1 across widths, the inner loop is
+ * vectorised over time.
+ */
+void boxcar_max(std::span<const double> prefix, std::span<const int> widths,
+                std::span<float> best_snr, std::span<int32_t> best_width,
+                int nsamps_in, int nsamps_out);
+
 } // namespace sigproc
@@ -11,35 +11,34 @@
 
 namespace map_utils {
 
+template <typename T> std::string print_name_of_type() {
+    return boost::typeindex::type_id<T>().pretty_name();
+}
+
 // Get the value of a key in a basic map
 template <typename K, typename V>
 V get_value(const std::unordered_map<K, V>& smap, const K& key) {
     if (!smap.contains(key)) {
         throw std::runtime_error(fmt::format("Key {} not found in map {}", key,
-                                             printNameOfType<K>()));
+                                             print_name_of_type<K>()));
     }
     return smap.at(key);
 }
 
-// Get the value of a key in a map of variants
-template <typename K, typename T>
-T get_value_variant(const std::unordered_map<K, SighdrTypes>& smap,
-                    const K& key) {
+// Get the value of a key in a map (ordered or not) of variants
+template <typename K, typename T, typename Map>
+T get_value_variant(const Map& smap, const K& key) {
     if (!smap.contains(key)) {
         throw std::runtime_error(fmt::format("Key {} not found in map {}", key,
-                                             printNameOfType<K>()));
+                                             print_name_of_type<K>()));
     }
     const auto& variant = smap.at(key);
     if (!std::holds_alternative<T>(variant)) {
         throw std::runtime_error(
             fmt::format("Key {} in map {} is not of expected type {}.", key,
-                        printNameOfType<K>(), printNameOfType<T>()));
+                        print_name_of_type<K>(), print_name_of_type<T>()));
     }
     return std::get<T>(variant);
 }
 
-template <typename T> std::string print_name_of_type() {
-    return boost::typeindex::type_id<T>().pretty_name();
-}
-
 } // namespace map_utils
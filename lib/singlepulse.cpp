@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+#include <sigproc/kernels.hpp>
+#include <sigproc/parallel.hpp>
+#include <sigproc/singlepulse.hpp>
+
+namespace {
+
+// MAD of Gaussian noise is this fraction of its rms
+constexpr double kMADToSigma = 1.4826;
+
+} // namespace
+
+std::vector<int> boxcar_widths(int max_width, bool all_widths) {
+    if (max_width < 1) {
+        throw std::invalid_argument(
+            std::format("Boxcar width must be positive, got {}", max_width));
+    }
+    std::vector<int> widths;
+    if (all_widths) {
+        for (int width = 1; width <= max_width; ++width) {
+            widths.push_back(width);
+        }
+        return widths;
+    }
+    for (int width = 1; width <= max_width; width *= 2) {
+        widths.push_back(width);
+        if (width > 1 && width + width / 2 <= max_width) {
+            widths.push_back(width + width / 2);
+        }
+    }
+    if (widths.back() != max_width) {
+        widths.push_back(max_width);
+    }
+    return widths;
+}
+
+void normalise_series(std::span<float> series, int window) {
+    if (window < 1) {
+        throw std::invalid_argument(std::format(
+            "Normalisation window must be positive, got {}", window));
+    }
+    const std::size_t nsamps = series.size();
+    if (nsamps == 0) {
+        return;
+    }
+    const auto width = static_cast<std::size_t>(window);
+
+    // Block edges, the last block absorbs a short remainder
+    std::vector<std::size_t> edges{0};
+    while (edges.back() < nsamps) {
+        const std::size_t lo = edges.back();
+        edges.push_back(nsamps - lo < width + width / 2 ? nsamps : lo + width);
+    }
+    const std::size_t nblocks = edges.size() - 1;
+
+    std::vector<double> centres(nblocks);
+    std::vector<double> medians(nblocks);
+    std::vector<double> sigmas(nblocks);
+    std::vector<float> scratch;
+    for (std::size_t iblock = 0; iblock < nblocks; ++iblock) {
+        const auto block = series.subspan(edges[iblock],
+                                          edges[iblock + 1] - edges[iblock]);
+        scratch.assign(block.begin(), block.end());
+        const auto mid = scratch.begin() + scratch.size() / 2;
+        std::nth_element(scratch.begin(), mid, scratch.end());
+        const float median = *mid;
+        for (auto& value : scratch) {
+            value = std::abs(value - median);
+        }
+        std::nth_element(scratch.begin(), mid, scratch.end());
+        double sigma = kMADToSigma * *mid;
+        if (sigma <= 0.0) {
+            // Mostly constant, e.g. coarsely quantised data, use the rms
+            double sumsq = 0.0;
+            for (const float value : block) {
+                sumsq += (value - median) * (value - median);
+            }
+            sigma = std::sqrt(sumsq / static_cast<double>(block.size()));
+        }
+        centres[iblock] = 0.5 * static_cast<double>(edges[iblock] +
+                                                    edges[iblock + 1] - 1);
+        medians[iblock] = median;
+        sigmas[iblock]  = sigma > 0.0 ? sigma : 1.0;
+    }
+
+    std::size_t iblock = 0;
+    for (std::size_t isamp = 0; isamp < nsamps; ++isamp) {
+        const auto pos = static_cast<double>(isamp);
+        while (iblock + 1 < nblocks && centres[iblock + 1] <= pos) {
+            ++iblock;
+        }
+        double median = medians[iblock];
+        double sigma  = sigmas[iblock];
+        if (iblock + 1 < nblocks && pos > centres[iblock]) {
+            const double frac = (pos - centres[iblock]) /
+                                (centres[iblock + 1] - centres[iblock]);
+            median += frac * (medians[iblock + 1] - medians[iblock]);
+            sigma += frac * (sigmas[iblock + 1] - sigmas[iblock]);
+        }
+        series[isamp] = static_cast<float>((series[isamp] - median) / sigma);
+    }
+}
+
+std::vector<SinglePulseCandidate> single_pulse_search(
+    std::span<const float> block, int nsamps_in, int nsamps_out,
+    std::span<const double> dms, int64_t start_sample,
+    const SinglePulseOptions& options, int nthreads) {
+    const auto ndms = static_cast<int>(dms.size());
+    if (nsamps_out < 0 || nsamps_out > nsamps_in ||
+        block.size() < static_cast<std::size_t>(ndms) * nsamps_in) {
+        throw std::invalid_argument(std::format(
+            "Need {} series of {} >= {} samples, got {} values", ndms,
+            nsamps_in, nsamps_out, block.size()));
+    }
+    const auto threshold  = static_cast<float>(options.threshold);
+    const int norm_window = options.norm_window;
+    if (norm_window < 1) {
+        throw std::invalid_argument(std::format(
+            "Normalisation window must be positive, got {}", norm_window));
+    }
+    const auto widths = boxcar_widths(options.max_width, options.all_widths);
+
+    std::vector<std::vector<SinglePulseCandidate>> found(ndms);
+#pragma omp parallel num_threads(resolve_nthreads(nthreads))
+    {
+        std::vector<float> series(nsamps_in);
+        std::vector<double> prefix(static_cast<std::size_t>(nsamps_in) + 1);
+        std::vector<float> best_snr(nsamps_out);
+        std::vector<int32_t> best_width(nsamps_out);
+#pragma omp for schedule(dynamic)
+        for (int idm = 0; idm < ndms; ++idm) {
+            const auto row = block.subspan(
+                static_cast<std::size_t>(idm) * nsamps_in, nsamps_in);
+            std::ranges::copy(row, series.begin());
+            normalise_series(series, norm_window);
+            prefix[0] = 0.0;
+            for (int t = 0; t < nsamps_in; ++t) {
+                prefix[t + 1] = prefix[t] + series[t];
+            }
+            sigproc::boxcar_max(prefix, widths, best_snr, best_width,
+                                nsamps_in, nsamps_out);
+
+            // One candidate per run above threshold, at its peak
+            auto& cands = found[idm];
+            const auto dm = static_cast<float>(dms[idm]);
+            SinglePulseCandidate peak{};
+            int last = -1;
+            for (int t = 0; t < nsamps_out; ++t) {
+                if (best_snr[t] <= threshold) {
+                    continue;
+                }
+                const int width = widths[best_width[t]];
+                // Contiguous, or inside the boxcar of the peak so far
+                const bool same = last >= 0 && (t == last + 1 ||
+                                                t < peak.sample + peak.width);
+                if (same) {
+                    if (best_snr[t] > peak.snr) {
+                        peak = {t, dm, width, best_snr[t]};
+                    }
+                } else {
+                    if (last >= 0) {
+                        cands.push_back(peak);
+                    }
+                    peak = {t, dm, width, best_snr[t]};
+                }
+                last = t;
+            }
+            if (last >= 0) {
+                cands.push_back(peak);
+            }
+            for (auto& cand : cands) {
+                cand.sample += start_sample;
+            }
+        }
+    }
+
+    std::vector<SinglePulseCandidate> cands;
+    for (const auto& dm_cands : found) {
+        cands.insert(cands.end(), dm_cands.begin(), dm_cands.end());
+    }
+    return cands;
+}
+
+std::vector<SinglePulseCandidate> merge_single_pulses(
+    std::vector<SinglePulseCandidate> cands, int64_t gap) {
+    std::ranges::sort(cands, [](const auto& lhs, const auto& rhs) {
+        return lhs.dm != rhs.dm ? lhs.dm < rhs.dm : lhs.sample < rhs.sample;
+    });
+    std::vector<SinglePulseCandidate> merged;
+    int64_t cluster_end = 0;
+    for (const auto& cand : cands) {
+        if (!merged.empty() && merged.back().dm == cand.dm &&
+            cand.sample <= cluster_end + gap) {
+            cluster_end = std::max(cluster_end, cand.sample + cand.width);
+            if (cand.snr > merged.back().snr) {
+                merged.back() = cand;
+            }
+            continue;
+        }
+        merged.push_back(cand);
+        cluster_end = cand.sample + cand.width;
+    }
+    return merged;
+}
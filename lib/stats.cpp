@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include <sigproc/exceptions.hpp>
+#include <sigproc/ringbuffer.hpp>
+#include <sigproc/stats.hpp>
+
+namespace {
+
+constexpr std::array<char, 8> kStatsMagic{'S', 'I', 'G', 'P',
+                                          'S', 'T', 'A', 'T'};
+constexpr uint32_t kStatsVersion = 2;
+
+struct StatsFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    int32_t chunk_len;
+    uint64_t stride_len;
+    uint64_t nsamples;
+    int32_t nbits;
+    uint32_t reserved;
+    uint64_t data_size;
+    int64_t data_mtime;
+};
+
+struct DataStamp {
+    uint64_t size{};
+    int64_t mtime{};
+};
+
+// Total size and latest modification time of the files behind reader, a
+// ring has neither
+DataStamp data_stamp(const FilReader& reader) {
+    DataStamp stamp;
+    for (const auto& source : reader.get_sources()) {
+        if (is_shm_source(source)) {
+            continue;
+        }
+        // Nanoseconds since the Unix epoch, the file clock may start anywhere
+        const auto mtime = std::chrono::file_clock::to_sys(
+            std::filesystem::last_write_time(source));
+        stamp.size += std::filesystem::file_size(source);
+        stamp.mtime = std::max<int64_t>(
+            stamp.mtime, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             mtime.time_since_epoch())
+                             .count());
+    }
+    return stamp;
+}
+
+// Channels handled together by a thread, keeps its sums in registers/L1
+constexpr std::size_t kChannelBlock = 64;
+
+} // namespace
+
+void ChannelStats::merge(const ChannelStats& other) {
+    sum += other.sum;
+    sumsq += other.sumsq;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+}
+
+double ChannelStats::mean() const {
+    return count == 0 ? 0.0 : sum / static_cast<double>(count);
+}
+
+double ChannelStats::stddev() const {
+    if (count == 0) {
+        return 0.0;
+    }
+    const double avg = mean();
+    return std::sqrt(
+        std::max(0.0, sumsq / static_cast<double>(count) - avg * avg));
+}
+
+void accumulate_stats(std::span<const float> block,
+                      std::span<ChannelStats> stats) {
+    const std::size_t stride_len = stats.size();
+    const std::size_t nsamps     = block.size() / stride_len;
+    const std::size_t nblocks =
+        (stride_len + kChannelBlock - 1) / kChannelBlock;
+#pragma omp parallel for
+    for (std::size_t iblock = 0; iblock < nblocks; iblock++) {
+        const std::size_t chan0 = iblock * kChannelBlock;
+        const std::size_t nchan = std::min(kChannelBlock, stride_len - chan0);
+        std::array<double, kChannelBlock> sum{};
+        std::array<double, kChannelBlock> sumsq{};
+        std::array<float, kChannelBlock> min;
+        std::array<float, kChannelBlock> max;
+        min.fill(std::numeric_limits<float>::max());
+        max.fill(std::numeric_limits<float>::lowest());
+        for (std::size_t ii = 0; ii < nsamps; ii++) {
+            const float* row = block.data() + ii * stride_len + chan0;
+            for (std::size_t jj = 0; jj < nchan; jj++) {
+                const double value = row[jj];
+                sum[jj] += value;
+                sumsq[jj] += value * value;
+                min[jj] = std::min(min[jj], row[jj]);
+                max[jj] = std::max(max[jj], row[jj]);
+            }
+        }
+        for (std::size_t jj = 0; jj < nchan; jj++) {
+            stats[chan0 + jj].merge({sum[jj], sumsq[jj], min[jj], max[jj],
+                                     static_cast<uint64_t>(nsamps)});
+        }
+    }
+}
+
+ChunkStatsIndex ChunkStatsIndex::build(FilReader& reader, int chunk_len) {
+    if (chunk_len <= 0) {
+        throw std::invalid_argument("chunk_len must be positive");
+    }
+    ChunkStatsIndex index;
+    index.m_chunk_len  = chunk_len;
+    index.m_stride_len = static_cast<std::size_t>(
+        reader.hdr.get<HeaderKey::kNchans>() *
+        reader.hdr.get<HeaderKey::kNifs>());
+    index.m_nsamples =
+        static_cast<std::size_t>(reader.hdr.get<HeaderKey::kNsamples>());
+    index.m_nbits = reader.hdr.get<HeaderKey::kNbits>();
+    const DataStamp stamp = data_stamp(reader);
+    index.m_data_size     = stamp.size;
+    index.m_data_mtime    = stamp.mtime;
+    index.m_stats.resize(index.nchunks() * index.m_stride_len);
+
+    const BlockLayout old_layout = reader.get_layout();
+    reader.set_layout(BlockLayout::kTimeMajor);
+    reader.seek_sample(0);
+    std::vector<float> block;
+    // One plan block per chunk
+    for (const auto& [iread, block_len, skip] :
+         reader.get_readplan(chunk_len)) {
+        reader.read_plan(block_len, block, skip);
+        accumulate_stats(std::span(block).first(block_len),
+                         std::span(index.m_stats)
+                             .subspan(iread * index.m_stride_len,
+                                      index.m_stride_len));
+    }
+    reader.set_layout(old_layout);
+    return index;
+}
+
+ChunkStatsIndex ChunkStatsIndex::load(const std::string& filename,
+                                      const FilReader& reader) {
+    std::ifstream stream(filename, std::ios::binary);
+    ErrorChecker::check_stream(stream, filename);
+    StatsFileHeader header{};
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!stream || header.magic != kStatsMagic ||
+        header.version != kStatsVersion) {
+        throw std::runtime_error(
+            std::format("{} is not a chunk statistics index", filename));
+    }
+    const auto stride_len = static_cast<std::size_t>(
+        reader.hdr.get<HeaderKey::kNchans>() *
+        reader.hdr.get<HeaderKey::kNifs>());
+    const auto nsamples =
+        static_cast<std::size_t>(reader.hdr.get<HeaderKey::kNsamples>());
+    if (header.stride_len != stride_len || header.nsamples != nsamples ||
+        header.nbits != reader.hdr.get<HeaderKey::kNbits>()) {
+        throw std::runtime_error(
+            std::format("{} does not match the data it indexes", filename));
+    }
+    const DataStamp stamp = data_stamp(reader);
+    if (header.data_size != stamp.size || header.data_mtime != stamp.mtime) {
+        throw std::runtime_error(std::format(
+            "{} is stale, the data changed since it was built", filename));
+    }
+    if (header.chunk_len <= 0) {
+        throw std::runtime_error(
+            std::format("{} has chunks of {} samples", filename,
+                        header.chunk_len));
+    }
+    ChunkStatsIndex index;
+    index.m_chunk_len  = header.chunk_len;
+    index.m_stride_len = stride_len;
+    index.m_nsamples   = nsamples;
+    index.m_nbits      = header.nbits;
+    index.m_data_size  = header.data_size;
+    index.m_data_mtime = header.data_mtime;
+    index.m_stats.resize(index.nchunks() * stride_len);
+    stream.read(reinterpret_cast<char*>(index.m_stats.data()),
+                static_cast<std::streamsize>(index.m_stats.size() *
+                                             sizeof(ChannelStats)));
+    if (!stream) {
+        throw std::runtime_error(std::format("{} is truncated", filename));
+    }
+    return index;
+}
+
+ChunkStatsIndex ChunkStatsIndex::load_or_build(const std::string& filename,
+                                               FilReader& reader,
+                                               int chunk_len) {
+    if (std::filesystem::exists(filename)) {
+        try {
+            ChunkStatsIndex index = load(filename, reader);
+            if (index.chunk_len() == chunk_len) {
+                return index;
+            }
+            fmt::print(stderr,
+                       "Warning: rebuilding index: {} has chunks of {} "
+                       "samples, not {}\n",
+                       filename, index.chunk_len(), chunk_len);
+        } catch (const std::runtime_error& e) {
+            fmt::print(stderr, "Warning: rebuilding index: {}\n", e.what());
+        }
+    }
+    ChunkStatsIndex index = build(reader, chunk_len);
+    index.save(filename);
+    return index;
+}
+
+void ChunkStatsIndex::save(const std::string& filename) const {
+    std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+    ErrorChecker::check_stream(stream, filename);
+    const StatsFileHeader header{kStatsMagic, kStatsVersion, m_chunk_len,
+                                 m_stride_len, m_nsamples,  m_nbits,
+                                 0,           m_data_size, m_data_mtime};
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(m_stats.data()),
+                 static_cast<std::streamsize>(m_stats.size() *
+                                              sizeof(ChannelStats)));
+    ErrorChecker::check_stream(stream, filename);
+}
+
+std::size_t ChunkStatsIndex::nchunks() const {
+    const auto chunk_len = static_cast<std::size_t>(m_chunk_len);
+    return (m_nsamples + chunk_len - 1) / chunk_len;
+}
+
+std::span<const ChannelStats>
+ChunkStatsIndex::chunk(std::size_t ichunk) const {
+    if (ichunk >= nchunks()) {
+        throw std::out_of_range(std::format(
+            "Chunk {} out of range ({} chunks)", ichunk, nchunks()));
+    }
+    return std::span(m_stats).subspan(ichunk * m_stride_len, m_stride_len);
+}
+
+std::vector<ChannelStats> ChunkStatsIndex::query(FilReader& reader,
+                                                 std::size_t start,
+                                                 std::size_t nsamps) const {
+    if (start > m_nsamples) {
+        throw std::out_of_range(std::format(
+            "Start sample {} beyond the end of the data ({} samples)", start,
+            m_nsamples));
+    }
+    if (nsamps == 0 || nsamps > m_nsamples - start) {
+        nsamps = m_nsamples - start;
+    }
+    const auto chunk_len = static_cast<std::size_t>(m_chunk_len);
+    const std::size_t end = start + nsamps;
+    // Whole chunks inside the range; the last chunk may be short and is
+    // whole when the range runs to the end of the data.
+    const std::size_t first_chunk = (start + chunk_len - 1) / chunk_len;
+    const std::size_t last_chunk =
+        end == m_nsamples ? nchunks() : end / chunk_len;
+
+    std::vector<ChannelStats> stats(m_stride_len);
+    if (first_chunk >= last_chunk) {
+        add_raw(reader, start, nsamps, stats);
+        return stats;
+    }
+    add_raw(reader, start, first_chunk * chunk_len - start, stats);
+    for (std::size_t ichunk = first_chunk; ichunk < last_chunk; ichunk++) {
+        const auto summary = chunk(ichunk);
+        for (std::size_t jj = 0; jj < m_stride_len; jj++) {
+            stats[jj].merge(summary[jj]);
+        }
+    }
+    const std::size_t tail = std::min(last_chunk * chunk_len, end);
+    add_raw(reader, tail, end - tail, stats);
+    return stats;
+}
+
+void ChunkStatsIndex::add_raw(FilReader& reader, std::size_t start,
+                              std::size_t nsamps,
+                              std::span<ChannelStats> stats) const {
+    if (nsamps == 0) {
+        return;
+    }
+    const BlockLayout old_layout = reader.get_layout();
+    reader.set_layout(BlockLayout::kTimeMajor);
+    std::vector<float> block;
+    reader.read_block(static_cast<int64_t>(start), static_cast<int>(nsamps),
+                      block);
+    reader.set_layout(old_layout);
+    accumulate_stats(block, stats);
+}
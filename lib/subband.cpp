@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include <sigproc/kernels.hpp>
+#include <sigproc/subband.hpp>
+
+namespace {
+
+// Trials and output samples per tile of the second stage
+constexpr int kDMTile   = 8;
+constexpr int kTimeTile = 1024;
+
+struct SubbandGrid {
+    std::vector<double> coarse_dms;
+    std::vector<int> groups;
+};
+
+/*
+ * Group the trials so that each is within half_step of the coarse DM of its
+ * group, in one pass over the trials sorted by DM.
+ */
+SubbandGrid make_grid(const std::vector<double>& dms, double half_step) {
+    std::vector<std::size_t> order(dms.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, {}, [&](std::size_t idm) { return dms[idm]; });
+
+    SubbandGrid grid;
+    grid.groups.resize(dms.size());
+    std::size_t first = 0;
+    while (first < order.size()) {
+        const double dm_lo = dms[order[first]];
+        std::size_t last   = first;
+        while (last + 1 < order.size() &&
+               dms[order[last + 1]] - dm_lo <= 2 * half_step) {
+            ++last;
+        }
+        for (std::size_t ii = first; ii <= last; ++ii) {
+            grid.groups[order[ii]] = static_cast<int>(grid.coarse_dms.size());
+        }
+        grid.coarse_dms.push_back(0.5 * (dm_lo + dms[order[last]]));
+        first = last + 1;
+    }
+    return grid;
+}
+
+} // namespace
+
+SubbandDedisperser::SubbandDedisperser(const DMPlan& plan, double smearing,
+                                       int nsub)
+    : m_nchans(plan.nchans()) {
+    if (plan.ndms() == 0) {
+        throw std::invalid_argument("Subband dedispersion needs a trial");
+    }
+    if (smearing <= 0) {
+        throw std::invalid_argument(
+            std::format("Smearing budget must be positive, got {}", smearing));
+    }
+    if (nsub < 0 || (nsub > 0 && m_nchans % nsub != 0)) {
+        throw std::invalid_argument(std::format(
+            "{} subbands do not divide {} channels", nsub, m_nchans));
+    }
+    const double scale = kDMConst / plan.tsamp();
+    const auto freq    = [&](int ichan) {
+        return plan.fch1() + ichan * plan.foff();
+    };
+    const auto inv_sq = [](double f) { return 1.0 / (f * f); };
+    // Reference of each subband, its highest channel
+    const auto sub_ref = [&](int isub, int chans_per_sub) {
+        return std::max(freq(isub * chans_per_sub),
+                        freq((isub + 1) * chans_per_sub - 1));
+    };
+
+    // Work per output sample of each candidate
+    const auto ndms    = static_cast<double>(plan.ndms());
+    double best_cost   = std::numeric_limits<double>::max();
+    SubbandGrid grid;
+    for (int candidate = 1; candidate <= m_nchans; ++candidate) {
+        if (m_nchans % candidate != 0 || (nsub > 0 && candidate != nsub)) {
+            continue;
+        }
+        const int chans_per_sub = m_nchans / candidate;
+        double max_span         = 0.0;
+        for (int isub = 0; isub < candidate; ++isub) {
+            const double f_lo = std::min(freq(isub * chans_per_sub),
+                                         freq((isub + 1) * chans_per_sub - 1));
+            max_span = std::max(max_span, scale * (inv_sq(f_lo) -
+                                                   inv_sq(sub_ref(
+                                                       isub, chans_per_sub))));
+        }
+        const double half_step = max_span > 0
+                                     ? smearing / max_span
+                                     : std::numeric_limits<double>::max();
+        auto trial_grid   = make_grid(plan.dms(), half_step);
+        const double cost = static_cast<double>(trial_grid.coarse_dms.size()) *
+                                m_nchans +
+                            ndms * candidate;
+        if (cost < best_cost) {
+            best_cost = cost;
+            m_nsub    = candidate;
+            grid      = std::move(trial_grid);
+        }
+    }
+    m_coarse_dms = std::move(grid.coarse_dms);
+    m_groups     = std::move(grid.groups);
+    m_speedup    = ndms * m_nchans / best_cost;
+
+    // Stage 1: channels relative to the top of their subband
+    const int chans_per_sub = m_nchans / m_nsub;
+    const auto ncoarse      = m_coarse_dms.size();
+    m_delays1.resize(m_nsub * ncoarse * chans_per_sub);
+    for (int isub = 0; isub < m_nsub; ++isub) {
+        const double ref = inv_sq(sub_ref(isub, chans_per_sub));
+        for (std::size_t icoarse = 0; icoarse < ncoarse; ++icoarse) {
+            int32_t* row =
+                m_delays1.data() + (isub * ncoarse + icoarse) * chans_per_sub;
+            for (int ichan = 0; ichan < chans_per_sub; ++ichan) {
+                const double delay =
+                    m_coarse_dms[icoarse] * scale *
+                    (inv_sq(freq(isub * chans_per_sub + ichan)) - ref);
+                row[ichan]   = static_cast<int32_t>(std::lround(delay));
+                m_max_delay1 = std::max(m_max_delay1, row[ichan]);
+            }
+        }
+    }
+    // Stage 2: subbands relative to the reference of the plan
+    const double ref = inv_sq(plan.ref_freq());
+    m_delays2.resize(m_groups.size() * m_nsub);
+    for (std::size_t idm = 0; idm < m_groups.size(); ++idm) {
+        for (int isub = 0; isub < m_nsub; ++isub) {
+            const double delay = plan.dms()[idm] * scale *
+                                 (inv_sq(sub_ref(isub, chans_per_sub)) - ref);
+            const auto shift = static_cast<int32_t>(std::lround(delay));
+            if (shift < 0) {
+                throw std::invalid_argument(
+                    "Subband dedispersion needs non-negative delays");
+            }
+            m_delays2[idm * m_nsub + isub] = shift;
+            m_max_delay2                   = std::max(m_max_delay2, shift);
+        }
+    }
+}
+
+void SubbandDedisperser::execute(std::span<const float> in, int nsamps_in,
+                                 int nifs, std::span<float> out) {
+    const int nsamps_sub = nsamps_in - m_max_delay1;
+    const int nsamps_out = nsamps_in - max_delay();
+    if (nsamps_out <= 0) {
+        throw std::invalid_argument(std::format(
+            "Block of {} samples is shorter than the maximum delay {}",
+            nsamps_in, max_delay()));
+    }
+    if (in.size() < static_cast<std::size_t>(m_nchans) * nifs * nsamps_in ||
+        out.size() < ndms() * nsamps_out) {
+        throw std::invalid_argument(std::format(
+            "Buffers too small for {} rows x {} samples into {} trials",
+            m_nchans * nifs, nsamps_in, ndms()));
+    }
+    const int chans_per_sub = m_nchans / m_nsub;
+    const auto ncoarse      = static_cast<int>(m_coarse_dms.size());
+    const auto sub_size     = static_cast<std::size_t>(ncoarse) * nsamps_sub;
+    if (m_subbands.size() < m_nsub * sub_size) {
+        m_subbands.resize(m_nsub * sub_size);
+    }
+
+    // Stage 1: [nsub][ncoarse][nsamps_sub]
+    const auto delays1 = std::span<const int32_t>(m_delays1);
+    for (int isub = 0; isub < m_nsub; ++isub) {
+        sigproc::shift_add_channels(
+            in, std::span(m_subbands).subspan(isub * sub_size, sub_size),
+            delays1.subspan(static_cast<std::size_t>(isub) * ncoarse *
+                                chans_per_sub,
+                            static_cast<std::size_t>(ncoarse) * chans_per_sub),
+            ncoarse, isub * chans_per_sub, chans_per_sub, m_nchans, nifs,
+            nsamps_in, nsamps_sub);
+    }
+
+    // Stage 2: each trial sums the subbands of its coarse DM
+    const float* subbands  = m_subbands.data();
+    float* outbuf          = out.data();
+    const int32_t* delays2 = m_delays2.data();
+    const int* groups      = m_groups.data();
+    const auto ntrials     = static_cast<int>(ndms());
+    const int nsub         = m_nsub;
+    const int ntrial_tiles = (ntrials + kDMTile - 1) / kDMTile;
+    const int ntime_tiles  = (nsamps_out + kTimeTile - 1) / kTimeTile;
+#pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int trial_tile = 0; trial_tile < ntrial_tiles; ++trial_tile) {
+        for (int time_tile = 0; time_tile < ntime_tiles; ++time_tile) {
+            const int trial0 = trial_tile * kDMTile;
+            const int trial1 = std::min(trial0 + kDMTile, ntrials);
+            const int t0     = time_tile * kTimeTile;
+            const int nt     = std::min(kTimeTile, nsamps_out - t0);
+            for (int itrial = trial0; itrial < trial1; ++itrial) {
+                float* dst =
+                    outbuf + static_cast<int64_t>(itrial) * nsamps_out + t0;
+                const int32_t* shifts =
+                    delays2 + static_cast<int64_t>(itrial) * nsub;
+                std::fill_n(dst, nt, 0.0F);
+                for (int isub = 0; isub < nsub; ++isub) {
+                    const float* src =
+                        subbands +
+                        (static_cast<int64_t>(isub) * ncoarse +
+                         groups[itrial]) *
+                            nsamps_sub +
+                        t0 + shifts[isub];
+#pragma omp simd
+                    for (int t = 0; t < nt; ++t) {
+                        dst[t] += src[t];
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <utility>
+
+#include "sigproc/buffer.hpp"
+
+TEST_CASE("BufferPool reuses released buffers", "[buffer]") {
+    BufferPool pool;
+    for (int iblock = 0; iblock < 10; ++iblock) {
+        PooledBuffer buf = pool.acquire(10000);
+        REQUIRE(buf.size() == 10000);
+        REQUIRE(buf.capacity() >= 10000);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(buf.data()) %
+                    BufferPool::kAlignment ==
+                0);
+    }
+    const PoolStats stats = pool.stats();
+    REQUIRE(stats.nallocs == 1);
+    REQUIRE(stats.nreuses == 9);
+    REQUIRE(stats.bytes_in_use == 0);
+    REQUIRE(stats.peak_bytes == 16384);
+
+    pool.trim();
+    REQUIRE(pool.stats().bytes_reserved == 0);
+    REQUIRE(pool.stats().nfrees == 1);
+}
+
+TEST_CASE("PooledBuffer resize and move", "[buffer]") {
+    BufferPool pool;
+    PooledBuffer buf = pool.acquire(100);
+    uint8_t* data    = buf.data();
+    buf.resize(4000);
+    REQUIRE(buf.data() == data);
+    REQUIRE(buf.as<float>().size() == 1000);
+    buf.resize(5000);
+    REQUIRE(buf.size() == 5000);
+    REQUIRE(pool.stats().nallocs == 2);
+
+    PooledBuffer other = std::move(buf);
+    REQUIRE(buf.data() == nullptr);
+    REQUIRE(other.size() == 5000);
+    other.release();
+    REQUIRE(pool.stats().bytes_in_use == 0);
+}
+
+TEST_CASE("BufferPool huge page buffers", "[buffer]") {
+    BufferPool pool(true);
+    PooledBuffer buf = pool.acquire(BufferPool::kHugePageSize);
+    buf.data()[buf.size() - 1] = 1;
+    REQUIRE(buf.capacity() == BufferPool::kHugePageSize);
+}
@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "sigproc/catalogue.hpp"
+#include "sigproc/header.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void write_header(const fs::path& path, const std::string& source,
+                  double fch1, double tstart) {
+    SigprocHeader hdr;
+    hdr.set<HeaderKey::kSourceName>(source);
+    hdr.set<HeaderKey::kNchans>(64);
+    hdr.set<HeaderKey::kNbits>(8);
+    hdr.set<HeaderKey::kNifs>(1);
+    hdr.set<HeaderKey::kFch1>(fch1);
+    hdr.set<HeaderKey::kFoff>(-1.0);
+    hdr.set<HeaderKey::kTsamp>(1.0);
+    hdr.set<HeaderKey::kTstart>(tstart);
+    hdr.set<HeaderKey::kNsamples>(int64_t{8640});
+    hdr.tofile(path.string());
+}
+
+} // namespace
+
+TEST_CASE("HeaderCatalogue scans and caches headers", "[catalogue]") {
+    const fs::path root  = "test_catalogue_dir";
+    const auto cache     = (root / "cache.bin").string();
+    fs::remove_all(root);
+    fs::create_directories(root / "sub");
+    write_header(root / "a.fil", "J0001", 1400.0, 60000.0);
+    write_header(root / "sub" / "b.fil", "J0002", 800.0, 60001.0);
+    std::ofstream(root / "junk.fil") << "not a filterbank";
+    std::ofstream(root / "notes.txt") << "ignored";
+
+    auto catalogue = HeaderCatalogue::load(cache);
+    REQUIRE(catalogue.entries().empty());
+    auto stats = catalogue.scan({root.string()}, 2);
+    REQUIRE(stats.nfiles == 3);
+    REQUIRE(stats.nparsed == 3);
+    REQUIRE(stats.nfailed == 1);
+    catalogue.save(cache);
+
+    const auto& entries = catalogue.entries();
+    REQUIRE(entries[0].path == (root / "a.fil").string());
+    REQUIRE(entries[0].source_name == "J0001");
+    REQUIRE(entries[0].covers_freq(1380.0));
+    REQUIRE_FALSE(entries[0].covers_freq(1401.0));
+    REQUIRE(entries[0].covers_mjd(60000.05));
+    REQUIRE_FALSE(entries[0].covers_mjd(60001.5));
+    REQUIRE_FALSE(entries[1].valid);
+
+    SECTION("unchanged files come from the cache") {
+        auto reloaded = HeaderCatalogue::load(cache);
+        REQUIRE(reloaded.entries().size() == 3);
+        write_header(root / "c.fil", "J0003", 400.0, 60002.0);
+        // Make the change visible on filesystems with coarse timestamps
+        fs::last_write_time(root / "sub" / "b.fil",
+                            fs::last_write_time(root / "sub" / "b.fil") +
+                                std::chrono::seconds(2));
+        stats = reloaded.scan({root.string()}, 2);
+        REQUIRE(stats.nfiles == 4);
+        REQUIRE(stats.ncached == 2);
+        REQUIRE(stats.nparsed == 2);
+        REQUIRE(reloaded.entries()[1].source_name == "J0003");
+
+        std::ostringstream csv;
+        HeaderCatalogue::write_csv(csv, reloaded.entries());
+        REQUIRE(csv.str().find("J0003") != std::string::npos);
+        REQUIRE(csv.str().find("junk.fil") == std::string::npos);
+    }
+    fs::remove_all(root);
+}
@@ -0,0 +1,161 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "sigproc/compress.hpp"
+#include "sigproc/io.hpp"
+
+namespace {
+
+// Noise around a per-channel level, like digitised filterbank data
+std::vector<uint8_t> make_noise(std::size_t nsamps, std::size_t stride_size,
+                                double sigma) {
+    std::mt19937 gen(42);
+    std::normal_distribution<double> dist(0.0, sigma);
+    std::vector<uint8_t> data(nsamps * stride_size);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        const double level = 64.0 + static_cast<double>(ii % stride_size);
+        data[ii]           = static_cast<uint8_t>(
+            std::clamp(std::round(level + dist(gen)), 0.0, 255.0));
+    }
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("compress_chunk round trips", "[compress]") {
+    const std::size_t stride_size = 128;
+    const int nbits               = GENERATE(1, 2, 4, 8, 16, 32);
+    auto data                     = make_noise(1000, stride_size, 4.0);
+    const auto packed = sigproc::compress_chunk(data, nbits, stride_size);
+    std::vector<uint8_t> decoded(data.size());
+    sigproc::decompress_chunk(packed, decoded, nbits, stride_size);
+    REQUIRE(decoded == data);
+}
+
+TEST_CASE("compress_chunk shrinks 8-bit noise", "[compress]") {
+    const std::size_t stride_size = 256;
+    auto data          = make_noise(4096, stride_size, 3.0);
+    const auto packed  = sigproc::compress_chunk(data, 8, stride_size);
+    REQUIRE(packed.size() * 2 < data.size());
+    std::vector<uint8_t> decoded(data.size());
+    sigproc::decompress_chunk(packed, decoded, 8, stride_size);
+    REQUIRE(decoded == data);
+}
+
+TEST_CASE("compress_chunk stores incompressible data", "[compress]") {
+    std::mt19937 gen(7);
+    std::vector<uint8_t> data(10000);
+    for (auto& value : data) {
+        value = static_cast<uint8_t>(gen());
+    }
+    const auto packed = sigproc::compress_chunk(data, 8, 100);
+    REQUIRE(packed.size() == data.size() + 1);
+    std::vector<uint8_t> decoded(data.size());
+    sigproc::decompress_chunk(packed, decoded, 8, 100);
+    REQUIRE(decoded == data);
+}
+
+TEST_CASE("decompress_chunk rejects corrupt input", "[compress]") {
+    auto data   = make_noise(100, 64, 2.0);
+    auto packed = sigproc::compress_chunk(data, 8, 64);
+    std::vector<uint8_t> decoded(data.size());
+    packed.resize(packed.size() / 2);
+    REQUIRE_THROWS_AS(sigproc::decompress_chunk(packed, decoded, 8, 64),
+                      std::runtime_error);
+}
+
+TEST_CASE("CompressedFilterbankWriter round trips through FilReader",
+          "[compress]") {
+    const std::string plain_name = "test_compress_plain.fil";
+    const std::string zname      = "test_compress_chunks.fil";
+    const int nchans             = 24;
+    // Ten whole chunks of 100 samples and a partial one
+    const int nsamples           = 1037;
+    const std::size_t chunk_len  = 100;
+    const int nbits              = GENERATE(2, 8, 16);
+    SigprocHeader hdr;
+    hdr.set("nbits", nbits);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    std::mt19937 gen(11);
+    std::normal_distribution<double> dist(0.0, 2.0);
+    const double level = nbits == 2 ? 1.5 : 40.0;
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamples);
+    for (auto& value : data) {
+        value = static_cast<float>(
+            std::clamp(std::round(level + dist(gen)), 0.0, (1 << nbits) - 1.0));
+    }
+    {
+        FilterbankWriter plain(plain_name, hdr);
+        CompressedFilterbankWriter writer(zname, hdr, chunk_len);
+        // Blocks that do not line up with the chunks
+        for (int start = 0; start < nsamples; start += 33) {
+            const int nsamps = std::min(33, nsamples - start);
+            const auto block = std::span<const float>(data).subspan(
+                static_cast<std::size_t>(start) * nchans,
+                static_cast<std::size_t>(nsamps) * nchans);
+            plain.write_block(block, nsamps * nchans);
+            writer.write_block(block, nsamps * nchans);
+        }
+        writer.close();
+        plain.close();
+    }
+    FilReader expected(plain_name);
+    FilReader reader(zname);
+    REQUIRE(reader.hdr.get<HeaderKey::kNsamples>() == nsamples);
+    std::vector<float> lhs;
+    std::vector<float> rhs;
+
+    SECTION("random blocks") {
+        std::uniform_int_distribution<int> pick_start(0, nsamples - 1);
+        for (int iblock = 0; iblock < 200; ++iblock) {
+            const int start  = pick_start(gen);
+            const int nsamps = std::uniform_int_distribution<int>(
+                1, std::min(250, nsamples - start))(gen);
+            expected.read_block(start, nsamps, lhs);
+            reader.read_block(start, nsamps, rhs);
+            REQUIRE(rhs == lhs);
+        }
+        // Backwards over the same chunk, then the last partial chunk
+        for (const int start : {150, 120, 101, 99, 1000, 1036}) {
+            expected.read_block(start, 1, lhs);
+            reader.read_block(start, 1, rhs);
+            REQUIRE(rhs == lhs);
+        }
+    }
+    SECTION("overlapping read plan") {
+        const int gulp     = GENERATE(37, 100, 256);
+        const int skipback = gulp / 3;
+        const auto plan    = reader.get_readplan(gulp, skipback);
+        REQUIRE(plan == expected.get_readplan(gulp, skipback));
+        for (const auto& [iread, block_len, skip] : plan) {
+            REQUIRE(skip <= 0);
+            expected.read_plan(block_len, lhs, skip);
+            reader.read_plan(block_len, rhs, skip);
+            REQUIRE(rhs == lhs);
+        }
+    }
+    SECTION("sequential reads straddling chunks") {
+        // Reads smaller than a chunk go through the partial-chunk cache
+        const int nsamps = GENERATE(1, 7, 61, 150);
+        std::vector<float> out(static_cast<std::size_t>(nsamps) * nchans);
+        int64_t nread = 0;
+        while (const int64_t got = reader.read_samples(out)) {
+            const auto offset = static_cast<std::ptrdiff_t>(nread) * nchans;
+            REQUIRE(std::equal(out.begin(), out.begin() + got * nchans,
+                               data.begin() + offset));
+            nread += got;
+        }
+        REQUIRE(nread == nsamples);
+    }
+    std::remove(plain_name.c_str());
+    std::remove(zname.c_str());
+}
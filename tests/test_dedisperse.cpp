@@ -0,0 +1,126 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sigproc/dedisperse.hpp"
+#include "sigproc/io.hpp"
+
+namespace {
+
+SigprocHeader make_header(int nchans, int nifs, int nsamples,
+                          double foff = -2.0) {
+    SigprocHeader hdr;
+    hdr.set("nbits", 8);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", nifs);
+    hdr.set("nsamples", nsamples);
+    hdr.set("fch1", 1500.0);
+    hdr.set("foff", foff);
+    hdr.set("tsamp", 256e-6);
+    return hdr.new_header(std::map<std::string, int>{{"nbits", 8}});
+}
+
+// Small integers, so sums are exact in any order
+std::vector<float> make_data(std::size_t size) {
+    std::vector<float> data(size);
+    for (std::size_t ii = 0; ii < size; ++ii) {
+        data[ii] = static_cast<float>((ii * 7919 + ii / 13) % 251);
+    }
+    return data;
+}
+
+// Reference: sum channel-major rows at their delays
+std::vector<float> naive_dedisperse(const DMPlan& plan,
+                                    const std::vector<float>& in,
+                                    int nsamps_in, int nifs) {
+    const int nchans     = plan.nchans();
+    const int nsamps_out = nsamps_in - plan.max_delay();
+    std::vector<float> out(plan.ndms() * nsamps_out, 0.0F);
+    for (std::size_t idm = 0; idm < plan.ndms(); ++idm) {
+        const auto delays = plan.delays(idm);
+        for (int row = 0; row < nchans * nifs; ++row) {
+            for (int t = 0; t < nsamps_out; ++t) {
+                out[idm * nsamps_out + t] +=
+                    in[row * nsamps_in + t + delays[row % nchans]];
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("dedisperse_brute matches the direct sum", "[dedisperse]") {
+    const int nchans = 64;
+    const int nifs   = GENERATE(1, 2);
+    const int nsamps = 3000;
+    // descending and ascending bands
+    const double foff = GENERATE(-2.0, 2.0);
+    const auto hdr    = make_header(nchans, nifs, nsamps, foff);
+    // more trials and samples than one tile, with partial tiles
+    const auto dms = DMPlan::generate_dm_list(hdr, 0.0, 60.0);
+    REQUIRE(dms.size() > 8);
+    const DMPlan plan(hdr, dms);
+    const auto in = make_data(static_cast<std::size_t>(nchans) * nifs * nsamps);
+
+    const int nsamps_out = nsamps - plan.max_delay();
+    std::vector<float> out(plan.ndms() * nsamps_out, -1.0F);
+    dedisperse_brute(plan, in, nsamps, nifs, out);
+    REQUIRE(out == naive_dedisperse(plan, in, nsamps, nifs));
+
+    REQUIRE_THROWS_AS(dedisperse_brute(plan, in, plan.max_delay(), nifs, out),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(dedisperse_brute(plan, std::span(in).first(100), nsamps,
+                                       nifs, out),
+                      std::invalid_argument);
+    const DMPlan centred(hdr, dms, "center");
+    REQUIRE_THROWS_AS(dedisperse_brute(centred, in, nsamps, nifs, out),
+                      std::invalid_argument);
+}
+
+TEST_CASE("dedisperse_stream matches one whole block", "[dedisperse]") {
+    const std::string filename = "test_dedisperse.fil";
+    const int nchans           = 32;
+    const int nsamps           = 5000;
+    const auto hdr             = make_header(nchans, 1, nsamps);
+    // time-major 8-bit data
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamps);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>((ii * 31 + ii / 7) % 256);
+    }
+    {
+        FilterbankWriter writer(filename, hdr);
+        writer.write_block(data, static_cast<int>(data.size()));
+        writer.close();
+    }
+    std::vector<float> turned(data.size());
+    for (int t = 0; t < nsamps; ++t) {
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            turned[ichan * nsamps + t] = data[t * nchans + ichan];
+        }
+    }
+    const DMPlan plan(hdr, DMPlan::generate_dm_list(hdr, 0.0, 100.0));
+    const auto expected = naive_dedisperse(plan, turned, nsamps, 1);
+    const int nsamps_out = nsamps - plan.max_delay();
+
+    FilReader reader(filename);
+    std::vector<float> out(expected.size(), -1.0F);
+    int64_t next_sample = 0;
+    const int64_t ndone = dedisperse_stream(
+        reader, plan, 700,
+        [&](std::span<const float> block, int64_t start_sample, int nout) {
+            REQUIRE(start_sample == next_sample);
+            for (std::size_t idm = 0; idm < plan.ndms(); ++idm) {
+                std::copy_n(block.begin() + idm * nout, nout,
+                            out.begin() + idm * nsamps_out + start_sample);
+            }
+            next_sample += nout;
+        });
+    REQUIRE(ndone == nsamps_out);
+    REQUIRE(out == expected);
+    REQUIRE(reader.get_layout() == BlockLayout::kTimeMajor);
+    std::remove(filename.c_str());
+}
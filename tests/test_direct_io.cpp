@@ -0,0 +1,150 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include "sigproc/direct_io.hpp"
+#include "sigproc/io.hpp"
+
+namespace {
+
+// Bytes that differ at every offset within a few pages
+std::vector<uint8_t> write_bytes(const std::string& filename,
+                                 std::size_t size) {
+    std::vector<uint8_t> bytes(size);
+    for (std::size_t ii = 0; ii < size; ++ii) {
+        bytes[ii] = static_cast<uint8_t>((ii * 7 + ii / 4093) % 251);
+    }
+    std::ofstream stream(filename, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(bytes.data()),
+                 static_cast<std::streamsize>(size));
+    return bytes;
+}
+
+// Filterbank whose value encodes (sample, channel)
+std::vector<float> write_ramp(const std::string& filename, int nchans,
+                              int nsamples, int first) {
+    SigprocHeader hdr;
+    hdr.set("nbits", 8);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("nsamples", nsamples);
+    hdr.set("tsamp", 1.0);
+    hdr.set("tstart", first / 86400.0);
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamples);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>(
+            ((ii / nchans + first) * 3 + ii % nchans) % 256);
+    }
+    FilterbankWriter writer(filename, hdr);
+    writer.write_block(data, static_cast<int>(data.size()));
+    writer.close();
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("read_engine_from_string names every engine", "[direct_io]") {
+    REQUIRE(read_engine_from_string("buffered") == ReadEngine::kBuffered);
+    REQUIRE(read_engine_from_string("direct") == ReadEngine::kDirect);
+    REQUIRE(read_engine_from_string("uring") == ReadEngine::kUring);
+    REQUIRE_THROWS_AS(read_engine_from_string("aio"), std::invalid_argument);
+}
+
+TEST_CASE("DirectReader reads any offset and length", "[direct_io]") {
+    const std::string filename = "test_direct_io_read.bin";
+    // Not a multiple of the alignment, the last chunk is short
+    const std::size_t size = 3 * 65536 + 1234;
+    const auto bytes       = write_bytes(filename, size);
+    const auto engine = GENERATE(ReadEngine::kDirect, ReadEngine::kUring);
+    // Small chunks and queue so one read keeps the queue full
+    DirectReader reader(filename, engine, 4, 8192);
+    if (reader.engine() != engine) {
+        // io_uring is not available here, kDirect covers the fallback
+        std::remove(filename.c_str());
+        return;
+    }
+    REQUIRE(reader.size() == size);
+
+    const auto [offset, length] =
+        GENERATE(std::tuple<std::size_t, std::size_t>{0, 4096},
+                 std::tuple<std::size_t, std::size_t>{1, 1},
+                 std::tuple<std::size_t, std::size_t>{4095, 2},
+                 std::tuple<std::size_t, std::size_t>{777, 100000},
+                 std::tuple<std::size_t, std::size_t>{0, 3 * 65536 + 1234},
+                 std::tuple<std::size_t, std::size_t>{196000, 10000});
+    std::vector<uint8_t> buffer(length, 0xFF);
+    const std::size_t expected = std::min(length, size - offset);
+    REQUIRE(reader.pread(offset, buffer) == expected);
+    REQUIRE(std::equal(buffer.begin(), buffer.begin() + expected,
+                       bytes.begin() + offset));
+    // Nothing to read at or past the end
+    REQUIRE(reader.pread(size, buffer) == 0);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("DirectReader moves on to other files", "[direct_io]") {
+    const std::string first  = "test_direct_io_first.bin";
+    const std::string second = "test_direct_io_second.bin";
+    const auto bytes1        = write_bytes(first, 20000);
+    const auto bytes2        = write_bytes(second, 50001);
+    const auto engine = GENERATE(ReadEngine::kDirect, ReadEngine::kUring);
+    DirectReader reader(first, engine, 2, 4096);
+    std::vector<uint8_t> buffer(bytes1.size());
+    REQUIRE(reader.pread(0, buffer) == bytes1.size());
+    REQUIRE(buffer == bytes1);
+
+    reader.open(second);
+    REQUIRE(reader.size() == bytes2.size());
+    buffer.assign(bytes2.size(), 0);
+    REQUIRE(reader.pread(0, buffer) == bytes2.size());
+    REQUIRE(buffer == bytes2);
+    // A failed open leaves no file to read
+    REQUIRE_THROWS_AS(reader.open("test_direct_io_missing.bin"),
+                      std::system_error);
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+}
+
+TEST_CASE("FilReader streams files with every engine", "[direct_io]") {
+    const int nchans   = 16;
+    const int nsamples = 5000;
+    const int nfiles   = 3;
+    std::vector<std::string> filenames;
+    std::vector<float> data;
+    for (int ifile = 0; ifile < nfiles; ++ifile) {
+        filenames.push_back(std::format("test_direct_io_{}.fil", ifile));
+        const auto part =
+            write_ramp(filenames.back(), nchans, nsamples, ifile * nsamples);
+        data.insert(data.end(), part.begin(), part.end());
+    }
+    const auto engine = GENERATE(ReadEngine::kBuffered, ReadEngine::kDirect,
+                                 ReadEngine::kUring);
+    FilReader reader(filenames, false, engine);
+    REQUIRE(reader.hdr.get<HeaderKey::kNsamples>() == nfiles * nsamples);
+
+    // Blocks that straddle each file boundary, and the whole stream
+    std::vector<float> block;
+    for (const int64_t start : {0, nsamples - 100, 2 * nsamples - 1}) {
+        reader.read_block(start, 1000, block);
+        REQUIRE(std::equal(block.begin(), block.end(),
+                           data.begin() + start * nchans));
+    }
+    reader.read_block(0, nfiles * nsamples, block);
+    REQUIRE(block == data);
+    // Back to the first file after the last
+    reader.read_block(10, 20, block);
+    REQUIRE(std::equal(block.begin(), block.end(),
+                       data.begin() + 10 * nchans));
+    for (const auto& filename : filenames) {
+        std::remove(filename.c_str());
+    }
+}
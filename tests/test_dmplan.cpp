@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sigproc/dmplan.hpp"
+
+namespace {
+
+SigprocHeader make_header(double fch1 = 1500.0, double foff = -1.0) {
+    SigprocHeader hdr;
+    hdr.set<HeaderKey::kNchans>(256);
+    hdr.set<HeaderKey::kFch1>(fch1);
+    hdr.set<HeaderKey::kFoff>(foff);
+    hdr.set<HeaderKey::kTsamp>(64e-6);
+    // derived keys, e.g. ftop
+    return hdr.new_header(std::map<std::string, int>{{"nbits", 8}});
+}
+
+} // namespace
+
+TEST_CASE("DMPlan delay table", "[dmplan]") {
+    const auto hdr = make_header();
+    const std::vector<double> dms{0.0, 10.0, 100.0, 500.0};
+    const DMPlan plan(hdr, dms);
+    REQUIRE(plan.ndms() == dms.size());
+    REQUIRE(plan.table().size() == dms.size() * 256);
+    REQUIRE(plan.ref_freq() == Approx(1500.5));
+
+    for (std::size_t idm = 0; idm < dms.size(); ++idm) {
+        const auto delays = hdr.get_dm_delays(dms[idm], "top");
+        const auto row    = plan.delays(idm);
+        for (int ichan = 0; ichan < 256; ++ichan) {
+            REQUIRE(std::abs(row[ichan] - delays[ichan] / 64e-6) <= 0.51);
+        }
+    }
+    // lowest channel of the largest DM
+    REQUIRE(plan.max_delay() == plan.delays(3)[255]);
+    REQUIRE(plan.delays(0)[255] == 0);
+    REQUIRE_THROWS_AS(plan.delays(4), std::out_of_range);
+}
+
+TEST_CASE("DMPlan of an ascending band", "[dmplan]") {
+    // fch1 is the lowest channel, the top of the band is past channel 255
+    const auto hdr = make_header(1245.0, 1.0);
+    REQUIRE(hdr.get_ref_freq("top") == Approx(1500.5));
+    const std::vector<double> dms{0.0, 100.0, 500.0};
+    const DMPlan plan(hdr, dms);
+    REQUIRE(plan.ref_freq() == Approx(1500.5));
+    for (std::size_t idm = 0; idm < dms.size(); ++idm) {
+        const auto row = plan.delays(idm);
+        REQUIRE(std::ranges::min(row) >= 0);
+        REQUIRE(std::ranges::is_sorted(row, std::greater<>()));
+    }
+    REQUIRE(plan.delays(0)[0] == 0);
+    REQUIRE(plan.max_delay() == plan.delays(2)[0]);
+    // the same channels in descending order
+    REQUIRE(plan.max_delay() == DMPlan(make_header(), dms).max_delay());
+}
+
+TEST_CASE("DMPlan grid from smearing tolerances", "[dmplan]") {
+    const auto hdr = make_header();
+    const auto dms = DMPlan::generate_dm_list(hdr, 0.0, 1000.0);
+    REQUIRE(dms.front() == 0.0);
+    REQUIRE(dms.back() >= 1000.0);
+    for (std::size_t idm = 1; idm < dms.size(); ++idm) {
+        REQUIRE(dms[idm] > dms[idm - 1]);
+    }
+    // coarser steps at high DM, where channel smearing dominates
+    REQUIRE(dms[dms.size() - 1] - dms[dms.size() - 2] > dms[1] - dms[0]);
+    const auto finer = DMPlan::generate_dm_list(hdr, 0.0, 1000.0, 40e-6, 1.1);
+    REQUIRE(finer.size() > dms.size());
+    REQUIRE_THROWS_AS(DMPlan::generate_dm_list(hdr, 0.0, 10.0, 40e-6, 1.0),
+                      std::invalid_argument);
+}
+
+TEST_CASE("DMPlan is cached to disk", "[dmplan]") {
+    const std::string filename = "test_dmplan.plan";
+    const auto hdr = make_header();
+    const auto dms = DMPlan::generate_dm_list(hdr, 0.0, 200.0);
+    const auto plan = DMPlan::load_or_build(filename, hdr, dms);
+    const auto loaded = DMPlan::load(filename);
+    REQUIRE(loaded.dms() == plan.dms());
+    REQUIRE(std::equal(loaded.table().begin(), loaded.table().end(),
+                       plan.table().begin(), plan.table().end()));
+    REQUIRE(loaded.max_delay() == plan.max_delay());
+
+    // other trials rebuild the plan
+    const std::vector<double> other{1.0, 2.0};
+    const auto rebuilt = DMPlan::load_or_build(filename, hdr, other);
+    REQUIRE(rebuilt.ndms() == 2);
+    REQUIRE(DMPlan::load(filename).ndms() == 2);
+    std::remove(filename.c_str());
+}
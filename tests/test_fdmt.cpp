@@ -0,0 +1,102 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sigproc/dedisperse.hpp"
+#include "sigproc/fdmt.hpp"
+
+namespace {
+
+SigprocHeader make_header(int nchans, double foff) {
+    SigprocHeader hdr;
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("fch1", foff < 0 ? 400.0 : 400.0 - (nchans - 1) * foff);
+    hdr.set("foff", foff);
+    hdr.set("tsamp", 1e-3);
+    return hdr.new_header(std::map<std::string, int>{{"nbits", 8}});
+}
+
+// Channel-major block with a pulse at sample t0 of the top of the band
+std::vector<float> make_pulse(const SigprocHeader& hdr, double dm, int t0,
+                              int nsamps) {
+    const int nchans   = hdr.get<HeaderKey::kNchans>();
+    const double ftop  = hdr.get_ref_freq("top");
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamps, 0.0F);
+    for (int ichan = 0; ichan < nchans; ++ichan) {
+        const double freq = hdr.get<HeaderKey::kFch1>() +
+                            ichan * hdr.get<HeaderKey::kFoff>();
+        const double delay = kDMConst * dm *
+                             (1.0 / (freq * freq) - 1.0 / (ftop * ftop)) /
+                             hdr.get<HeaderKey::kTsamp>();
+        data[ichan * nsamps + t0 + std::lround(delay)] = 1.0F;
+    }
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("FDMT native DM grid", "[fdmt]") {
+    const auto hdr = make_header(64, -1.0);
+    const auto dms = FDMT::dm_list(hdr, 0.0, 50.0);
+    REQUIRE(dms.front() == 0.0);
+    REQUIRE(dms.back() >= 50.0);
+    const DMPlan plan(hdr, dms);
+    const FDMT fdmt(plan);
+    REQUIRE(fdmt.ndms() == dms.size());
+    // one trial per sample of delay across the band
+    const auto rows = fdmt.trial_delays();
+    for (std::size_t idm = 0; idm < rows.size(); ++idm) {
+        REQUIRE(rows[idm] == static_cast<int>(idm));
+    }
+    REQUIRE(fdmt.max_delay() == rows.back());
+    REQUIRE(fdmt.max_delay() >= plan.max_delay());
+    REQUIRE_THROWS_AS(FDMT::dm_list(hdr, 10.0, 5.0), std::invalid_argument);
+}
+
+TEST_CASE("FDMT zero DM is the channel sum", "[fdmt]") {
+    const int nchans = GENERATE(64, 48);
+    const int nsamps = 512;
+    const auto hdr   = make_header(nchans, -1.0);
+    const DMPlan plan(hdr, FDMT::dm_list(hdr, 0.0, 20.0));
+    FDMT fdmt(plan);
+    std::vector<float> in(static_cast<std::size_t>(nchans) * nsamps);
+    for (std::size_t ii = 0; ii < in.size(); ++ii) {
+        in[ii] = static_cast<float>((ii * 7919) % 97);
+    }
+    const int nsamps_out = nsamps - fdmt.max_delay();
+    std::vector<float> fast(fdmt.ndms() * nsamps_out);
+    std::vector<float> brute(plan.ndms() * (nsamps - plan.max_delay()));
+    fdmt.execute(in, nsamps, 1, fast);
+    dedisperse_brute(plan, in, nsamps, 1, brute);
+    REQUIRE(std::equal(fast.begin(), fast.begin() + nsamps_out,
+                       brute.begin()));
+}
+
+TEST_CASE("FDMT recovers a dispersed pulse", "[fdmt]") {
+    const int nchans  = GENERATE(128, 96);
+    const double foff = GENERATE(-0.5, 0.5);
+    const int nsamps  = 2048;
+    const int t0      = 300;
+    const auto hdr    = make_header(nchans, foff);
+    const auto dms    = FDMT::dm_list(hdr, 0.0, 40.0);
+    const DMPlan plan(hdr, dms);
+    FDMT fdmt(plan);
+    const std::size_t itrue = dms.size() * 2 / 3;
+    const auto in = make_pulse(hdr, dms[itrue], t0, nsamps);
+
+    const int nsamps_out = nsamps - fdmt.max_delay();
+    std::vector<float> out(fdmt.ndms() * nsamps_out);
+    fdmt.execute(in, nsamps, 1, out);
+    const auto peak = std::ranges::max_element(out) - out.begin();
+    REQUIRE(std::abs(static_cast<int>(peak / nsamps_out) -
+                     static_cast<int>(itrue)) <= 1);
+    REQUIRE(std::abs(static_cast<int>(peak % nsamps_out) - t0) <= 1);
+    // nearly every channel adds up at the right trial
+    REQUIRE(out[peak] >= 0.9F * nchans);
+    REQUIRE(out[peak] <= static_cast<float>(nchans));
+}
@@ -0,0 +1,135 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <numbers>
+#include <string>
+#include <vector>
+
+#include "sigproc/fft.hpp"
+
+namespace {
+
+// |DFT|^2 of one series, the reference for the FFTs
+std::vector<double> naive_power(std::span<const float> series) {
+    const auto n = static_cast<int>(series.size());
+    std::vector<double> power(n / 2 + 1);
+    for (int k = 0; k <= n / 2; ++k) {
+        double re = 0.0;
+        double im = 0.0;
+        for (int t = 0; t < n; ++t) {
+            const double phase = -2.0 * std::numbers::pi * k * t / n;
+            re += series[t] * std::cos(phase);
+            im += series[t] * std::sin(phase);
+        }
+        power[k] = re * re + im * im;
+    }
+    return power;
+}
+
+} // namespace
+
+TEST_CASE("PowerSpectrum matches the DFT", "[fft]") {
+    const int n       = 64;
+    const int howmany = 3;
+    FFTPlanManager manager;
+    PowerSpectrum spectrum(n, howmany, 1, manager);
+    REQUIRE(spectrum.nbins() == n / 2 + 1);
+
+    // one spare value in front, so in + 1 is not aligned
+    std::vector<float> in(n * howmany + 1);
+    for (int iseries = 0; iseries < howmany; ++iseries) {
+        for (int t = 0; t < n; ++t) {
+            in[1 + iseries * n + t] = static_cast<float>(
+                std::cos(2.0 * std::numbers::pi * (iseries + 3) * t / n) +
+                0.1 * iseries);
+        }
+    }
+    const auto series = std::span<const float>(in).subspan(1);
+    std::vector<float> power(spectrum.nbins() * howmany);
+    spectrum.compute(series, power);
+    std::vector<double> sums(power.size(), 1.0);
+    spectrum.accumulate(series, sums);
+
+    for (int iseries = 0; iseries < howmany; ++iseries) {
+        const auto expected = naive_power(series.subspan(iseries * n, n));
+        for (int k = 0; k < spectrum.nbins(); ++k) {
+            const auto ii = iseries * spectrum.nbins() + k;
+            REQUIRE(power[ii] == Approx(expected[k]).margin(1e-3));
+            REQUIRE(sums[ii] == Approx(expected[k] + 1.0).margin(1e-3));
+        }
+        // the tone of each series
+        const auto row  = std::span(power).subspan(
+            iseries * spectrum.nbins(), spectrum.nbins());
+        const auto peak = std::ranges::max_element(row.subspan(1)) -
+                          row.begin();
+        REQUIRE(peak == iseries + 3);
+    }
+    REQUIRE_THROWS_AS(spectrum.compute(std::span(in).first(10), power),
+                      std::invalid_argument);
+}
+
+TEST_CASE("FFTPlanManager caches plans and wisdom", "[fft]") {
+    const std::string wisdom = "test_fft.wisdom";
+    std::filesystem::remove(wisdom);
+    {
+        FFTPlanManager manager;
+        manager.set_effort(FFTEffort::kEstimate);
+        REQUIRE_FALSE(manager.set_wisdom_file(wisdom));
+        const auto plan = manager.r2c(128, 4, 1);
+        REQUIRE(manager.r2c(128, 4, 1) == plan);
+        REQUIRE(manager.nplans() == 1);
+        manager.r2c(128, 4, 2);
+        manager.r2c(256, 4, 1);
+        REQUIRE(manager.nplans() == 3);
+        REQUIRE_THROWS_AS(manager.r2c(1, 1, 1), std::invalid_argument);
+        manager.save_wisdom();
+        REQUIRE(std::filesystem::exists(wisdom));
+    }
+    FFTPlanManager manager;
+    REQUIRE(manager.set_wisdom_file(wisdom));
+    std::filesystem::remove(wisdom);
+}
+
+TEST_CASE("channel_spectra averages every channel", "[fft]") {
+    const std::string filename = "test_fft.fil";
+    const int nchans           = 4;
+    const int nsamples         = 1000;
+    const int nfft             = 128;
+    SigprocHeader hdr;
+    hdr.set("nbits", 32);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("nsamples", nsamples);
+    // a tone at bin 2 * (chan + 1) of each channel
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamples);
+    for (int t = 0; t < nsamples; ++t) {
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            data[t * nchans + ichan] = static_cast<float>(std::sin(
+                2.0 * std::numbers::pi * 2 * (ichan + 1) * t / nfft));
+        }
+    }
+    {
+        FilterbankWriter writer(filename, hdr);
+        writer.write_block(data, static_cast<int>(data.size()));
+        writer.close();
+    }
+
+    FilReader reader(filename);
+    const auto spectra = channel_spectra(reader, nfft, 1);
+    REQUIRE(spectra.nrows == nchans);
+    REQUIRE(spectra.nblocks == nsamples / nfft);
+    const int nbins = nfft / 2 + 1;
+    REQUIRE(spectra.power.size() == static_cast<std::size_t>(nchans) * nbins);
+    for (int ichan = 0; ichan < nchans; ++ichan) {
+        const auto row = std::span(spectra.power).subspan(ichan * nbins, nbins);
+        const auto peak = std::ranges::max_element(row) - row.begin();
+        REQUIRE(peak == 2 * (ichan + 1));
+        // a full-amplitude sine has power (n / 2)^2
+        REQUIRE(row[peak] == Approx(nfft * nfft / 4.0).epsilon(1e-3));
+    }
+    REQUIRE(reader.get_layout() == BlockLayout::kTimeMajor);
+    std::remove(filename.c_str());
+}
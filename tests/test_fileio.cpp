@@ -0,0 +1,183 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sigproc/fileIO.hpp"
+
+namespace {
+
+// Write a file with a dummy header of hdrlen bytes followed by data.
+FileInfo write_chunk(const std::string& filename, std::size_t hdrlen,
+                     const std::vector<uint8_t>& data) {
+    std::ofstream stream(filename, std::ios::binary);
+    const std::string header(hdrlen, 'H');
+    stream.write(header.data(), static_cast<std::streamsize>(header.size()));
+    stream.write(reinterpret_cast<const char*>(data.data()),
+                 static_cast<std::streamsize>(data.size()));
+    return {filename, hdrlen, data.size()};
+}
+
+} // namespace
+
+TEST_CASE("FileReader stitches a list of files") {
+    std::vector<uint8_t> stream_data(3000);
+    std::iota(stream_data.begin(), stream_data.end(), 0);
+    std::vector<FileInfo> entries;
+    for (std::size_t ifile = 0; ifile < 3; ++ifile) {
+        std::vector<uint8_t> chunk(stream_data.begin() + ifile * 1000,
+                                   stream_data.begin() + (ifile + 1) * 1000);
+        auto info = write_chunk("test_fileio_" + std::to_string(ifile),
+                                17 + ifile, chunk);
+        info.nsamples = 1000;
+        info.tsamp    = 1e-3;
+        info.tstart   = 60000.0 + ifile * 1.0 / 86400.0;
+        entries.push_back(info);
+    }
+    const StreamInfo sinfo(entries);
+    REQUIRE(sinfo.nsamples() == 3000);
+    REQUIRE_NOTHROW(sinfo.check_contiguity());
+
+    const auto engine = GENERATE(ReadEngine::kBuffered, ReadEngine::kDirect);
+    FileReader reader(sinfo, "r", 8, engine);
+
+    SECTION("Reads straddle file boundaries") {
+        std::vector<uint8_t> buffer(1500);
+        std::vector<uint8_t> unpacked;
+        reader.seek(900);
+        REQUIRE(reader.creadinto(buffer, unpacked) == 1500);
+        REQUIRE(std::equal(buffer.begin(), buffer.end(),
+                           stream_data.begin() + 900));
+        REQUIRE(reader.cur_data_pos_stream() == 2400);
+        REQUIRE(reader.cur_data_pos_file() == 400);
+    }
+    SECTION("Reads stop at the end of the stream") {
+        std::vector<uint8_t> buffer(500);
+        std::vector<uint8_t> unpacked;
+        reader.seek(2800);
+        REQUIRE(reader.creadinto(buffer, unpacked) == 200);
+        REQUIRE(reader.eos());
+    }
+    SECTION("Relative seeks move backwards across files") {
+        reader.seek(2100);
+        reader.seek(-200, 1);
+        REQUIRE(reader.cur_data_pos_stream() == 1900);
+        const auto data = reader.cread(4);
+        REQUIRE(data == std::vector<uint8_t>(stream_data.begin() + 1900,
+                                             stream_data.begin() + 1904));
+    }
+    for (const auto& entry : entries) {
+        std::remove(entry.filename.c_str());
+    }
+}
+
+TEST_CASE("StreamInfo rejects non-contiguous files") {
+    FileInfo first{"a", 100, 1000, 1000, 60000.0, 1e-3, 64, 1, 8};
+    FileInfo second = first;
+    second.filename = "b";
+    second.tstart   = first.tstart + 1.0 / 86400.0;
+    REQUIRE_NOTHROW(StreamInfo({first, second}).check_contiguity());
+
+    SECTION("Gap in time") {
+        second.tstart += 0.1 / 86400.0;
+        REQUIRE_THROWS_AS(StreamInfo({first, second}).check_contiguity(),
+                          std::runtime_error);
+    }
+    SECTION("Different number of channels") {
+        second.nchans = 128;
+        REQUIRE_THROWS_AS(StreamInfo({first, second}).check_contiguity(),
+                          std::runtime_error);
+    }
+    SECTION("Different sampling time") {
+        second.tsamp = 2e-3;
+        REQUIRE_THROWS_AS(StreamInfo({first, second}).check_contiguity(),
+                          std::runtime_error);
+    }
+}
+
+TEST_CASE("PositionalWriter fills disjoint ranges from threads") {
+    const std::string filename = "test_fileio_pwrite";
+    const std::size_t hdrlen   = 20;
+    const std::size_t nbytes   = 4000;
+    write_chunk(filename, hdrlen, {});
+    {
+        const PositionalWriter writer(filename, hdrlen + nbytes);
+        REQUIRE(writer.size() == hdrlen + nbytes);
+        std::vector<std::thread> threads;
+        for (std::size_t ithread = 0; ithread < 4; ++ithread) {
+            threads.emplace_back([&writer, ithread] {
+                const std::vector<uint8_t> part(1000,
+                                                static_cast<uint8_t>(ithread));
+                writer.pwrite(hdrlen + ithread * 1000, part);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE_THROWS_AS(writer.pwrite(hdrlen + nbytes - 1,
+                                        std::vector<uint8_t>(2)),
+                          std::out_of_range);
+        writer.sync();
+    }
+    std::ifstream stream(filename, std::ios::binary);
+    std::vector<char> contents(hdrlen + nbytes);
+    stream.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+    REQUIRE(stream.gcount() == static_cast<std::streamsize>(contents.size()));
+    REQUIRE(contents[0] == 'H');
+    for (std::size_t ii = 0; ii < nbytes; ++ii) {
+        REQUIRE(contents[hdrlen + ii] == static_cast<char>(ii / 1000));
+    }
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("FileReader seeks past 4 GB in sparse files") {
+    // Sparse files: only the marker pages take up disk space
+    constexpr std::size_t kGiB   = std::size_t{1} << 30;
+    const std::size_t hdrlen     = 33;
+    const std::size_t datalen    = 3 * kGiB;
+    const std::vector<uint8_t> marker{1, 2, 3, 4, 5, 6, 7, 8};
+    std::vector<FileInfo> entries;
+    for (std::size_t ifile = 0; ifile < 2; ++ifile) {
+        const std::string filename =
+            "test_fileio_sparse_" + std::to_string(ifile);
+        auto info = write_chunk(filename, hdrlen, {});
+        std::filesystem::resize_file(filename, hdrlen + datalen);
+        {
+            const PositionalWriter writer(filename, hdrlen + datalen);
+            // Near the end of each file, beyond INT_MAX
+            writer.pwrite(hdrlen + datalen - 100, marker);
+        }
+        info.datalen = datalen;
+        entries.push_back(info);
+    }
+    FileReader reader(StreamInfo(entries), "r", 8);
+    std::vector<uint8_t> buffer(marker.size());
+
+    const auto first = static_cast<int64_t>(datalen - 100);
+    reader.seek(first);
+    REQUIRE(reader.cur_data_pos_stream() == first);
+    REQUIRE(reader.creadinto(buffer) == marker.size());
+    REQUIRE(buffer == marker);
+
+    // The second file's marker is at ~6 GB into the stream
+    const auto second = static_cast<int64_t>(2 * datalen - 100);
+    reader.seek(second);
+    REQUIRE(reader.cur_data_pos_file() == first);
+    REQUIRE(reader.cur_data_pos_stream() == second);
+    REQUIRE(reader.creadinto(buffer) == marker.size());
+    REQUIRE(buffer == marker);
+
+    reader.seek(-second, 1);
+    REQUIRE(reader.cur_data_pos_stream() ==
+            static_cast<int64_t>(marker.size()));
+    REQUIRE_THROWS_AS(reader.seek(static_cast<int64_t>(2 * datalen) + 1),
+                      std::out_of_range);
+    for (const auto& entry : entries) {
+        std::remove(entry.filename.c_str());
+    }
+}
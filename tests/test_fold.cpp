@@ -0,0 +1,200 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "sigproc/fold.hpp"
+#include "sigproc/io.hpp"
+
+namespace {
+
+SigprocHeader make_header(int nchans, int64_t nsamples, double tsamp) {
+    SigprocHeader hdr;
+    hdr.set("nbits", 32);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("nsamples", nsamples);
+    hdr.set("tsamp", tsamp);
+    hdr.set("fch1", 1500.0);
+    hdr.set("foff", -1.0);
+    // Refresh the band edges of the dispersion delays
+    return hdr.new_header(std::map<std::string, int>{{"nbits", 32}});
+}
+
+int peak_bin(std::span<const float> profile) {
+    return static_cast<int>(std::ranges::max_element(profile) -
+                            profile.begin());
+}
+
+} // namespace
+
+TEST_CASE("Folder shares samples among bins", "[fold]") {
+    const int nsamps = 1000;
+    const auto hdr   = make_header(1, nsamps, 1e-3);
+    FoldParams params;
+    params.period   = 0.0237;
+    params.nbins    = 32;
+    params.nsubints = 4;
+    Folder folder(hdr, params);
+    const std::vector<float> series(nsamps, 2.5F);
+    folder.add(series, 0, nsamps);
+
+    // A constant is folded to itself, and every sample adds a weight of 1
+    for (const float value : folder.profiles()) {
+        REQUIRE(value == Approx(2.5F));
+    }
+    const auto weights = folder.weights();
+    REQUIRE(std::accumulate(weights.begin(), weights.end(), 0.0) ==
+            Approx(nsamps));
+    REQUIRE(folder.npulses() == 42);
+    params.nbins = 0;
+    REQUIRE_THROWS_AS(Folder(hdr, params), std::invalid_argument);
+}
+
+TEST_CASE("Folder weights count past float precision", "[fold]") {
+    // A float weight stops growing at 2^24 samples per bin
+    const int64_t nsamps = int64_t{1} << 25;
+    const int gulp       = 1 << 20;
+    const auto hdr       = make_header(1, nsamps, 1e-3);
+    FoldParams params;
+    params.period = 0.5;
+    params.nbins  = 1;
+    Folder folder(hdr, params);
+    const std::vector<float> series(gulp, 1.0F);
+    for (int64_t start = 0; start < nsamps; start += gulp) {
+        folder.add(series, start, gulp);
+    }
+    REQUIRE(folder.weights()[0] == Approx(static_cast<double>(nsamps)));
+    REQUIRE(folder.profiles()[0] == Approx(1.0F));
+}
+
+TEST_CASE("Folder finds the phase of a pulse train", "[fold]") {
+    const int nsamps    = 20000;
+    const double tsamp  = 1e-4;
+    const double period = 0.01234;
+    const auto hdr      = make_header(1, nsamps, tsamp);
+    std::vector<float> series(nsamps);
+    for (int t = 0; t < nsamps; ++t) {
+        const double phase = t * tsamp / period;
+        series[t] = phase - std::floor(phase) < 0.05 ? 1.0F : 0.0F;
+    }
+    FoldParams params;
+    params.period = period;
+    params.nbins  = 20;
+    Folder folder(hdr, params);
+    folder.add(series, 0, nsamps);
+    const auto profile = folder.profiles();
+    REQUIRE(peak_bin(profile) == 0);
+    REQUIRE(profile[0] > 0.8F);
+    REQUIRE(profile[10] == 0.0F);
+
+    // Folded at a slightly wrong period the pulse drifts in phase, the
+    // right pdot for the apparent change of period brings it back
+    std::vector<float> chirp(nsamps);
+    const double pdot = 2e-7;
+    params.pdot       = pdot;
+    Folder reference(hdr, params);
+    for (int t = 0; t < nsamps; ++t) {
+        const double phase = reference.phase(t * tsamp);
+        chirp[t] = phase - std::floor(phase) < 0.05 ? 1.0F : 0.0F;
+    }
+    reference.add(chirp, 0, nsamps);
+    REQUIRE(reference.profiles()[0] > 0.8F);
+    params.pdot = 0.0;
+    Folder plain(hdr, params);
+    plain.add(chirp, 0, nsamps);
+    REQUIRE(plain.profiles()[0] < reference.profiles()[0]);
+}
+
+TEST_CASE("Folder partial folds merge to one fold", "[fold]") {
+    const int nsamps = 3000;
+    const auto hdr   = make_header(2, nsamps, 5e-4);
+    std::vector<float> data(2 * nsamps);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>((ii * 13) % 29);
+    }
+    FoldParams params;
+    params.period   = 0.0371;
+    params.nbins    = 16;
+    params.nsubints = 3;
+    Folder whole(hdr, params);
+    whole.add(data, 0, nsamps);
+    Folder first(hdr, params);
+    Folder second(hdr, params);
+    // Samples outside a block's share are skipped
+    first.add(std::span<const float>(data).first(2 * 1700), 0, 1700);
+    second.add(std::span<const float>(data).subspan(2 * 1700), 1700,
+               nsamps - 1700);
+    first.merge(second);
+    const auto lhs = whole.profiles();
+    const auto rhs = first.profiles();
+    for (std::size_t ii = 0; ii < lhs.size(); ++ii) {
+        REQUIRE(rhs[ii] == Approx(lhs[ii]).epsilon(1e-5));
+    }
+    params.nbins = 8;
+    REQUIRE_THROWS_AS(whole.merge(Folder(hdr, params)),
+                      std::invalid_argument);
+}
+
+TEST_CASE("fold_stream aligns dispersed channels", "[fold]") {
+    const std::string filename = "test_fold.fil";
+    const int nchans           = 16;
+    const int nsamps           = 8192;
+    const double tsamp         = 2e-4;
+    const double period        = 0.05;
+    const double dm            = 500.0;
+    const auto hdr             = make_header(nchans, nsamps, tsamp);
+    const auto delays          = hdr.get_dm_delays(dm, "top");
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamps);
+    for (int t = 0; t < nsamps; ++t) {
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            const double phase = (t * tsamp - delays[ichan]) / period;
+            data[t * nchans + ichan] =
+                phase - std::floor(phase) < 0.1 ? 1.0F : 0.0F;
+        }
+    }
+    FilterbankWriter writer(filename, hdr);
+    writer.write_block(data, static_cast<int>(data.size()));
+    writer.close();
+
+    FoldParams params;
+    params.period   = period;
+    params.dm       = dm;
+    params.nbins    = 25;
+    params.nsubints = 2;
+    MapReduceOptions opts;
+    opts.gulp     = 1000;
+    opts.nthreads = 1;
+    const auto single = fold_stream({filename}, params, opts);
+    opts.nthreads     = 3;
+    const auto multi  = fold_stream({filename}, params, opts);
+
+    const auto profiles = single.profiles();
+    const auto others   = multi.profiles();
+    REQUIRE(profiles.size() ==
+            static_cast<std::size_t>(2 * nchans * params.nbins));
+    for (std::size_t ii = 0; ii < profiles.size(); ++ii) {
+        REQUIRE(others[ii] == Approx(profiles[ii]).epsilon(1e-5));
+    }
+    for (int row = 0; row < 2 * nchans; ++row) {
+        const auto profile = std::span<const float>(profiles).subspan(
+            row * params.nbins, params.nbins);
+        REQUIRE(peak_bin(profile) <= 2);
+        REQUIRE(profile[peak_bin(profile)] > 0.7F);
+    }
+
+    const auto out = single.profile_header();
+    REQUIRE(out.get<HeaderKey::kDataType>() == 3);
+    REQUIRE(out.get<HeaderKey::kNbins>() == params.nbins);
+    REQUIRE(out.get<HeaderKey::kPeriod>() == period);
+    REQUIRE(out.get<HeaderKey::kRefdm>() == dm);
+    REQUIRE(out.get<HeaderKey::kNpuls>() == 32);
+    REQUIRE(out.get<HeaderKey::kNsamples>() == 2 * params.nbins);
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "sigproc/header.hpp"
+
+TEST_CASE("SigprocHeader sizes are 64-bit", "[header]") {
+    SigprocHeader hdr;
+    hdr.set("nchans", 1024);
+    hdr.set("nbits", 8);
+    hdr.set("nifs", 1);
+    hdr.set("tsamp", 64e-6);
+
+    SECTION("integer values take the type of the key") {
+        hdr.set("nsamples", 100);
+        REQUIRE(hdr.get<int64_t>("nsamples") == 100);
+        hdr.set("nsamples", int64_t{5} << 30);
+        REQUIRE(hdr.get<int64_t>("nsamples") == int64_t{5} << 30);
+        REQUIRE_THROWS_AS(hdr.set("nchans", int64_t{1} << 40),
+                          std::out_of_range);
+    }
+
+    SECTION("sizes of a sparse file beyond 4 GB") {
+        const std::string filename = "test_header_sparse.fil";
+        // Too many samples for the 4-byte field, written as 0
+        hdr.set("nsamples", int64_t{5} << 30);
+        hdr.tofile(filename);
+        const auto header_size = std::filesystem::file_size(filename);
+        const auto data_size   = std::uintmax_t{3} << 32;
+        std::filesystem::resize_file(filename, header_size + data_size);
+
+        SigprocHeader read_hdr;
+        REQUIRE(read_hdr.fromfile(filename));
+        REQUIRE(read_hdr.get<int64_t>("header_size") ==
+                static_cast<int64_t>(header_size));
+        REQUIRE(read_hdr.get<int64_t>("data_size") ==
+                static_cast<int64_t>(data_size));
+        REQUIRE(read_hdr.get<int64_t>("nsamples") ==
+                static_cast<int64_t>(data_size / 1024));
+        std::filesystem::remove(filename);
+    }
+}
+
+TEST_CASE("SigprocHeader typed fields", "[header]") {
+    SigprocHeader hdr;
+    hdr.set<HeaderKey::kNchans>(512);
+    hdr.set<HeaderKey::kTsamp>(1e-3);
+    hdr.set<HeaderKey::kSourceName>("J0534+2200");
+
+    SECTION("typed and string-keyed access share the fields") {
+        REQUIRE(hdr.get<int>("nchans") == 512);
+        REQUIRE(hdr.get<std::string>("source_name") == "J0534+2200");
+        hdr.set("nbits", 4);
+        REQUIRE(hdr.get<HeaderKey::kNbits>() == 4);
+        // values take the type of the key
+        hdr.set("tsamp", 2);
+        REQUIRE(hdr.get<HeaderKey::kTsamp>() == 2.0);
+        REQUIRE_THROWS_AS(hdr.get<double>("nchans"), std::runtime_error);
+        REQUIRE_THROWS_AS(hdr.set("nchans", std::string("x")),
+                          std::invalid_argument);
+    }
+
+    SECTION("unknown keys are kept aside") {
+        hdr.set("my_key", 1.5);
+        REQUIRE(hdr.get<double>("my_key") == 1.5);
+        REQUIRE_THROWS_AS(hdr.get<int>("missing"), std::runtime_error);
+    }
+
+    SECTION("headers parse in place from a buffer") {
+        const std::string filename = "test_header_buffer.fil";
+        hdr.set<HeaderKey::kNbits>(8);
+        hdr.set<HeaderKey::kNifs>(1);
+        hdr.set<HeaderKey::kBarycentric>(true);
+        hdr.tofile(filename);
+        std::ifstream file(filename, std::ios::binary);
+        std::vector<uint8_t> buffer{std::istreambuf_iterator<char>(file),
+                                    std::istreambuf_iterator<char>()};
+        buffer.resize(buffer.size() + 512 * 10);
+
+        SigprocHeader read_hdr;
+        const auto header_size = read_hdr.frombuffer(buffer);
+        REQUIRE(header_size == std::filesystem::file_size(filename));
+        REQUIRE(read_hdr.get<HeaderKey::kNchans>() == 512);
+        REQUIRE(read_hdr.get<HeaderKey::kTsamp>() == 1e-3);
+        REQUIRE(read_hdr.get<HeaderKey::kSourceName>() == "J0534+2200");
+        REQUIRE(read_hdr.get<HeaderKey::kBarycentric>());
+        REQUIRE(read_hdr.get<HeaderKey::kFrame>() == "barycentric");
+        REQUIRE(read_hdr.get<HeaderKey::kNsamples>() == 10);
+
+        REQUIRE_THROWS_AS(
+            read_hdr.frombuffer(std::span(buffer).first(header_size - 4)),
+            std::runtime_error);
+        const std::vector<uint8_t> garbage(64, 0xff);
+        REQUIRE(read_hdr.frombuffer(garbage) == 0);
+        std::filesystem::remove(filename);
+    }
+}
@@ -0,0 +1,289 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "sigproc/io.hpp"
+
+namespace {
+
+// Filterbank whose value encodes (sample, channel)
+std::vector<float> write_ramp(const std::string& filename, int nchans,
+                              int nsamples, int nbits = 8, int nifs = 1) {
+    SigprocHeader hdr;
+    hdr.set("nbits", nbits);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", nifs);
+    hdr.set("nsamples", nsamples);
+    const int stride_len = nchans * nifs;
+    std::vector<float> data(static_cast<std::size_t>(stride_len) * nsamples);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>((ii / stride_len * 7 + ii % stride_len) %
+                                      (1U << nbits));
+    }
+    FilterbankWriter writer(filename, hdr);
+    writer.write_block(data, static_cast<int>(data.size()));
+    writer.close();
+    return data;
+}
+
+std::vector<char> read_bytes(const std::string& filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    return {std::istreambuf_iterator<char>(stream),
+            std::istreambuf_iterator<char>()};
+}
+
+// Write blocks of growing size through one reused buffer
+void write_blocks(FilterbankWriter& writer, int nchans, int nblocks) {
+    std::vector<float> block;
+    for (int iblock = 0; iblock < nblocks; ++iblock) {
+        block.resize(static_cast<std::size_t>(iblock + 1) * nchans);
+        for (std::size_t ii = 0; ii < block.size(); ++ii) {
+            block[ii] = static_cast<float>((iblock * 31 + ii) % 4);
+        }
+        writer.write_block(block, static_cast<int>(block.size()));
+    }
+}
+
+// Value of (sample t, IF ipol, channel ichan) of time-major data
+float at(const std::vector<float>& data, int nchans, int nifs, int64_t t,
+         int ipol, int ichan) {
+    return data[(static_cast<std::size_t>(t) * nifs + ipol) * nchans + ichan];
+}
+
+} // namespace
+
+TEST_CASE("FilReader views match read_block", "[io]") {
+    const std::string filename = "test_io_view.fil";
+    const int nchans           = 16;
+    const int nsamples         = 1000;
+    write_ramp(filename, nchans, nsamples);
+    FilReader mapped(filename, true);
+    FilReader streamed(filename);
+    REQUIRE(mapped.is_mapped());
+    std::vector<float> expected;
+
+    SECTION("view_block and view_block_as") {
+        for (const int64_t start : {0, 123, 990}) {
+            const int nsamps =
+                std::min<int>(64, nsamples - static_cast<int>(start));
+            streamed.read_block(start, nsamps, expected);
+            const auto bytes = mapped.view_block(start, nsamps);
+            REQUIRE(bytes.size() == static_cast<std::size_t>(nsamps) * nchans);
+            REQUIRE(std::equal(bytes.begin(), bytes.end(), expected.begin(),
+                               expected.end()));
+            const auto typed = mapped.view_block_as<uint8_t>(start, nsamps);
+            REQUIRE(std::ranges::equal(typed, bytes));
+        }
+        REQUIRE_THROWS_AS(mapped.view_block_as<float>(0, 1),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(streamed.view_block(0, 1), std::runtime_error);
+    }
+
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("FilReader view_plan steps back and forth", "[io]") {
+    const std::string filename = "test_io_plan.fil";
+    const int nchans           = 16;
+    const int nsamples         = 1000;
+    // Packed samples scale the skip by bits per value
+    const int nbits = GENERATE(2, 8);
+    write_ramp(filename, nchans, nsamples, nbits);
+    // Overlapping blocks, adjacent blocks and blocks with a gap
+    const int skip      = GENERATE(-5 * nchans, 0, 7 * nchans);
+    const bool use_mmap = GENERATE(false, true);
+    const int gulp      = 64;
+    const int block_len = gulp * nchans;
+    FilReader mapped(filename, true);
+    FilReader streamed(filename);
+    FilReader planned(filename, use_mmap);
+    std::vector<float> expected;
+    std::vector<float> block;
+    int nblocks = 0;
+    for (int64_t start = 0; start + gulp <= nsamples;
+         start += gulp + skip / nchans) {
+        const auto bytes = mapped.view_plan(block_len, skip);
+        REQUIRE(std::ranges::equal(bytes, mapped.view_block(start, gulp)));
+        streamed.read_block(start, gulp, expected);
+        planned.read_plan(block_len, block, skip);
+        REQUIRE(block == expected);
+        ++nblocks;
+    }
+    REQUIRE(nblocks == (nsamples - gulp) / (gulp + skip / nchans) + 1);
+    REQUIRE_THROWS_AS(streamed.view_plan(block_len, 0), std::runtime_error);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("FilterbankWriter writes behind in order", "[io]") {
+    const std::string sync_name  = "test_io_sync.fil";
+    const std::string async_name = "test_io_async.fil";
+    const int nchans             = 8;
+    const int nblocks            = 40;
+    const int nbits              = GENERATE(2, 8, 32);
+    const std::size_t nbuffers   = GENERATE(1, 3);
+    SigprocHeader hdr;
+    hdr.set("nbits", nbits);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    {
+        FilterbankWriter writer(sync_name, hdr);
+        REQUIRE_FALSE(writer.is_async());
+        write_blocks(writer, nchans, nblocks);
+        writer.close();
+    }
+    const auto expected = read_bytes(sync_name);
+    const int nvalues   = nblocks * (nblocks + 1) / 2 * nchans;
+    REQUIRE(expected.size() > static_cast<std::size_t>(nvalues * nbits / 8));
+
+    SECTION("flushed by flush() and close()") {
+        FilterbankWriter writer(async_name, hdr, nbuffers);
+        REQUIRE(writer.is_async());
+        write_blocks(writer, nchans, nblocks);
+        writer.flush();
+        REQUIRE(read_bytes(async_name) == expected);
+        writer.close();
+        writer.close();
+        REQUIRE(read_bytes(async_name) == expected);
+        const std::vector<float> block(nchans);
+        REQUIRE_THROWS_AS(writer.write_block(block, nchans),
+                          std::runtime_error);
+    }
+    SECTION("flushed by the destructor") {
+        {
+            FilterbankWriter writer(async_name, hdr, nbuffers);
+            write_blocks(writer, nchans, nblocks);
+        }
+        REQUIRE(read_bytes(async_name) == expected);
+    }
+    std::remove(sync_name.c_str());
+    std::remove(async_name.c_str());
+}
+
+TEST_CASE("FilterbankWriter reports write errors", "[io]") {
+    // Every write to /dev/full fails with ENOSPC
+    const std::string filename = "/dev/full";
+    if (!std::filesystem::exists(filename)) {
+        return;
+    }
+    SigprocHeader hdr;
+    hdr.set("nbits", 32);
+    hdr.set("nchans", 1024);
+    hdr.set("nifs", 1);
+    // Larger than the stream buffer, so each write reaches the device
+    const std::vector<float> block(1 << 20, 1.0F);
+    const auto block_len = static_cast<int>(block.size());
+
+    SECTION("synchronous") {
+        FilterbankWriter writer(filename, hdr);
+        REQUIRE_THROWS_AS(writer.write_block(block, block_len),
+                          std::runtime_error);
+    }
+    SECTION("from the writer thread") {
+        // The error of a queued block surfaces in a later call
+        FilterbankWriter writer(filename, hdr, 2);
+        REQUIRE_THROWS_AS(
+            [&] {
+                for (int iblock = 0; iblock < 8; ++iblock) {
+                    writer.write_block(block, block_len);
+                }
+                writer.close();
+            }(),
+            std::runtime_error);
+    }
+    SECTION("at close()") {
+        FilterbankWriter writer(filename, hdr, 4);
+        writer.write_block(block, block_len);
+        REQUIRE_THROWS_AS(writer.close(), std::runtime_error);
+    }
+}
+
+TEST_CASE("FilReader corner-turns blocks on request", "[io]") {
+    const std::string filename = "test_io_layout.fil";
+    const int nchans           = 13;
+    const int nifs             = 2;
+    const int nsamples         = 501;
+
+    const auto data = write_ramp(filename, nchans, nsamples, 8, nifs);
+    const bool use_mmap = GENERATE(false, true);
+    FilReader reader(filename, use_mmap);
+    REQUIRE(reader.get_layout() == BlockLayout::kTimeMajor);
+    reader.set_layout(BlockLayout::kChannelMajor);
+    REQUIRE(reader.get_layout() == BlockLayout::kChannelMajor);
+
+    const auto check_block = [&](const std::vector<float>& block,
+                                 int64_t start, int nsamps) {
+        REQUIRE(block.size() ==
+                static_cast<std::size_t>(nsamps) * nchans * nifs);
+        for (int ipol = 0; ipol < nifs; ++ipol) {
+            for (int ichan = 0; ichan < nchans; ++ichan) {
+                const auto row = (static_cast<std::size_t>(ipol) * nchans +
+                                  ichan) * nsamps;
+                for (int t = 0; t < nsamps; ++t) {
+                    REQUIRE(block[row + t] ==
+                            at(data, nchans, nifs, start + t, ipol, ichan));
+                }
+            }
+        }
+    };
+    std::vector<float> block;
+    reader.read_block(37, 91, block);
+    check_block(block, 37, 91);
+    // Plans still count values, the short last block is turned as well
+    reader.seek_sample(0);
+    int64_t start = 0;
+    for (const auto& [iread, block_len, skip] : reader.get_readplan(120)) {
+        reader.read_plan(block_len, block, skip);
+        const int nsamps = block_len / (nchans * nifs);
+        check_block(block, start, nsamps);
+        start += nsamps;
+    }
+    REQUIRE(start == nsamples);
+    // read_samples() stays time-major
+    std::vector<float> samples(static_cast<std::size_t>(10) * nchans * nifs);
+    reader.seek_sample(5);
+    REQUIRE(reader.read_samples(samples) == 10);
+    REQUIRE(std::equal(samples.begin(), samples.end(),
+                       data.begin() + 5 * nchans * nifs));
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("ChannelMajorFile maps each channel as a time series", "[io]") {
+    const std::string filename = "test_io_cmaj.fil";
+    const std::string sidecar  = ChannelMajorFile::sidecar_name(filename);
+    const int nchans           = 13;
+    const int nifs             = 2;
+    const int nsamples         = 1001;
+
+    const auto data = write_ramp(filename, nchans, nsamples, 8, nifs);
+    FilReader reader(filename);
+    // A gulp that does not divide the file leaves a short last block
+    ChannelMajorFile::create(reader, sidecar, 128);
+    REQUIRE(reader.get_layout() == BlockLayout::kTimeMajor);
+
+    const ChannelMajorFile cmaj(sidecar);
+    REQUIRE(cmaj.nchans() == nchans);
+    REQUIRE(cmaj.nifs() == nifs);
+    REQUIRE(cmaj.nsamples() == static_cast<std::size_t>(nsamples));
+    for (int ipol = 0; ipol < nifs; ++ipol) {
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            const auto series = cmaj.channel(ichan, ipol);
+            REQUIRE(series.size() == static_cast<std::size_t>(nsamples));
+            for (int t = 0; t < nsamples; ++t) {
+                REQUIRE(series[t] == at(data, nchans, nifs, t, ipol, ichan));
+            }
+        }
+    }
+    REQUIRE_THROWS_AS(cmaj.channel(nchans), std::out_of_range);
+    REQUIRE_THROWS_AS(cmaj.channel(0, nifs), std::out_of_range);
+    // The filterbank itself is not a sidecar
+    REQUIRE_THROWS_AS(ChannelMajorFile(filename), std::runtime_error);
+    std::remove(filename.c_str());
+    std::remove(sidecar.c_str());
+}
@@ -0,0 +1,42 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+#include "sigproc/kernels.hpp"
+
+TEST_CASE("corner_turn round trips any shape", "[kernels]") {
+    // Shapes below, at and past the transpose tile, none a multiple of 8
+    const auto [nchans, nsamps, nifs] =
+        GENERATE(std::tuple<int, int, int>{1, 1, 1},
+                 std::tuple<int, int, int>{3, 5, 1},
+                 std::tuple<int, int, int>{13, 77, 2},
+                 std::tuple<int, int, int>{65, 63, 1},
+                 std::tuple<int, int, int>{129, 67, 3},
+                 std::tuple<int, int, int>{1, 1001, 4});
+    const auto size = static_cast<std::size_t>(nchans) * nsamps * nifs;
+    std::vector<float> data(size);
+    for (std::size_t ii = 0; ii < size; ++ii) {
+        data[ii] = static_cast<float>(ii);
+    }
+    std::vector<float> turned(size, -1.0F);
+    sigproc::corner_turn(data, turned, nchans, nsamps, nifs);
+    for (int t = 0; t < nsamps; ++t) {
+        for (int ipol = 0; ipol < nifs; ++ipol) {
+            for (int ichan = 0; ichan < nchans; ++ichan) {
+                const auto in =
+                    (static_cast<std::size_t>(t) * nifs + ipol) * nchans +
+                    ichan;
+                const auto out =
+                    (static_cast<std::size_t>(ipol) * nchans + ichan) *
+                        nsamps +
+                    t;
+                REQUIRE(turned[out] == data[in]);
+            }
+        }
+    }
+    std::vector<float> back(size, -1.0F);
+    sigproc::corner_turn_inverse(turned, back, nchans, nsamps, nifs);
+    REQUIRE(back == data);
+}
@@ -0,0 +1,136 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "sigproc/numbits.hpp"
+
+namespace {
+
+std::vector<uint8_t> make_bytes(std::size_t nbytes) {
+    std::vector<uint8_t> bytes(nbytes);
+    for (std::size_t ii = 0; ii < nbytes; ++ii) {
+        bytes[ii] = static_cast<uint8_t>((ii * 37 + 11) % 256);
+    }
+    return bytes;
+}
+
+} // namespace
+
+TEST_CASE("unpack_to_float matches unpack", "[numbits]") {
+    const std::size_t nsamps = 1000;
+    for (std::size_t nbits : {1, 2, 4}) {
+        for (const std::string bitorder : {"little", "big"}) {
+            const auto packed = make_bytes(nsamps * nbits / 8);
+            std::vector<uint8_t> unpacked(nsamps);
+            sigproc::unpack(packed, unpacked, nbits, bitorder, false);
+            std::vector<float> out(nsamps);
+            sigproc::unpack_to_float(packed, out, nbits, bitorder);
+            for (std::size_t ii = 0; ii < nsamps; ++ii) {
+                REQUIRE(out[ii] == static_cast<float>(unpacked[ii]));
+            }
+        }
+    }
+    SECTION("16-bit") {
+        const auto bytes = make_bytes(nsamps * 2);
+        std::vector<float> out(nsamps);
+        sigproc::unpack_to_float(bytes, out, 16);
+        for (std::size_t ii = 0; ii < nsamps; ++ii) {
+            uint16_t value{};
+            std::memcpy(&value, bytes.data() + ii * 2, 2);
+            REQUIRE(out[ii] == static_cast<float>(value));
+        }
+    }
+}
+
+TEST_CASE("unpack_to_float fills a partial last byte", "[numbits]") {
+    const std::size_t nbits     = GENERATE(1, 2, 4);
+    const std::string bitorder  = GENERATE("little", "big");
+    const std::size_t nsamps    = GENERATE(1, 7, 13, 21);
+    const std::size_t nelements = 8 / nbits;
+
+    const auto packed = make_bytes((nsamps + nelements - 1) / nelements);
+    std::vector<uint8_t> unpacked(packed.size() * nelements);
+    sigproc::unpack(packed, unpacked, nbits, bitorder, false);
+    std::vector<float> out(nsamps, -1.0F);
+    sigproc::unpack_to_float(packed, out, nbits, bitorder);
+    for (std::size_t ii = 0; ii < nsamps; ++ii) {
+        REQUIRE(out[ii] == static_cast<float>(unpacked[ii]));
+    }
+    // Packing the values back pads the last byte with zeros
+    std::vector<uint8_t> repacked(packed.size(), 0xFF);
+    sigproc::pack_from_float(out, repacked, nbits, bitorder);
+    std::vector<float> again(nsamps);
+    sigproc::unpack_to_float(repacked, again, nbits, bitorder);
+    REQUIRE(again == out);
+    std::vector<uint8_t> padded(repacked.size() * nelements);
+    sigproc::unpack(repacked, padded, nbits, bitorder, false);
+    for (std::size_t ii = nsamps; ii < padded.size(); ++ii) {
+        REQUIRE(padded[ii] == 0);
+    }
+
+    SECTION("scaled runs") {
+        // 8 channels fill whole bytes, the last run ends within one
+        const std::size_t nchans = 8;
+        const std::vector<float> scale(nchans, 2.0F);
+        const std::vector<float> offset(nchans, 1.0F);
+        const std::size_t ntotal = nchans * 3 + nsamps % nchans;
+        const auto bytes = make_bytes((ntotal * nbits + 7) / 8);
+        std::vector<float> plain(ntotal);
+        std::vector<float> scaled(ntotal, -1.0F);
+        sigproc::unpack_to_float(bytes, plain, nbits, bitorder);
+        sigproc::unpack_to_float(bytes, scaled, nbits, scale, offset,
+                                 bitorder);
+        for (std::size_t ii = 0; ii < ntotal; ++ii) {
+            REQUIRE(scaled[ii] == plain[ii] * 2.0F + 1.0F);
+        }
+    }
+}
+
+TEST_CASE("unpack_to_float applies scale and offset", "[numbits]") {
+    const std::size_t nchans = 16;
+    const std::size_t nsamps = nchans * 25;
+    std::vector<float> scale(nchans);
+    std::vector<float> offset(nchans);
+    for (std::size_t ichan = 0; ichan < nchans; ++ichan) {
+        scale[ichan]  = 0.5F + static_cast<float>(ichan);
+        offset[ichan] = -static_cast<float>(ichan);
+    }
+    for (std::size_t nbits : {2, 8}) {
+        const auto packed = make_bytes(nsamps * nbits / 8);
+        std::vector<float> plain(nsamps);
+        std::vector<float> scaled(nsamps);
+        sigproc::unpack_to_float(packed, plain, nbits);
+        sigproc::unpack_to_float(packed, scaled, nbits, scale, offset);
+        for (std::size_t ii = 0; ii < nsamps; ++ii) {
+            const auto ichan = ii % nchans;
+            REQUIRE(scaled[ii] ==
+                    Approx(plain[ii] * scale[ichan] + offset[ichan]));
+        }
+    }
+    std::vector<float> out(nsamps);
+    std::vector<float> odd(3, 1.0F);
+    REQUIRE_THROWS_AS(sigproc::unpack_to_float(make_bytes(nsamps / 4), out, 2,
+                                               odd, odd),
+                      std::invalid_argument);
+}
+
+TEST_CASE("pack_from_float round trips", "[numbits]") {
+    const std::size_t nsamps = 512;
+    for (std::size_t nbits : {1, 2, 4, 8, 16}) {
+        const auto packed = make_bytes(nsamps * nbits / 8);
+        std::vector<float> floats(nsamps);
+        sigproc::unpack_to_float(packed, floats, nbits);
+        std::vector<uint8_t> repacked(packed.size());
+        sigproc::pack_from_float(floats, repacked, nbits);
+        REQUIRE(repacked == packed);
+    }
+    SECTION("values are clipped to the output range") {
+        const std::vector<float> floats{-3.0F, 1.4F, 2.6F, 300.0F};
+        std::vector<uint8_t> out(4);
+        sigproc::pack_from_float(floats, out, 8);
+        REQUIRE(out == std::vector<uint8_t>{0, 1, 3, 255});
+    }
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sigproc/io.hpp"
+#include "sigproc/overlap.hpp"
+
+namespace {
+
+// 8-bit filterbank whose value encodes (sample, channel)
+std::vector<float> write_ramp(const std::string& filename, int nchans,
+                              int nsamples) {
+    SigprocHeader hdr;
+    hdr.set("nbits", 8);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("nsamples", nsamples);
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamples);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>((ii / nchans * 3 + ii % nchans) % 256);
+    }
+    FilterbankWriter writer(filename, hdr);
+    writer.write_block(data, static_cast<int>(data.size()));
+    writer.close();
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("OverlapReader reads each sample once", "[overlap]") {
+    const std::string filename = "test_overlap.fil";
+    const int nchans           = 16;
+    const int nsamples         = 1000;
+    const auto data            = write_ramp(filename, nchans, nsamples);
+    const bool use_mmap        = GENERATE(false, true);
+    const int gulp             = 128;
+    const int overlap          = 100;
+
+    FilReader reader(filename, use_mmap);
+    OverlapReader blocks(reader, gulp, overlap);
+    int64_t expected_start = 0;
+    int64_t last_end       = 0;
+    for (const auto& block : blocks) {
+        REQUIRE(block.start_sample == expected_start);
+        REQUIRE(block.nhistory == (expected_start == 0 ? 0 : overlap));
+        REQUIRE(block.data.size() ==
+                static_cast<std::size_t>(block.nsamps) * nchans);
+        const auto offset =
+            static_cast<std::ptrdiff_t>(block.start_sample) * nchans;
+        REQUIRE(std::equal(block.data.begin(), block.data.end(),
+                           data.begin() + offset));
+        last_end = block.start_sample + block.nsamps;
+        REQUIRE((block.nsamps == gulp || last_end == nsamples));
+        expected_start += gulp - overlap;
+    }
+    REQUIRE(last_end == nsamples);
+    // Every sample came from the file once
+    REQUIRE(blocks.nsamples_read() == nsamples);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("OverlapReader streams a sub-range", "[overlap]") {
+    const std::string filename = "test_overlap_range.fil";
+    const int nchans           = 8;
+    const auto data            = write_ramp(filename, nchans, 500);
+
+    FilReader reader(filename);
+    OverlapReader blocks(reader, 64, 16, 100, 200);
+    int64_t last_end = 0;
+    for (const auto& block : blocks) {
+        const auto offset =
+            static_cast<std::size_t>(block.start_sample) * nchans;
+        REQUIRE(std::equal(block.data.begin(), block.data.end(),
+                           data.begin() + static_cast<std::ptrdiff_t>(offset)));
+        last_end = block.start_sample + block.nsamps;
+    }
+    REQUIRE(last_end == 300);
+    REQUIRE(blocks.nsamples_read() == 200);
+    REQUIRE_THROWS_AS(OverlapReader(reader, 64, 64), std::invalid_argument);
+    std::remove(filename.c_str());
+}
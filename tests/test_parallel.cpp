@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sigproc/io.hpp"
+#include "sigproc/parallel.hpp"
+
+TEST_CASE("partition_samples covers the range", "[parallel]") {
+    const auto ranges = partition_samples(10, 1000, 3, 64);
+    REQUIRE(ranges.size() == 3);
+    int64_t next = 10;
+    for (const auto& range : ranges) {
+        REQUIRE(range.start == next);
+        REQUIRE((range.start - 10) % 64 == 0);
+        next += range.nsamps;
+    }
+    REQUIRE(next == 1010);
+    REQUIRE(partition_samples(0, 0, 4).empty());
+    REQUIRE(partition_samples(0, 3, 8).size() == 3);
+    REQUIRE_THROWS_AS(partition_samples(0, 10, 0), std::invalid_argument);
+}
+
+TEST_CASE("parallel_map_reduce matches a sequential pass", "[parallel]") {
+    const std::string filename = "test_parallel.fil";
+    const int nchans           = 8;
+    const int nsamples         = 5000;
+    SigprocHeader hdr;
+    hdr.set("nbits", 8);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("nsamples", nsamples);
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamples);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>((ii * 7 + ii / nchans) % 256);
+    }
+    FilterbankWriter writer(filename, hdr);
+    writer.write_block(data, static_cast<int>(data.size()));
+    writer.close();
+
+    struct ChanSum {
+        std::vector<double> sum;
+        int64_t nsamps;
+        int64_t first;
+        int nbad_blocks;
+    };
+    const int64_t start = 123;
+    const int64_t nsamp = 4000;
+    ChanSum expected{std::vector<double>(nchans), nsamp, start, 0};
+    for (int64_t isamp = start; isamp < start + nsamp; ++isamp) {
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            expected.sum[ichan] += data[isamp * nchans + ichan];
+        }
+    }
+
+    MapReduceOptions opts;
+    opts.nthreads = GENERATE(1, 2, 5);
+    opts.gulp     = 300;
+    opts.use_mmap = GENERATE(false, true);
+    const ChanSum init{std::vector<double>(nchans), 0, -1, 0};
+    const auto result = parallel_map_reduce(
+        {filename}, start, nsamp, init, opts,
+        [&](ChanSum& acc, std::span<const float> block, int64_t start_sample,
+            int nsamps) {
+            // map runs on the worker threads, check outside of them
+            if (block.size() != static_cast<std::size_t>(nsamps) * nchans ||
+                nsamps > opts.gulp) {
+                ++acc.nbad_blocks;
+            }
+            if (acc.first < 0) {
+                acc.first = start_sample;
+            }
+            for (std::size_t ii = 0; ii < block.size(); ++ii) {
+                acc.sum[ii % nchans] += block[ii];
+            }
+            acc.nsamps += nsamps;
+        },
+        [&](ChanSum& acc, const ChanSum& part) {
+            // states are merged in sample order
+            REQUIRE(part.first == acc.first + acc.nsamps);
+            for (int ichan = 0; ichan < nchans; ++ichan) {
+                acc.sum[ichan] += part.sum[ichan];
+            }
+            acc.nsamps += part.nsamps;
+            acc.nbad_blocks += part.nbad_blocks;
+        });
+    REQUIRE(result.nbad_blocks == 0);
+    REQUIRE(result.nsamps == expected.nsamps);
+    REQUIRE(result.first == expected.first);
+    REQUIRE(result.sum == expected.sum);
+    std::remove(filename.c_str());
+}
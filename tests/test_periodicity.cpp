@@ -0,0 +1,143 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sigproc/periodicity.hpp"
+
+namespace {
+
+// Gaussian noise plus a train of narrow pulses of the given period
+std::vector<float> make_pulsar(int nsamps, double tsamp, double period,
+                               float amplitude, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0F, 1.0F);
+    std::vector<float> series(nsamps);
+    for (int t = 0; t < nsamps; ++t) {
+        const double phase = std::fmod(t * tsamp / period, 1.0);
+        series[t] = noise(rng) + (phase < 0.05 ? amplitude : 0.0F);
+    }
+    return series;
+}
+
+} // namespace
+
+TEST_CASE("Harmonic sum thresholds invert the significance", "[period]") {
+    for (const int nharm : {1, 2, 8, 32}) {
+        const double threshold = harmonic_sum_threshold(6.0, nharm);
+        REQUIRE(threshold > nharm);
+        REQUIRE(harmonic_sum_sigma(threshold, nharm) ==
+                Approx(6.0).margin(1e-6));
+    }
+    // a single power is exponential, P(X > x) = exp(-x)
+    REQUIRE(harmonic_sum_sigma(-std::log(0.5), 1) ==
+            Approx(0.0).margin(1e-6));
+    REQUIRE(harmonic_sum_sigma(1e6, 16) > 1000.0);
+}
+
+TEST_CASE("whiten_spectrum removes red noise", "[period]") {
+    const int nbins = 20000;
+    std::mt19937 rng(7);
+    std::exponential_distribution<float> noise(1.0F);
+    std::vector<float> power(nbins);
+    for (int k = 0; k < nbins; ++k) {
+        // noise power falling from 1000 to 1
+        power[k] = noise(rng) * (1.0F + 1000.0F / (1.0F + 0.01F * k));
+    }
+    whiten_spectrum(power);
+    REQUIRE(power[0] == 0.0F);
+    for (const int k0 : {100, 1000, 10000}) {
+        double mean = 0.0;
+        for (int k = k0; k < k0 + 1000; ++k) {
+            mean += power[k];
+        }
+        REQUIRE(mean / 1000 == Approx(1.0).epsilon(0.15));
+    }
+}
+
+TEST_CASE("PeriodicitySearch finds a periodic signal", "[period]") {
+    const int nsamps    = 1 << 16;
+    const double tsamp  = 1e-3;
+    const double period = 0.0731;
+    PeriodSearchOptions options;
+    options.max_harmonics = 16;
+    PeriodicitySearch search(nsamps, tsamp, options);
+    REQUIRE(search.folds() == std::vector<int>{1, 2, 4, 8, 16});
+    REQUIRE(search.bin_width() == Approx(1.0 / (nsamps * tsamp)));
+
+    const auto series = make_pulsar(nsamps, tsamp, period, 0.3F, 1);
+    const auto cands  = search.search(series, 12.5);
+    REQUIRE_FALSE(cands.empty());
+    const auto& best = cands.front();
+    REQUIRE(best.freq == Approx(1.0 / period).margin(search.bin_width()));
+    REQUIRE(best.dm == 12.5F);
+    REQUIRE(best.nharm > 1);
+    REQUIRE(best.sigma > options.threshold);
+    REQUIRE(std::ranges::is_sorted(cands, std::greater{},
+                                   &PeriodCandidate::sigma));
+
+    // noise alone rarely crosses 6 sigma
+    const auto quiet =
+        search.search(make_pulsar(nsamps, tsamp, period, 0.0F, 2), 0.0);
+    REQUIRE(quiet.size() <= 1);
+
+    REQUIRE_THROWS_AS(PeriodicitySearch(nsamps + 1, tsamp),
+                      std::invalid_argument);
+    options.max_harmonics = 12;
+    REQUIRE_THROWS_AS(PeriodicitySearch(nsamps, tsamp, options),
+                      std::invalid_argument);
+}
+
+TEST_CASE("PeriodicitySearch searches many series", "[period]") {
+    const int nsamps   = 1 << 14;
+    const double tsamp = 1e-3;
+    const int nseries  = 6;
+    PeriodicitySearch search(nsamps, tsamp);
+    std::vector<float> series;
+    std::vector<double> dms;
+    for (int idm = 0; idm < nseries; ++idm) {
+        const auto one = make_pulsar(nsamps, tsamp, 0.05 + 0.01 * idm,
+                                     idm % 2 == 0 ? 0.5F : 0.0F, 10 + idm);
+        series.insert(series.end(), one.begin(), one.end());
+        dms.push_back(10.0 * idm);
+    }
+    const auto cands = search.search_many(series, nsamps, dms, 3);
+    // the same as one at a time, in order of the series
+    std::vector<PeriodCandidate> expected;
+    for (int idm = 0; idm < nseries; ++idm) {
+        const auto one = search.search(
+            std::span(series).subspan(idm * nsamps, nsamps), dms[idm]);
+        expected.insert(expected.end(), one.begin(), one.end());
+    }
+    REQUIRE(cands.size() == expected.size());
+    for (std::size_t ii = 0; ii < cands.size(); ++ii) {
+        REQUIRE(cands[ii].freq == expected[ii].freq);
+        REQUIRE(cands[ii].dm == expected[ii].dm);
+        REQUIRE(cands[ii].power == Approx(expected[ii].power));
+    }
+    for (int idm = 0; idm < nseries; idm += 2) {
+        REQUIRE(std::ranges::any_of(cands, [&](const auto& cand) {
+            return cand.dm == static_cast<float>(dms[idm]) &&
+                   std::abs(cand.freq - 1.0 / (0.05 + 0.01 * idm)) <=
+                       search.bin_width();
+        }));
+    }
+
+    const std::string filename = "test_periodicity.cands";
+    write_period_candidates(filename, cands);
+    const auto loaded = read_period_candidates(filename);
+    REQUIRE(loaded.size() == cands.size());
+    for (std::size_t ii = 0; ii < cands.size(); ++ii) {
+        REQUIRE(loaded[ii].freq == cands[ii].freq);
+        REQUIRE(loaded[ii].sigma == cands[ii].sigma);
+        REQUIRE(loaded[ii].nharm == cands[ii].nharm);
+    }
+    std::remove(filename.c_str());
+    REQUIRE_THROWS_AS(search.search_many(series, nsamps + 1, dms),
+                      std::invalid_argument);
+}
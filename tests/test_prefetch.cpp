@@ -0,0 +1,156 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "sigproc/io.hpp"
+#include "sigproc/prefetch.hpp"
+
+namespace {
+
+// 8-bit filterbank whose value encodes (sample, channel)
+std::vector<float> write_ramp(const std::string& filename, int nchans,
+                              int nsamples) {
+    SigprocHeader hdr;
+    hdr.set("nbits", 8);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("nsamples", nsamples);
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamples);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>((ii / nchans * 5 + ii % nchans) % 256);
+    }
+    FilterbankWriter writer(filename, hdr);
+    writer.write_block(data, static_cast<int>(data.size()));
+    writer.close();
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("PrefetchReader hands out the plan in order", "[prefetch]") {
+    const std::string filename = "test_prefetch_plan.fil";
+    const int nchans           = 8;
+    const int nsamples         = 1000;
+    write_ramp(filename, nchans, nsamples);
+    const bool use_mmap = GENERATE(false, true);
+    const int skipback  = GENERATE(0, 16);
+
+    FilReader expected_reader(filename);
+    auto plan = expected_reader.get_readplan(128, skipback);
+    std::vector<float> expected;
+    for (const auto& [iread, block_len, skip] : plan) {
+        expected_reader.read_plan(block_len, expected, skip);
+    }
+    expected_reader.seek_sample(0);
+
+    FilReader reader(filename, use_mmap);
+    PrefetchReader prefetcher(reader, plan, 2);
+    std::size_t iblock = 0;
+    while (const auto block = prefetcher.next()) {
+        REQUIRE(iblock < plan.size());
+        const auto [iread, block_len, skip] = plan[iblock];
+        REQUIRE(block->iread == iread);
+        REQUIRE(block->block_len == block_len);
+        expected_reader.read_plan(block_len, expected, skip);
+        REQUIRE(std::ranges::equal(block->data, expected));
+        ++iblock;
+    }
+    REQUIRE(iblock == plan.size());
+    // The end of the plan is sticky
+    REQUIRE_FALSE(prefetcher.next());
+    REQUIRE(prefetcher.stats().nblocks == plan.size());
+    REQUIRE_THROWS_AS(PrefetchReader(reader, plan, 1), std::invalid_argument);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("PrefetchReader gulps to the end of the stream", "[prefetch]") {
+    const std::string filename = "test_prefetch_gulp.fil";
+    const int nchans           = 4;
+    const int nsamples         = 1000;
+    const auto data            = write_ramp(filename, nchans, nsamples);
+    const int gulp             = 300;
+    // A sub-range, the rest of the stream, and a range past its end
+    const auto [start, nsamps, nexpected] =
+        GENERATE(std::tuple<int64_t, int64_t, int64_t>{100, 450, 450},
+                 std::tuple<int64_t, int64_t, int64_t>{100, 0, 900},
+                 std::tuple<int64_t, int64_t, int64_t>{500, 800, 500});
+
+    FilReader reader(filename);
+    reader.seek_sample(start);
+    PrefetchReader prefetcher(reader, gulp, nsamps, 3);
+    int64_t nread = 0;
+    int iread     = 0;
+    while (const auto block = prefetcher.next()) {
+        REQUIRE(block->iread == iread++);
+        REQUIRE(block->block_len % nchans == 0);
+        const int nsamps_block = block->block_len / nchans;
+        REQUIRE((nsamps_block == gulp || nread + nsamps_block == nexpected));
+        const auto offset = static_cast<std::ptrdiff_t>(start + nread) * nchans;
+        REQUIRE(std::equal(block->data.begin(), block->data.end(),
+                           data.begin() + offset));
+        nread += nsamps_block;
+    }
+    REQUIRE(nread == nexpected);
+    REQUIRE_FALSE(prefetcher.next());
+    REQUIRE_THROWS_AS(PrefetchReader(reader, 0), std::invalid_argument);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("PrefetchReader rethrows errors of the I/O thread", "[prefetch]") {
+    const std::string filename = "test_prefetch_error.fil";
+    const int nchans           = 8;
+    write_ramp(filename, nchans, 100);
+    // A mapped reader refuses to view past the end of the file
+    FilReader reader(filename, true);
+    const std::vector<readplan_tuple> plan{{0, 10 * nchans, 0},
+                                           {1, 1000 * nchans, 0},
+                                           {2, 10 * nchans, 0}};
+    PrefetchReader prefetcher(reader, plan);
+    int nblocks = 0;
+    REQUIRE_THROWS_AS(
+        [&] {
+            while (prefetcher.next()) {
+                ++nblocks;
+            }
+        }(),
+        std::out_of_range);
+    // No block after the failed read is handed out
+    REQUIRE(nblocks <= 1);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("PrefetchReader counts blocks and stalls", "[prefetch]") {
+    const std::string filename = "test_prefetch_stats.fil";
+    const int nchans           = 8;
+    const int nsamples         = 2000;
+    write_ramp(filename, nchans, nsamples);
+    const std::size_t nbuffers = 3;
+    FilReader reader(filename);
+    PrefetchReader prefetcher(reader, 100, 0, nbuffers);
+    REQUIRE(prefetcher.stats().nblocks == 0);
+    REQUIRE(prefetcher.stats().mean_queue_depth == 0.0);
+    std::size_t nblocks = 0;
+    while (prefetcher.next()) {
+        // A slow consumer lets the I/O thread fill every free buffer
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ++nblocks;
+    }
+    const auto stats = prefetcher.stats();
+    REQUIRE(nblocks == 20);
+    REQUIRE(stats.nblocks == nblocks);
+    REQUIRE(stats.max_queue_depth >= nbuffers - 1);
+    REQUIRE(stats.max_queue_depth <= nbuffers);
+    REQUIRE(stats.mean_queue_depth >= 1.0);
+    REQUIRE(stats.mean_queue_depth <= static_cast<double>(nbuffers));
+    // The I/O thread waited on the consumer, not the other way round
+    REQUIRE(stats.producer_stall_sec > stats.consumer_stall_sec);
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,154 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "sigproc/io.hpp"
+#include "sigproc/overlap.hpp"
+#include "sigproc/parallel.hpp"
+#include "sigproc/prefetch.hpp"
+#include "sigproc/ringbuffer.hpp"
+
+namespace {
+
+std::string test_ring_name(const std::string& tag) {
+    return "shm:/sigproc_test_" + tag + "_" + std::to_string(::getpid());
+}
+
+// Header of a file as a producer would send it, without nsamples
+std::vector<uint8_t> header_blob(const SigprocHeader& hdr) {
+    const std::string filename = "test_ringbuffer.hdr";
+    hdr.tofile(filename);
+    std::ifstream stream(filename, std::ios::binary);
+    std::vector<uint8_t> blob((std::istreambuf_iterator<char>(stream)),
+                              std::istreambuf_iterator<char>());
+    std::remove(filename.c_str());
+    return blob;
+}
+
+} // namespace
+
+TEST_CASE("shm source names", "[ringbuffer]") {
+    REQUIRE(is_shm_source("shm:/beam0"));
+    REQUIRE_FALSE(is_shm_source("beam0.fil"));
+    REQUIRE(shm_name("shm:/beam0") == "/beam0");
+    REQUIRE(shm_name("shm:beam0") == "/beam0");
+}
+
+TEST_CASE("ShmRingReader streams what the writer sends", "[ringbuffer]") {
+    const std::string name = test_ring_name("stream");
+    const std::vector<uint8_t> header{'H', 'D', 'R'};
+    std::vector<uint8_t> data(10000);
+    std::iota(data.begin(), data.end(), 0);
+
+    ShmRingWriter writer(name, header, 4, 256);
+    std::vector<uint8_t> received;
+    std::vector<uint8_t> received_header;
+    std::thread consumer([&name, &received, &received_header] {
+        ShmRingReader reader(name);
+        received_header = reader.header();
+        std::vector<uint8_t> chunk(100);
+        while (const auto nread = reader.read(chunk)) {
+            received.insert(received.end(), chunk.begin(),
+                            chunk.begin() + static_cast<long>(nread));
+        }
+    });
+    // Small writes paced so the 4-slot ring is never overrun
+    for (std::size_t pos = 0; pos < data.size(); pos += 50) {
+        writer.write(std::span(data).subspan(pos, 50));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    writer.finish();
+    consumer.join();
+    REQUIRE(received_header == header);
+    REQUIRE(received == data);
+}
+
+TEST_CASE("ShmRingReader seeks back and detects overruns", "[ringbuffer]") {
+    const std::string name = test_ring_name("overrun");
+    std::vector<uint8_t> data(256 * 3);
+    std::iota(data.begin(), data.end(), 0);
+
+    ShmRingWriter writer(name, {}, 4, 256);
+    ShmRingReader reader(name);
+    writer.write(data);
+
+    std::vector<uint8_t> chunk(10);
+    reader.seek(300);
+    REQUIRE(reader.read(chunk) == 10);
+    REQUIRE(chunk[0] == static_cast<uint8_t>(300));
+    reader.seek(100);
+    REQUIRE(reader.read(chunk) == 10);
+    REQUIRE(chunk[0] == 100);
+
+    // Two more slots overwrite the first one
+    writer.write(std::vector<uint8_t>(512));
+    reader.seek(0);
+    REQUIRE_THROWS_AS(reader.read(chunk), std::runtime_error);
+    writer.finish();
+    reader.seek(256 * 5 - 5);
+    REQUIRE(reader.read(chunk) == 5);
+}
+
+TEST_CASE("FilReader reads a live ring to its end", "[ringbuffer]") {
+    const std::string name = test_ring_name("filreader");
+    const int nchans       = 4;
+    const int nsamples     = 1001;
+    SigprocHeader hdr;
+    hdr.set("nbits", 8);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    std::vector<uint8_t> data(static_cast<std::size_t>(nchans) * nsamples);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<uint8_t>((ii * 7 + ii / 5) % 256);
+    }
+    // The ring holds the whole stream, so every reader sees all of it
+    ShmRingWriter writer(name, header_blob(hdr), 8, 1024);
+    writer.write(data);
+    writer.finish();
+    const std::vector<float> expected(data.begin(), data.end());
+
+    FilReader reader(name);
+    REQUIRE(reader.is_unbounded());
+    REQUIRE(reader.hdr.get<HeaderKey::kNsamples>() == 0);
+    REQUIRE_THROWS_AS(reader.get_readplan(64), std::invalid_argument);
+
+    SECTION("prefetched gulps") {
+        std::vector<float> received;
+        PrefetchReader prefetcher(reader, 64);
+        while (auto block = prefetcher.next()) {
+            received.insert(received.end(), block->data.begin(),
+                            block->data.end());
+        }
+        REQUIRE(received == expected);
+    }
+    SECTION("overlapping blocks") {
+        int64_t nsamps = 0;
+        OverlapReader blocks(reader, 100, 10);
+        for (const auto& block : blocks) {
+            REQUIRE(std::equal(
+                block.data.begin(), block.data.end(),
+                expected.begin() + block.start_sample * nchans));
+            nsamps = block.start_sample + block.nsamps;
+        }
+        REQUIRE(nsamps == nsamples);
+    }
+    SECTION("map-reduce") {
+        MapReduceOptions opts;
+        opts.nthreads     = 4;
+        opts.gulp         = 128;
+        const auto nsamps = parallel_map_reduce(
+            {name}, 0, 0, int64_t{0}, opts,
+            [](int64_t& count, std::span<const float> /*block*/,
+               int64_t /*start_sample*/, int nread) { count += nread; },
+            [](int64_t& total, int64_t part) { total += part; });
+        REQUIRE(nsamps == nsamples);
+    }
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "sigproc/singlepulse.hpp"
+
+namespace {
+
+std::vector<float> make_noise(int nsamps, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0F, 1.0F);
+    std::vector<float> series(nsamps);
+    for (auto& value : series) {
+        value = noise(rng);
+    }
+    return series;
+}
+
+} // namespace
+
+TEST_CASE("boxcar_widths", "[singlepulse]") {
+    REQUIRE(boxcar_widths(16) == std::vector<int>{1, 2, 3, 4, 6, 8, 12, 16});
+    REQUIRE(boxcar_widths(20) ==
+            std::vector<int>{1, 2, 3, 4, 6, 8, 12, 16, 20});
+    REQUIRE(boxcar_widths(5, true) == std::vector<int>{1, 2, 3, 4, 5});
+    REQUIRE(boxcar_widths(1) == std::vector<int>{1});
+    REQUIRE_THROWS_AS(boxcar_widths(0), std::invalid_argument);
+}
+
+TEST_CASE("normalise_series removes baseline and scale", "[singlepulse]") {
+    const int nsamps = 40000;
+    auto series      = make_noise(nsamps, 3);
+    for (int t = 0; t < nsamps; ++t) {
+        series[t] = 100.0F + 0.001F * t + 5.0F * series[t];
+    }
+    // spikes hardly move the estimates
+    for (int t = 0; t < nsamps; t += 97) {
+        series[t] += 1000.0F;
+    }
+    normalise_series(series, 4096);
+    double sum   = 0.0;
+    double sumsq = 0.0;
+    int count    = 0;
+    for (int t = 0; t < nsamps; ++t) {
+        if (t % 97 != 0) {
+            sum += series[t];
+            sumsq += series[t] * series[t];
+            ++count;
+        }
+    }
+    const double mean = sum / count;
+    REQUIRE(mean == Approx(0.0).margin(0.05));
+    REQUIRE(std::sqrt(sumsq / count - mean * mean) ==
+            Approx(1.0).epsilon(0.05));
+    REQUIRE_THROWS_AS(normalise_series(series, 0), std::invalid_argument);
+}
+
+TEST_CASE("single_pulse_search finds boxcar pulses", "[singlepulse]") {
+    const int nsamps = 20000;
+    const int ndms   = 5;
+    const int start  = 1000000;
+    std::vector<float> block;
+    std::vector<double> dms;
+    for (int idm = 0; idm < ndms; ++idm) {
+        auto series = make_noise(nsamps, 20 + idm);
+        // a 12-sample pulse of S/N 3 * sqrt(12) = 10.4 in trial 2
+        if (idm == 2) {
+            for (int t = 7000; t < 7012; ++t) {
+                series[t] += 3.0F;
+            }
+        }
+        block.insert(block.end(), series.begin(), series.end());
+        dms.push_back(2.0 * idm);
+    }
+    SinglePulseOptions options;
+    options.threshold = 7.0;
+    const auto cands  = single_pulse_search(block, nsamps, nsamps - 64, dms,
+                                            start, options, 3);
+    REQUIRE(cands.size() == 1);
+    REQUIRE(cands[0].dm == 4.0F);
+    REQUIRE(cands[0].sample == Approx(start + 7000).margin(2));
+    REQUIRE(cands[0].width == 12);
+    REQUIRE(cands[0].snr == Approx(10.4).margin(1.5));
+
+    // the same with one thread
+    const auto serial = single_pulse_search(block, nsamps, nsamps - 64, dms,
+                                            start, options, 1);
+    REQUIRE(serial.size() == 1);
+    REQUIRE(serial[0].sample == cands[0].sample);
+    REQUIRE(serial[0].snr == cands[0].snr);
+
+    // starts past nsamps_out are not searched
+    const auto early =
+        single_pulse_search(block, nsamps, 6000, dms, start, options, 2);
+    REQUIRE(early.empty());
+    REQUIRE_THROWS_AS(
+        single_pulse_search(block, nsamps, nsamps + 1, dms, start, options),
+        std::invalid_argument);
+}
+
+TEST_CASE("merge_single_pulses joins split pulses", "[singlepulse]") {
+    std::vector<SinglePulseCandidate> cands{{100, 1.0F, 8, 7.0F},
+                                            {500, 1.0F, 4, 6.5F},
+                                            {104, 1.0F, 8, 9.0F},
+                                            {106, 2.0F, 8, 8.0F},
+                                            {110, 1.0F, 2, 6.2F}};
+    const auto merged = merge_single_pulses(cands);
+    REQUIRE(merged.size() == 3);
+    REQUIRE(merged[0].sample == 104);
+    REQUIRE(merged[0].snr == 9.0F);
+    REQUIRE(merged[1].sample == 500);
+    REQUIRE(merged[2].dm == 2.0F);
+    // a gap joins nearby pulses
+    REQUIRE(merge_single_pulses(cands, 400).size() == 2);
+}
@@ -0,0 +1,207 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "sigproc/io.hpp"
+#include "sigproc/stats.hpp"
+
+namespace {
+
+// 8-bit filterbank of two IFs with a different spread in every channel
+void write_data(const std::string& filename, int nchans, int nsamples) {
+    SigprocHeader hdr;
+    hdr.set("nbits", 8);
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 2);
+    hdr.set("nsamples", nsamples);
+    std::vector<float> data(static_cast<std::size_t>(2) * nchans * nsamples);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        const std::size_t ichan = ii % (2 * nchans);
+        data[ii] = static_cast<float>((ii * 37 % 101) * (ichan + 1) % 256);
+    }
+    FilterbankWriter writer(filename, hdr);
+    writer.write_block(data, static_cast<int>(data.size()));
+    writer.close();
+}
+
+void require_same(const std::vector<ChannelStats>& lhs,
+                  const std::vector<ChannelStats>& rhs) {
+    REQUIRE(lhs.size() == rhs.size());
+    for (std::size_t ii = 0; ii < lhs.size(); ++ii) {
+        REQUIRE(lhs[ii].count == rhs[ii].count);
+        REQUIRE(lhs[ii].sum == Approx(rhs[ii].sum));
+        REQUIRE(lhs[ii].sumsq == Approx(rhs[ii].sumsq));
+        REQUIRE(lhs[ii].min == rhs[ii].min);
+        REQUIRE(lhs[ii].max == rhs[ii].max);
+    }
+}
+
+} // namespace
+
+TEST_CASE("accumulate_stats summarises each channel", "[stats]") {
+    constexpr std::size_t kNchans = 100;
+    constexpr std::size_t kNsamps = 37;
+    std::vector<float> block(kNchans * kNsamps);
+    for (std::size_t ii = 0; ii < block.size(); ++ii) {
+        block[ii] = static_cast<float>((ii * 13) % 29) - 7.0F;
+    }
+    std::vector<ChannelStats> stats(kNchans);
+    accumulate_stats(block, stats);
+    for (std::size_t ichan = 0; ichan < kNchans; ++ichan) {
+        double sum   = 0;
+        double sumsq = 0;
+        float min    = block[ichan];
+        float max    = block[ichan];
+        for (std::size_t isamp = 0; isamp < kNsamps; ++isamp) {
+            const float value = block[isamp * kNchans + ichan];
+            sum += value;
+            sumsq += value * value;
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+        REQUIRE(stats[ichan].count == kNsamps);
+        REQUIRE(stats[ichan].sum == Approx(sum));
+        REQUIRE(stats[ichan].sumsq == Approx(sumsq));
+        REQUIRE(stats[ichan].min == min);
+        REQUIRE(stats[ichan].max == max);
+    }
+}
+
+TEST_CASE("ChannelStats merge matches a single pass", "[stats]") {
+    const std::vector<float> values{1, 2, 3, 4, 5, 6, 7, 8};
+    std::vector<ChannelStats> whole(1);
+    std::vector<ChannelStats> first(1);
+    std::vector<ChannelStats> second(1);
+    accumulate_stats(values, whole);
+    accumulate_stats(std::span(values).first(3), first);
+    accumulate_stats(std::span(values).subspan(3), second);
+    first[0].merge(second[0]);
+    REQUIRE(first[0].count == whole[0].count);
+    REQUIRE(first[0].sum == Approx(whole[0].sum));
+    REQUIRE(first[0].min == 1);
+    REQUIRE(first[0].max == 8);
+    REQUIRE(first[0].mean() == Approx(4.5));
+    REQUIRE(first[0].stddev() == Approx(std::sqrt(5.25)));
+}
+
+TEST_CASE("ChunkStatsIndex query matches raw statistics", "[stats]") {
+    const std::string filename = "test_stats_query.fil";
+    const int nchans           = 5;
+    // Ten chunks of 100 samples and a partial one
+    const int nsamples = 1037;
+    const int chunk    = 100;
+    write_data(filename, nchans, nsamples);
+    FilReader reader(filename);
+    const auto index = ChunkStatsIndex::build(reader, chunk);
+    REQUIRE(index.chunk_len() == chunk);
+    REQUIRE(index.stride_len() == static_cast<std::size_t>(2 * nchans));
+    REQUIRE(index.nsamples() == static_cast<std::size_t>(nsamples));
+    REQUIRE(index.nchunks() == 11);
+    REQUIRE(index.chunk(10)[0].count == 37);
+    REQUIRE_THROWS_AS(index.chunk(11), std::out_of_range);
+    REQUIRE_THROWS_AS(ChunkStatsIndex::build(reader, 0),
+                      std::invalid_argument);
+
+    // Ranges within a chunk, on and across chunk edges, and in the last
+    // partial chunk; nsamps 0 runs to the end
+    const auto [start, nsamps, nexpected] =
+        GENERATE(std::tuple<int, int, int>{0, 0, 1037},
+                 std::tuple<int, int, int>{0, 100, 100},
+                 std::tuple<int, int, int>{100, 300, 300},
+                 std::tuple<int, int, int>{10, 20, 20},
+                 std::tuple<int, int, int>{99, 2, 2},
+                 std::tuple<int, int, int>{50, 100, 100},
+                 std::tuple<int, int, int>{37, 900, 900},
+                 std::tuple<int, int, int>{150, 0, 887},
+                 std::tuple<int, int, int>{1000, 37, 37},
+                 std::tuple<int, int, int>{1036, 5000, 1},
+                 std::tuple<int, int, int>{1037, 0, 0});
+    std::vector<ChannelStats> expected(index.stride_len());
+    if (nexpected > 0) {
+        std::vector<float> block;
+        reader.read_block(start, nexpected, block);
+        accumulate_stats(block, expected);
+    }
+    // The layout of the reader does not matter
+    reader.set_layout(BlockLayout::kChannelMajor);
+    require_same(index.query(reader, start, nsamps), expected);
+    REQUIRE(reader.get_layout() == BlockLayout::kChannelMajor);
+    REQUIRE_THROWS_AS(index.query(reader, nsamples + 1), std::out_of_range);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("ChunkStatsIndex sidecar is checked against its data", "[stats]") {
+    const std::string filename = "test_stats_sidecar.fil";
+    const std::string sidecar  = ChunkStatsIndex::sidecar_name(filename);
+    const int nchans           = 4;
+    const int nsamples         = 500;
+    write_data(filename, nchans, nsamples);
+    std::remove(sidecar.c_str());
+
+    {
+        FilReader reader(filename);
+        const auto built = ChunkStatsIndex::load_or_build(sidecar, reader, 64);
+        REQUIRE(std::filesystem::exists(sidecar));
+        const auto loaded = ChunkStatsIndex::load(sidecar, reader);
+        REQUIRE(loaded.chunk_len() == 64);
+        REQUIRE(loaded.nchunks() == built.nchunks());
+        for (std::size_t ichunk = 0; ichunk < built.nchunks(); ++ichunk) {
+            const auto lhs = loaded.chunk(ichunk);
+            const auto rhs = built.chunk(ichunk);
+            require_same({lhs.begin(), lhs.end()}, {rhs.begin(), rhs.end()});
+        }
+    }
+
+    SECTION("reused while it matches") {
+        const auto stamp = std::filesystem::last_write_time(sidecar);
+        FilReader reader(filename);
+        const auto index = ChunkStatsIndex::load_or_build(sidecar, reader, 64);
+        REQUIRE(index.chunk_len() == 64);
+        REQUIRE(std::filesystem::last_write_time(sidecar) == stamp);
+    }
+    SECTION("rebuilt for another chunk length") {
+        FilReader reader(filename);
+        const auto index = ChunkStatsIndex::load_or_build(sidecar, reader, 50);
+        REQUIRE(index.chunk_len() == 50);
+        REQUIRE(index.nchunks() == 10);
+        REQUIRE(ChunkStatsIndex::load(sidecar, reader).chunk_len() == 50);
+    }
+    SECTION("stale after the data changed") {
+        SECTION("touched") {
+            std::filesystem::last_write_time(
+                filename, std::filesystem::last_write_time(filename) +
+                              std::chrono::seconds(1));
+        }
+        SECTION("grown") {
+            std::ofstream(filename, std::ios::binary | std::ios::app)
+                .write("\0\0\0\0\0\0\0\0", 8);
+        }
+        FilReader reader(filename);
+        REQUIRE_THROWS_AS(ChunkStatsIndex::load(sidecar, reader),
+                          std::runtime_error);
+        // load_or_build falls back to a fresh index
+        const auto index = ChunkStatsIndex::load_or_build(sidecar, reader, 64);
+        REQUIRE(index.nsamples() ==
+                static_cast<std::size_t>(
+                    reader.hdr.get<HeaderKey::kNsamples>()));
+        REQUIRE_NOTHROW(ChunkStatsIndex::load(sidecar, reader));
+    }
+    SECTION("not an index") {
+        FilReader reader(filename);
+        REQUIRE_THROWS_AS(ChunkStatsIndex::load(filename, reader),
+                          std::runtime_error);
+        std::filesystem::resize_file(sidecar, 100);
+        REQUIRE_THROWS_AS(ChunkStatsIndex::load(sidecar, reader),
+                          std::runtime_error);
+    }
+    std::remove(filename.c_str());
+    std::remove(sidecar.c_str());
+}
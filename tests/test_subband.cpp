@@ -0,0 +1,128 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sigproc/dedisperse.hpp"
+#include "sigproc/subband.hpp"
+
+namespace {
+
+SigprocHeader make_header(int nchans, double foff = -0.5) {
+    SigprocHeader hdr;
+    hdr.set("nchans", nchans);
+    hdr.set("nifs", 1);
+    hdr.set("fch1", 400.0);
+    hdr.set("foff", foff);
+    hdr.set("tsamp", 1e-3);
+    return hdr.new_header(std::map<std::string, int>{{"nbits", 8}});
+}
+
+} // namespace
+
+TEST_CASE("SubbandDedisperser chooses the subbands", "[subband]") {
+    const auto hdr = make_header(256);
+    const DMPlan plan(hdr, DMPlan::generate_dm_list(hdr, 0.0, 200.0));
+    const SubbandDedisperser subband(plan);
+    REQUIRE(256 % subband.nsub() == 0);
+    REQUIRE(subband.nsub() > 1);
+    REQUIRE(subband.nsub() < 256);
+    REQUIRE(subband.coarse_dms().size() < plan.ndms());
+    REQUIRE(subband.ndms() == plan.ndms());
+    REQUIRE(subband.speedup() > 2.0);
+    REQUIRE(subband.max_delay() >= plan.max_delay());
+
+    // a looser budget needs fewer coarse DMs
+    const SubbandDedisperser loose(plan, 4.0, subband.nsub());
+    REQUIRE(loose.nsub() == subband.nsub());
+    REQUIRE(loose.coarse_dms().size() < subband.coarse_dms().size());
+    REQUIRE_THROWS_AS(SubbandDedisperser(plan, 1.0, 3), std::invalid_argument);
+    REQUIRE_THROWS_AS(SubbandDedisperser(plan, 0.0), std::invalid_argument);
+}
+
+TEST_CASE("SubbandDedisperser matches brute force", "[subband]") {
+    const int nchans = 128;
+    const int nsamps = 4096;
+    const int t0     = 500;
+    // descending and ascending bands
+    const double foff = GENERATE(-0.5, 0.5);
+    const auto hdr    = make_header(nchans, foff);
+    const auto dms   = DMPlan::generate_dm_list(hdr, 0.0, 100.0);
+    const DMPlan plan(hdr, dms);
+    SubbandDedisperser subband(plan);
+
+    // Noise-free pulse of a few samples, wider than the smearing budget
+    const std::size_t itrue = dms.size() / 2;
+    std::vector<float> in(static_cast<std::size_t>(nchans) * nsamps, 0.0F);
+    const auto delays = plan.delays(itrue);
+    for (int ichan = 0; ichan < nchans; ++ichan) {
+        for (int t = 0; t < 4; ++t) {
+            in[ichan * nsamps + t0 + delays[ichan] + t] = 1.0F;
+        }
+    }
+
+    const int nout_brute = nsamps - plan.max_delay();
+    const int nout_sub   = nsamps - subband.max_delay();
+    std::vector<float> brute(plan.ndms() * nout_brute);
+    std::vector<float> fast(subband.ndms() * nout_sub);
+    dedisperse_brute(plan, in, nsamps, 1, brute);
+    subband.execute(in, nsamps, 1, fast);
+
+    const auto peak = std::ranges::max_element(fast) - fast.begin();
+    REQUIRE(static_cast<std::size_t>(peak / nout_sub) == itrue);
+    REQUIRE(std::abs(static_cast<int>(peak % nout_sub) - t0) <= 3);
+    // the smearing budget keeps most of the pulse
+    REQUIRE(brute[itrue * nout_brute + t0] == static_cast<float>(nchans));
+    REQUIRE(fast[peak] >= 0.9F * nchans);
+}
+
+TEST_CASE("dedisperse_stream runs the subband engine", "[subband]") {
+    const std::string filename = "test_subband.fil";
+    const int nchans           = 64;
+    const int nsamps           = 3000;
+    auto hdr                   = make_header(nchans);
+    hdr.set("nsamples", nsamps);
+    std::vector<float> data(static_cast<std::size_t>(nchans) * nsamps);
+    for (std::size_t ii = 0; ii < data.size(); ++ii) {
+        data[ii] = static_cast<float>((ii * 31 + ii / 7) % 256);
+    }
+    {
+        FilterbankWriter writer(filename, hdr);
+        writer.write_block(data, static_cast<int>(data.size()));
+        writer.close();
+    }
+    const DMPlan plan(hdr, DMPlan::generate_dm_list(hdr, 0.0, 50.0));
+    const DedispersionOptions options{DedispersionEngine::kSubband, 1.0, 8};
+    const int overlap = dedispersion_overlap(plan, options);
+    SubbandDedisperser subband(plan, 1.0, 8);
+    REQUIRE(overlap == subband.max_delay());
+
+    // one block of everything
+    std::vector<float> turned(data.size());
+    for (int t = 0; t < nsamps; ++t) {
+        for (int ichan = 0; ichan < nchans; ++ichan) {
+            turned[ichan * nsamps + t] = data[t * nchans + ichan];
+        }
+    }
+    const int nsamps_out = nsamps - overlap;
+    std::vector<float> expected(plan.ndms() * nsamps_out);
+    subband.execute(turned, nsamps, 1, expected);
+
+    FilReader reader(filename);
+    std::vector<float> out(expected.size(), -1.0F);
+    const int64_t ndone = dedisperse_stream(
+        reader, plan, 512,
+        [&](std::span<const float> block, int64_t start_sample, int nout) {
+            for (std::size_t idm = 0; idm < plan.ndms(); ++idm) {
+                std::copy_n(block.begin() + idm * nout, nout,
+                            out.begin() + idm * nsamps_out + start_sample);
+            }
+        },
+        0, 0, options);
+    REQUIRE(ndone == nsamps_out);
+    REQUIRE(out == expected);
+    std::remove(filename.c_str());
+}